@@ -1,16 +1,195 @@
+/*
+  Coprocesador de adquisición (núcleo M4)
+
+  El M4 es dueño del timer y de los sensores. En cada tick lee los sensores
+  activos, marca cada muestra con el micros() capturado en la interrupción y la
+  publica en el ring compartido de SRAM4 (ver Testing/src/shared.h). El M7 solo
+  consume muestras y configura frecuencia/sensores por el buzón de control, así
+  que el jitter de adquisición no depende de lo que esté haciendo el M7.
+
+  Los sensores, buses y etapas salen del perfil de placa elegido con
+  BOARD_PROFILE (Testing/src/board_profiles.h): el tick de adquisición se
+  genera en compilación para ese perfil. En los perfiles ACQUIRE_CONCURRENT
+  las lecturas de buses I2C distintos se solapan.
+
+  Después de cada tick copia al bloque compartido el tiempo de bus medido por
+  sensor; el M7 lo reporta como ocupación ("#BUS ...").
+*/
+
+// Perfil de placa: ProfileSuction, ProfileSuctionRedundant, ProfileMultiPoint, ProfileSlowMonitor,
+// ProfileMultiPointSplit
+#define BOARD_PROFILE ProfileSuctionRedundant
+
 #include <Arduino.h>
+#include "shared.h"
+#include "board_profiles.h"
+#include "board_io.h"
+
+#define _TIMERINTERRUPT_LOGLEVEL_     0
+#include "Portenta_H7_TimerInterrupt.h"
+
+// Instancia del bus I2C3 para este binario (en el M7 está en dev_i2c.cpp)
+TwoWire dev_i2c(I2C3_SDA, I2C3_SCL);
+
+#define DEFAULT_PERIOD_US   BOARD_PROFILE::periodUs()
+#define MIN_PERIOD_US(mask) BOARD_PROFILE::minPeriodUs(mask)   // Con los sensores activos
+#define DEFAULT_SENSOR_MASK (1u << SENSOR_SM4291_I2C)
+#define SUPPORTED_SENSORS   BOARD_PROFILE::sensorMask()
+
+static_assert((DEFAULT_SENSOR_MASK & ~SUPPORTED_SENSORS) == 0, "el perfil no incluye los sensores por defecto");
+
+// Publica en el ring las muestras que deja pasar el perfil
+struct IpcSink {
+  void publish(const IpcSample& sample);
+};
+
+Portenta_H7_Timer ITimer(TIM12);
+
+volatile bool tickPending = false;
+volatile uint32_t tickTimestampUs = 0;
+
+IpcShared* ipc = nullptr;
+uint32_t periodUs = DEFAULT_PERIOD_US;
+uint32_t sensorMask = DEFAULT_SENSOR_MASK;
+bool running = false;
+uint16_t sequence = 0;
+uint32_t lastTickUs = 0;
+
+DeviceSource source;
+IpcSink sink;
+ProfileRunner<BOARD_PROFILE, DeviceSource, IpcSink> runner(source, sink);
+
+// Recuperación del bus I2C cuando un sensor I2C deja de responder
+#define BUS_RECOVERY_ERRORS     10
+#define BUS_RECOVERY_INTERVAL   200     // Ticks entre intentos
+uint32_t busErrorRun = 0;
+uint32_t ticksSinceRecovery = BUS_RECOVERY_INTERVAL;
+
+void TimerHandler() {
+  tickTimestampUs = micros();
+  tickPending = true;
+}
 
+void IpcSink::publish(const IpcSample& sample) {
+  ipcPushSample(ipc, sample);
+}
+
+void acquire(uint32_t timestampUs) {
+  uint32_t errors = runner.tick(timestampUs, sequence, sensorMask);
+  if (sensorMask & BOARD_PROFILE::i2cMask()) {
+    busErrorRun = (errors & BOARD_PROFILE::i2cMask()) ? busErrorRun + 1 : 0;
+  }
+}
+
+// Ocupación de los buses I2C por sensor (acumulada; el M7 calcula diferencias)
+void publishBusStats() {
+  for (uint8_t id = 0; id < SENSOR_COUNT; id++) {
+    if (!(BOARD_PROFILE::i2cMask() & (1u << id))) continue;
+    ipc->busBusyUs[id] = source.busyUs(id);
+    ipc->busReads[id] = source.reads(id);
+  }
+}
+
+bool applyPeriod(uint32_t newPeriodUs) {
+  if (newPeriodUs < MIN_PERIOD_US(sensorMask)) return false;
+  periodUs = newPeriodUs;
+  ipc->periodUs = periodUs;
+  if (running) {
+    ITimer.setInterval(periodUs, TimerHandler);
+  }
+  return true;
+}
+
+void handleCommands() {
+  IpcCommand cmd;
+  uint32_t arg;
+  if (!ipcPollCommand(ipc, &cmd, &arg)) return;
+
+  int32_t result = 0;
+  switch (cmd) {
+    case IPC_CMD_SET_PERIOD_US:
+      if (!applyPeriod(arg)) result = -1;
+      break;
+    case IPC_CMD_SET_SENSORS:
+      // Sensores fuera del perfil, o más lecturas de las que entran en el periodo
+      if ((arg & ~SUPPORTED_SENSORS) || periodUs < MIN_PERIOD_US(arg)) {
+        result = -1;
+      } else {
+        sensorMask = arg;
+        ipc->sensorMask = sensorMask;
+      }
+      break;
+    case IPC_CMD_START:
+      if (!running) {
+        running = ITimer.attachInterruptInterval(periodUs, TimerHandler);
+        lastTickUs = 0;
+        if (!running) result = -1;
+      }
+      break;
+    case IPC_CMD_STOP:
+      if (running) {
+        ITimer.stopTimer();
+        running = false;
+      }
+      break;
+    default:
+      result = -1;
+      break;
+  }
+  ipcAckCommand(ipc, result);
+}
 
 void setup() {
-  //  pinMode(LEDB, OUTPUT);
-//    digitalWrite(LEDB, HIGH);
+  ipc = ipcShared();
+
+  // Esperar a que el M7 de este arranque responda al saludo: un magic que
+  // quedó en SRAM4 de un arranque anterior no alcanza para tomar los buses
+  uint32_t hello = ipcHello(ipc);
+  while (!ipcWelcomed(ipc, hello)) {
+    delay(1);
+  }
+
+  source.begin<BOARD_PROFILE::mode()>(BOARD_PROFILE::SensorTypeList());
+  ipc->periodUs = periodUs;
+  ipc->busMap = BOARD_PROFILE::i2cBusMap();
+  ipc->sensorMask = sensorMask;
 }
 
-bool ledState = false;
 void loop() {
-    //    ledState = !ledState;
-   // digitalWrite(LEDB, ledState ? HIGH : LOW);
+  handleCommands();
 
-  delay(1000);
-}
+  if (tickPending) {
+    tickPending = false;
+    uint32_t timestampUs = tickTimestampUs;
 
+    // Jitter respecto del periodo nominal
+    if (lastTickUs != 0) {
+      int32_t jitter = (int32_t)(timestampUs - lastTickUs) - (int32_t)periodUs;
+      uint32_t absJitter = jitter < 0 ? -jitter : jitter;
+      if (absJitter > ipc->maxJitterUs) ipc->maxJitterUs = absJitter;
+    }
+    lastTickUs = timestampUs;
+
+    acquire(timestampUs);
+    publishBusStats();
+    sequence++;
+    ipc->ticks = ipc->ticks + 1;
+
+    // Después de publicar el tick, así la recuperación no atrasa la muestra
+    if (ticksSinceRecovery < BUS_RECOVERY_INTERVAL) ticksSinceRecovery++;
+    if (busErrorRun >= BUS_RECOVERY_ERRORS && ticksSinceRecovery >= BUS_RECOVERY_INTERVAL) {
+      devI2cRecover();
+      ticksSinceRecovery = 0;
+    }
+  }
+
+  // Dormir hasta la próxima interrupción (timer o SysTick, que revisa comandos).
+  // WFI despierta aunque las interrupciones estén deshabilitadas, así que un
+  // tick que llegue justo después de la comprobación no se pierde.
+  __disable_irq();
+  if (!tickPending) {
+    __DSB();
+    __WFI();
+  }
+  __enable_irq();
+}
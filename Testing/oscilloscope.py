@@ -2,12 +2,14 @@
 """
 Osciloscopio PyQt5 para datos del sensor SM4291
 Visualiza datos en tiempo real desde COM9
+
+Decodificación, historial y frecuencia usan los kernels del firmware de
+sensor_core.py (hay que compilar tools/sensor_core.cpp, ver ese módulo).
 """
 
 import sys
 import serial
 import numpy as np
-from collections import deque
 from PyQt5.QtWidgets import (QApplication, QMainWindow, QVBoxLayout, QHBoxLayout, 
                             QWidget, QPushButton, QComboBox, QLabel, QSpinBox,
                             QCheckBox, QGroupBox, QGridLayout, QSlider)
@@ -15,10 +17,14 @@ from PyQt5.QtCore import QTimer, QThread, pyqtSignal, Qt
 from PyQt5.QtGui import QFont
 import pyqtgraph as pg
 import time
+from time_sync import ClockSync
+from sensor_core import StreamDecoder, HistoryRing, FLAG_TIMED
+
+SYNC_INTERVAL_S = 1.0  # Periodo de los pings de sincronización
 
 class SerialOscilloscope(QThread):
     """Thread para leer datos del puerto serie"""
-    new_data_point = pyqtSignal(float, float)  # timestamp, value
+    new_data_block = pyqtSignal(object, object, float)  # timestamps, valores, frecuencia
     status_update = pyqtSignal(str)
     
     def __init__(self):
@@ -28,6 +34,11 @@ class SerialOscilloscope(QThread):
         self.port_name = "COM9"
         self.baud_rate = 2000000
         self.start_time = time.time()
+        self.clock_sync = ClockSync()
+        self.decoder = StreamDecoder()
+        self.sync_seq = 0
+        self.sync_pending = {}  # seq -> tiempo de envío en el host
+        self.last_sync = 0.0
         
     def set_port(self, port_name, baud_rate):
         """Configurar puerto serie"""
@@ -39,6 +50,9 @@ class SerialOscilloscope(QThread):
         try:
             self.serial_port = serial.Serial(self.port_name, self.baud_rate, timeout=0.1)
             self.start_time = time.time()
+            self.clock_sync = ClockSync()
+            self.decoder = StreamDecoder()
+            self.sync_pending.clear()
             self.status_update.emit(f"Conectado a {self.port_name}")
             return True
         except Exception as e:
@@ -62,23 +76,56 @@ class SerialOscilloscope(QThread):
         self.running = False
         self.disconnect_serial()
         
+    def send_sync(self):
+        """Enviar un ping de sincronización de reloj"""
+        self.sync_seq += 1
+        # Olvidar pings sin respuesta para que el diccionario no crezca
+        for seq in [s for s in self.sync_pending if s < self.sync_seq - 16]:
+            del self.sync_pending[seq]
+        self.sync_pending[self.sync_seq] = time.time()
+        self.serial_port.write(f"SYNC {self.sync_seq}\n".encode('ascii'))
+        self.last_sync = time.time()
+
+    def handle_sync(self, line, recv_time):
+        """Procesar respuesta '#SYNC <seq> <micros>'"""
+        parts = line.split()
+        if len(parts) != 3:
+            return
+        send_time = self.sync_pending.pop(int(parts[1]), None)
+        if send_time is not None:
+            self.clock_sync.add_exchange(send_time, int(parts[2]), recv_time)
+
     def run(self):
         """Loop principal del thread"""
         while self.running and self.serial_port and self.serial_port.is_open:
             try:
-                line = self.serial_port.readline().decode('utf-8').strip()
-                
-                if line and not line.startswith("=") and not line.startswith("Timer"):
-                    try:
-                        # Intentar convertir a float (datos del sensor)
-                        value = float(line)
-                        timestamp = time.time() - self.start_time
-                        self.new_data_point.emit(timestamp, value)
-                    except ValueError:
-                        # Ignorar líneas que no son números
-                        if "ERROR" not in line:
-                            pass
-                        
+                if time.time() - self.last_sync >= SYNC_INTERVAL_S:
+                    self.send_sync()
+
+                # Todo lo que haya llegado (o hasta el timeout por un byte): el
+                # decodificador del firmware arma los renglones en C++
+                chunk = self.serial_port.read(self.serial_port.in_waiting or 1)
+                if not chunk:
+                    continue
+                recv_time = time.time()
+                us, values, flags, meta = self.decoder.feed(chunk)
+
+                for line in meta:
+                    if line.startswith("#SYNC"):
+                        self.handle_sync(line, recv_time)
+
+                if len(values) == 0:
+                    continue
+                # Formato "<micros> <valor>"; los renglones con solo "<valor>"
+                # (o antes de la primera sincronización) usan la hora de llegada
+                timestamps = np.full(len(values), recv_time)
+                timed = (flags & FLAG_TIMED) != 0
+                if timed.any():
+                    host_times = self.clock_sync.to_host_array(us[timed])
+                    if host_times is not None:
+                        timestamps[timed] = host_times
+                self.new_data_block.emit(timestamps - self.start_time, values, self.decoder.rate_hz)
+
             except Exception as e:
                 self.status_update.emit(f"Error leyendo: {str(e)}")
                 break
@@ -95,8 +142,7 @@ class OscilloscopeWindow(QMainWindow):
         
         # Variables para datos
         self.max_points = 10000  # Máximo 10000 puntos en pantalla
-        self.time_data = deque(maxlen=self.max_points)
-        self.value_data = deque(maxlen=self.max_points)
+        self.history = HistoryRing(self.max_points)
         
         # Variables de control
         self.is_running = False
@@ -109,7 +155,7 @@ class OscilloscopeWindow(QMainWindow):
         
         # Configurar serial reader
         self.serial_reader = SerialOscilloscope()
-        self.serial_reader.new_data_point.connect(self.add_data_point)
+        self.serial_reader.new_data_block.connect(self.add_data_block)
         self.serial_reader.status_update.connect(self.update_status)
         
         # Timer para actualizar gráficos
@@ -251,8 +297,7 @@ class OscilloscopeWindow(QMainWindow):
     
     def clear_data(self):
         """Limpiar todos los datos"""
-        self.time_data.clear()
-        self.value_data.clear()
+        self.history.clear()
         self.data_curve.setData([], [])
     
     def update_status(self, message):
@@ -265,43 +310,30 @@ class OscilloscopeWindow(QMainWindow):
         else:
             self.status_label.setStyleSheet("color: blue; font-weight: bold;")
     
-    def add_data_point(self, timestamp, value):
-        """Agregar nuevo punto de datos"""
-        self.time_data.append(timestamp)
-        self.value_data.append(value)
+    def add_data_block(self, timestamps, values, rate_hz):
+        """Agregar un bloque de muestras"""
+        self.history.push(timestamps, values)
         
         # Actualizar valor actual
-        self.current_value_label.setText(f"{value:.3f}")
-        
-        # Calcular frecuencia aproximada
-        if len(self.time_data) > 100:
-            time_diff = self.time_data[-1] - self.time_data[-100]
-            if time_diff > 0:
-                freq = 99 / time_diff  # 99 muestras en time_diff segundos
-                self.frequency_label.setText(f"{freq:.1f} Hz")
+        self.current_value_label.setText(f"{values[-1]:.3f}")
+        
+        # Frecuencia según los timestamps del dispositivo
+        if rate_hz > 0:
+            self.frequency_label.setText(f"{rate_hz:.1f} Hz")
     
     def update_plot(self):
         """Actualizar el gráfico"""
-        if len(self.time_data) == 0:
+        if len(self.history) == 0:
             return
         
-        # Convertir a arrays numpy para mejor rendimiento
-        times = np.array(self.time_data)
-        values = np.array(self.value_data)
-        
-        # Aplicar ventana de tiempo
+        # Aplicar ventana de tiempo (vistas sobre el historial, sin copiar)
         time_window = self.time_window_spin.value()
-        if len(times) > 0:
-            current_time = times[-1]
-            mask = times >= (current_time - time_window)
-            times_windowed = times[mask]
-            values_windowed = values[mask]
-        else:
-            times_windowed = times
-            values_windowed = values
+        current_time = self.history.times()[-1]
+        times_windowed, values_windowed = self.history.window(current_time - time_window)
         
-        # Actualizar datos del gráfico
-        self.data_curve.setData(times_windowed, values_windowed)
+        # Actualizar datos del gráfico. pyqtgraph guarda los arreglos y las
+        # vistas cambian con el próximo bloque, así que se le pasa una copia
+        self.data_curve.setData(times_windowed.copy(), values_windowed.copy())
         
         # Auto escala
         if self.auto_scale and len(values_windowed) > 0:
@@ -0,0 +1,395 @@
+#!/usr/bin/env python3
+"""
+Cliente del protocolo binario de comandos del Portenta H7 (ver src/cmd_protocol.h)
+
+Uso como librería:
+    with PortentaLink("COM9") as link:
+        link.set_period(1000)
+        print(link.get_stats())
+
+El puerto puede ser un dispositivo serie o una URL de pyserial; por TCP hace
+falta un puente serie <-> TCP en la máquina conectada a la placa (ser2net o
+similar), porque el firmware solo atiende comandos por el puerto serie USB:
+    python portenta_cmd.py socket://192.168.1.20:4000 stats
+
+Uso como CLI:
+    python portenta_cmd.py COM9 set-period 1000
+    python portenta_cmd.py COM9 set-thresholds -40 -180
+    python portenta_cmd.py COM9 set-setpoint -200
+    python portenta_cmd.py COM9 stats
+    python portenta_cmd.py COM9 download-log captura.csv
+    python portenta_cmd.py COM9 cycle-learn 0
+"""
+
+import argparse
+import struct
+import sys
+import time
+import zlib
+
+SYNC0 = 0xA5
+SYNC1 = 0x5A
+RESPONSE_FLAG = 0x80
+MAX_PAYLOAD = 32
+
+CMD_PING = 0x01
+CMD_GET_CONFIG = 0x02
+CMD_SET_PERIOD = 0x10
+CMD_SET_SENSORS = 0x11
+CMD_SET_WINDOW = 0x12
+CMD_SET_THRESHOLDS = 0x13
+CMD_SET_FILTER = 0x14
+CMD_SET_KURTOSIS = 0x15
+CMD_SET_SETPOINT = 0x16
+CMD_SET_PID = 0x17
+CMD_GET_STATS = 0x20
+CMD_STREAM_START = 0x30
+CMD_STREAM_STOP = 0x31
+CMD_LOG_INFO = 0x40
+CMD_LOG_READ = 0x41
+CMD_LOG_DATA = 0x42
+CMD_LOG_READ_MAX = 64
+CMD_CYCLE_LEARN = 0x50
+CMD_CYCLE_CLEAR_ALL = 0xFF
+
+# Log circular en flash (ver src/flash_log.h)
+LOG_BLOCK_MAGIC = 0x4C4F4731
+LOG_HEADER = struct.Struct("<IIIIiHHI")
+LOG_VALUE_SCALE = 1000.0
+
+STATUS_NAMES = {0: "OK", 1: "comando desconocido", 2: "longitud incorrecta", 3: "fuera de rango",
+                4: "no disponible en este firmware", 5: "sin respuesta del M4"}
+
+SENSORS = {"sm4291": 0, "sm4291_analog": 1, "elvh": 2, "abplln": 3, "sscdann": 4}
+
+
+def crc8(data, crc=0):
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+def encode_frame(cmd, payload=b""):
+    if len(payload) > MAX_PAYLOAD:
+        raise ValueError("payload demasiado largo")
+    body = bytes([cmd, len(payload)]) + payload
+    return bytes([SYNC0, SYNC1]) + body + bytes([crc8(body)])
+
+
+class CommandError(Exception):
+    pass
+
+
+def decode_log_block(block):
+    """Devuelve (seq, [(timestamp_us, mbar), ...]) o None si el bloque no es válido"""
+    magic, seq, first_ts, period, value, count, length, crc = LOG_HEADER.unpack_from(block)
+    if magic != LOG_BLOCK_MAGIC or length > len(block) - LOG_HEADER.size:
+        return None
+    header = LOG_HEADER.pack(magic, seq, first_ts, period, value, count, length, 0)
+    payload = block[LOG_HEADER.size:LOG_HEADER.size + length]
+    if zlib.crc32(payload, zlib.crc32(header)) != crc:
+        return None
+
+    samples = [(first_ts, value / LOG_VALUE_SCALE)]
+    pos = 0
+    for i in range(1, count):
+        zz, shift = 0, 0
+        while True:
+            b = payload[pos]
+            pos += 1
+            zz |= (b & 0x7F) << shift
+            shift += 7
+            if not b & 0x80:
+                break
+        value += (zz >> 1) ^ -(zz & 1)
+        samples.append(((first_ts + i * period) & 0xFFFFFFFF, value / LOG_VALUE_SCALE))
+    return seq, samples
+
+
+class FrameReader:
+    """Separa tramas binarias y líneas de texto de un flujo de bytes mezclado"""
+
+    def __init__(self):
+        self.buffer = bytearray()
+
+    def feed(self, data):
+        """Devuelve (tramas, líneas) completas; tramas como (cmd, payload)"""
+        self.buffer.extend(data)
+        frames, lines = [], []
+        while self.buffer:
+            if self.buffer[0] == SYNC0:
+                if len(self.buffer) < 4:
+                    break
+                if self.buffer[1] != SYNC1 or self.buffer[3] > MAX_PAYLOAD:
+                    del self.buffer[0]
+                    continue
+                total = self.buffer[3] + 5
+                if len(self.buffer) < total:
+                    break
+                body = bytes(self.buffer[2:total - 1])
+                if crc8(body) == self.buffer[total - 1]:
+                    frames.append((body[0], body[2:]))
+                    del self.buffer[:total]
+                else:
+                    del self.buffer[0]
+                continue
+            end = self.buffer.find(b"\n")
+            sync = self.buffer.find(bytes([SYNC0]))
+            if end < 0 or (0 <= sync < end):
+                if sync > 0:
+                    # Texto parcial interrumpido por una trama: se descarta
+                    del self.buffer[:sync]
+                    continue
+                break
+            lines.append(self.buffer[:end].decode("utf-8", "replace").strip())
+            del self.buffer[:end + 1]
+        return frames, lines
+
+
+class PortentaLink:
+    def __init__(self, port, baud_rate=115200, timeout=1.0, transport=None):
+        """transport: objeto con write(), read(n) e in_waiting en lugar del puerto
+        (lo usa tools/cmd_check.py con el dispositivo nativo)"""
+        if transport is None:
+            import serial
+            transport = serial.serial_for_url(port, baud_rate, timeout=0.05)
+        self.serial = transport
+        self.timeout = timeout
+        self.reader = FrameReader()
+        self.lines = []  # Líneas de texto recibidas mientras se esperaba una respuesta
+
+    def close(self):
+        self.serial.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def request(self, cmd, payload=b""):
+        """Envía un comando y devuelve el payload de la respuesta (sin el estado)"""
+        self.serial.write(encode_frame(cmd, payload))
+        deadline = time.time() + self.timeout
+        while time.time() < deadline:
+            frames, lines = self.reader.feed(self.serial.read(self.serial.in_waiting or 1))
+            self.lines.extend(lines)
+            for rcmd, rpayload in frames:
+                if rcmd == cmd | RESPONSE_FLAG:
+                    status = rpayload[0]
+                    if status != 0:
+                        raise CommandError(STATUS_NAMES.get(status, f"estado {status}"))
+                    return rpayload[1:]
+        raise CommandError("sin respuesta del dispositivo")
+
+    def request_bulk(self, cmd, payload, nbytes):
+        """Comando cuya respuesta OK va seguida de nbytes de datos en tramas
+        CMD_LOG_DATA (u16 posición + trozo), mezcladas con el texto"""
+        self.serial.write(encode_frame(cmd, payload))
+        data = bytearray(nbytes)
+        received = 0
+        accepted = False
+        deadline = time.time() + self.timeout
+        while time.time() < deadline:
+            frames, lines = self.reader.feed(self.serial.read(self.serial.in_waiting or 1))
+            self.lines.extend(lines)
+            for rcmd, rpayload in frames:
+                if rcmd == cmd | RESPONSE_FLAG:
+                    status = rpayload[0]
+                    if status != 0:
+                        raise CommandError(STATUS_NAMES.get(status, f"estado {status}"))
+                    accepted = True
+                elif rcmd == CMD_LOG_DATA | RESPONSE_FLAG and accepted and len(rpayload) > 3:
+                    offset = struct.unpack_from("<H", rpayload, 1)[0]
+                    chunk = rpayload[3:]
+                    if offset != received or offset + len(chunk) > nbytes:
+                        raise CommandError("descarga con huecos")
+                    data[offset:offset + len(chunk)] = chunk
+                    received += len(chunk)
+                    deadline = time.time() + self.timeout
+            if received == nbytes:
+                return bytes(data)
+        raise CommandError("sin respuesta del dispositivo" if not accepted else "descarga incompleta")
+
+    def ping(self):
+        self.request(CMD_PING)
+
+    def set_period(self, period_us):
+        self.request(CMD_SET_PERIOD, struct.pack("<I", period_us))
+
+    def set_rate(self, rate_hz):
+        self.set_period(int(round(1e6 / rate_hz)))
+
+    def set_sensors(self, names):
+        mask = 0
+        for name in names:
+            mask |= 1 << SENSORS[name]
+        self.request(CMD_SET_SENSORS, struct.pack("<I", mask))
+
+    def set_window(self, length):
+        """Tamaño de la ventana de curtosis. El firmware todavía no la usa en el
+        procesamiento y responde "no disponible en este firmware" (igual que
+        set_kurtosis).
+        """
+        self.request(CMD_SET_WINDOW, struct.pack("<H", length))
+
+    def set_thresholds(self, low_max, medium_max):
+        self.request(CMD_SET_THRESHOLDS, struct.pack("<ff", low_max, medium_max))
+
+    def set_filter(self, alpha):
+        self.request(CMD_SET_FILTER, struct.pack("<f", alpha))
+
+    def set_kurtosis(self, low, high):
+        self.request(CMD_SET_KURTOSIS, struct.pack("<ff", low, high))
+
+    def set_setpoint(self, mbar):
+        """Consigna del control de succión en mbar (negativa); 0 lo apaga. Solo con
+        ENABLE_CONTROL; si no, el error es "no disponible en este firmware".
+        """
+        self.request(CMD_SET_SETPOINT, struct.pack("<f", mbar))
+
+    def set_pid(self, kp, ki, kd, kff):
+        self.request(CMD_SET_PID, struct.pack("<ffff", kp, ki, kd, kff))
+
+    def start_stream(self):
+        self.request(CMD_STREAM_START)
+
+    def stop_stream(self):
+        self.request(CMD_STREAM_STOP)
+
+    def get_config(self):
+        values = struct.unpack("<IIHBfffff", self.request(CMD_GET_CONFIG))
+        keys = ("period_us", "sensor_mask", "window_length", "streaming",
+                "suction_low_max", "suction_medium_max", "filter_alpha",
+                "kurtosis_low", "kurtosis_high")
+        return dict(zip(keys, values))
+
+    def get_stats(self):
+        values = struct.unpack("<IIIIIIf", self.request(CMD_GET_STATS))
+        keys = ("readings", "errors", "consecutive_errors", "config_changes",
+                "dropped", "uptime_ms", "last_value")
+        return dict(zip(keys, values))
+
+
+    def log_info(self):
+        oldest, newest, capacity, block_size = struct.unpack("<IIIH", self.request(CMD_LOG_INFO))
+        return {"oldest": oldest, "newest": newest, "capacity": capacity, "block_size": block_size}
+
+    def download_log(self, first=None, last=None):
+        """Descarga el log en tandas de CMD_LOG_READ_MAX bloques; devuelve las muestras"""
+        info = self.log_info()
+        first = info["oldest"] if first is None else first
+        last = info["newest"] if last is None else last
+        samples = []
+        seq = first
+        while seq <= last:
+            count = min(CMD_LOG_READ_MAX, last - seq + 1)
+            data = self.request_bulk(CMD_LOG_READ, struct.pack("<IH", seq, count),
+                                     count * info["block_size"])
+            for i in range(count):
+                block = decode_log_block(data[i * info["block_size"]:(i + 1) * info["block_size"]])
+                if block is not None:
+                    samples.extend(block[1])
+            seq += count
+        return samples
+
+    def learn_cycle(self, slot):
+        """Guarda la forma del último ciclo (línea "#C") como plantilla 'slot'"""
+        self.request(CMD_CYCLE_LEARN, struct.pack("<B", slot))
+
+    def clear_cycle_templates(self):
+        self.request(CMD_CYCLE_LEARN, struct.pack("<B", CMD_CYCLE_CLEAR_ALL))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Configuración del Portenta H7 en tiempo de ejecución")
+    parser.add_argument("port")
+    parser.add_argument("--baud", type=int, default=115200)
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    sub.add_parser("ping")
+    sub.add_parser("config")
+    sub.add_parser("stats")
+    sub.add_parser("start")
+    sub.add_parser("stop")
+    sub.add_parser("set-period").add_argument("period_us", type=int)
+    sub.add_parser("set-rate").add_argument("rate_hz", type=float)
+    sub.add_parser("set-sensors").add_argument("names", nargs="+", choices=sorted(SENSORS))
+    sub.add_parser("set-window").add_argument("length", type=int)
+    p = sub.add_parser("set-thresholds")
+    p.add_argument("low_max", type=float)
+    p.add_argument("medium_max", type=float)
+    sub.add_parser("set-filter").add_argument("alpha", type=float)
+    p = sub.add_parser("set-kurtosis")
+    p.add_argument("low", type=float)
+    p.add_argument("high", type=float)
+    sub.add_parser("set-setpoint").add_argument("mbar", type=float)
+    p = sub.add_parser("set-pid")
+    p.add_argument("kp", type=float)
+    p.add_argument("ki", type=float)
+    p.add_argument("kd", type=float)
+    p.add_argument("kff", type=float)
+    sub.add_parser("log-info")
+    sub.add_parser("download-log").add_argument("output", help="archivo CSV de salida")
+    sub.add_parser("cycle-learn").add_argument("slot", type=int, help="plantilla (0-3)")
+    sub.add_parser("cycle-clear")
+
+    args = parser.parse_args()
+
+    try:
+        with PortentaLink(args.port, args.baud) as link:
+            if args.command == "ping":
+                link.ping()
+                print("OK")
+            elif args.command == "config":
+                for key, value in link.get_config().items():
+                    print(f"{key}: {value}")
+            elif args.command == "stats":
+                for key, value in link.get_stats().items():
+                    print(f"{key}: {value}")
+            elif args.command == "start":
+                link.start_stream()
+            elif args.command == "stop":
+                link.stop_stream()
+            elif args.command == "set-period":
+                link.set_period(args.period_us)
+            elif args.command == "set-rate":
+                link.set_rate(args.rate_hz)
+            elif args.command == "set-sensors":
+                link.set_sensors(args.names)
+            elif args.command == "set-window":
+                link.set_window(args.length)
+            elif args.command == "set-thresholds":
+                link.set_thresholds(args.low_max, args.medium_max)
+            elif args.command == "set-filter":
+                link.set_filter(args.alpha)
+            elif args.command == "set-kurtosis":
+                link.set_kurtosis(args.low, args.high)
+            elif args.command == "set-setpoint":
+                link.set_setpoint(args.mbar)
+            elif args.command == "set-pid":
+                link.set_pid(args.kp, args.ki, args.kd, args.kff)
+            elif args.command == "log-info":
+                for key, value in link.log_info().items():
+                    print(f"{key}: {value}")
+            elif args.command == "download-log":
+                samples = link.download_log()
+                with open(args.output, "w") as f:
+                    f.write("timestamp_us,mbar\n")
+                    for timestamp, value in samples:
+                        f.write(f"{timestamp},{value:.3f}\n")
+                print(f"{len(samples)} muestras guardadas en {args.output}")
+            elif args.command == "cycle-learn":
+                link.learn_cycle(args.slot)
+            elif args.command == "cycle-clear":
+                link.clear_cycle_templates()
+    except CommandError as e:
+        print(f"Error: {e}", file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
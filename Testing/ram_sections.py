@@ -0,0 +1,116 @@
+"""
+Secciones de RAM propias del firmware dentro del script de enlazado del core
+
+PlatformIO lo corre después del builder del framework (extra_scripts = post:
+en platformio.ini, en los dos proyectos). Toma el script de enlazado de la
+variante (LDSCRIPT_PATH o el -T de LINKFLAGS), le agrega:
+- REGION_ALIAS de RAM_DTCM (0x20000000), RAM_AXI (0x24000000) y RAM_SRAM4
+  (0x38000000) a las regiones del MEMORY del core que empiezan en esos
+  bloques; si el core no declara SRAM4, se declara acá entera
+- al comienzo de SECTIONS, el linker_script.ld del proyecto (las secciones
+  .dtcm_data, .axi_data y .sram4_data de static_memory.h)
+
+y enlaza con el resultado ($BUILD_DIR/linker_script_ram.ld). Si falta alguna
+región que el fragmento usa, el build falla en lugar de dejar secciones
+huérfanas que el enlazador pondría en cualquier lado.
+"""
+
+import os
+import re
+import sys
+
+Import("env")  # noqa: F821
+
+REGION_BASES = {
+    "RAM_DTCM": 0x20000000,
+    "RAM_AXI": 0x24000000,
+    "RAM_SRAM4": 0x38000000,
+}
+SRAM4_LENGTH = "64K"
+
+
+def fail(message):
+    sys.stderr.write("ram_sections.py: " + message + "\n")
+    env.Exit(1)  # noqa: F821
+
+
+def core_script():
+    path = env.subst("$LDSCRIPT_PATH")  # noqa: F821
+    if path and os.path.isfile(path):
+        return path
+    for flag in env.get("LINKFLAGS", []):  # noqa: F821
+        flag = env.subst(str(flag))  # noqa: F821
+        for prefix in ("-Wl,-T", "-T"):
+            if flag.startswith(prefix) and os.path.isfile(flag[len(prefix):]):
+                return flag[len(prefix):]
+    board = env.BoardConfig()  # noqa: F821
+    framework = env.PioPlatform().get_package_dir("framework-arduino-mbed")  # noqa: F821
+    if framework:
+        path = os.path.join(framework, "variants", board.get("build.variant", ""), "linker_script.ld")
+        if os.path.isfile(path):
+            return path
+    fail("no se encontró el script de enlazado del core")
+
+
+def region_aliases(script, fragment):
+    """REGION_ALIAS (y la región de SRAM4 si hace falta) para las regiones que usa el fragmento"""
+    memory = re.search(r"MEMORY\s*\{(.*?)\}", script, re.S)
+    if memory is None:
+        fail("el script del core no tiene bloque MEMORY")
+    regions = re.findall(r"^\s*(\w+)\s*\([^)]*\)\s*:\s*ORIGIN\s*=\s*(0x[0-9A-Fa-f]+)", memory.group(1), re.M)
+    lines = []
+    for alias, base in REGION_BASES.items():
+        if not re.search(r"\b" + alias + r"\b", fragment):
+            continue
+        name = next((n for n, origin in regions if int(origin, 16) >> 24 == base >> 24), None)
+        if name is not None:
+            lines.append("REGION_ALIAS(\"%s\", %s);" % (alias, name))
+        elif alias == "RAM_SRAM4":
+            lines.append("MEMORY { RAM_SRAM4 (rw) : ORIGIN = 0x%08X, LENGTH = %s }" % (base, SRAM4_LENGTH))
+        else:
+            fail("el script del core no tiene una región en 0x%08X para %s" % (base, alias))
+    return memory.end(), "\n".join(lines)
+
+
+def generate():
+    source = core_script()
+    fragment_path = os.path.join(env.subst("$PROJECT_DIR"), "linker_script.ld")  # noqa: F821
+    with open(source) as f:
+        script = f.read()
+    with open(fragment_path) as f:
+        fragment = f.read()
+
+    at, aliases = region_aliases(script, fragment)
+    script = script[:at] + "\n\n" + aliases + "\n" + script[at:]
+    sections = re.search(r"SECTIONS\s*\{", script)
+    if sections is None:
+        fail("el script del core no tiene bloque SECTIONS")
+    script = script[:sections.end()] + "\n" + fragment + "\n" + script[sections.end():]
+
+    build_dir = env.subst("$BUILD_DIR")  # noqa: F821
+    if not os.path.isdir(build_dir):
+        os.makedirs(build_dir)
+    target = os.path.join(build_dir, "linker_script_ram.ld")
+    with open(target, "w") as f:
+        f.write(script)
+
+    # Saca el -T del core ("-T<script>", "-Wl,-T<script>" o "-T" y el script
+    # por separado) y enlaza solo con el generado
+    flags = []
+    skip = False
+    for flag in env.get("LINKFLAGS", []):  # noqa: F821
+        text = str(flag)
+        if skip or text == "$LDSCRIPT_PATH":
+            skip = False
+            continue
+        if text == "-T":
+            skip = True
+            continue
+        if env.subst(text).startswith(("-T", "-Wl,-T")):  # noqa: F821
+            continue
+        flags.append(flag)
+    env.Replace(LINKFLAGS=flags + ["-T" + target], LDSCRIPT_PATH=target)  # noqa: F821
+    print("ram_sections.py: %s + %s -> %s" % (source, fragment_path, target))
+
+
+generate()
@@ -0,0 +1,419 @@
+#!/usr/bin/env python3
+"""
+Kernels del firmware para Python (decodificador, historial, filtro, momentos, FFT)
+
+Envuelve con ctypes la biblioteca compartida de tools/sensor_core.cpp, que
+compila los mismos headers que el dispositivo. Así la GUI y los notebooks usan
+el mismo código validado que el firmware y procesan bloques enteros en C++ en
+lugar de hacer trabajo en Python por cada muestra.
+
+Compilar la biblioteca desde Testing/:
+    g++ -O2 -std=gnu++14 -shared -fPIC -Isrc tools/sensor_core.cpp -o libsensorcore.so
+(en Windows con MinGW: -o sensorcore.dll; en macOS: -o libsensorcore.dylib)
+
+Ejecutar este módulo corre la comparación de rendimiento y exactitud entre
+el camino en Python puro y el de la biblioteca (antes comprueba que el
+decodificador no pierda muestras en el peor caso; si pierde, devuelve 1):
+    python sensor_core.py
+"""
+
+import ctypes
+import os
+import sys
+
+import numpy as np
+
+ABI_VERSION = 2
+FLAG_TIMED = 0x01
+SUCTION_ERROR_VALUE = -1.0
+
+# Estados de SuctionStatus (sample_pipeline.h)
+SUCTION_STATUS_NAMES = ["error", "error_occasional", "out_of_range", "low", "medium", "high", "undefined"]
+
+_c_float_p = ctypes.POINTER(ctypes.c_float)
+_c_double_p = ctypes.POINTER(ctypes.c_double)
+_c_uint8_p = ctypes.POINTER(ctypes.c_uint8)
+_c_uint32_p = ctypes.POINTER(ctypes.c_uint32)
+_c_int32_p = ctypes.POINTER(ctypes.c_int32)
+
+
+def _library_path():
+    if sys.platform.startswith("win"):
+        name = "sensorcore.dll"
+    elif sys.platform == "darwin":
+        name = "libsensorcore.dylib"
+    else:
+        name = "libsensorcore.so"
+    return os.path.join(os.environ.get("SENSOR_CORE_DIR", os.path.dirname(os.path.abspath(__file__))), name)
+
+
+def _load():
+    path = _library_path()
+    try:
+        lib = ctypes.CDLL(path)
+    except OSError as e:
+        raise ImportError(f"No se encontró {path}; compilar tools/sensor_core.cpp (ver sensor_core.py)") from e
+
+    def sig(name, restype, *argtypes):
+        fn = getattr(lib, name)
+        fn.restype = restype
+        fn.argtypes = list(argtypes)
+
+    sig("sc_abi_version", ctypes.c_int)
+    sig("sc_decoder_new", ctypes.c_void_p)
+    sig("sc_decoder_free", None, ctypes.c_void_p)
+    sig("sc_decoder_feed", ctypes.c_size_t, ctypes.c_void_p, ctypes.c_char_p, ctypes.c_size_t,
+        _c_uint32_p, _c_float_p, _c_uint8_p, ctypes.c_size_t,
+        ctypes.c_char_p, ctypes.c_size_t, ctypes.POINTER(ctypes.c_size_t))
+    sig("sc_decoder_counters", None, ctypes.c_void_p, _c_uint32_p)
+    sig("sc_decoder_rate_hz", ctypes.c_float, ctypes.c_void_p)
+    sig("sc_ring_new", ctypes.c_void_p, ctypes.c_size_t)
+    sig("sc_ring_free", None, ctypes.c_void_p)
+    sig("sc_ring_push", None, ctypes.c_void_p, _c_double_p, _c_float_p, ctypes.c_size_t)
+    sig("sc_ring_clear", None, ctypes.c_void_p)
+    sig("sc_ring_size", ctypes.c_size_t, ctypes.c_void_p)
+    sig("sc_ring_times", _c_double_p, ctypes.c_void_p)
+    sig("sc_ring_values", _c_float_p, ctypes.c_void_p)
+    sig("sc_ring_lower_bound", ctypes.c_size_t, ctypes.c_void_p, ctypes.c_double)
+    sig("sc_pipeline_new", ctypes.c_void_p)
+    sig("sc_pipeline_free", None, ctypes.c_void_p)
+    sig("sc_pipeline_configure", None, ctypes.c_void_p, ctypes.c_float, ctypes.c_float, ctypes.c_float)
+    sig("sc_pipeline_reset", None, ctypes.c_void_p)
+    sig("sc_pipeline_process", None, ctypes.c_void_p, _c_float_p, ctypes.c_size_t, _c_float_p, _c_uint8_p)
+    sig("sc_rollup", None, _c_float_p, ctypes.c_size_t, _c_double_p)
+    sig("sc_window_kurtosis", ctypes.c_float, _c_int32_p, ctypes.c_size_t)
+    sig("sc_fft", ctypes.c_int, _c_float_p, _c_float_p, ctypes.c_size_t, ctypes.c_int)
+
+    version = lib.sc_abi_version()
+    if version != ABI_VERSION:
+        raise ImportError(f"{path} tiene ABI {version}, se esperaba {ABI_VERSION}; recompilar")
+    return lib
+
+
+_lib = _load()
+
+
+def _ptr(array, ctype):
+    return array.ctypes.data_as(ctypes.POINTER(ctype))
+
+
+class StreamDecoder:
+    """Renglones de la salida serie a arreglos (us, valor, flags) y metadatos"""
+
+    def __init__(self):
+        self._handle = _lib.sc_decoder_new()
+        if not self._handle:
+            raise MemoryError("sc_decoder_new")
+        self._meta = ctypes.create_string_buffer(4096)
+        self._meta_length = ctypes.c_size_t(0)
+
+    def __del__(self):
+        if getattr(self, "_handle", None):
+            _lib.sc_decoder_free(self._handle)
+            self._handle = None
+
+    def feed(self, data):
+        """Decodifica un bloque de bytes.
+
+        Devuelve (us, valores, flags, metadatos): tres arreglos numpy con las
+        muestras completas del bloque (los renglones partidos se completan en
+        la próxima llamada) y la lista de renglones '#...' como str.
+        """
+        # SC_DECODER_CAPACITY: el renglón de muestra más corto es "1\n"
+        capacity = len(data) // 2 + 1
+        us = np.empty(capacity, dtype=np.uint32)
+        values = np.empty(capacity, dtype=np.float32)
+        flags = np.empty(capacity, dtype=np.uint8)
+        # Cada renglón de metadatos ocupa en la salida lo mismo que en la entrada
+        if len(self._meta) < len(data) + 1:
+            self._meta = ctypes.create_string_buffer(len(data) + 1)
+        count = _lib.sc_decoder_feed(self._handle, data, len(data),
+                                     _ptr(us, ctypes.c_uint32), _ptr(values, ctypes.c_float),
+                                     _ptr(flags, ctypes.c_uint8), capacity,
+                                     self._meta, len(self._meta), ctypes.byref(self._meta_length))
+        if count > capacity:
+            raise RuntimeError("sc_decoder_feed: arreglos de muestras demasiado chicos")
+        meta = []
+        if self._meta_length.value:
+            text = ctypes.string_at(self._meta, self._meta_length.value).decode("utf-8", errors="replace")
+            meta = text.splitlines()
+        return us[:count], values[:count], flags[:count], meta
+
+    @property
+    def counters(self):
+        """dict con renglones, muestras, errores, metadatos y otros"""
+        out = (ctypes.c_uint32 * 5)()
+        _lib.sc_decoder_counters(self._handle, out)
+        return dict(zip(("lines", "samples", "errors", "metadata", "other"), out))
+
+    @property
+    def rate_hz(self):
+        """Frecuencia de muestreo según los timestamps del dispositivo (0 si no hay)"""
+        return _lib.sc_decoder_rate_hz(self._handle)
+
+
+class HistoryRing:
+    """Historial de (tiempo, valor) de tamaño fijo con vistas numpy sin copia.
+
+    Las vistas de times()/values()/window() apuntan a la memoria del ring y
+    valen hasta el próximo push(); copiarlas si se necesitan después.
+    """
+
+    def __init__(self, capacity):
+        self.capacity = capacity
+        self._handle = _lib.sc_ring_new(capacity)
+        if not self._handle:
+            raise MemoryError("sc_ring_new")
+
+    def __del__(self):
+        if getattr(self, "_handle", None):
+            _lib.sc_ring_free(self._handle)
+            self._handle = None
+
+    def __len__(self):
+        return _lib.sc_ring_size(self._handle)
+
+    def push(self, times, values):
+        times = np.ascontiguousarray(times, dtype=np.float64)
+        values = np.ascontiguousarray(values, dtype=np.float32)
+        n = min(len(times), len(values))
+        if n:
+            _lib.sc_ring_push(self._handle, _ptr(times, ctypes.c_double), _ptr(values, ctypes.c_float), n)
+
+    def clear(self):
+        _lib.sc_ring_clear(self._handle)
+
+    def times(self):
+        n = len(self)
+        if n == 0:
+            return np.empty(0, dtype=np.float64)
+        return np.ctypeslib.as_array(_lib.sc_ring_times(self._handle), shape=(n,))
+
+    def values(self):
+        n = len(self)
+        if n == 0:
+            return np.empty(0, dtype=np.float32)
+        return np.ctypeslib.as_array(_lib.sc_ring_values(self._handle), shape=(n,))
+
+    def window(self, since):
+        """Vistas de las muestras con tiempo >= since"""
+        start = _lib.sc_ring_lower_bound(self._handle, since)
+        return self.times()[start:], self.values()[start:]
+
+
+class SamplePipeline:
+    """Filtro IIR y estado de succión del firmware (processSample sin hardware)"""
+
+    def __init__(self, filter_alpha=1.0, suction_low_max=-50.0, suction_medium_max=-200.0):
+        self._handle = _lib.sc_pipeline_new()
+        if not self._handle:
+            raise MemoryError("sc_pipeline_new")
+        self.configure(filter_alpha, suction_low_max, suction_medium_max)
+
+    def __del__(self):
+        if getattr(self, "_handle", None):
+            _lib.sc_pipeline_free(self._handle)
+            self._handle = None
+
+    def configure(self, filter_alpha, suction_low_max=-50.0, suction_medium_max=-200.0):
+        _lib.sc_pipeline_configure(self._handle, filter_alpha, suction_low_max, suction_medium_max)
+
+    def reset(self):
+        _lib.sc_pipeline_reset(self._handle)
+
+    def process(self, mbar):
+        """Devuelve (valores filtrados, estados SuctionStatus); -1.0 marca lectura fallida"""
+        mbar = np.ascontiguousarray(mbar, dtype=np.float32)
+        out = np.empty_like(mbar)
+        status = np.empty(len(mbar), dtype=np.uint8)
+        _lib.sc_pipeline_process(self._handle, _ptr(mbar, ctypes.c_float), len(mbar),
+                                 _ptr(out, ctypes.c_float), _ptr(status, ctypes.c_uint8))
+        return out, status
+
+
+def rollup(values):
+    """count, min, max, mean, var, p50, p95, p99 como los agregados del firmware"""
+    values = np.ascontiguousarray(values, dtype=np.float32)
+    out = (ctypes.c_double * 8)()
+    _lib.sc_rollup(_ptr(values, ctypes.c_float), len(values), out)
+    keys = ("count", "min", "max", "mean", "var", "p50", "p95", "p99")
+    stats = dict(zip(keys, out))
+    stats["count"] = int(stats["count"])
+    return stats
+
+
+def window_kurtosis(data):
+    """Curtosis de una ventana de enteros (window_analysis del firmware)"""
+    data = np.ascontiguousarray(data, dtype=np.int32)
+    return _lib.sc_window_kurtosis(_ptr(data, ctypes.c_int32), len(data))
+
+
+def fft(x, inverse=False):
+    """FFT compleja de FftRadix2 (float32; la inversa sin escalar). len(x) potencia de 2 entre 64 y 8192."""
+    x = np.asarray(x)
+    re = np.array(x.real, dtype=np.float32)
+    im = np.array(x.imag if np.iscomplexobj(x) else np.zeros(len(x)), dtype=np.float32)
+    if _lib.sc_fft(_ptr(re, ctypes.c_float), _ptr(im, ctypes.c_float), len(re), 1 if inverse else 0) != 0:
+        raise ValueError(f"tamaño de FFT no soportado: {len(re)}")
+    return re + 1j * im
+
+
+# ---- Comparación de rendimiento ----
+
+def _synthetic_stream(seconds=10.0, rate_hz=2000.0, seed=1):
+    """Salida del dispositivo simulada: muestras con el formato del firmware,
+    algún ERROR, metadatos y el resumen de estado cada 1000 lecturas"""
+    rng = np.random.default_rng(seed)
+    n = int(seconds * rate_hz)
+    us = (np.arange(n) * (1e6 / rate_hz)).astype(np.uint64) + 123456
+    t = np.arange(n) / rate_hz
+    values = -250.0 + 120.0 * np.sin(2 * np.pi * 1.5 * t) + rng.normal(0.0, 2.0, n)
+    lines = []
+    for i in range(n):
+        if i % 4999 == 4998:
+            lines.append("ERROR")
+            continue
+        line = f"{int(us[i]) & 0xFFFFFFFF} {values[i]:.6f}"
+        if (i + 1) % 1000 == 0:
+            line += f" [Lecturas: {i + 1}, Errores: 0, Nivel: MEDIO]"
+        lines.append(line)
+        if i % 2000 == 0:
+            lines.append(f"#SYNC {i // 2000} {int(us[i]) & 0xFFFFFFFF}")
+    return ("\r\n".join(lines) + "\r\n").encode("ascii"), n
+
+
+def _python_decode(data):
+    """Camino anterior de la GUI: un renglón por vez con split/float"""
+    us, values = [], []
+    for raw in data.split(b"\n"):
+        line = raw.decode("utf-8").strip()
+        if not line or line.startswith("#") or line.startswith("=") or line.startswith("Timer"):
+            continue
+        parts = line.split()
+        try:
+            if len(parts) >= 2:
+                values.append(float(parts[1]))
+                us.append(int(parts[0]))
+            else:
+                values.append(float(parts[0]))
+                us.append(0)
+        except ValueError:
+            pass
+    return np.array(us, dtype=np.uint32), np.array(values, dtype=np.float32)
+
+
+def _python_iir(values, alpha):
+    out = np.empty(len(values), dtype=np.float32)
+    filtered = None
+    for i, v in enumerate(values):
+        filtered = v if filtered is None else filtered + alpha * (v - filtered)
+        out[i] = filtered
+    return out
+
+
+def _bench(fn, repeat=3):
+    import time
+    best = float("inf")
+    result = None
+    for _ in range(repeat):
+        start = time.perf_counter()
+        result = fn()
+        best = min(best, time.perf_counter() - start)
+    return best, result
+
+
+def main():
+    from collections import deque
+
+    data, n = _synthetic_stream()
+    chunk = 4096
+    chunks = [data[i:i + chunk] for i in range(0, len(data), chunk)]
+    print(f"Flujo sintético: {n} muestras a 2 kHz, {len(data) / 1e6:.1f} MB, bloques de {chunk} bytes\n")
+    # Peor caso del decodificador: renglones "1\n" y uno partido entre bloques
+    worst = b"1\n" * 5000
+    decoder = StreamDecoder()
+    decoded = sum(len(decoder.feed(worst[i:i + 1001])[0]) for i in range(0, len(worst), 1001))
+    if decoded != 5000:
+        print(f"FALLA: el decodificador dio {decoded} de 5000 renglones mínimos")
+        return 1
+
+    print(f"{'etapa':<28}{'Python ns/muestra':>20}{'C++ ns/muestra':>18}{'aceleración':>14}  validación")
+
+    def report(name, t_py, t_c, count, check):
+        print(f"{name:<28}{t_py * 1e9 / count:>20.1f}{t_c * 1e9 / count:>18.1f}{t_py / t_c:>13.1f}x  {check}")
+
+    # Decodificación: el parser por renglón de la GUI contra el decodificador del firmware
+    t_py, (us_py, v_py) = _bench(lambda: _python_decode(data))
+
+    def decode_c():
+        decoder = StreamDecoder()
+        parts = [decoder.feed(c) for c in chunks]
+        return (np.concatenate([p[0] for p in parts]), np.concatenate([p[1] for p in parts]),
+                decoder.counters)
+
+    t_c, (us_c, v_c, counters) = _bench(decode_c)
+    same = len(us_py) == len(us_c) and np.array_equal(us_py, us_c) and np.array_equal(v_py, v_c)
+    report("decodificación", t_py, t_c, n, f"{'idéntica' if same else 'DIFIERE'} ({counters['samples']} muestras, "
+           f"{counters['errors']} ERROR, {counters['metadata']} metadatos)")
+
+    # Historial de la GUI: deque + conversión a numpy por cuadro contra el ring con vistas
+    times = us_c.astype(np.float64) * 1e-6
+    frame = 100   # Muestras por cuadro (2 kHz a 20 FPS)
+
+    def history_py():
+        t_hist, v_hist = deque(maxlen=10000), deque(maxlen=10000)
+        for start in range(0, len(times), frame):
+            for k in range(start, min(start + frame, len(times))):
+                t_hist.append(times[k])
+                v_hist.append(v_c[k])
+            t_arr = np.array(t_hist)
+            v_arr = np.array(v_hist)
+            mask = t_arr >= t_arr[-1] - 2.0
+            last = (t_arr[mask], v_arr[mask])
+        return last
+
+    def history_c():
+        ring = HistoryRing(10000)
+        for start in range(0, len(times), frame):
+            ring.push(times[start:start + frame], v_c[start:start + frame])
+            last = ring.window(ring.times()[-1] - 2.0)
+        return (last[0].copy(), last[1].copy())
+
+    t_py, last_py = _bench(history_py)
+    t_c, last_c = _bench(history_c)
+    same = np.array_equal(last_py[0], last_c[0]) and np.array_equal(last_py[1].astype(np.float32), last_c[1])
+    report("historial + ventana", t_py, t_c, len(times), "idéntica" if same else "DIFIERE")
+
+    # Filtro IIR
+    alpha = 0.1
+    t_py, f_py = _bench(lambda: _python_iir(v_c, np.float32(alpha)))
+
+    def iir_c():
+        pipeline = SamplePipeline(filter_alpha=alpha)
+        return pipeline.process(v_c)[0]
+
+    t_c, f_c = _bench(iir_c)
+    report("filtro IIR", t_py, t_c, len(v_c), f"error máx {np.max(np.abs(f_py - f_c)):.2e} mbar")
+
+    # Momentos: numpy (ya vectorizado) contra el agregado del firmware
+    t_py, m_py = _bench(lambda: (np.mean(v_c, dtype=np.float64), np.var(v_c, ddof=1, dtype=np.float64),
+                                 np.percentile(v_c, 95)))
+    t_c, m_c = _bench(lambda: rollup(v_c))
+    report("momentos (numpy)", t_py, t_c, len(v_c),
+           f"media Δ{abs(m_py[0] - m_c['mean']):.1e}, var Δ{abs(m_py[1] - m_c['var']) / m_py[1]:.1e} rel, "
+           f"p95 Δ{abs(m_py[2] - m_c['p95']):.2f} mbar (bins de 3 mbar)")
+
+    # FFT por bloques de 1024 (numpy en doble contra FftRadix2 en float)
+    blocks = v_c[:len(v_c) // 1024 * 1024].reshape(-1, 1024)
+    t_py, s_py = _bench(lambda: [np.fft.fft(b) for b in blocks])
+    t_c, s_c = _bench(lambda: [fft(b) for b in blocks])
+    err = max(np.max(np.abs(a - b)) / np.max(np.abs(a)) for a, b in zip(s_py, s_c))
+    report("FFT 1024 (numpy)", t_py, t_c, blocks.size, f"error relativo máx {err:.1e}")
+
+    print("\nLas etapas por muestra (decodificación, historial, IIR) son las que reemplaza la biblioteca;")
+    print("momentos y FFT ya estaban vectorizados en numpy y se comparan para validar los kernels.")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -1,4 +1,5 @@
 #include "ABPLLN.h"
+#include "pressure_convert.h"
 #include <Wire.h>
 
 // Variables globales para el sensor
@@ -51,28 +52,9 @@ uint16_t readRawPressure() {
 }
 
 // Función para convertir valor raw a presión en mbar
+// (conversión lineal del rango útil 10-90% a 0-600 mbar, recortada a la banda)
 float convertToPressure(uint16_t rawValue) {
-  // Calcular el rango útil (10% a 90% del rango total)
-  float usefulRange = PRESSURE_MAX_PERCENT - PRESSURE_MIN_PERCENT; // 80%
-  float countsPerPercent = PRESSURE_MAX_COUNTS / 100.0f;
-  
-  // Calcular los counts correspondientes al 10% y 90%
-  uint16_t minCounts = (uint16_t)(PRESSURE_MIN_PERCENT * countsPerPercent);
-  uint16_t maxCounts = (uint16_t)(PRESSURE_MAX_PERCENT * countsPerPercent);
-  
-  // Verificar si el valor está en el rango válido
-  if (rawValue < minCounts) {
-    return 0.0f; // Por debajo del rango mínimo
-  }
-  if (rawValue > maxCounts) {
-    return PRESSURE_RANGE_MBAR; // Por encima del rango máximo
-  }
-  
-  // Conversión lineal del rango útil (10-90%) a 0-600 mbar
-  float normalizedValue = (float)(rawValue - minCounts) / (float)(maxCounts - minCounts);
-  float pressure = normalizedValue * PRESSURE_RANGE_MBAR;
-  
-  return pressure;
+  return pressureConvertClamped(rawValue, CAL_ABPLLN);
 }
 
 // Función para leer y procesar la presión
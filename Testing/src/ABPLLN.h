@@ -2,6 +2,7 @@
 #define ABPLLN_H
 
 #include <Arduino.h>
+#include <Wire.h>
 
 // Configuración del sensor de presión I2C
 #define PRESSURE_SENSOR_ADDR 0x08
@@ -16,6 +17,19 @@ extern float currentPressure;
 extern uint16_t rawPressureData;
 extern bool sensorConnected;
 
+// Cuentas crudas (14 bits) sin pasar por el estado global del driver; false si
+// el sensor no respondió o informa diagnóstico. Inline para poder usarla desde
+// el M4, que no compila ABPLLN.cpp.
+inline bool abpllnReadRaw(uint16_t* raw) {
+  Wire.requestFrom(PRESSURE_SENSOR_ADDR, 2);
+  if (Wire.available() < 2) return false;
+  uint8_t msb = Wire.read();
+  uint8_t lsb = Wire.read();
+  if ((msb >> 6) == 0b11) return false;
+  *raw = (((uint16_t)msb << 8) | lsb) & 0x3FFF;
+  return true;
+}
+
 // Declaraciones de funciones
 void initPressureSensor();
 uint16_t readRawPressure();
@@ -1,6 +1,7 @@
 #pragma once
 #include <Arduino.h>
 #include <SPI.h>
+#include "pressure_convert.h"
 
 // Cambia el pin CS según tu conexión
 #ifndef CCDANN600MDSA3_CS_PIN
@@ -19,7 +20,8 @@ inline void CCDANN600MDSA3_begin() {
     SPI.begin();
 }
 
-inline float CCDANN600MDSA3_read() {
+// Palabra de 16 bits del sensor: 2 bits de estado y 12 de presión (bits 13..2)
+inline uint16_t CCDANN600MDSA3_transfer() {
     SPI.beginTransaction(SPISettings(750000, MSBFIRST, SPI_MODE3));
     digitalWrite(CCDANN600MDSA3_CS_PIN, LOW);
     delayMicroseconds(2); // tCSS típico
@@ -31,13 +33,25 @@ inline float CCDANN600MDSA3_read() {
     digitalWrite(CCDANN600MDSA3_CS_PIN, HIGH);
     SPI.endTransaction();
 
-    uint16_t w = (uint16_t(b0) << 8) | b1;
-    uint8_t status = (w >> 14) & 0x03; // 2 bits de estado
+    return (uint16_t(b0) << 8) | b1;
+}
+
+// Cuentas crudas; false en modo comando o diagnóstico (el dato repetido
+// entre conversiones sigue siendo válido)
+inline bool CCDANN600MDSA3_readRaw(uint16_t* raw) {
+    uint16_t w = CCDANN600MDSA3_transfer();
+    uint8_t status = (w >> 14) & 0x03;
+    if (status == 1 || status == 3) return false;
+    *raw = (w >> 2) & 0x0FFF;
+    return true;
+}
+
+inline float CCDANN600MDSA3_read() {
+    uint16_t w = CCDANN600MDSA3_transfer();
     uint16_t raw = (w >> 2) & 0x0FFF;  // 12 bits de presión (bits 13..2)
 
     // Conversión a presión física (mbar)
-    float pressure = ((float)raw - CCDANN600MDSA3_OUTPUT_MIN) * (CCDANN600MDSA3_P_MAX - CCDANN600MDSA3_P_MIN) /
-                     (CCDANN600MDSA3_OUTPUT_MAX - CCDANN600MDSA3_OUTPUT_MIN) + CCDANN600MDSA3_P_MIN;
+    float pressure = pressureConvert(raw, CAL_SSCDANN);
 
     return pressure;
 }
@@ -2,8 +2,8 @@
 
 #define P_2SMPP_02  A2
 #define N_2SMPP_02  A1
-#define VDD         3.3     // Voltaje de alimentación del sensor
 
+const float VDD_02 = 3.3;          // Voltaje de alimentación del sensor
 const float V_OFFSET_MV_02 = -2.5;   // Voltaje de offset en mV
 const float P_SPAN_02 = 37.0;     // Rango de presión total (P_MAX - P_MIN)
 const float V_SPAN_MV_02 = 31.0;   // Voltaje de span en mV
@@ -16,8 +16,8 @@ inline void D_2SMPP_02_read() {
     int rawVoutNeg = analogRead(N_2SMPP_02);
 
   // 2. Convertir los valores raw a voltajes
-  float vOutPos = (float)rawVoutPos / 65535.0 * VDD;
-  float vOutNeg = (float)rawVoutNeg / 65535.0 * VDD;
+  float vOutPos = (float)rawVoutPos / 65535.0 * VDD_02;
+  float vOutNeg = (float)rawVoutNeg / 65535.0 * VDD_02;
   
   // 3. Calcular la diferencia de voltaje en mV
   float vOutDiff_mv = (vOutPos - vOutNeg) * 1000.0;
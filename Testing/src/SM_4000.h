@@ -1,20 +1,9 @@
 #pragma once
-#include <Wire.h>
+#include "dev_i2c.h"
+#include "pressure_convert.h"
 
-// Pines y configuración analógica
-#define analogPin  A0
-#define VDD         3.3
-#define V_offset    -2.5
-#define pendiente   0.8378 // V/kPa
-
-// Pines y configuración I2C
-#define I2C3_SCL    D12
-#define I2C3_SDA    D11
-
-#ifndef DEV_I2C_DEFINED
-#define DEV_I2C_DEFINED
-static TwoWire dev_i2c(I2C3_SDA, I2C3_SCL);
-#endif
+// Entrada analógica del SM4291 (la calibración está en pressure_convert.h)
+#define SM4291_ANALOG_PIN  A0
 
 // Direcciones y registros I2C del sensor
 const int SENSOR_I2C_ADDRESS_UNPROTECTED = 0x6C;
@@ -36,52 +25,54 @@ const float P_SPAN_MBAR = P_MAX_MBAR - P_MIN_MBAR; // -500.0
 
 inline void SM_4000_begin() {
     dev_i2c.begin();
+    dev_i2c.setClock(DEV_I2C_CLOCK_HZ);
     analogReadResolution(16); // Habilitar resolución de 16 bits
 }
 
 inline float SM_4000_readAnalog() {
-    int rawVout = analogRead(analogPin);
-
-    // El sensor entrega 10-90% de VDD para el rango de presión (0 a -500 mbar)
-    // Convertimos la lectura analógica (0-65535) a voltaje
-    float vOut = (rawVout / 65535.0) * VDD;
-
-    // El rango útil es de 10% a 90% de VDD
-    float vMin = 0.10 * VDD;
-    float vMax = 0.90 * VDD;
-
-    // Convertimos el voltaje a presión (mbar)
-    float pressure_mbar = (vOut - vMin) * (-500 / (vMax - vMin));
+    int rawVout = analogRead(SM4291_ANALOG_PIN);
 
-    // Limitamos la presión al rango físico
-    if (pressure_mbar > 0) pressure_mbar = 0;
-    if (pressure_mbar < -500) pressure_mbar = -500.0;
+    // El sensor entrega 10-90% de VDD para el rango de presión (0 a -500 mbar);
+    // la conversión recorta al rango físico
+    float pressure_mbar = pressureConvertClamped(rawVout, CAL_SM4291_ANALOG);
 
     // Retornar presión en mbar
     return pressure_mbar;
 }
 
-inline float SM_4000_readI2C_pressure() {
+// Lectura analógica sin recortar: permite detectar una salida fuera de la banda
+// 10-90% (cable cortado, corto a VDD) en el control de redundancia
+inline float SM_4000_readAnalogUnclamped() {
+    return pressureConvert(analogRead(SM4291_ANALOG_PIN), CAL_SM4291_ANALOG);
+}
+
+// Cuentas crudas de presión; false si el sensor no respondió
+inline bool SM_4000_readI2C_raw(int16_t* raw) {
     dev_i2c.beginTransmission(SENSOR_I2C_ADDRESS_UNPROTECTED);
     dev_i2c.write(PRESS_REG_ADDR); // Dirección de inicio (0x30)
     dev_i2c.endTransmission(false); // Mantener la conexión abierta para la lectura
 
     dev_i2c.requestFrom(SENSOR_I2C_ADDRESS_UNPROTECTED, 2);
 
-    if (dev_i2c.available() == 2) {
-        byte pressLo = dev_i2c.read();
-        byte pressHi = dev_i2c.read();
-
-        // Interpreta el valor como entero de 16 bits en complemento a 2
-        int16_t rawPressure = (int16_t)((pressHi << 8) | pressLo);
+    if (dev_i2c.available() != 2) return false;
+    byte pressLo = dev_i2c.read();
+    byte pressHi = dev_i2c.read();
 
-        // Puedes convertir a presión física aquí si lo necesitas:
-         float pressure_mbar = ((float)rawPressure - RAW_MIN) * P_SPAN_MBAR / RAW_SPAN + P_MIN_MBAR;
+    // Interpreta el valor como entero de 16 bits en complemento a 2
+    *raw = (int16_t)((pressHi << 8) | pressLo);
+    return true;
+}
 
-        return pressure_mbar; // O retorna pressure_mbar si quieres la presión física
-    } else {
+inline float SM_4000_readI2C_pressure() {
+    int16_t rawPressure;
+    if (!SM_4000_readI2C_raw(&rawPressure)) {
         return -1.0; // Error en la lectura
     }
+
+    // Conversión a presión física (sin recorte, como el driver original)
+    float pressure_mbar = pressureConvert(rawPressure, CAL_SM4291_I2C);
+
+    return pressure_mbar;
 }
 
 inline void SM_4000_readI2C() {
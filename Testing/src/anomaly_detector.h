@@ -0,0 +1,322 @@
+#pragma once
+#include <stdint.h>
+#include <math.h>
+
+/*
+  Detector de anomalías con baseline aprendido por línea de succión
+
+  Primero aprende cómo es la línea en estado normal (ANOMALY_LEARN_SAMPLES
+  muestras): nivel, varianza, ruido de alta frecuencia y energía por banda.
+  Después evalúa cada muestra contra ese baseline:
+  - Oclusión / fuga: CUSUM de dos lados sobre el residuo normalizado y
+    suavizado (~50 ms, para que una pulsación no parezca un cambio de nivel).
+    La succión que se hace más negativa es oclusión; la que se acerca a 0 es fuga
+  - Deriva: el baseline adaptativo se alejó más de ANOMALY_DRIFT_SIGMA desvíos
+    del nivel aprendido (cambios lentos que el CUSUM no ve porque el baseline
+    los absorbe)
+  - Ruido: la varianza de las diferencias entre muestras consecutivas supera
+    ANOMALY_NOISE_RATIO veces la aprendida. Las diferencias ignoran el ripple
+    lento de la bomba y se recortan, así un escalón no cuenta como ruido
+  - Pulsación: la energía de alguna banda cambió más de ANOMALY_BAND_DB
+    respecto de su firma aprendida
+
+  Las bandas se miden con filtros de Goertzel (una frecuencia cada uno, con
+  resolución fs / ANOMALY_BLOCK): cuesta O(ANOMALY_BANDS) por muestra en lugar
+  de una FFT por bloque, así el tiempo por muestra está acotado. Los bloques que
+  contienen un escalón de nivel no se evalúan. La memoria es constante.
+
+  El baseline solo se adapta mientras no hay ninguna anomalía en curso (salvo
+  deriva, que justamente se mide con el baseline).
+
+  Este archivo no depende de Arduino y compila también en el host.
+*/
+
+#define ANOMALY_LEARN_SAMPLES   20000     // 10 s a 2 kHz
+#define ANOMALY_BASELINE_ALPHA  0.0005f   // Adaptación del baseline (~1 s a 2 kHz)
+#define ANOMALY_LEVEL_ALPHA     0.01f     // Suavizado del residuo para el CUSUM (~50 ms a 2 kHz)
+#define ANOMALY_NOISE_ALPHA     0.005f    // Ruido reciente (~100 ms a 2 kHz)
+#define ANOMALY_MIN_SIGMA       0.05f     // mbar, piso para sensores muy silenciosos
+#define ANOMALY_CUSUM_K         2.0f      // Holgura del CUSUM (desvíos): el ripple normal no acumula
+#define ANOMALY_CUSUM_H         50.0f     // Umbral de alarma del CUSUM
+#define ANOMALY_STEP_Z          6.0f      // Residuo que marca un escalón (bloque espectral descartado)
+#define ANOMALY_DRIFT_SIGMA     4.0f
+#define ANOMALY_NOISE_RATIO     4.0f
+#define ANOMALY_NOISE_CLIP      6.0f      // Recorte de las diferencias (desvíos de ruido)
+#define ANOMALY_BANDS           4
+#define ANOMALY_BLOCK           1024      // Muestras por medición espectral
+#define ANOMALY_BAND_FAST       0.5f      // Suavizado de la energía medida (por bloque)
+#define ANOMALY_BAND_SLOW       0.02f     // Adaptación de la firma (por bloque)
+#define ANOMALY_BAND_FLOOR      8.0f      // Piso de energía: múltiplo del ruido blanco por bin
+#define ANOMALY_BAND_DB         6.0f
+
+// Frecuencias centrales de las bandas (Hz): bomba, respiración de la línea, vibración
+static const float ANOMALY_BAND_HZ[ANOMALY_BANDS] = {2.0f, 8.0f, 25.0f, 60.0f};
+
+enum AnomalyFlag : uint8_t {
+    ANOMALY_DRIFT      = 1 << 0,
+    ANOMALY_OCCLUSION  = 1 << 1,
+    ANOMALY_LEAK       = 1 << 2,
+    ANOMALY_NOISE      = 1 << 3,
+    ANOMALY_PULSATION  = 1 << 4,
+};
+
+inline const char* anomalyFlagName(uint8_t flag) {
+    switch (flag) {
+        case ANOMALY_DRIFT:     return "drift";
+        case ANOMALY_OCCLUSION: return "occlusion";
+        case ANOMALY_LEAK:      return "leak";
+        case ANOMALY_NOISE:     return "noise";
+        case ANOMALY_PULSATION: return "pulsation";
+        default:                return "?";
+    }
+}
+
+// Puntajes actuales (telemetría); cada uno se compara con su umbral
+struct AnomalyScores {
+    float levelZ;                     // Residuo suavizado y normalizado
+    float cusumLeak;                  // CUSUM hacia 0 mbar
+    float cusumOcclusion;             // CUSUM hacia más succión
+    float driftSigma;                 // Distancia baseline - nivel aprendido (desvíos)
+    float noiseRatio;                 // Ruido reciente / aprendido
+    float bandDeltaDb[ANOMALY_BANDS]; // Energía por banda respecto de la firma
+};
+
+// Puntaje que decide cada bandera (para reportar junto con el evento)
+inline float anomalyFlagScore(const AnomalyScores& scores, uint8_t flag) {
+    switch (flag) {
+        case ANOMALY_DRIFT:     return scores.driftSigma;
+        case ANOMALY_OCCLUSION: return scores.cusumOcclusion;
+        case ANOMALY_LEAK:      return scores.cusumLeak;
+        case ANOMALY_NOISE:     return scores.noiseRatio;
+        case ANOMALY_PULSATION: {
+            float worst = 0.0f;
+            for (int b = 0; b < ANOMALY_BANDS; b++) {
+                if (fabsf(scores.bandDeltaDb[b]) > fabsf(worst)) worst = scores.bandDeltaDb[b];
+            }
+            return worst;
+        }
+        default:                return 0.0f;
+    }
+}
+
+class AnomalyDetector {
+private:
+    // Aprendizaje inicial (Welford sobre el nivel, suma de cuadrados de las diferencias)
+    uint32_t learnCount;
+    double learnMean;
+    double learnM2;
+    double learnDiff2;
+
+    float referenceMean;     // Nivel aprendido (fijo)
+    float referenceSigma;
+    float baselineMean;      // Baseline adaptativo
+    float baselineVar;
+    float smoothResidual;
+    float noiseVar;          // Varianza aprendida de las diferencias
+    float recentNoiseVar;
+    float previousValue;
+
+    // Goertzel por banda
+    float coeff[ANOMALY_BANDS];
+    float s1[ANOMALY_BANDS];
+    float s2[ANOMALY_BANDS];
+    float bandPower[ANOMALY_BANDS];     // Energía medida (suavizada)
+    float bandSignature[ANOMALY_BANDS]; // Firma aprendida
+    uint16_t blockCount;
+    uint16_t spectralBlocks;            // Bloques medidos (el primero inicializa)
+    bool blockDisturbed;
+    uint8_t pulsationStrikes;
+
+    uint8_t flags;
+    AnomalyScores scores;
+
+    static float clampSigma(float var) {
+        float sigma = sqrtf(var);
+        return sigma < ANOMALY_MIN_SIGMA ? ANOMALY_MIN_SIGMA : sigma;
+    }
+
+    void finishBlock() {
+        bool disturbed = blockDisturbed;
+        blockDisturbed = false;
+
+        // Energía de ruido blanco por bin (potencia / N^2 = sigma^2 / N)
+        float floor = ANOMALY_BAND_FLOOR * 0.5f * noiseVar / ANOMALY_BLOCK;
+        bool outside = false;
+        for (int b = 0; b < ANOMALY_BANDS; b++) {
+            float power = s1[b] * s1[b] + s2[b] * s2[b] - coeff[b] * s1[b] * s2[b];
+            power /= (float)ANOMALY_BLOCK * ANOMALY_BLOCK;
+            s1[b] = 0.0f;
+            s2[b] = 0.0f;
+            if (disturbed) continue;
+
+            if (spectralBlocks == 0) {
+                bandPower[b] = power;
+            } else {
+                bandPower[b] += ANOMALY_BAND_FAST * (power - bandPower[b]);
+            }
+
+            if (!learned()) {
+                bandSignature[b] = bandPower[b];
+                continue;
+            }
+            scores.bandDeltaDb[b] = 10.0f * log10f((bandPower[b] + floor) / (bandSignature[b] + floor));
+            // La firma solo sigue a las bandas que están dentro del umbral
+            if (fabsf(scores.bandDeltaDb[b]) > ANOMALY_BAND_DB) {
+                outside = true;
+            } else if ((flags & ~ANOMALY_DRIFT) == 0) {
+                bandSignature[b] += ANOMALY_BAND_SLOW * (bandPower[b] - bandSignature[b]);
+            }
+        }
+        if (disturbed) return;
+        if (spectralBlocks < UINT16_MAX) spectralBlocks++;
+
+        // Dos bloques seguidos fuera de la firma para evitar falsos positivos
+        pulsationStrikes = outside ? (uint8_t)(pulsationStrikes + (pulsationStrikes < 255)) : 0;
+    }
+
+    void setFlag(uint8_t flag, bool active) {
+        if (active) flags |= flag; else flags &= ~flag;
+    }
+
+    // Activa por encima de threshold y se despeja por debajo de la mitad
+    void setFlagHysteresis(uint8_t flag, float score, float threshold) {
+        setFlag(flag, score > threshold || ((flags & flag) && score > 0.5f * threshold));
+    }
+
+public:
+    AnomalyDetector() { reset(); setPeriodUs(500); }
+
+    // Olvida el baseline y vuelve a aprender
+    void reset() {
+        learnCount = 0;
+        learnMean = 0.0;
+        learnM2 = 0.0;
+        learnDiff2 = 0.0;
+        referenceMean = 0.0f;
+        referenceSigma = ANOMALY_MIN_SIGMA;
+        baselineMean = 0.0f;
+        baselineVar = 0.0f;
+        smoothResidual = 0.0f;
+        noiseVar = 0.0f;
+        recentNoiseVar = 0.0f;
+        previousValue = 0.0f;
+        for (int b = 0; b < ANOMALY_BANDS; b++) {
+            s1[b] = 0.0f;
+            s2[b] = 0.0f;
+            bandPower[b] = 0.0f;
+            bandSignature[b] = 0.0f;
+            scores.bandDeltaDb[b] = 0.0f;
+        }
+        blockCount = 0;
+        spectralBlocks = 0;
+        blockDisturbed = false;
+        pulsationStrikes = 0;
+        flags = 0;
+        scores.levelZ = 0.0f;
+        scores.cusumLeak = 0.0f;
+        scores.cusumOcclusion = 0.0f;
+        scores.driftSigma = 0.0f;
+        scores.noiseRatio = 1.0f;
+    }
+
+    // Recalcula los coeficientes de Goertzel para el periodo de muestreo
+    // (la firma espectral depende de la frecuencia, así que se vuelve a aprender)
+    void setPeriodUs(uint32_t periodUs) {
+        float fs = 1e6f / (float)periodUs;
+        for (int b = 0; b < ANOMALY_BANDS; b++) {
+            // Bin más cercano a la frecuencia de la banda (al menos el 1)
+            float k = floorf(0.5f + ANOMALY_BAND_HZ[b] * ANOMALY_BLOCK / fs);
+            if (k < 1.0f) k = 1.0f;
+            coeff[b] = 2.0f * cosf(2.0f * (float)M_PI * k / ANOMALY_BLOCK);
+            s1[b] = 0.0f;
+            s2[b] = 0.0f;
+        }
+        blockCount = 0;
+        spectralBlocks = 0;
+        blockDisturbed = false;
+        pulsationStrikes = 0;
+        flags &= ~ANOMALY_PULSATION;
+    }
+
+    bool learned() const { return learnCount >= ANOMALY_LEARN_SAMPLES; }
+
+    // Procesa una muestra válida (mbar). Devuelve las banderas que cambiaron.
+    uint8_t update(float value) {
+        uint8_t previous = flags;
+        float diff = learnCount ? value - previousValue : 0.0f;
+        previousValue = value;
+
+        if (!learned()) {
+            learnCount++;
+            double delta = value - learnMean;
+            learnMean += delta / learnCount;
+            learnM2 += delta * (value - learnMean);
+            learnDiff2 += (double)diff * diff;
+            baselineMean = (float)learnMean;
+            if (learned()) {
+                referenceMean = (float)learnMean;
+                baselineVar = (float)(learnM2 / (learnCount - 1));
+                referenceSigma = clampSigma(baselineVar);
+                noiseVar = (float)(learnDiff2 / (learnCount - 1));
+                recentNoiseVar = noiseVar;
+            }
+        }
+
+        // Espectro sobre el residuo (sin la componente continua)
+        float residual = value - baselineMean;
+        for (int b = 0; b < ANOMALY_BANDS; b++) {
+            float s0 = residual + coeff[b] * s1[b] - s2[b];
+            s2[b] = s1[b];
+            s1[b] = s0;
+        }
+
+        if (learned()) {
+            // Nivel: CUSUM de dos lados, con tope para que la alarma se despeje
+            // en un tiempo acotado cuando la línea se normaliza
+            float sigma = clampSigma(baselineVar);
+            smoothResidual += ANOMALY_LEVEL_ALPHA * (residual - smoothResidual);
+            float z = smoothResidual / sigma;
+            scores.levelZ = z;
+            scores.cusumLeak = fminf(fmaxf(0.0f, scores.cusumLeak + z - ANOMALY_CUSUM_K),
+                                     2.0f * ANOMALY_CUSUM_H);
+            scores.cusumOcclusion = fminf(fmaxf(0.0f, scores.cusumOcclusion - z - ANOMALY_CUSUM_K),
+                                          2.0f * ANOMALY_CUSUM_H);
+            if (fabsf(residual) > ANOMALY_STEP_Z * sigma) blockDisturbed = true;
+
+            // Ruido: diferencias recortadas
+            float noiseSigma = clampSigma(noiseVar);
+            float clipped = fminf(fabsf(diff), ANOMALY_NOISE_CLIP * noiseSigma);
+            recentNoiseVar += ANOMALY_NOISE_ALPHA * (clipped * clipped - recentNoiseVar);
+            scores.noiseRatio = recentNoiseVar / (noiseSigma * noiseSigma);
+
+            setFlagHysteresis(ANOMALY_LEAK, scores.cusumLeak, ANOMALY_CUSUM_H);
+            setFlagHysteresis(ANOMALY_OCCLUSION, scores.cusumOcclusion, ANOMALY_CUSUM_H);
+            setFlagHysteresis(ANOMALY_NOISE, scores.noiseRatio, ANOMALY_NOISE_RATIO);
+
+            // El baseline sigue cambios lentos solo en estado normal (tampoco
+            // mientras el CUSUM acumula, para no absorber el comienzo de un escalón)
+            bool normal = (flags & ~ANOMALY_DRIFT) == 0 &&
+                          scores.cusumLeak == 0.0f && scores.cusumOcclusion == 0.0f;
+            if (normal) {
+                baselineMean += ANOMALY_BASELINE_ALPHA * residual;
+                baselineVar += ANOMALY_BASELINE_ALPHA * (residual * residual - baselineVar);
+                noiseVar += ANOMALY_BASELINE_ALPHA * (clipped * clipped - noiseVar);
+            }
+            scores.driftSigma = (baselineMean - referenceMean) / referenceSigma;
+            setFlagHysteresis(ANOMALY_DRIFT, fabsf(scores.driftSigma), ANOMALY_DRIFT_SIGMA);
+        }
+
+        if (++blockCount >= ANOMALY_BLOCK) {
+            blockCount = 0;
+            finishBlock();
+            if (learned()) setFlag(ANOMALY_PULSATION, pulsationStrikes >= 2);
+        }
+
+        return flags ^ previous;
+    }
+
+    uint8_t activeFlags() const { return flags; }
+    const AnomalyScores& currentScores() const { return scores; }
+    float baseline() const { return baselineMean; }
+    float reference() const { return referenceMean; }
+};
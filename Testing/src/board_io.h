@@ -0,0 +1,188 @@
+#pragma once
+#include <Arduino.h>
+#include "board_profile.h"
+#include "dev_i2c.h"
+#include "SM_4000.h"
+#include "sensor_elv.h"
+#include "ABPLLN.h"
+#include "CCDANN600MDSA3.h"
+#include "i2c_bus_manager.h"
+
+/*
+  Lectura física de los sensores de un perfil (política Source de ProfileRunner)
+
+  Hay una sobrecarga de read() por tipo de sensor, así el runner resuelve la
+  lectura en compilación. Solo se instancian las de los sensores del perfil:
+  un perfil sin SSCDANN no arrastra SPI ni el driver del CCDANN.
+
+  Los drivers tienen la dirección y el bus fijos (dev_i2c y Wire son el mismo
+  I2C3 en el Portenta); los static_assert avisan si un perfil declara otra
+  cosa que el driver no soporta. En modo ACQUIRE_CONCURRENT los sensores I2C
+  no usan los drivers sino start()/finish() sobre los periféricos de
+  i2c_bus_manager.h, con cualquier bus y dirección del perfil.
+
+  Cada lectura I2C se mide con el DWT (busyUs/reads por sensor) para
+  reportar la ocupación de los buses.
+*/
+
+// Pin de Arduino de un BoardPin
+constexpr int arduinoPin(BoardPin pin) {
+    return pin == PIN_D7  ? D7
+         : pin == PIN_D8  ? D8
+         : pin == PIN_D9  ? D9
+         : pin == PIN_D10 ? D10
+         : pin == PIN_D11 ? D11
+         : pin == PIN_D12 ? D12
+         : pin == PIN_A0  ? A0
+         : pin == PIN_A1  ? A1
+         : pin == PIN_A2  ? A2
+         : -1;
+}
+
+struct DeviceSource {
+    // Inicializa los drivers (o los periféricos asincrónicos) y los relojes de
+    // bus de todos los sensores del perfil
+    template <AcquireMode MODE, typename... Sensors>
+    void begin(SensorList<Sensors...>) {
+        i2cBusCyclesBegin();
+        using expand = int[];
+        (void)expand{0, (beginMode(Sensors(), std::integral_constant<bool, MODE == ACQUIRE_CONCURRENT &&
+                                                                           Sensors::desc().bus == BUS_I2C>()), 0)...};
+    }
+
+    // Tiempo de bus acumulado y lecturas I2C de un sensor
+    uint32_t busyUs(uint8_t sensorId) const {
+        return (uint32_t)(busyCycles[sensorId] / (SystemCoreClock / 1000000u));
+    }
+    uint32_t reads(uint8_t sensorId) const { return readCount[sensorId]; }
+
+    // ---- Modo concurrente (sensores I2C) ----
+
+    template <typename Sensor>
+    void start(Sensor) {
+        constexpr SensorDesc d = Sensor::desc();
+        buses[d.busIndex].start(d.address, tx[Sensor::id()], Sensor::txLength(), rx[Sensor::id()],
+                                Sensor::rxLength());
+    }
+
+    template <typename Sensor>
+    bool finish(Sensor, int32_t* raw) {
+        constexpr SensorDesc d = Sensor::desc();
+        I2cAsyncBus& bus = buses[d.busIndex];
+        bool ok = bus.wait();
+        account(Sensor::id(), bus.lastCycles);
+        return ok && Sensor::decode(rx[Sensor::id()], raw);
+    }
+
+    // ---- Lecturas bloqueantes con los drivers ----
+
+    template <typename Bus, uint8_t ADDRESS>
+    bool read(Sm4291I2c<Bus, ADDRESS>, int32_t* raw) {
+        int16_t counts;
+        uint32_t cycles = DWT->CYCCNT;
+        bool ok = SM_4000_readI2C_raw(&counts);
+        account(SENSOR_SM4291_I2C, DWT->CYCCNT - cycles);
+        if (!ok) return false;
+        *raw = counts;
+        return true;
+    }
+
+    template <BoardPin PIN>
+    bool read(Sm4291Analog<PIN>, int32_t* raw) {
+        *raw = analogRead(arduinoPin(PIN));
+        return true;
+    }
+
+    template <typename Bus, uint8_t ADDRESS>
+    bool read(ElvhI2c<Bus, ADDRESS>, int32_t* raw) {
+        int counts;
+        uint32_t cycles = DWT->CYCCNT;
+        bool ok = sensorELV_readRaw(&counts);
+        account(SENSOR_ELVH, DWT->CYCCNT - cycles);
+        if (!ok) return false;
+        *raw = counts;
+        return true;
+    }
+
+    template <typename Bus, uint8_t ADDRESS>
+    bool read(AbpllnI2c<Bus, ADDRESS>, int32_t* raw) {
+        uint16_t counts;
+        uint32_t cycles = DWT->CYCCNT;
+        bool ok = abpllnReadRaw(&counts);
+        account(SENSOR_ABPLLN, DWT->CYCCNT - cycles);
+        if (!ok) return false;
+        *raw = counts;
+        return true;
+    }
+
+    template <typename Bus, BoardPin CS>
+    bool read(SscdannSpi<Bus, CS>, int32_t* raw) {
+        uint16_t counts;
+        if (!CCDANN600MDSA3_readRaw(&counts)) return false;
+        *raw = counts;
+        return true;
+    }
+
+private:
+    I2cAsyncBus buses[I2C_BUS_PERIPHERALS];
+    uint8_t tx[SENSOR_COUNT][2];
+    uint8_t rx[SENSOR_COUNT][4];
+    uint64_t busyCycles[SENSOR_COUNT] = {};
+    uint32_t readCount[SENSOR_COUNT] = {};
+
+    void account(uint8_t sensorId, uint32_t cycles) {
+        busyCycles[sensorId] += cycles;
+        readCount[sensorId]++;
+    }
+
+    template <typename Sensor>
+    void beginMode(Sensor sensor, std::false_type) {
+        beginSensor(sensor);
+    }
+
+    // Sensor I2C en modo concurrente: periférico del bus y bytes a escribir
+    template <typename Sensor>
+    void beginMode(Sensor, std::true_type) {
+        constexpr SensorDesc d = Sensor::desc();
+        static_assert(d.busIndex >= 1 && d.busIndex < I2C_BUS_PERIPHERALS, "el H7 tiene los periféricos I2C1..I2C4");
+        static_assert(Sensor::txLength() <= sizeof(tx[0]) && Sensor::rxLength() <= sizeof(rx[0]),
+                      "transacción más larga que los buffers");
+        buses[d.busIndex].begin(d.busPins[0], d.busPins[1], d.busClockHz);
+        for (uint8_t i = 0; i < Sensor::txLength(); i++) tx[Sensor::id()][i] = Sensor::txByte(i);
+    }
+
+    template <typename Bus, uint8_t ADDRESS>
+    void beginSensor(Sm4291I2c<Bus, ADDRESS>) {
+        static_assert(Bus::index() == 3 && ADDRESS == 0x6C, "el driver del SM4291 usa dev_i2c (I2C3) en 0x6C");
+        static_assert(Bus::clockHz() == DEV_I2C_CLOCK_HZ, "devI2cRecover() vuelve dev_i2c a DEV_I2C_CLOCK_HZ");
+        dev_i2c.begin();
+        dev_i2c.setClock(Bus::clockHz());
+    }
+
+    template <BoardPin PIN>
+    void beginSensor(Sm4291Analog<PIN>) {
+        static_assert(arduinoPin(PIN) >= 0, "pin analógico sin equivalente en Arduino");
+        analogReadResolution(16);   // La calibración supone 16 bits
+    }
+
+    template <typename Bus, uint8_t ADDRESS>
+    void beginSensor(ElvhI2c<Bus, ADDRESS>) {
+        static_assert(Bus::index() == 3 && ADDRESS == SENSOR_I2C_ADDR, "el driver del ELVH usa dev_i2c (I2C3) en 0x28");
+        static_assert(Bus::clockHz() == DEV_I2C_CLOCK_HZ, "devI2cRecover() vuelve dev_i2c a DEV_I2C_CLOCK_HZ");
+        dev_i2c.begin();
+        dev_i2c.setClock(Bus::clockHz());
+    }
+
+    template <typename Bus, uint8_t ADDRESS>
+    void beginSensor(AbpllnI2c<Bus, ADDRESS>) {
+        static_assert(Bus::index() == 3 && ADDRESS == PRESSURE_SENSOR_ADDR, "el driver del ABPLLN usa Wire (I2C3) en 0x08");
+        Wire.begin();
+        Wire.setClock(Bus::clockHz());
+    }
+
+    template <typename Bus, BoardPin CS>
+    void beginSensor(SscdannSpi<Bus, CS>) {
+        // El driver fija el CS con CCDANN600MDSA3_CS_PIN (por defecto PIN_SPI_SS = D7)
+        CCDANN600MDSA3_begin();
+    }
+};
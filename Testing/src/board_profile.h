@@ -0,0 +1,796 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <tuple>
+#include <utility>
+#include <type_traits>
+#include "shared.h"
+#include "pressure_convert.h"
+
+/*
+  Perfiles de placa en tiempo de compilación
+
+  Un perfil declara como tipos los sensores (con su bus, dirección y pines),
+  el periodo del tick y las etapas de procesamiento por muestra:
+
+    using MiPerfil = BoardProfile<500,
+        SensorList<Sm4291I2c<BusI2c3>, Sm4291Analog<PIN_A0>>,
+        StageList<RangeCheckStage<>>>;
+
+  Al instanciarlo se verifica con static_assert que no haya dos sensores con
+  el mismo SensorId, direcciones repetidas en un bus I2C, un bus declarado con
+  pines o reloj distintos, pines usados por dos recursos, ni una lectura que
+  no entre en el periodo (la estimación usa el reloj de cada bus y la
+  cantidad de bytes de cada transacción), ni un bus I2C más rápido de lo que
+  admite alguno de sus sensores o con un sensor en una dirección reservada
+  por la placa.
+
+  Los sensores I2C pueden repartirse en varios periféricos (I2C1, I2C3,
+  I2C4). Con ACQUIRE_CONCURRENT el tick arranca a la vez una transacción en
+  cada bus (ronda por ronda) y la estimación pasa a ser la del bus más
+  cargado, no la suma de todos.
+
+  ProfileRunner genera el tick de adquisición expandiendo la lista de
+  sensores: cada lectura, su conversión (con la calibración como constante)
+  y las etapas quedan en línea, sin punteros a función ni switch por sensor,
+  y lo que el perfil no usa no se compila. La lectura física la hace una
+  política Source (board_io.h en la placa, datos simulados en el host) y la
+  salida una política Sink (el ring IPC en el M4).
+
+  Este archivo no depende de Arduino y compila también en el host.
+*/
+
+#define PROFILE_TICK_BUDGET_PERCENT  80    // Parte del periodo que puede ocupar la adquisición
+#define PROFILE_PUBLISH_US           2     // Publicar una muestra en el ring
+#define PROFILE_I2C_OVERHEAD_US      20    // Driver, interrupciones y subida de las líneas (tools/i2c_bus_sim.cpp)
+#define PROFILE_I2C_MAX_CLOCK_HZ     1000000   // Fast-mode Plus, lo máximo del periférico del H7
+#define PROFILE_SPI_OVERHEAD_US      5     // CS y tiempos tCSS/tCSH
+#define PROFILE_ADC_READ_US          20    // analogRead a 16 bits
+
+enum BusKind : uint8_t {
+    BUS_I2C,
+    BUS_SPI,
+    BUS_ADC,
+};
+
+// Pines de la placa que usan los sensores. Son propios (no los del core de
+// Arduino) para poder verificar perfiles en el host; board_io.h los traduce.
+enum BoardPin : uint8_t {
+    PIN_NONE = 0,
+    PIN_D7,      // CS de SPI por defecto
+    PIN_D8,      // SPI COPI
+    PIN_D9,      // SPI SCK
+    PIN_D10,     // SPI CIPO
+    PIN_D11,     // I2C3 SDA
+    PIN_D12,     // I2C3 SCL
+    PIN_A0,
+    PIN_A1,
+    PIN_A2,
+    PIN_I2C1_SDA,   // PB7 (conector HD, compartido con el PMIC y el chip criptográfico)
+    PIN_I2C1_SCL,   // PB6
+    PIN_I2C4_SDA,   // PH12 (conector HD)
+    PIN_I2C4_SCL,   // PH11
+};
+
+// Modo de adquisición de un perfil
+enum AcquireMode : uint8_t {
+    ACQUIRE_SEQUENTIAL,     // Una lectura detrás de otra, en el orden del perfil
+    ACQUIRE_CONCURRENT,     // Una transacción en curso por cada bus I2C a la vez
+};
+
+// Descripción de un sensor para las verificaciones del perfil
+struct SensorDesc {
+    uint8_t id;             // SensorId
+    BusKind bus;
+    uint8_t busIndex;
+    uint8_t address;        // Dirección I2C (0 si no aplica)
+    BoardPin busPins[3];    // Compartidos con los demás sensores del mismo bus
+    BoardPin ownPin;        // Exclusivo del sensor: CS o entrada analógica
+    uint32_t busClockHz;
+    uint32_t maxClockHz;    // Reloj máximo del sensor según su hoja de datos (0 si no aplica)
+    bool reservedAddress;   // La dirección la usa un dispositivo de la placa en ese bus
+    uint16_t readUs;        // Estimación de una lectura
+};
+
+// ---- Modelo de tiempo I2C ----
+
+// Mínimos de SCL en bajo y en alto según el modo (UM10204 de NXP, tabla 10).
+// El periférico del H7 reparte el periodo de SCL en esa proporción y usa los
+// mismos contadores para START, START repetido, STOP y tBUF.
+struct I2cModeTiming {
+    float lowMinUs;     // tLOW
+    float highMinUs;    // tHIGH
+};
+
+constexpr I2cModeTiming i2cModeTiming(uint32_t clockHz) {
+    return clockHz <= 100000 ? I2cModeTiming{4.7f, 4.0f}
+         : clockHz <= 400000 ? I2cModeTiming{1.3f, 0.6f}
+         :                     I2cModeTiming{0.5f, 0.26f};
+}
+
+// Tiempo de bus de una transacción: escritura de txBytes (si hay) y lectura
+// de rxBytes con START repetido, 9 bits por byte (ACK incluido) más la
+// dirección en cada fase. Antes del START repetido y del STOP SCL pasa un
+// tLOW en bajo, tSU y tHD duran un tHIGH y tBUF un tLOW. No incluye el
+// software del driver ni el tiempo de subida de las líneas.
+constexpr float i2cBusUs(uint32_t clockHz, uint8_t txBytes, uint8_t rxBytes) {
+    const I2cModeTiming t = i2cModeTiming(clockHz);
+    const float bitUs = 1e6f / (float)clockHz;
+    const float lowUs = bitUs * t.lowMinUs / (t.lowMinUs + t.highMinUs);
+    const float highUs = bitUs - lowUs;
+    float us = highUs;                              // tHD;STA
+    if (txBytes) us += 9.0f * (1 + txBytes) * bitUs;
+    if (rxBytes) {
+        if (txBytes) us += lowUs + 2.0f * highUs;   // tSU;STA y tHD;STA
+        us += 9.0f * (1 + rxBytes) * bitUs;
+    }
+    return us + lowUs + highUs + lowUs;             // tSU;STO y tBUF
+}
+
+// Estimación de una lectura completa (bus más driver), redondeada hacia arriba
+constexpr uint16_t i2cTransactionUs(uint32_t clockHz, uint8_t txBytes, uint8_t rxBytes) {
+    return (uint16_t)(i2cBusUs(clockHz, txBytes, rxBytes) + 0.999f) + PROFILE_I2C_OVERHEAD_US;
+}
+
+// ---- Buses ----
+
+// RESERVED: direcciones que ya ocupa la placa en ese periférico
+template <uint8_t INDEX, BoardPin SDA, BoardPin SCL, uint32_t CLOCK_HZ, uint8_t... RESERVED>
+struct I2cBus {
+    static_assert(CLOCK_HZ > 0 && CLOCK_HZ <= PROFILE_I2C_MAX_CLOCK_HZ, "reloj I2C fuera de 1 Hz..1 MHz");
+
+    static constexpr BusKind kind() { return BUS_I2C; }
+    static constexpr uint8_t index() { return INDEX; }
+    static constexpr uint32_t clockHz() { return CLOCK_HZ; }
+    static constexpr BoardPin pin(int i) { return i == 0 ? SDA : i == 1 ? SCL : PIN_NONE; }
+
+    static constexpr bool reserved(uint8_t address) {
+        const uint8_t list[] = {0, RESERVED...};
+        for (size_t i = 1; i < sizeof(list); i++) {
+            if (list[i] == address) return true;
+        }
+        return false;
+    }
+
+    // Escribe txBytes y lee rxBytes en una transacción
+    static constexpr uint16_t transactionUs(uint8_t txBytes, uint8_t rxBytes) {
+        return i2cTransactionUs(CLOCK_HZ, txBytes, rxBytes);
+    }
+};
+
+template <uint8_t INDEX, BoardPin SCK, BoardPin CIPO, BoardPin COPI, uint32_t CLOCK_HZ>
+struct SpiBus {
+    static constexpr BusKind kind() { return BUS_SPI; }
+    static constexpr uint8_t index() { return INDEX; }
+    static constexpr uint32_t clockHz() { return CLOCK_HZ; }
+    static constexpr BoardPin pin(int i) { return i == 0 ? SCK : i == 1 ? CIPO : i == 2 ? COPI : PIN_NONE; }
+
+    static constexpr uint32_t transferUs(uint32_t bytes) {
+        return (bytes * 8 * 1000000u + CLOCK_HZ - 1) / CLOCK_HZ + PROFILE_SPI_OVERHEAD_US;
+    }
+};
+
+// ---- Sensores ----
+// Cada tipo describe el sensor y su conversión; la lectura física está en
+// board_io.h. Los I2C describen además su transacción (bytes a escribir y a
+// leer) y cómo decodificar la respuesta, para el bus asincrónico.
+
+template <typename Bus, typename Sensor>
+constexpr SensorDesc i2cSensorDesc(uint8_t address) {
+    return SensorDesc{Sensor::id(), BUS_I2C, Bus::index(), address, {Bus::pin(0), Bus::pin(1), PIN_NONE},
+                      PIN_NONE, Bus::clockHz(), Sensor::maxClockHz(), Bus::reserved(address),
+                      Bus::transactionUs(Sensor::txLength(), Sensor::rxLength())};
+}
+
+template <typename Bus, uint8_t ADDRESS = 0x6C>
+struct Sm4291I2c {
+    static_assert(Bus::kind() == BUS_I2C, "el SM4291 digital va en un bus I2C");
+    static constexpr uint8_t id() { return SENSOR_SM4291_I2C; }
+    static constexpr uint8_t address() { return ADDRESS; }
+    static constexpr uint32_t maxClockHz() { return 400000; }
+
+    // Registro de presión (0x30) y, con START repetido, sus 2 bytes
+    static constexpr uint8_t txLength() { return 1; }
+    static constexpr uint8_t txByte(uint8_t) { return 0x30; }
+    static constexpr uint8_t rxLength() { return 2; }
+    static bool decode(const uint8_t* rx, int32_t* raw) {
+        *raw = (int16_t)((rx[1] << 8) | rx[0]);     // Complemento a 2, byte bajo primero
+        return true;
+    }
+
+    static constexpr SensorDesc desc() { return i2cSensorDesc<Bus, Sm4291I2c>(ADDRESS); }
+    static constexpr LinearCal cal() { return CAL_SM4291_I2C; }
+    static constexpr bool clamped() { return false; }
+    static constexpr float unitScale() { return 1.0f; }
+};
+
+template <BoardPin PIN>
+struct Sm4291Analog {
+    static constexpr uint8_t id() { return SENSOR_SM4291_ANALOG; }
+    static constexpr SensorDesc desc() {
+        return SensorDesc{id(), BUS_ADC, 0, 0, {PIN_NONE, PIN_NONE, PIN_NONE}, PIN, 0, 0, false,
+                          PROFILE_ADC_READ_US};
+    }
+    static constexpr BoardPin pin() { return PIN; }
+    static constexpr LinearCal cal() { return CAL_SM4291_ANALOG; }
+    static constexpr bool clamped() { return true; }
+    static constexpr float unitScale() { return 1.0f; }
+};
+
+template <typename Bus, uint8_t ADDRESS = 0x28>
+struct ElvhI2c {
+    static_assert(Bus::kind() == BUS_I2C, "el ELVH va en un bus I2C");
+    static constexpr uint8_t id() { return SENSOR_ELVH; }
+    static constexpr uint8_t address() { return ADDRESS; }
+    static constexpr uint32_t maxClockHz() { return 400000; }
+
+    // Solo los bytes de presión; estado 3 (diagnóstico) es error
+    static constexpr uint8_t txLength() { return 0; }
+    static constexpr uint8_t txByte(uint8_t) { return 0; }
+    static constexpr uint8_t rxLength() { return 2; }
+    static bool decode(const uint8_t* rx, int32_t* raw) {
+        if ((rx[0] >> 6) == 3) return false;
+        *raw = ((rx[0] & 0x3F) << 8) | rx[1];
+        return true;
+    }
+
+    static constexpr SensorDesc desc() { return i2cSensorDesc<Bus, ElvhI2c>(ADDRESS); }
+    static constexpr LinearCal cal() { return CAL_ELVH_BAR; }
+    static constexpr bool clamped() { return false; }
+    static constexpr float unitScale() { return 1000.0f; }    // bar -> mbar
+};
+
+template <typename Bus, uint8_t ADDRESS = 0x08>
+struct AbpllnI2c {
+    static_assert(Bus::kind() == BUS_I2C, "el ABPLLN va en un bus I2C");
+    static constexpr uint8_t id() { return SENSOR_ABPLLN; }
+    static constexpr uint8_t address() { return ADDRESS; }
+    static constexpr uint32_t maxClockHz() { return 400000; }
+
+    // Presión en 2 bytes; estado 3 (diagnóstico) es error
+    static constexpr uint8_t txLength() { return 0; }
+    static constexpr uint8_t txByte(uint8_t) { return 0; }
+    static constexpr uint8_t rxLength() { return 2; }
+    static bool decode(const uint8_t* rx, int32_t* raw) {
+        if ((rx[0] >> 6) == 3) return false;
+        *raw = ((rx[0] & 0x3F) << 8) | rx[1];
+        return true;
+    }
+
+    static constexpr SensorDesc desc() { return i2cSensorDesc<Bus, AbpllnI2c>(ADDRESS); }
+    static constexpr LinearCal cal() { return CAL_ABPLLN; }
+    static constexpr bool clamped() { return true; }
+    static constexpr float unitScale() { return 1.0f; }
+};
+
+template <typename Bus, BoardPin CS>
+struct SscdannSpi {
+    static_assert(Bus::kind() == BUS_SPI, "el SSCDANN va en un bus SPI");
+    static constexpr uint8_t id() { return SENSOR_SSCDANN; }
+    static constexpr SensorDesc desc() {
+        return SensorDesc{id(), BUS_SPI, Bus::index(), 0, {Bus::pin(0), Bus::pin(1), Bus::pin(2)},
+                          CS, Bus::clockHz(), 0, false, (uint16_t)Bus::transferUs(2)};
+    }
+    static constexpr LinearCal cal() { return CAL_SSCDANN; }
+    static constexpr bool clamped() { return false; }
+    static constexpr float unitScale() { return 1.0f; }
+};
+
+// ---- Etapas por muestra ----
+// process<Sensor>(sample) puede modificar la muestra; false la descarta
+
+// Marca SAMPLE_OUT_OF_RANGE las lecturas que se alejan de la banda de
+// calibración más de MARGIN_PERCENT del span (valores físicamente imposibles:
+// el M7 las trata como error). Cerca de los extremos el ruido normal cae fuera
+// de la banda, por eso el margen.
+template <uint8_t MARGIN_PERCENT = 25>
+struct RangeCheckStage {
+    static constexpr uint16_t costUs() { return 1; }
+
+    template <typename Sensor>
+    bool process(IpcSample& sample) {
+        constexpr LinearCal cal = Sensor::cal();
+        constexpr float margin = (cal.outHigh - cal.outLow) * MARGIN_PERCENT / 100.0f;
+        const float low = (cal.outLow - margin) * Sensor::unitScale();
+        const float high = (cal.outHigh + margin) * Sensor::unitScale();
+        if (sample.status == SAMPLE_OK && (sample.value < low || sample.value > high)) {
+            sample.status = SAMPLE_OUT_OF_RANGE;
+        }
+        return true;
+    }
+};
+
+// Filtro IIR de primer orden por sensor (alfa en milésimas)
+template <uint16_t ALPHA_PERMILLE>
+class IirStage {
+    static_assert(ALPHA_PERMILLE > 0 && ALPHA_PERMILLE <= 1000, "alfa entre 1 y 1000 milésimas");
+
+private:
+    float state[SENSOR_COUNT];
+    bool primed[SENSOR_COUNT];
+
+public:
+    IirStage() {
+        for (int i = 0; i < SENSOR_COUNT; i++) {
+            state[i] = 0.0f;
+            primed[i] = false;
+        }
+    }
+
+    static constexpr uint16_t costUs() { return 1; }
+
+    template <typename Sensor>
+    bool process(IpcSample& sample) {
+        if (sample.status != SAMPLE_OK) return true;
+        const uint8_t i = Sensor::id();
+        if (!primed[i]) {
+            state[i] = sample.value;
+            primed[i] = true;
+        } else {
+            state[i] += (ALPHA_PERMILLE / 1000.0f) * (sample.value - state[i]);
+        }
+        sample.value = state[i];
+        return true;
+    }
+};
+
+// Publica una de cada FACTOR muestras de cada sensor
+template <uint16_t FACTOR>
+class DecimateStage {
+    static_assert(FACTOR >= 1, "FACTOR debe ser al menos 1");
+
+private:
+    uint16_t count[SENSOR_COUNT];
+
+public:
+    DecimateStage() {
+        for (int i = 0; i < SENSOR_COUNT; i++) count[i] = 0;
+    }
+
+    static constexpr uint16_t costUs() { return 1; }
+
+    template <typename Sensor>
+    bool process(IpcSample&) {
+        uint16_t& c = count[Sensor::id()];
+        if (++c < FACTOR) return false;
+        c = 0;
+        return true;
+    }
+};
+
+// ---- Verificaciones ----
+
+constexpr bool descsUniqueIds(const SensorDesc* d, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (d[i].id >= SENSOR_COUNT) return false;
+        for (size_t j = i + 1; j < n; j++) {
+            if (d[i].id == d[j].id) return false;
+        }
+    }
+    return true;
+}
+
+constexpr bool sameBus(const SensorDesc& a, const SensorDesc& b) {
+    return a.bus != BUS_ADC && a.bus == b.bus && a.busIndex == b.busIndex;
+}
+
+constexpr bool descsNoAddressClash(const SensorDesc* d, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = i + 1; j < n; j++) {
+            if (d[i].bus == BUS_I2C && sameBus(d[i], d[j]) && d[i].address == d[j].address) return false;
+        }
+    }
+    return true;
+}
+
+// Un mismo bus (tipo e índice) tiene que tener los mismos pines y el mismo reloj en todos sus sensores
+constexpr bool descsBusesConsistent(const SensorDesc* d, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = i + 1; j < n; j++) {
+            if (!sameBus(d[i], d[j])) continue;
+            if (d[i].busClockHz != d[j].busClockHz) return false;
+            for (int p = 0; p < 3; p++) {
+                if (d[i].busPins[p] != d[j].busPins[p]) return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Ningún sensor I2C en un bus más rápido de lo que admite
+constexpr bool descsClocksAllowed(const SensorDesc* d, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (d[i].bus == BUS_I2C && d[i].busClockHz > d[i].maxClockHz) return false;
+    }
+    return true;
+}
+
+constexpr bool descsNoReservedAddress(const SensorDesc* d, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (d[i].bus == BUS_I2C && d[i].reservedAddress) return false;
+    }
+    return true;
+}
+
+// Dueño de un pin: el bus (compartido) o el sensor (exclusivo)
+constexpr uint32_t busOwner(const SensorDesc& d) {
+    return 0x10000u | ((uint32_t)d.bus << 8) | d.busIndex;
+}
+constexpr uint32_t sensorOwner(const SensorDesc& d) {
+    return 0x20000u | d.id;
+}
+
+constexpr bool descsNoPinClash(const SensorDesc* d, size_t n) {
+    BoardPin pins[SENSOR_COUNT * 4] = {};
+    uint32_t owners[SENSOR_COUNT * 4] = {};
+    size_t count = 0;
+    for (size_t i = 0; i < n && i < SENSOR_COUNT; i++) {
+        for (int p = 0; p < 3; p++) {
+            if (d[i].busPins[p] == PIN_NONE) continue;
+            pins[count] = d[i].busPins[p];
+            owners[count++] = busOwner(d[i]);
+        }
+        if (d[i].ownPin != PIN_NONE) {
+            pins[count] = d[i].ownPin;
+            owners[count++] = sensorOwner(d[i]);
+        }
+    }
+    for (size_t a = 0; a < count; a++) {
+        for (size_t b = a + 1; b < count; b++) {
+            if (pins[a] == pins[b] && owners[a] != owners[b]) return false;
+        }
+    }
+    return true;
+}
+
+template <typename... Sensors>
+constexpr bool profileUniqueIds() {
+    const SensorDesc d[] = {Sensors::desc()...};
+    return descsUniqueIds(d, sizeof...(Sensors));
+}
+
+template <typename... Sensors>
+constexpr bool profileNoAddressClash() {
+    const SensorDesc d[] = {Sensors::desc()...};
+    return descsNoAddressClash(d, sizeof...(Sensors));
+}
+
+template <typename... Sensors>
+constexpr bool profileBusesConsistent() {
+    const SensorDesc d[] = {Sensors::desc()...};
+    return descsBusesConsistent(d, sizeof...(Sensors));
+}
+
+template <typename... Sensors>
+constexpr bool profileNoPinClash() {
+    const SensorDesc d[] = {Sensors::desc()...};
+    return descsNoPinClash(d, sizeof...(Sensors));
+}
+
+template <typename... Sensors>
+constexpr bool profileClocksAllowed() {
+    const SensorDesc d[] = {Sensors::desc()...};
+    return descsClocksAllowed(d, sizeof...(Sensors));
+}
+
+template <typename... Sensors>
+constexpr bool profileNoReservedAddress() {
+    const SensorDesc d[] = {Sensors::desc()...};
+    return descsNoReservedAddress(d, sizeof...(Sensors));
+}
+
+template <typename... Stages>
+constexpr uint32_t stagesCostUs() {
+    const uint32_t costs[] = {0u, Stages::costUs()...};
+    uint32_t sum = 0;
+    for (uint32_t c : costs) sum += c;
+    return sum;
+}
+
+// Estimación del tick: lecturas más, por muestra, las etapas y la publicación.
+// mask limita la cuenta a los sensores activos (por defecto, todos)
+template <typename... Sensors>
+constexpr uint32_t sensorsReadUs(uint32_t mask = ~0u) {
+    const SensorDesc d[] = {Sensors::desc()...};
+    uint32_t sum = 0;
+    for (const SensorDesc& s : d) {
+        if (mask & (1u << s.id)) sum += s.readUs;
+    }
+    return sum;
+}
+
+template <typename... Sensors>
+constexpr uint32_t sensorsActive(uint32_t mask) {
+    const SensorDesc d[] = {Sensors::desc()...};
+    uint32_t count = 0;
+    for (const SensorDesc& s : d) {
+        if (mask & (1u << s.id)) count++;
+    }
+    return count;
+}
+
+// Posición de un sensor I2C entre los de su bus (0 = primero en el perfil):
+// en modo concurrente es la ronda en la que se lee
+constexpr uint8_t descBusRank(const SensorDesc* d, size_t i) {
+    uint8_t rank = 0;
+    for (size_t j = 0; j < i; j++) {
+        if (d[j].bus == BUS_I2C && sameBus(d[i], d[j])) rank++;
+    }
+    return rank;
+}
+
+// Lecturas en modo concurrente: en cada ronda los buses I2C trabajan en
+// paralelo y la ronda dura lo que su lectura más larga. SPI y ADC se leen
+// mientras corre la primera ronda, pero la estimación no lo descuenta.
+constexpr uint32_t descsConcurrentReadUs(const SensorDesc* d, size_t n, uint32_t mask = ~0u) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (d[i].bus != BUS_I2C && (mask & (1u << d[i].id))) sum += d[i].readUs;
+    }
+    for (uint8_t round = 0; round < n; round++) {
+        uint32_t longest = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (d[i].bus == BUS_I2C && (mask & (1u << d[i].id)) && descBusRank(d, i) == round &&
+                d[i].readUs > longest) {
+                longest = d[i].readUs;
+            }
+        }
+        sum += longest;
+    }
+    return sum;
+}
+
+template <typename... Sensors>
+constexpr uint32_t sensorsConcurrentReadUs(uint32_t mask = ~0u) {
+    const SensorDesc d[] = {Sensors::desc()...};
+    return descsConcurrentReadUs(d, sizeof...(Sensors), mask);
+}
+
+// Ocupación estimada de un bus I2C por tick
+template <typename... Sensors>
+constexpr uint32_t i2cBusLoadUs(uint8_t busIndex) {
+    const SensorDesc d[] = {Sensors::desc()...};
+    uint32_t sum = 0;
+    for (const SensorDesc& s : d) {
+        if (s.bus == BUS_I2C && s.busIndex == busIndex) sum += s.readUs;
+    }
+    return sum;
+}
+
+template <typename... Sensors>
+constexpr uint8_t sensorsRounds() {
+    const SensorDesc d[] = {Sensors::desc()...};
+    uint8_t rounds = 0;
+    for (size_t i = 0; i < sizeof...(Sensors); i++) {
+        if (d[i].bus == BUS_I2C && descBusRank(d, i) + 1 > rounds) rounds = descBusRank(d, i) + 1;
+    }
+    return rounds;
+}
+
+template <size_t I, typename... Sensors>
+constexpr uint8_t sensorBusRank() {
+    const SensorDesc d[] = {Sensors::desc()...};
+    return descBusRank(d, I);
+}
+
+// Bus I2C de cada sensor, 4 bits por SensorId (0 si no va por I2C)
+template <typename... Sensors>
+constexpr uint32_t sensorsI2cBusMap() {
+    const SensorDesc d[] = {Sensors::desc()...};
+    uint32_t map = 0;
+    for (const SensorDesc& s : d) {
+        if (s.bus == BUS_I2C) map |= (uint32_t)(s.busIndex & 0x0F) << (4 * s.id);
+    }
+    return map;
+}
+
+template <typename... Sensors>
+constexpr uint32_t sensorsMask(BusKind onlyBus = BUS_ADC, bool filter = false) {
+    const SensorDesc d[] = {Sensors::desc()...};
+    uint32_t mask = 0;
+    for (const SensorDesc& s : d) {
+        if (!filter || s.bus == onlyBus) mask |= 1u << s.id;
+    }
+    return mask;
+}
+
+// ---- Perfil ----
+
+template <typename... Sensors> struct SensorList {};
+template <typename... Stages> struct StageList {};
+
+template <uint32_t PERIOD_US, typename SensorTypes, typename StageTypes, AcquireMode MODE = ACQUIRE_SEQUENTIAL>
+struct BoardProfile;
+
+template <uint32_t PERIOD_US, typename... Sensors, typename... Stages, AcquireMode MODE>
+struct BoardProfile<PERIOD_US, SensorList<Sensors...>, StageList<Stages...>, MODE> {
+    static_assert(sizeof...(Sensors) > 0, "el perfil necesita al menos un sensor");
+    static_assert(sizeof...(Sensors) <= SENSOR_COUNT, "más sensores que SensorId");
+    static_assert(profileUniqueIds<Sensors...>(), "dos sensores con el mismo SensorId");
+    static_assert(profileNoAddressClash<Sensors...>(), "dos sensores con la misma dirección en un bus I2C");
+    static_assert(profileNoReservedAddress<Sensors...>(), "un sensor en una dirección I2C reservada por la placa");
+    static_assert(profileBusesConsistent<Sensors...>(), "un bus declarado con pines o reloj distintos");
+    static_assert(profileClocksAllowed<Sensors...>(), "un bus I2C más rápido que el máximo de uno de sus sensores");
+    static_assert(profileNoPinClash<Sensors...>(), "un pin asignado a dos recursos distintos");
+
+    using SensorTypeList = SensorList<Sensors...>;
+    using StageTuple = std::tuple<Stages...>;
+
+    static constexpr uint32_t periodUs() { return PERIOD_US; }
+    static constexpr AcquireMode mode() { return MODE; }
+    static constexpr size_t sensorCount() { return sizeof...(Sensors); }
+    static constexpr uint32_t sensorMask() { return sensorsMask<Sensors...>(); }
+    static constexpr uint32_t i2cMask() { return sensorsMask<Sensors...>(BUS_I2C, true); }
+    static constexpr uint32_t i2cBusMap() { return sensorsI2cBusMap<Sensors...>(); }
+    static constexpr uint32_t busLoadUs(uint8_t busIndex) { return i2cBusLoadUs<Sensors...>(busIndex); }
+
+    // Lecturas de un tick según el modo, con los sensores de mask
+    static constexpr uint32_t readUs(uint32_t mask = ~0u) {
+        return MODE == ACQUIRE_CONCURRENT ? sensorsConcurrentReadUs<Sensors...>(mask)
+                                          : sensorsReadUs<Sensors...>(mask);
+    }
+
+    // Duración estimada de un tick (por defecto con todos los sensores)
+    static constexpr uint32_t tickUs(uint32_t mask = ~0u) {
+        return readUs(mask) + sensorsActive<Sensors...>(mask) * (PROFILE_PUBLISH_US + stagesCostUs<Stages...>());
+    }
+    static constexpr uint32_t budgetUs() { return PERIOD_US * PROFILE_TICK_BUDGET_PERCENT / 100; }
+
+    // Periodo mínimo que respeta el presupuesto con los sensores de mask (para
+    // rechazar cambios de periodo o de sensores en tiempo de ejecución)
+    static constexpr uint32_t minPeriodUs(uint32_t mask = ~0u) {
+        return (tickUs(mask) * 100 + PROFILE_TICK_BUDGET_PERCENT - 1) / PROFILE_TICK_BUDGET_PERCENT;
+    }
+
+    static_assert(tickUs() <= PERIOD_US * PROFILE_TICK_BUDGET_PERCENT / 100,
+                  "la adquisición estimada no entra en el periodo del tick");
+};
+
+// ---- Tick generado ----
+
+template <typename Profile, typename Source, typename Sink>
+class ProfileRunner;
+
+// Source tiene que ofrecer read(Sensor, int32_t* raw) para todos los sensores
+// y, en modo concurrente, start(Sensor) y finish(Sensor, int32_t* raw) para
+// los I2C: start() arranca la transacción sin esperar y finish() espera a que
+// termine y decodifica la respuesta.
+template <uint32_t PERIOD_US, typename... Sensors, typename... Stages, AcquireMode MODE, typename Source, typename Sink>
+class ProfileRunner<BoardProfile<PERIOD_US, SensorList<Sensors...>, StageList<Stages...>, MODE>, Source, Sink> {
+private:
+    using Mode = std::integral_constant<AcquireMode, MODE>;
+    using Sequential = std::integral_constant<AcquireMode, ACQUIRE_SEQUENTIAL>;
+    using Concurrent = std::integral_constant<AcquireMode, ACQUIRE_CONCURRENT>;
+
+    Source& source;
+    Sink& sink;
+    std::tuple<Stages...> stages;
+
+    // Modo concurrente: muestras del tick en el orden del perfil
+    IpcSample pending[sizeof...(Sensors)];
+    bool keep[sizeof...(Sensors)];
+
+    template <typename Sensor, size_t... I>
+    bool runStages(IpcSample& sample, std::index_sequence<I...>) {
+        bool keep = true;
+        using expand = int[];
+        (void)expand{0, (keep = keep && std::get<I>(stages).template process<Sensor>(sample), 0)...};
+        return keep;
+    }
+
+    // Arma la muestra de una lectura terminada y le aplica las etapas;
+    // false si alguna etapa la descarta
+    template <typename Sensor>
+    inline bool convert(IpcSample& sample, bool ok, int32_t raw, uint32_t timestampUs, uint16_t sequence,
+                        uint32_t& errors) {
+        constexpr LinearCal cal = Sensor::cal();
+        sample.timestampUs = timestampUs;
+        sample.sensorId = Sensor::id();
+        sample.status = ok ? SAMPLE_OK : SAMPLE_BUS_ERROR;
+        sample.sequence = sequence;
+        sample.raw = raw;
+        sample.value = 0.0f;
+        if (ok) {
+            float value = Sensor::clamped() ? pressureConvertClamped((float)raw, cal)
+                                            : pressureConvert((float)raw, cal);
+            sample.value = value * Sensor::unitScale();
+        } else {
+            errors |= 1u << Sensor::id();
+        }
+        return runStages<Sensor>(sample, std::index_sequence_for<Stages...>());
+    }
+
+    template <typename Sensor>
+    inline void acquire(uint32_t timestampUs, uint16_t sequence, uint32_t mask, uint32_t& errors) {
+        if (!(mask & (1u << Sensor::id()))) return;
+
+        int32_t raw = 0;
+        bool ok = source.read(Sensor(), &raw);
+        IpcSample sample;
+        if (convert<Sensor>(sample, ok, raw, timestampUs, sequence, errors)) {
+            sink.publish(sample);
+        }
+    }
+
+    // start()/finish() solo se instancian para los sensores I2C
+    template <typename Sensor>
+    using IsI2c = std::integral_constant<bool, Sensor::desc().bus == BUS_I2C>;
+
+    // Ronda 'round': arranca la transacción del sensor en cada bus
+    template <size_t I, typename Sensor>
+    inline void startRound(uint8_t round, uint32_t mask, std::true_type) {
+        if (!(mask & (1u << Sensor::id())) || sensorBusRank<I, Sensors...>() != round) return;
+        source.start(Sensor());
+    }
+    template <size_t I, typename Sensor>
+    inline void startRound(uint8_t, uint32_t, std::false_type) {}
+
+    template <size_t I, typename Sensor>
+    inline void finishRound(uint8_t round, uint32_t timestampUs, uint16_t sequence, uint32_t mask,
+                            uint32_t& errors, std::true_type) {
+        if (!(mask & (1u << Sensor::id())) || sensorBusRank<I, Sensors...>() != round) return;
+        int32_t raw = 0;
+        bool ok = source.finish(Sensor(), &raw);
+        keep[I] = convert<Sensor>(pending[I], ok, raw, timestampUs, sequence, errors);
+    }
+    template <size_t I, typename Sensor>
+    inline void finishRound(uint8_t, uint32_t, uint16_t, uint32_t, uint32_t&, std::false_type) {}
+
+    // Los sensores que no van por I2C se leen mientras corre la primera ronda
+    template <size_t I, typename Sensor>
+    inline void readOthers(uint32_t timestampUs, uint16_t sequence, uint32_t mask, uint32_t& errors,
+                           std::false_type) {
+        if (!(mask & (1u << Sensor::id()))) return;
+        int32_t raw = 0;
+        bool ok = source.read(Sensor(), &raw);
+        keep[I] = convert<Sensor>(pending[I], ok, raw, timestampUs, sequence, errors);
+    }
+    template <size_t I, typename Sensor>
+    inline void readOthers(uint32_t, uint16_t, uint32_t, uint32_t&, std::true_type) {}
+
+    uint32_t tickMode(uint32_t timestampUs, uint16_t sequence, uint32_t mask, Sequential) {
+        uint32_t errors = 0;
+        using expand = int[];
+        (void)expand{0, (acquire<Sensors>(timestampUs, sequence, mask, errors), 0)...};
+        return errors;
+    }
+
+    uint32_t tickMode(uint32_t timestampUs, uint16_t sequence, uint32_t mask, Concurrent) {
+        return tickConcurrent(timestampUs, sequence, mask, std::index_sequence_for<Sensors...>());
+    }
+
+    // Las muestras se publican al final y en el orden del perfil, igual que
+    // en modo secuencial (el M7 espera la I2C del SM4291 antes que la analógica)
+    template <size_t... I>
+    uint32_t tickConcurrent(uint32_t timestampUs, uint16_t sequence, uint32_t mask, std::index_sequence<I...>) {
+        uint32_t errors = 0;
+        using expand = int[];
+        for (size_t i = 0; i < sizeof...(Sensors); i++) keep[i] = false;
+        for (uint8_t round = 0; round < sensorsRounds<Sensors...>(); round++) {
+            (void)expand{0, (startRound<I, Sensors>(round, mask, IsI2c<Sensors>()), 0)...};
+            if (round == 0) {
+                (void)expand{0, (readOthers<I, Sensors>(timestampUs, sequence, mask, errors, IsI2c<Sensors>()), 0)...};
+            }
+            (void)expand{0, (finishRound<I, Sensors>(round, timestampUs, sequence, mask, errors, IsI2c<Sensors>()), 0)...};
+        }
+        if (sensorsRounds<Sensors...>() == 0) {
+            (void)expand{0, (readOthers<I, Sensors>(timestampUs, sequence, mask, errors, IsI2c<Sensors>()), 0)...};
+        }
+        for (size_t i = 0; i < sizeof...(Sensors); i++) {
+            if (keep[i]) sink.publish(pending[i]);
+        }
+        return errors;
+    }
+
+public:
+    ProfileRunner(Source& src, Sink& out) : source(src), sink(out) {}
+
+    // Lee los sensores del perfil habilitados en 'mask' y publica sus muestras
+    // en el orden del perfil. Devuelve la máscara de sensores con error de bus.
+    uint32_t tick(uint32_t timestampUs, uint16_t sequence, uint32_t mask) {
+        return tickMode(timestampUs, sequence, mask, Mode());
+    }
+
+    template <size_t I>
+    typename std::tuple_element<I, std::tuple<Stages...>>::type& stage() { return std::get<I>(stages); }
+};
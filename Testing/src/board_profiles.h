@@ -0,0 +1,60 @@
+#pragma once
+#include "board_profile.h"
+
+/*
+  Perfiles de placa disponibles (ver board_profile.h)
+
+  El M4 elige uno con BOARD_PROFILE; tools/profile_check.cpp los instancia
+  todos en el host, así un perfil con conflictos de pines/direcciones o que no
+  entra en el periodo falla al compilar la herramienta.
+
+  Los buses I2C van a 400 kHz: a los 100 kHz por defecto de Wire una lectura
+  del SM4291 se estima en ~500 us y no entra en un tick de 2 kHz. Más rápido
+  no se puede: los cuatro sensores I2C admiten hasta 400 kHz según sus hojas
+  de datos, y el perfil no compila con un bus en Fast-mode Plus (1 MHz) si
+  tiene alguno de ellos. Para bajar el tick hay que repartirlos en buses y
+  leerlos en paralelo (tools/i2c_bus_sim.cpp valida el modelo de tiempo y
+  sugiere la ubicación).
+
+  Este archivo no depende de Arduino y compila también en el host.
+*/
+
+// Bus I2C3 de la placa (D11/D12): SM4291, ELVH y ABPLLN
+using BusI2c3 = I2cBus<3, PIN_D11, PIN_D12, 400000>;
+
+// I2C1 (conector HD): compartido con el PMIC PF1550 (0x08, la misma
+// dirección que el ABPLLN) y el chip criptográfico (0x60)
+using BusI2c1 = I2cBus<1, PIN_I2C1_SDA, PIN_I2C1_SCL, 400000, 0x08, 0x60>;
+
+// I2C4 (conector HD), libre
+using BusI2c4 = I2cBus<4, PIN_I2C4_SDA, PIN_I2C4_SCL, 400000>;
+
+// SPI del conector (SCK D9, CIPO D10, COPI D8) a la velocidad del SSCDANN
+using BusSpi1 = SpiBus<1, PIN_D9, PIN_D10, PIN_D8, 750000>;
+
+// Succión: SM4291 digital a 2 kHz
+using ProfileSuction = BoardProfile<500,
+    SensorList<Sm4291I2c<BusI2c3>>,
+    StageList<RangeCheckStage<>>>;
+
+// Succión con redundancia: SM4291 digital y su salida analógica a 2 kHz
+using ProfileSuctionRedundant = BoardProfile<500,
+    SensorList<Sm4291I2c<BusI2c3>, Sm4291Analog<PIN_A0>>,
+    StageList<RangeCheckStage<>>>;
+
+// Multipunto: los cuatro sensores de presión a 2 kHz (correlación cruzada)
+using ProfileMultiPoint = BoardProfile<500,
+    SensorList<Sm4291I2c<BusI2c3>, ElvhI2c<BusI2c3>, AbpllnI2c<BusI2c3>, SscdannSpi<BusSpi1, PIN_D7>>,
+    StageList<RangeCheckStage<>>>;
+
+// Monitoreo lento: SM4291 filtrado y decimado a 100 Hz sobre un tick de 1 kHz
+using ProfileSlowMonitor = BoardProfile<1000,
+    SensorList<Sm4291I2c<BusI2c3>>,
+    StageList<RangeCheckStage<>, IirStage<100>, DecimateStage<10>>>;
+
+// Multipunto con un sensor I2C por bus, leídos en paralelo: el tick baja de
+// la suma de las cuatro lecturas a la más larga (la del SM4291)
+using ProfileMultiPointSplit = BoardProfile<500,
+    SensorList<Sm4291I2c<BusI2c3>, ElvhI2c<BusI2c1>, AbpllnI2c<BusI2c4>, SscdannSpi<BusSpi1, PIN_D7>>,
+    StageList<RangeCheckStage<>>,
+    ACQUIRE_CONCURRENT>;
@@ -0,0 +1,68 @@
+#pragma once
+#include <stdint.h>
+
+/*
+  Marcas de tiempo de las fases del arranque
+
+  setup() marca cada fase con micros() apenas termina; como el contador de
+  microsegundos arranca con el runtime, el valor es el tiempo desde el reset
+  (sin el bootloader). El puerto serie puede no estar conectado todavía, así
+  que las marcas se guardan acá y el M7 las envía cuando el host se conecta:
+      #BOOT <fase> <micros>
+  y al final "#BOOT budget <micros hasta la adquisición> ok|late".
+
+  La adquisición tiene que arrancar antes de BOOT_ACQ_BUDGET_US: nada lento
+  (esperar al host, animaciones, escaneos del bus, montar el log) va antes de
+  la fase BOOT_ACQ_START.
+
+  Este archivo no depende de Arduino y compila también en el host.
+*/
+
+#define BOOT_ACQ_BUDGET_US  100000   // Del reset al arranque de la adquisición
+
+enum BootPhase : uint8_t {
+    BOOT_SETUP,         // Entrada a setup()
+    BOOT_LED,           // LED en azul (inicializando)
+    BOOT_M4,            // Bloque compartido listo y M4 arrancado
+    BOOT_SENSORS,       // Sensores locales configurados (caché de descubrimiento leído)
+    BOOT_ACQ_START,     // Timer o M4 adquiriendo
+    BOOT_FIRST_SAMPLE,  // Primera muestra procesada en el M7
+    BOOT_STORAGE,       // Log de la flash montado
+    BOOT_HOST,          // Host conectado al puerto serie
+    BOOT_PHASES
+};
+
+inline const char* bootPhaseName(uint8_t phase) {
+    switch (phase) {
+        case BOOT_SETUP:        return "setup";
+        case BOOT_LED:          return "led";
+        case BOOT_M4:           return "m4";
+        case BOOT_SENSORS:      return "sensors";
+        case BOOT_ACQ_START:    return "acq";
+        case BOOT_FIRST_SAMPLE: return "sample";
+        case BOOT_STORAGE:      return "storage";
+        case BOOT_HOST:         return "host";
+        default:                return "?";
+    }
+}
+
+struct BootTimeline {
+    uint32_t us[BOOT_PHASES];
+    uint16_t marked;        // Bit por fase ya marcada
+
+    void reset() {
+        for (uint8_t p = 0; p < BOOT_PHASES; p++) us[p] = 0;
+        marked = 0;
+    }
+
+    // Solo cuenta la primera marca de cada fase
+    void mark(BootPhase phase, uint32_t nowUs) {
+        if (has(phase)) return;
+        us[phase] = nowUs;
+        marked |= 1u << phase;
+    }
+
+    bool has(uint8_t phase) const { return phase < BOOT_PHASES && (marked & (1u << phase)); }
+
+    bool withinBudget() const { return has(BOOT_ACQ_START) && us[BOOT_ACQ_START] <= BOOT_ACQ_BUDGET_US; }
+};
@@ -0,0 +1,161 @@
+#pragma once
+#include <stdint.h>
+#include "cmd_protocol.h"
+#include "runtime_config.h"
+#include "shared.h"
+#include "board_profile.h"
+#include "pressure_control.h"
+
+/*
+  Validación y codificación de los comandos de configuración
+
+  Es la parte del enlace con el host (host_link.h) que no toca el puerto:
+  los comandos SET validan el payload completo y recién entonces escriben en
+  la configuración recibida, así un comando rechazado no deja nada a medias.
+  El firmware y el dispositivo nativo de pruebas (tools/cmd_device.cpp) usan
+  el mismo código.
+
+  Lo que acepta cada build (sensores, ventana de curtosis, control de succión,
+  costo del tick para el periodo mínimo) va en CmdCapabilities, armado por
+  quien llama según sus #define.
+
+  Este archivo no depende de Arduino y compila también en el host.
+*/
+
+struct CmdCapabilities {
+    uint32_t sensorMask;        // Sensores que este build puede adquirir
+    uint32_t requiredSensors;   // Sensores que no se pueden apagar (el canal principal)
+    uint16_t maxWindow;         // WINDOW_SIZE
+    bool control;               // ENABLE_CONTROL: admite consigna y ganancias
+    bool window;                // Ventana y umbrales de curtosis (window_analysis.h en el procesamiento)
+    uint16_t tickUs;            // Tick de adquisición del M7 sin las lecturas
+    uint16_t readUs[SENSOR_COUNT];  // Lectura de cada sensor en ese tick (0 si no la hace el M7)
+};
+
+// Periodo mínimo con los sensores de mask: el tick del M7 ocupa a lo sumo
+// PROFILE_TICK_BUDGET_PERCENT del periodo, el mismo criterio que los perfiles
+// del M4 (que además validan sus lecturas al recibir el cambio)
+inline uint32_t cmdMinPeriodUs(const CmdCapabilities& caps, uint32_t mask) {
+    uint32_t tickUs = caps.tickUs;
+    for (uint8_t id = 0; id < SENSOR_COUNT; id++) {
+        if (mask & (1u << id)) tickUs += caps.readUs[id];
+    }
+    return (tickUs * 100 + PROFILE_TICK_BUDGET_PERCENT - 1) / PROFILE_TICK_BUDGET_PERCENT;
+}
+
+// Aplica un comando SET sobre config; CMD_OK si lo aceptó
+inline uint8_t cmdApplySet(const CmdFrame& f, RuntimeConfig& config, const CmdCapabilities& caps) {
+    switch (f.cmd) {
+        case CMD_SET_PERIOD: {
+            if (f.len != 4) return CMD_ERR_LENGTH;
+            uint32_t period = cmdGetU32(f.payload);
+            if (period < cmdMinPeriodUs(caps, config.sensorMask) || period > MAX_PERIOD_US) return CMD_ERR_RANGE;
+            config.periodUs = period;
+            return CMD_OK;
+        }
+        case CMD_SET_SENSORS: {
+            if (f.len != 4) return CMD_ERR_LENGTH;
+            uint32_t mask = cmdGetU32(f.payload);
+            if (mask == 0 || mask >= (1u << SENSOR_COUNT)) return CMD_ERR_RANGE;
+            // Sensores que este build no lee, o apagar el canal principal
+            if ((mask & ~caps.sensorMask) || (mask & caps.requiredSensors) != caps.requiredSensors) {
+                return CMD_ERR_UNSUPPORTED;
+            }
+            // Las lecturas de más no entran en el periodo actual
+            if (config.periodUs < cmdMinPeriodUs(caps, mask)) return CMD_ERR_RANGE;
+            config.sensorMask = mask;
+            return CMD_OK;
+        }
+        case CMD_SET_WINDOW: {
+            if (!caps.window) return CMD_ERR_UNSUPPORTED;
+            if (f.len != 2) return CMD_ERR_LENGTH;
+            uint16_t length = cmdGetU16(f.payload);
+            if (length < 4 || length > caps.maxWindow) return CMD_ERR_RANGE;
+            config.windowLength = length;
+            return CMD_OK;
+        }
+        case CMD_SET_THRESHOLDS: {
+            if (f.len != 8) return CMD_ERR_LENGTH;
+            float lowMax = cmdGetF32(f.payload);
+            float mediumMax = cmdGetF32(f.payload + 4);
+            // Succión negativa: 0 > bajo > medio > -500
+            if (!(lowMax < 0.0f && mediumMax < lowMax && mediumMax > -500.0f)) return CMD_ERR_RANGE;
+            config.suctionLowMax = lowMax;
+            config.suctionMediumMax = mediumMax;
+            return CMD_OK;
+        }
+        case CMD_SET_FILTER: {
+            if (f.len != 4) return CMD_ERR_LENGTH;
+            float alpha = cmdGetF32(f.payload);
+            if (!(alpha > 0.0f && alpha <= 1.0f)) return CMD_ERR_RANGE;
+            config.filterAlpha = alpha;
+            return CMD_OK;
+        }
+        case CMD_SET_KURTOSIS: {
+            if (!caps.window) return CMD_ERR_UNSUPPORTED;
+            if (f.len != 8) return CMD_ERR_LENGTH;
+            float low = cmdGetF32(f.payload);
+            float high = cmdGetF32(f.payload + 4);
+            if (!(low > 0.0f && high > low)) return CMD_ERR_RANGE;
+            config.kurtosisLow = low;
+            config.kurtosisHigh = high;
+            return CMD_OK;
+        }
+        case CMD_SET_SETPOINT: {
+            if (!caps.control) return CMD_ERR_UNSUPPORTED;
+            if (f.len != 4) return CMD_ERR_LENGTH;
+            float setpoint = cmdGetF32(f.payload);
+            // Consigna dentro del rearme del corte por sobrepresión
+            if (!(setpoint <= 0.0f && setpoint > CONTROL_MAX_SUCTION_MBAR + CONTROL_LIMIT_HYSTERESIS)) return CMD_ERR_RANGE;
+            config.controlSetpoint = setpoint;
+            return CMD_OK;
+        }
+        case CMD_SET_PID: {
+            if (!caps.control) return CMD_ERR_UNSUPPORTED;
+            if (f.len != 16) return CMD_ERR_LENGTH;
+            float kp = cmdGetF32(f.payload);
+            float ki = cmdGetF32(f.payload + 4);
+            float kd = cmdGetF32(f.payload + 8);
+            float kff = cmdGetF32(f.payload + 12);
+            if (!(kp >= 0.0f && ki >= 0.0f && kd >= 0.0f && kff >= 0.0f)) return CMD_ERR_RANGE;
+            config.controlKp = kp;
+            config.controlKi = ki;
+            config.controlKd = kd;
+            config.controlKff = kff;
+            return CMD_OK;
+        }
+        case CMD_STREAM_START:
+        case CMD_STREAM_STOP:
+            if (f.len != 0) return CMD_ERR_LENGTH;
+            config.streaming = (f.cmd == CMD_STREAM_START);
+            return CMD_OK;
+        default:
+            return CMD_ERR_UNKNOWN;
+    }
+}
+
+// Respuesta de CMD_GET_CONFIG; devuelve la longitud
+inline uint8_t cmdEncodeConfig(const RuntimeConfig& c, uint8_t* data) {
+    cmdPutU32(&data[0], c.periodUs);
+    cmdPutU32(&data[4], c.sensorMask);
+    cmdPutU16(&data[8], c.windowLength);
+    data[10] = c.streaming ? 1 : 0;
+    cmdPutF32(&data[11], c.suctionLowMax);
+    cmdPutF32(&data[15], c.suctionMediumMax);
+    cmdPutF32(&data[19], c.filterAlpha);
+    cmdPutF32(&data[23], c.kurtosisLow);
+    cmdPutF32(&data[27], c.kurtosisHigh);
+    return 31;
+}
+
+// Respuesta de CMD_GET_STATS; devuelve la longitud
+inline uint8_t cmdEncodeStats(const RuntimeStats& stats, uint8_t* data) {
+    cmdPutU32(&data[0], stats.readings);
+    cmdPutU32(&data[4], stats.errors);
+    cmdPutU32(&data[8], stats.consecutiveErrors);
+    cmdPutU32(&data[12], stats.configChanges);
+    cmdPutU32(&data[16], stats.dropped);
+    cmdPutU32(&data[20], stats.uptimeMs);
+    cmdPutF32(&data[24], stats.lastValue);
+    return 28;
+}
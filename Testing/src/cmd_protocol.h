@@ -0,0 +1,159 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/*
+  Protocolo binario de comandos host <-> dispositivo
+
+  Trama:  0xA5 0x5A | cmd | len | payload[len] | crc8
+  - crc8 (polinomio 0x07) cubre cmd, len y payload
+  - Las respuestas usan cmd | 0x80 y el primer byte del payload es el estado
+  - Enteros y floats en little-endian
+
+  El byte 0xA5 no aparece en el texto ASCII que envía el firmware, así que
+  tramas binarias y líneas de texto (muestras, SYNC) comparten el mismo puerto.
+  Este archivo no depende de Arduino y compila también en el host.
+*/
+
+#define CMD_SYNC0          0xA5
+#define CMD_SYNC1          0x5A
+#define CMD_MAX_PAYLOAD    32
+#define CMD_FRAME_OVERHEAD 5
+#define CMD_RESPONSE_FLAG  0x80
+
+enum CmdId : uint8_t {
+    CMD_PING = 0x01,
+    CMD_GET_CONFIG = 0x02,
+    CMD_SET_PERIOD = 0x10,       // u32 periodo del timer en us
+    CMD_SET_SENSORS = 0x11,      // u32 máscara de SensorId
+    CMD_SET_WINDOW = 0x12,       // u16 tamaño de la ventana de curtosis
+    CMD_SET_THRESHOLDS = 0x13,   // f32 límite succión baja, f32 límite succión media (mbar)
+    CMD_SET_FILTER = 0x14,       // f32 coeficiente alfa del filtro IIR (1.0 = sin filtro)
+    CMD_SET_KURTOSIS = 0x15,     // f32 curtosis baja, f32 curtosis alta
+    CMD_SET_SETPOINT = 0x16,     // f32 consigna del control de succión (mbar, 0 = apagado)
+    CMD_SET_PID = 0x17,          // f32 kp, f32 ki, f32 kd, f32 kff
+    CMD_GET_STATS = 0x20,
+    CMD_STREAM_START = 0x30,
+    CMD_STREAM_STOP = 0x31,
+    CMD_LOG_INFO = 0x40,         // -> u32 más viejo, u32 más nuevo, u32 capacidad, u16 tamaño de bloque
+    CMD_LOG_READ = 0x41,         // u32 primera secuencia, u16 cantidad (<= CMD_LOG_READ_MAX)
+    CMD_LOG_DATA = 0x42,         // Solo del dispositivo: trozo de la descarga de CMD_LOG_READ
+    CMD_CYCLE_LEARN = 0x50       // u8 plantilla: guarda la forma del último ciclo (CMD_CYCLE_CLEAR_ALL borra todas)
+};
+
+// CMD_LOG_READ: tras la respuesta llegan los 'cantidad' bloques (LOG_BLOCK_SIZE
+// bytes cada uno; un bloque inexistente con 0xFF) en respuestas CMD_LOG_DATA:
+// estado, u16 posición en bytes dentro de la descarga y hasta
+// CMD_LOG_DATA_CHUNK bytes. Se envían de a poco desde la tarea del host,
+// mezcladas con el texto como cualquier otra trama.
+#define CMD_LOG_READ_MAX   64
+#define CMD_LOG_DATA_CHUNK (CMD_MAX_PAYLOAD - 3)
+
+// CMD_CYCLE_LEARN con esta plantilla borra todas (se vuelven a aprender solas)
+#define CMD_CYCLE_CLEAR_ALL 0xFF
+
+enum CmdStatus : uint8_t {
+    CMD_OK = 0,
+    CMD_ERR_UNKNOWN = 1,
+    CMD_ERR_LENGTH = 2,
+    CMD_ERR_RANGE = 3,
+    CMD_ERR_UNSUPPORTED = 4,    // Válido, pero este build no lo admite (ver #define en main.cpp)
+    CMD_ERR_TIMEOUT = 5         // El M4 no confirmó el cambio (ACQ_ON_M4); la configuración no cambió
+};
+
+struct CmdFrame {
+    uint8_t cmd;
+    uint8_t len;
+    uint8_t payload[CMD_MAX_PAYLOAD];
+};
+
+inline uint8_t cmdCrc8(uint8_t crc, const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+// Arma una trama en out (tamaño mínimo len + CMD_FRAME_OVERHEAD); devuelve su longitud
+inline size_t cmdEncodeFrame(uint8_t cmd, const uint8_t* payload, uint8_t len, uint8_t* out) {
+    if (len > CMD_MAX_PAYLOAD) return 0;
+    out[0] = CMD_SYNC0;
+    out[1] = CMD_SYNC1;
+    out[2] = cmd;
+    out[3] = len;
+    if (len > 0) memcpy(&out[4], payload, len);
+    out[4 + len] = cmdCrc8(0, &out[2], (size_t)len + 2);
+    return (size_t)len + CMD_FRAME_OVERHEAD;
+}
+
+// Lectura/escritura de valores en el payload
+inline uint16_t cmdGetU16(const uint8_t* p) { uint16_t v; memcpy(&v, p, sizeof(v)); return v; }
+inline uint32_t cmdGetU32(const uint8_t* p) { uint32_t v; memcpy(&v, p, sizeof(v)); return v; }
+inline float cmdGetF32(const uint8_t* p) { float v; memcpy(&v, p, sizeof(v)); return v; }
+inline void cmdPutU16(uint8_t* p, uint16_t v) { memcpy(p, &v, sizeof(v)); }
+inline void cmdPutU32(uint8_t* p, uint32_t v) { memcpy(p, &v, sizeof(v)); }
+inline void cmdPutF32(uint8_t* p, float v) { memcpy(p, &v, sizeof(v)); }
+
+// Parser incremental: se alimenta byte a byte y avisa cuando hay una trama válida
+class CmdParser {
+private:
+    enum State : uint8_t { WAIT_SYNC0, WAIT_SYNC1, WAIT_CMD, WAIT_LEN, WAIT_PAYLOAD, WAIT_CRC };
+
+    State state;
+    uint8_t index;
+    CmdFrame current;
+
+public:
+    uint32_t crcErrors;
+
+    CmdParser() : state(WAIT_SYNC0), index(0), crcErrors(0) {}
+
+    // true mientras haya una trama a medio recibir
+    bool busy() const { return state != WAIT_SYNC0; }
+
+    void reset() { state = WAIT_SYNC0; }
+
+    const CmdFrame& frame() const { return current; }
+
+    // Devuelve true cuando el byte completa una trama con CRC correcto
+    bool feed(uint8_t b) {
+        switch (state) {
+            case WAIT_SYNC0:
+                if (b == CMD_SYNC0) state = WAIT_SYNC1;
+                break;
+            case WAIT_SYNC1:
+                state = (b == CMD_SYNC1) ? WAIT_CMD : WAIT_SYNC0;
+                break;
+            case WAIT_CMD:
+                current.cmd = b;
+                state = WAIT_LEN;
+                break;
+            case WAIT_LEN:
+                if (b > CMD_MAX_PAYLOAD) {
+                    state = WAIT_SYNC0;
+                } else {
+                    current.len = b;
+                    index = 0;
+                    state = (b == 0) ? WAIT_CRC : WAIT_PAYLOAD;
+                }
+                break;
+            case WAIT_PAYLOAD:
+                current.payload[index++] = b;
+                if (index >= current.len) state = WAIT_CRC;
+                break;
+            case WAIT_CRC: {
+                state = WAIT_SYNC0;
+                uint8_t header[2] = {current.cmd, current.len};
+                uint8_t crc = cmdCrc8(cmdCrc8(0, header, 2), current.payload, current.len);
+                if (crc == b) return true;
+                crcErrors++;
+                break;
+            }
+        }
+        return false;
+    }
+};
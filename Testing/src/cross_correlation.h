@@ -0,0 +1,421 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include "fft_core.h"
+
+/*
+  Correlación cruzada y retardo entre canales de presión
+
+  Con varios sensores en el mismo circuito de succión, el retardo con que una
+  perturbación llega a cada punto y la coherencia entre puntos indican dónde
+  hay restricciones. Los canales entran alineados (una muestra de cada sensor
+  por tick del muestreador) y el canal 0 es la referencia: para cada canal c
+  se estima cuántas muestras va atrasado respecto del 0.
+
+  Dos motores con la misma interfaz (setChannels / push / estimate):
+  - FftCrossCorrelator: para retardos largos. Cada N/2 muestras transforma
+    la ventana de N muestras (con ceros hasta 2N, correlación lineal),
+    promedia los espectros cruzados y propios entre bloques, y vuelve al
+    tiempo con la FFT inversa. Da también la coherencia. Se empaquetan dos
+    canales reales por FFT compleja, así 4 canales cuestan 2 FFT directas y
+    2 inversas por bloque. Con append() + step() el bloque se procesa de a
+    una FFT por llamada (ver task_scheduler.h).
+  - DirectCorrelator: para retardos cortos (hasta MAX_LAG muestras).
+    Actualiza la correlación en cada muestra con olvido exponencial; cuesta
+    (2 MAX_LAG + 1) multiplicaciones por canal y muestra y no necesita
+    buffers grandes.
+
+  En ambos el pico se refina a fracciones de muestra con una parábola por
+  los tres puntos alrededor del máximo.
+
+  Este archivo no depende de Arduino y compila también en el host.
+*/
+
+#define XCORR_MAX_CHANNELS   4
+#define XCORR_SMOOTHING      0.25f     // Peso de cada bloque nuevo en los espectros promediados
+#define XCORR_MIN_PEAK       0.3f      // Coeficiente mínimo para dar el retardo por válido
+#define XCORR_DIRECT_ALPHA   0.002f    // Olvido del motor directo (~500 muestras)
+#define XCORR_DIRECT_HOP     256       // Muestras entre estimaciones del motor directo
+
+struct DelayEstimate {
+    float delaySamples;   // > 0: el canal va atrasado respecto del canal 0
+    float peak;           // Coeficiente de correlación en el pico (-1..1)
+    float coherence;      // Coherencia media ponderada por potencia (0..1); -1 si el motor no la calcula
+    bool valid;           // Pico claro y dentro del rango de búsqueda
+};
+
+// Desplazamiento del vértice de la parábola por (-1, left), (0, center),
+// (1, right), en muestras (-0.5..0.5)
+inline float parabolicOffset(float left, float center, float right) {
+    float denom = left - 2.0f * center + right;
+    if (denom >= 0.0f) return 0.0f;   // No es un máximo
+    float offset = 0.5f * (left - right) / denom;
+    if (offset > 0.5f) offset = 0.5f;
+    if (offset < -0.5f) offset = -0.5f;
+    return offset;
+}
+
+// Busca el máximo de corr(lag) para lag en [-maxLag, maxLag] y lo interpola.
+// corr(lag) debe estar normalizada (coeficiente de correlación).
+template <typename CorrFn>
+inline DelayEstimate findDelayPeak(CorrFn corr, int maxLag) {
+    int best = -maxLag;
+    float bestValue = corr(-maxLag);
+    for (int lag = -maxLag + 1; lag <= maxLag; lag++) {
+        float value = corr(lag);
+        if (value > bestValue) {
+            bestValue = value;
+            best = lag;
+        }
+    }
+    DelayEstimate estimate;
+    estimate.delaySamples = (float)best;
+    estimate.peak = bestValue > 1.0f ? 1.0f : bestValue;
+    estimate.coherence = -1.0f;
+    // En el borde el máximo verdadero puede estar fuera del rango
+    estimate.valid = best > -maxLag && best < maxLag && bestValue >= XCORR_MIN_PEAK;
+    if (estimate.valid) {
+        estimate.delaySamples += parabolicOffset(corr(best - 1), bestValue, corr(best + 1));
+    }
+    return estimate;
+}
+
+// Motor por FFT: ventana de N muestras por canal, retardos hasta N/2
+template <size_t N>
+class FftCrossCorrelator {
+    static_assert(N >= 8 && (N & (N - 1)) == 0, "N debe ser potencia de 2");
+
+private:
+    static const size_t M = 2 * N;       // Tamaño de la FFT (ventana + ceros)
+    static const size_t BINS = N + 1;    // Bins 0..N del espectro de una señal real
+    static const size_t HOP = N / 2;
+    static const size_t PAIRS = (XCORR_MAX_CHANNELS + 1) / 2;
+
+    FftRadix2<M> fft;
+    float history[XCORR_MAX_CHANNELS][N];
+    float workRe[PAIRS][M];
+    float workIm[PAIRS][M];
+    float autoSpec[XCORR_MAX_CHANNELS][BINS];           // |X_c|^2 promediado
+    float crossRe[XCORR_MAX_CHANNELS][BINS];            // conj(X_0) X_c promediado
+    float crossIm[XCORR_MAX_CHANNELS][BINS];
+    DelayEstimate estimates[XCORR_MAX_CHANNELS];
+    size_t writePos;
+    size_t filled;
+    size_t sinceBlock;
+    size_t stage;           // Próxima etapa del bloque en curso
+    bool blockPending;
+    uint8_t channels;
+    int maxLag;
+
+    // Ventana del canal, de la muestra más vieja a la más nueva y sin la media
+    void loadWindow(uint8_t channel, float* dest) const {
+        float mean = 0.0f;
+        for (size_t i = 0; i < N; i++) mean += history[channel][i];
+        mean /= (float)N;
+        for (size_t i = 0; i < N; i++) {
+            dest[i] = history[channel][(writePos + i) % N] - mean;
+        }
+        for (size_t i = N; i < M; i++) dest[i] = 0.0f;
+    }
+
+    // Energía de la ventana a partir del espectro propio (Parseval)
+    float windowEnergy(uint8_t channel) const {
+        const float* s = autoSpec[channel];
+        float sum = s[0] + s[N];
+        for (size_t k = 1; k < N; k++) sum += 2.0f * s[k];
+        return sum / (float)M;
+    }
+
+    // Carga las ventanas del bloque con los datos de este instante: las
+    // muestras que lleguen mientras se procesa no lo alteran
+    void beginBlock() {
+        const size_t pairs = (channels + 1) / 2;
+        for (size_t p = 0; p < pairs; p++) {
+            loadWindow(2 * p, workRe[p]);
+            if (2 * p + 1 < channels) {
+                loadWindow(2 * p + 1, workIm[p]);
+            } else {
+                for (size_t i = 0; i < M; i++) workIm[p][i] = 0.0f;
+            }
+        }
+        stage = 0;
+        blockPending = true;
+    }
+
+    // Etapas de un bloque: una FFT directa por par de canales, el promedio de
+    // los espectros y una FFT inversa por par de canales cruzados
+    void runStage() {
+        const size_t pairs = (channels + 1) / 2;
+        if (stage < pairs) {
+            // Dos canales reales por FFT: uno en la parte real y otro en la imaginaria
+            fft.forward(workRe[stage], workIm[stage]);
+        } else if (stage == pairs) {
+            accumulateSpectra();
+        } else {
+            estimatePair((uint8_t)(1 + 2 * (stage - pairs - 1)));
+        }
+        stage++;
+        if (stage >= pairs + 1 + channels / 2) blockPending = false;
+    }
+
+    // Separar los espectros y actualizar los promedios
+    void accumulateSpectra() {
+        const float alpha = blocks == 0 ? 1.0f : XCORR_SMOOTHING;
+        const size_t pairs = (channels + 1) / 2;
+        for (size_t k = 0; k < BINS; k++) {
+            size_t mk = (M - k) % M;
+            float xr[XCORR_MAX_CHANNELS], xi[XCORR_MAX_CHANNELS];
+            for (size_t p = 0; p < pairs; p++) {
+                float zr = workRe[p][k], zi = workIm[p][k];
+                float zmr = workRe[p][mk], zmi = workIm[p][mk];
+                // A = (Z[k] + conj(Z[M-k])) / 2,  B = (Z[k] - conj(Z[M-k])) / 2j
+                xr[2 * p] = 0.5f * (zr + zmr);
+                xi[2 * p] = 0.5f * (zi - zmi);
+                xr[2 * p + 1] = 0.5f * (zi + zmi);
+                xi[2 * p + 1] = -0.5f * (zr - zmr);
+            }
+            for (uint8_t c = 0; c < channels; c++) {
+                float power = xr[c] * xr[c] + xi[c] * xi[c];
+                autoSpec[c][k] += alpha * (power - autoSpec[c][k]);
+                if (c == 0) continue;
+                float cr = xr[0] * xr[c] + xi[0] * xi[c];
+                float ci = xr[0] * xi[c] - xi[0] * xr[c];
+                crossRe[c][k] += alpha * (cr - crossRe[c][k]);
+                crossIm[c][k] += alpha * (ci - crossIm[c][k]);
+            }
+        }
+        blocks++;
+    }
+
+    // Volver al tiempo: dos espectros cruzados (hermíticos) por FFT inversa,
+    // C = A + jB da a en la parte real y b en la imaginaria
+    void estimatePair(uint8_t first) {
+        float energy0 = windowEnergy(0);
+        uint8_t second = first + 1;
+        bool hasSecond = second < channels;
+        float* re = workRe[0];
+        float* im = workIm[0];
+        for (size_t k = 0; k < BINS; k++) {
+            float ar = crossRe[first][k], ai = crossIm[first][k];
+            float br = hasSecond ? crossRe[second][k] : 0.0f;
+            float bi = hasSecond ? crossIm[second][k] : 0.0f;
+            re[k] = ar - bi;
+            im[k] = ai + br;
+            if (k > 0 && k < N) {
+                re[M - k] = ar + bi;
+                im[M - k] = br - ai;
+            }
+        }
+        fft.inverse(re, im);
+
+        for (int half = 0; half < (hasSecond ? 2 : 1); half++) {
+            uint8_t c = half == 0 ? first : second;
+            const float* corr = half == 0 ? re : im;
+            float energy = sqrtf(energy0 * windowEnergy(c));
+            DelayEstimate& estimate = estimates[c];
+            if (energy <= 0.0f) {
+                estimate = DelayEstimate{0.0f, 0.0f, 0.0f, false};
+                continue;
+            }
+            // Coeficiente sin sesgo: se divide por la superposición N - |lag|
+            const float scale = (float)N / ((float)M * energy);
+            estimate = findDelayPeak([&](int lag) {
+                size_t index = lag >= 0 ? (size_t)lag : M - (size_t)(-lag);
+                return corr[index] * scale / (float)(N - (lag >= 0 ? lag : -lag));
+            }, maxLag);
+            estimate.coherence = coherence(c);
+        }
+    }
+
+    // Coherencia cuadrática media ponderada por potencia: cada bin pesa según
+    // S00 Scc, así las bandas sin señal (solo ruido, coherencia baja por
+    // azar) no diluyen el resultado
+    float coherence(uint8_t channel) const {
+        float cross = 0.0f, autos = 0.0f;
+        for (size_t k = 1; k < N; k++) {
+            float cr = crossRe[channel][k], ci = crossIm[channel][k];
+            cross += cr * cr + ci * ci;
+            autos += autoSpec[0][k] * autoSpec[channel][k];
+        }
+        return autos > 0.0f ? cross / autos : 0.0f;
+    }
+
+public:
+    uint32_t blocks;      // Bloques procesados desde el último reset
+    uint32_t dropped;     // Bloques descartados porque el anterior no había terminado
+
+    FftCrossCorrelator() : channels(2), maxLag(N / 2) { reset(); }
+
+    static constexpr size_t windowSize() { return N; }
+    static constexpr size_t hopSize() { return HOP; }
+
+    void reset() {
+        writePos = 0;
+        filled = 0;
+        sinceBlock = 0;
+        stage = 0;
+        blockPending = false;
+        blocks = 0;
+        dropped = 0;
+        for (uint8_t c = 0; c < XCORR_MAX_CHANNELS; c++) {
+            for (size_t i = 0; i < N; i++) history[c][i] = 0.0f;
+            for (size_t k = 0; k < BINS; k++) {
+                autoSpec[c][k] = 0.0f;
+                crossRe[c][k] = 0.0f;
+                crossIm[c][k] = 0.0f;
+            }
+            estimates[c] = DelayEstimate{0.0f, 0.0f, 0.0f, false};
+        }
+    }
+
+    // Cantidad de canales alineados (2..XCORR_MAX_CHANNELS); reinicia el estado
+    void setChannels(uint8_t count) {
+        if (count < 2) count = 2;
+        if (count > XCORR_MAX_CHANNELS) count = XCORR_MAX_CHANNELS;
+        channels = count;
+        reset();
+    }
+
+    // Retardo máximo buscado, en muestras (hasta N/2)
+    void setMaxLag(int lag) {
+        if (lag < 1) lag = 1;
+        if (lag > (int)(N / 2)) lag = N / 2;
+        maxLag = lag;
+    }
+
+    uint8_t channelCount() const { return channels; }
+
+    // Agrega una muestra de cada canal; true si hay estimaciones nuevas
+    bool push(const float* frame) {
+        if (!append(frame)) return false;
+        while (step()) {}
+        return true;
+    }
+
+    // Como push() pero sin procesar el bloque: true si quedó uno pendiente y
+    // hay que llamar a step() hasta que devuelva false. Con un bloque todavía
+    // en curso, el nuevo se descarta (y se cuenta en 'dropped').
+    bool append(const float* frame) {
+        for (uint8_t c = 0; c < channels; c++) history[c][writePos] = frame[c];
+        writePos = (writePos + 1) % N;
+        if (filled < N) filled++;
+        if (++sinceBlock < HOP || filled < N) return false;
+        sinceBlock = 0;
+        if (blockPending) {
+            dropped++;
+            return false;
+        }
+        beginBlock();
+        return true;
+    }
+
+    // Una etapa del bloque pendiente (una FFT o el promedio de los espectros);
+    // true si quedan etapas
+    bool step() {
+        if (blockPending) runStage();
+        return blockPending;
+    }
+
+    bool busy() const { return blockPending; }
+
+    // Retardo del canal respecto del canal 0 (channel >= 1)
+    const DelayEstimate& estimate(uint8_t channel) const { return estimates[channel]; }
+};
+
+// Motor directo: retardos de hasta MAX_LAG muestras, actualizado en cada muestra
+template <int MAX_LAG>
+class DirectCorrelator {
+    static_assert(MAX_LAG >= 1, "MAX_LAG debe ser al menos 1");
+
+private:
+    static const int SPAN = 2 * MAX_LAG + 1;
+
+    float history[XCORR_MAX_CHANNELS][SPAN];   // Desvíos respecto de la media
+    float mean[XCORR_MAX_CHANNELS];
+    float corr[XCORR_MAX_CHANNELS][SPAN];      // E[x0(n - L) xc(n - L + lag)], índice lag + L
+    float power[XCORR_MAX_CHANNELS];           // E[xc(n - L)^2]
+    DelayEstimate estimates[XCORR_MAX_CHANNELS];
+    int writePos;
+    uint32_t samples;
+    uint16_t sinceEstimate;
+    uint8_t channels;
+
+    void estimateAll() {
+        for (uint8_t c = 1; c < channels; c++) {
+            float energy = sqrtf(power[0] * power[c]);
+            if (energy <= 0.0f) {
+                estimates[c] = DelayEstimate{0.0f, 0.0f, -1.0f, false};
+                continue;
+            }
+            const float* r = corr[c];
+            estimates[c] = findDelayPeak([&](int lag) { return r[lag + MAX_LAG] / energy; }, MAX_LAG);
+        }
+    }
+
+public:
+    DirectCorrelator() : channels(2) { reset(); }
+
+    static constexpr int maxLag() { return MAX_LAG; }
+
+    void reset() {
+        writePos = 0;
+        samples = 0;
+        sinceEstimate = 0;
+        for (uint8_t c = 0; c < XCORR_MAX_CHANNELS; c++) {
+            for (int i = 0; i < SPAN; i++) {
+                history[c][i] = 0.0f;
+                corr[c][i] = 0.0f;
+            }
+            mean[c] = 0.0f;
+            power[c] = 0.0f;
+            estimates[c] = DelayEstimate{0.0f, 0.0f, -1.0f, false};
+        }
+    }
+
+    void setChannels(uint8_t count) {
+        if (count < 2) count = 2;
+        if (count > XCORR_MAX_CHANNELS) count = XCORR_MAX_CHANNELS;
+        channels = count;
+        reset();
+    }
+
+    uint8_t channelCount() const { return channels; }
+
+    // Agrega una muestra de cada canal; true cada XCORR_DIRECT_HOP muestras
+    bool push(const float* frame) {
+        for (uint8_t c = 0; c < channels; c++) {
+            if (samples == 0) mean[c] = frame[c];
+            mean[c] += XCORR_DIRECT_ALPHA * (frame[c] - mean[c]);
+            history[c][writePos] = frame[c] - mean[c];
+        }
+        writePos = writePos + 1 == SPAN ? 0 : writePos + 1;
+        samples++;
+        if (samples < (uint32_t)SPAN) return false;
+
+        // writePos apunta ahora a la muestra más vieja (n - 2L); la referencia
+        // se toma en el centro (n - L) para cubrir adelantos y atrasos
+        int center = writePos + MAX_LAG;
+        if (center >= SPAN) center -= SPAN;
+        const float x = history[0][center];
+        power[0] += XCORR_DIRECT_ALPHA * (x * x - power[0]);
+        for (uint8_t c = 1; c < channels; c++) {
+            const float* h = history[c];
+            float* r = corr[c];
+            float y = h[center];
+            power[c] += XCORR_DIRECT_ALPHA * (y * y - power[c]);
+            int index = writePos;
+            for (int i = 0; i < SPAN; i++) {
+                r[i] += XCORR_DIRECT_ALPHA * (x * h[index] - r[i]);
+                index = index + 1 == SPAN ? 0 : index + 1;
+            }
+        }
+
+        if (++sinceEstimate < XCORR_DIRECT_HOP) return false;
+        sinceEstimate = 0;
+        estimateAll();
+        return true;
+    }
+
+    const DelayEstimate& estimate(uint8_t channel) const { return estimates[channel]; }
+};
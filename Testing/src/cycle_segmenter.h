@@ -0,0 +1,514 @@
+#pragma once
+#include <stdint.h>
+#include <math.h>
+
+/*
+  Segmentación de ciclos de succión y comparación con plantillas
+
+  Las líneas trabajan en ciclos repetitivos: la succión sube desde el reposo,
+  se mantiene y vuelve. Este módulo recibe las muestras crudas de a una y
+  entrega un resultado por ciclo, para que los consumidores no tengan que
+  procesar el flujo crudo.
+
+  Detección (con histéresis sobre la profundidad = línea de base - mbar, la
+  succión es negativa):
+  - En reposo la línea de base sigue al nivel (lenta hacia más succión, rápida
+    hacia 0, así un arranque en medio de un ciclo se corrige solo)
+  - El ciclo empieza cuando la profundidad cruza CYCLE_EDGE_MBAR hacia arriba
+    y se confirma si llega a CYCLE_START_MBAR; si vuelve antes, se descarta
+  - Termina cuando queda CYCLE_END_HOLD muestras seguidas bajo
+    CYCLE_EDGE_MBAR; el fin es la primera de esas muestras
+  - Los ciclos de menos de CYCLE_MIN_SAMPLES se descartan y los que pasan de
+    CYCLE_MAX_SAMPLES se cierran truncados
+
+  Memoria constante: el ciclo en curso se guarda como una envolvente de
+  CYCLE_ENVELOPE_POINTS promedios. Cuando se llena, cada par de puntos se
+  funde en uno y cada punto pasa a cubrir el doble de muestras, así un ciclo
+  de cualquier largo queda con entre la mitad y el total de los puntos. El
+  área y el pico se acumulan exactos, muestra a muestra.
+
+  Al cerrar el ciclo se calculan (sobre la envolvente, con interpolación
+  lineal entre puntos):
+  - subida: del 10 % al 90 % de la profundidad máxima, primeros cruces
+  - bajada: del 90 % al 10 %, últimos cruces
+  - meseta: del primer al último cruce del 90 %
+  y la forma se remuestrea a CYCLE_SHAPE_POINTS puntos normalizados (media 0,
+  desvío 1) para compararla con hasta CYCLE_MAX_TEMPLATES plantillas:
+  - NCC: correlación normalizada, la mejor con desplazamientos de hasta
+    ±CYCLE_MAX_LAG puntos
+  - DTW: distancia media con ventana de Sakoe-Chiba de ±CYCLE_DTW_BAND puntos
+    (dos filas, sin matriz completa)
+  La métrica configurada elige la plantilla; se informan las dos. Si ninguna
+  alcanza el umbral y hay un lugar libre, la forma se aprende como plantilla
+  nueva (CYCLE_LEARNED). El costo del cierre es O(puntos de forma x
+  plantillas), independiente del largo del ciclo (ver tools/cycle_bench.cpp).
+
+  Este archivo no depende de Arduino y compila también en el host.
+*/
+
+#define CYCLE_ENVELOPE_POINTS  128       // Puntos de la envolvente (par)
+#define CYCLE_SHAPE_POINTS     32        // Puntos de la forma que se compara
+#define CYCLE_MAX_TEMPLATES    4
+#define CYCLE_MAX_LAG          2         // Desplazamiento de la NCC (puntos de forma)
+#define CYCLE_DTW_BAND         3         // Ventana del DTW (puntos de forma)
+#define CYCLE_EDGE_MBAR        10.0f     // Profundidad que marca inicio y fin
+#define CYCLE_START_MBAR       20.0f     // Profundidad que confirma el ciclo
+#define CYCLE_END_HOLD         20        // Muestras bajo el borde para cerrar (10 ms a 2 kHz)
+#define CYCLE_MIN_SAMPLES      40        // 20 ms a 2 kHz
+#define CYCLE_MAX_SAMPLES      120000    // 60 s a 2 kHz
+#define CYCLE_BASELINE_SLOW    0.001f    // Línea de base hacia más succión (~0.5 s a 2 kHz)
+#define CYCLE_BASELINE_FAST    0.02f     // Línea de base hacia 0 mbar (~25 ms a 2 kHz)
+#define CYCLE_MATCH_NCC        0.95f     // NCC mínima para asignar una plantilla
+#define CYCLE_MATCH_DTW        0.25f     // DTW máxima (desvíos por punto) para asignar una plantilla
+#define CYCLE_LEVEL_LOW        0.1f      // Niveles de subida y bajada (fracción del máximo)
+#define CYCLE_LEVEL_HIGH       0.9f
+
+enum CycleMetric : uint8_t {
+    CYCLE_METRIC_NCC,
+    CYCLE_METRIC_DTW,
+};
+
+enum CycleFlag : uint8_t {
+    CYCLE_LEARNED   = 1 << 0,   // La forma se guardó como plantilla nueva
+    CYCLE_TRUNCATED = 1 << 1,   // Se cerró por CYCLE_MAX_SAMPLES
+};
+
+struct CycleConfig {
+    float edgeMbar;
+    float startMbar;
+    uint16_t endHold;
+    uint32_t minSamples;
+    uint32_t maxSamples;
+    CycleMetric metric;
+    float matchNcc;
+    float matchDtw;
+    bool autoLearn;
+};
+
+inline CycleConfig defaultCycleConfig() {
+    CycleConfig config;
+    config.edgeMbar = CYCLE_EDGE_MBAR;
+    config.startMbar = CYCLE_START_MBAR;
+    config.endHold = CYCLE_END_HOLD;
+    config.minSamples = CYCLE_MIN_SAMPLES;
+    config.maxSamples = CYCLE_MAX_SAMPLES;
+    config.metric = CYCLE_METRIC_NCC;
+    config.matchNcc = CYCLE_MATCH_NCC;
+    config.matchDtw = CYCLE_MATCH_DTW;
+    config.autoLearn = true;
+    return config;
+}
+
+// Resultado de un ciclo cerrado
+struct CycleFeatures {
+    uint32_t index;         // Número de ciclo desde el arranque
+    uint32_t startUs;       // Cruce de subida del borde
+    uint32_t durationUs;    // Hasta el cruce de bajada
+    uint32_t samples;
+    float baselineMbar;     // Línea de base del reposo anterior
+    float peakMbar;         // Succión máxima (la muestra más negativa)
+    float areaMbarS;        // Integral de la profundidad (mbar·s)
+    uint32_t riseUs;
+    uint32_t fallUs;
+    uint32_t plateauUs;
+    int8_t templateId;      // Plantilla asignada, -1 si ninguna
+    float ncc;              // Contra la mejor plantilla según la métrica (0 sin plantillas)
+    float dtw;
+    uint8_t flags;          // CycleFlag
+};
+
+// Forma normalizada (media 0, desvío 1)
+struct CycleShape {
+    float v[CYCLE_SHAPE_POINTS];
+};
+
+// Mejor correlación normalizada entre a y b con desplazamientos de ±maxLag
+inline float cycleNcc(const CycleShape& a, const CycleShape& b, int maxLag = CYCLE_MAX_LAG) {
+    float best = -1.0f;
+    for (int lag = -maxLag; lag <= maxLag; lag++) {
+        int from = lag < 0 ? -lag : 0;
+        int to = lag > 0 ? CYCLE_SHAPE_POINTS - lag : CYCLE_SHAPE_POINTS;
+        float sum = 0.0f;
+        for (int i = from; i < to; i++) sum += a.v[i] * b.v[i + lag];
+        float r = sum / (float)(to - from);
+        if (r > best) best = r;
+    }
+    return best;
+}
+
+// DTW con ventana de Sakoe-Chiba: costo |a - b| acumulado por el camino
+// mínimo, dividido por la cantidad de puntos
+inline float cycleDtw(const CycleShape& a, const CycleShape& b, int band = CYCLE_DTW_BAND) {
+    const float INF = 1e30f;
+    float rows[2][CYCLE_SHAPE_POINTS];
+    float* prev = rows[0];
+    float* curr = rows[1];
+    for (int j = 0; j < CYCLE_SHAPE_POINTS; j++) prev[j] = INF;
+
+    for (int i = 0; i < CYCLE_SHAPE_POINTS; i++) {
+        int from = i - band < 0 ? 0 : i - band;
+        int to = i + band >= CYCLE_SHAPE_POINTS ? CYCLE_SHAPE_POINTS - 1 : i + band;
+        for (int j = 0; j < CYCLE_SHAPE_POINTS; j++) curr[j] = INF;
+        for (int j = from; j <= to; j++) {
+            float cost = fabsf(a.v[i] - b.v[j]);
+            float best;
+            if (i == 0 && j == 0) {
+                best = 0.0f;
+            } else {
+                best = prev[j];                                     // (i-1, j)
+                if (j > 0 && curr[j - 1] < best) best = curr[j - 1]; // (i, j-1)
+                if (j > 0 && prev[j - 1] < best) best = prev[j - 1]; // (i-1, j-1)
+            }
+            curr[j] = cost + best;
+        }
+        float* t = prev;
+        prev = curr;
+        curr = t;
+    }
+    return prev[CYCLE_SHAPE_POINTS - 1] / (float)CYCLE_SHAPE_POINTS;
+}
+
+class CycleSegmenter {
+public:
+    CycleSegmenter() : config(defaultCycleConfig()) {
+        reset();
+        clearTemplates();
+    }
+
+    // Olvida el ciclo en curso y la línea de base (las plantillas quedan)
+    void reset() {
+        haveBaseline = false;
+        baselineMbar = 0.0f;
+        active = false;
+        cycleCount = 0;
+        last.index = 0;
+        last.samples = 0;
+        last.templateId = -1;
+        last.flags = 0;
+        haveShape = false;
+    }
+
+    void setConfig(const CycleConfig& c) { config = c; }
+    const CycleConfig& currentConfig() const { return config; }
+
+    // Procesa una muestra válida (las erróneas no se pasan); true si con
+    // ella se cerró un ciclo, que queda en lastCycle()
+    bool add(uint32_t sampleUs, float mbar) {
+        if (!haveBaseline) {
+            baselineMbar = mbar;
+            haveBaseline = true;
+        }
+        float depth = baselineMbar - mbar;
+
+        if (!active) {
+            if (depth >= config.edgeMbar) {
+                open(sampleUs);
+                take(sampleUs, mbar, depth);
+                return false;
+            }
+            float alpha = mbar > baselineMbar ? CYCLE_BASELINE_FAST : CYCLE_BASELINE_SLOW;
+            baselineMbar += alpha * (mbar - baselineMbar);
+            return false;
+        }
+
+        if (depth < config.edgeMbar) {
+            if (!confirmed) {
+                // No llegó a CYCLE_START_MBAR: era ruido o un pulso corto
+                active = false;
+                return false;
+            }
+            if (tailCount == 0) tailStartUs = sampleUs;
+            if (tailCount < CYCLE_END_HOLD) tail[tailCount] = depth;
+            tailCount++;
+            if (tailCount >= config.endHold || tailCount >= CYCLE_END_HOLD) {
+                return close(tailStartUs, 0);
+            }
+            return false;
+        }
+
+        // Volvió sobre el borde: las muestras de la cola eran parte del ciclo
+        for (uint16_t i = 0; i < tailCount && i < CYCLE_END_HOLD; i++) {
+            pushEnvelope(tail[i]);
+            areaSum += tail[i];
+        }
+        tailCount = 0;
+        take(sampleUs, mbar, depth);
+        if (samples >= config.maxSamples) return close(sampleUs, CYCLE_TRUNCATED);
+        return false;
+    }
+
+    bool inCycle() const { return active && confirmed; }
+    float baseline() const { return baselineMbar; }
+    uint32_t cycles() const { return cycleCount; }
+    const CycleFeatures& lastCycle() const { return last; }
+
+    // Forma normalizada del último ciclo (para guardarla o depurar)
+    const CycleShape& lastShape() const { return shape; }
+
+    // Guarda la forma del último ciclo como plantilla 'slot'
+    bool learn(uint8_t slot) {
+        if (slot >= CYCLE_MAX_TEMPLATES || !haveShape) return false;
+        setTemplate(slot, shape);
+        return true;
+    }
+
+    // Carga una plantilla de referencia (p. ej. guardada en el host)
+    void setTemplate(uint8_t slot, const CycleShape& s) {
+        if (slot >= CYCLE_MAX_TEMPLATES) return;
+        templates[slot] = s;
+        templateUsed[slot] = true;
+        templateMatches[slot] = 0;
+    }
+
+    void clearTemplate(uint8_t slot) {
+        if (slot < CYCLE_MAX_TEMPLATES) templateUsed[slot] = false;
+    }
+
+    void clearTemplates() {
+        for (uint8_t t = 0; t < CYCLE_MAX_TEMPLATES; t++) {
+            templateUsed[t] = false;
+            templateMatches[t] = 0;
+        }
+    }
+
+    bool hasTemplate(uint8_t slot) const { return slot < CYCLE_MAX_TEMPLATES && templateUsed[slot]; }
+    uint32_t matches(uint8_t slot) const { return slot < CYCLE_MAX_TEMPLATES ? templateMatches[slot] : 0; }
+    const CycleShape& templateShape(uint8_t slot) const { return templates[slot]; }
+
+private:
+    CycleConfig config;
+    bool haveBaseline;
+    float baselineMbar;
+
+    // Ciclo en curso
+    bool active;
+    bool confirmed;
+    uint32_t startUs;
+    uint32_t lastUs;
+    uint32_t samples;
+    float startBaseline;
+    float peakDepth;
+    float peakMbar;
+    double areaSum;                 // Suma de profundidades (mbar por muestra)
+    float envelope[CYCLE_ENVELOPE_POINTS];
+    uint16_t envLength;
+    uint32_t envStep;               // Muestras por punto
+    float envAccum;
+    uint32_t envAccumCount;
+    float tail[CYCLE_END_HOLD];     // Muestras bajo el borde, pendientes
+    uint16_t tailCount;
+    uint32_t tailStartUs;
+
+    uint32_t cycleCount;
+    CycleFeatures last;
+    CycleShape shape;
+    bool haveShape;
+
+    CycleShape templates[CYCLE_MAX_TEMPLATES];
+    bool templateUsed[CYCLE_MAX_TEMPLATES];
+    uint32_t templateMatches[CYCLE_MAX_TEMPLATES];
+
+    void open(uint32_t sampleUs) {
+        active = true;
+        confirmed = false;
+        startUs = sampleUs;
+        samples = 0;
+        startBaseline = baselineMbar;
+        peakDepth = 0.0f;
+        peakMbar = baselineMbar;
+        areaSum = 0.0;
+        envLength = 0;
+        envStep = 1;
+        envAccum = 0.0f;
+        envAccumCount = 0;
+        tailCount = 0;
+    }
+
+    void take(uint32_t sampleUs, float mbar, float depth) {
+        if (depth >= config.startMbar) confirmed = true;
+        if (depth > peakDepth) {
+            peakDepth = depth;
+            peakMbar = mbar;
+        }
+        areaSum += depth;
+        lastUs = sampleUs;
+        pushEnvelope(depth);
+    }
+
+    void pushEnvelope(float depth) {
+        samples++;
+        envAccum += depth;
+        if (++envAccumCount < envStep) return;
+        envelope[envLength++] = envAccum / (float)envStep;
+        envAccum = 0.0f;
+        envAccumCount = 0;
+        if (envLength < CYCLE_ENVELOPE_POINTS) return;
+        // Llena: fundir pares y duplicar las muestras por punto
+        for (uint16_t i = 0; i < CYCLE_ENVELOPE_POINTS / 2; i++) {
+            envelope[i] = 0.5f * (envelope[2 * i] + envelope[2 * i + 1]);
+        }
+        envLength = CYCLE_ENVELOPE_POINTS / 2;
+        envStep *= 2;
+    }
+
+    // Punto i de la envolvente con los bordes virtuales: -1 y envLength valen
+    // el borde (donde se cruzó) en el inicio y el fin del ciclo
+    float envValue(int i) const {
+        if (i < 0 || i >= envLength) return config.edgeMbar;
+        return envelope[i];
+    }
+
+    // Posición (en muestras desde el inicio) del centro del punto i
+    float envCenter(int i) const {
+        if (i < 0) return -0.5f;
+        if (i >= envLength) return (float)samples - 0.5f;
+        uint32_t first = (uint32_t)i * envStep;
+        uint32_t count = envStep;
+        if (first + count > samples) count = samples - first;
+        return (float)first + 0.5f * (float)(count - 1);
+    }
+
+    // Valor de la envolvente en la posición x (muestras), interpolado
+    float envAt(float x) const {
+        // Punto cuyo centro es el primero >= x
+        int i = (int)((x + 0.5f) / (float)envStep);
+        if (i > envLength) i = envLength;
+        while (i > -1 && envCenter(i - 1) > x) i--;
+        while (i < envLength && envCenter(i) < x) i++;
+        float x0 = envCenter(i - 1), x1 = envCenter(i);
+        float y0 = envValue(i - 1), y1 = envValue(i);
+        if (x1 <= x0) return y1;
+        return y0 + (y1 - y0) * (x - x0) / (x1 - x0);
+    }
+
+    // Primer (forward) o último cruce del nivel, en muestras desde el inicio
+    float crossing(float level, bool forward) const {
+        if (forward) {
+            for (int i = 0; i <= envLength; i++) {
+                if (envValue(i) >= level && envValue(i - 1) < level) return interpolate(i - 1, i, level);
+            }
+        } else {
+            for (int i = envLength - 1; i >= -1; i--) {
+                if (envValue(i) >= level && envValue(i + 1) < level) return interpolate(i, i + 1, level);
+            }
+        }
+        return forward ? 0.0f : (float)samples;
+    }
+
+    float interpolate(int a, int b, float level) const {
+        float ya = envValue(a), yb = envValue(b);
+        float xa = envCenter(a), xb = envCenter(b);
+        if (yb == ya) return xa;
+        return xa + (xb - xa) * (level - ya) / (yb - ya);
+    }
+
+    bool close(uint32_t endUs, uint8_t flags) {
+        active = false;
+        tailCount = 0;
+        if (samples < config.minSamples) return false;
+        if (envAccumCount > 0) {
+            envelope[envLength++] = envAccum / (float)envAccumCount;
+            envAccum = 0.0f;
+            envAccumCount = 0;
+        }
+
+        CycleFeatures& f = last;
+        f.index = cycleCount++;
+        f.startUs = startUs;
+        f.durationUs = endUs - startUs;
+        f.samples = samples;
+        f.baselineMbar = startBaseline;
+        f.peakMbar = peakMbar;
+        float usPerSample = (float)f.durationUs / (float)samples;
+        f.areaMbarS = (float)(areaSum * usPerSample * 1e-6);
+        f.flags = flags;
+
+        // Niveles sobre el máximo de la envolvente (el pico de una muestra
+        // incluye el ruido)
+        float envPeak = config.edgeMbar;
+        for (uint16_t i = 0; i < envLength; i++) {
+            if (envelope[i] > envPeak) envPeak = envelope[i];
+        }
+        float low = CYCLE_LEVEL_LOW * envPeak;
+        float high = CYCLE_LEVEL_HIGH * envPeak;
+        if (low < config.edgeMbar) low = config.edgeMbar;
+        float riseLow = crossing(low, true), riseHigh = crossing(high, true);
+        float fallHigh = crossing(high, false), fallLow = crossing(low, false);
+        f.riseUs = toUs(riseHigh - riseLow, usPerSample);
+        f.fallUs = toUs(fallLow - fallHigh, usPerSample);
+        f.plateauUs = toUs(fallHigh - riseHigh, usPerSample);
+
+        buildShape();
+        match(f);
+        return true;
+    }
+
+    static uint32_t toUs(float samples, float usPerSample) {
+        return samples > 0.0f ? (uint32_t)(samples * usPerSample + 0.5f) : 0;
+    }
+
+    // Remuestrea la envolvente a CYCLE_SHAPE_POINTS sobre todo el ciclo y normaliza
+    void buildShape() {
+        float sum = 0.0f;
+        for (int k = 0; k < CYCLE_SHAPE_POINTS; k++) {
+            float x = ((float)k + 0.5f) * (float)samples / (float)CYCLE_SHAPE_POINTS - 0.5f;
+            shape.v[k] = envAt(x);
+            sum += shape.v[k];
+        }
+        float mean = sum / (float)CYCLE_SHAPE_POINTS;
+        float var = 0.0f;
+        for (int k = 0; k < CYCLE_SHAPE_POINTS; k++) {
+            shape.v[k] -= mean;
+            var += shape.v[k] * shape.v[k];
+        }
+        float sd = sqrtf(var / (float)CYCLE_SHAPE_POINTS);
+        float inv = sd > 1e-6f ? 1.0f / sd : 0.0f;
+        for (int k = 0; k < CYCLE_SHAPE_POINTS; k++) shape.v[k] *= inv;
+        haveShape = true;
+    }
+
+    void match(CycleFeatures& f) {
+        f.templateId = -1;
+        f.ncc = 0.0f;
+        f.dtw = 0.0f;
+        int best = -1;
+        float bestNcc = -2.0f, bestDtw = 1e30f;
+        int8_t freeSlot = -1;
+        for (uint8_t t = 0; t < CYCLE_MAX_TEMPLATES; t++) {
+            if (!templateUsed[t]) {
+                if (freeSlot < 0) freeSlot = t;
+                continue;
+            }
+            if (config.metric == CYCLE_METRIC_NCC) {
+                float r = cycleNcc(shape, templates[t]);
+                if (r > bestNcc) {
+                    bestNcc = r;
+                    best = t;
+                }
+            } else {
+                float d = cycleDtw(shape, templates[t]);
+                if (d < bestDtw) {
+                    bestDtw = d;
+                    best = t;
+                }
+            }
+        }
+
+        bool matched = false;
+        if (best >= 0) {
+            // La otra métrica solo contra la plantilla elegida
+            f.ncc = config.metric == CYCLE_METRIC_NCC ? bestNcc : cycleNcc(shape, templates[best]);
+            f.dtw = config.metric == CYCLE_METRIC_DTW ? bestDtw : cycleDtw(shape, templates[best]);
+            matched = config.metric == CYCLE_METRIC_NCC ? f.ncc >= config.matchNcc : f.dtw <= config.matchDtw;
+        }
+        if (matched) {
+            f.templateId = (int8_t)best;
+            templateMatches[best]++;
+        } else if (config.autoLearn && freeSlot >= 0) {
+            setTemplate((uint8_t)freeSlot, shape);
+            templateMatches[freeSlot] = 1;
+            f.templateId = freeSlot;
+            f.flags |= CYCLE_LEARNED;
+        }
+    }
+};
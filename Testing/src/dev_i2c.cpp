@@ -0,0 +1,3 @@
+#include "dev_i2c.h"
+
+TwoWire dev_i2c(I2C3_SDA, I2C3_SCL);
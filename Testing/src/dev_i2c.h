@@ -0,0 +1,48 @@
+#pragma once
+#include <Wire.h>
+
+// Bus I2C3 compartido por los sensores SM4291 y ELVH (pines D11/D12)
+#define I2C3_SCL    D12
+#define I2C3_SDA    D11
+
+// Reloj del bus: los sensores admiten hasta 400 kHz (Wire arranca en 100 kHz)
+#define DEV_I2C_CLOCK_HZ  400000
+
+// Instancia única del bus, definida en dev_i2c.cpp
+extern TwoWire dev_i2c;
+
+// Recupera el bus cuando un esclavo quedó reteniendo SDA (por ejemplo, tras un
+// reset a mitad de una lectura): hasta 9 pulsos de SCL para que termine de
+// sacar su byte, una condición de STOP y se vuelve a iniciar el periférico.
+// Los pines se manejan como open-drain (salida en bajo o entrada con pull-up).
+// Tarda ~100 us. Devuelve true si SDA quedó liberada.
+inline bool devI2cRecover() {
+    dev_i2c.end();
+
+    pinMode(I2C3_SDA, INPUT_PULLUP);
+    pinMode(I2C3_SCL, INPUT_PULLUP);
+    delayMicroseconds(5);
+    for (int i = 0; i < 9 && digitalRead(I2C3_SDA) == LOW; i++) {
+        pinMode(I2C3_SCL, OUTPUT);
+        digitalWrite(I2C3_SCL, LOW);
+        delayMicroseconds(5);
+        pinMode(I2C3_SCL, INPUT_PULLUP);
+        delayMicroseconds(5);
+    }
+
+    // STOP: SDA sube mientras SCL está en alto
+    pinMode(I2C3_SCL, OUTPUT);
+    digitalWrite(I2C3_SCL, LOW);
+    pinMode(I2C3_SDA, OUTPUT);
+    digitalWrite(I2C3_SDA, LOW);
+    delayMicroseconds(5);
+    pinMode(I2C3_SCL, INPUT_PULLUP);
+    delayMicroseconds(5);
+    pinMode(I2C3_SDA, INPUT_PULLUP);
+    delayMicroseconds(5);
+
+    bool released = digitalRead(I2C3_SDA) == HIGH;
+    dev_i2c.begin();
+    dev_i2c.setClock(DEV_I2C_CLOCK_HZ);
+    return released;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+
+/*
+  FFT compleja radix-2 de tamaño fijo
+
+  Las tablas de giro y de inversión de bits se calculan una vez en el
+  constructor; transform() no reserva memoria ni llama a funciones
+  trigonométricas. Trabaja en el lugar sobre dos arreglos (parte real e
+  imaginaria) de N floats.
+
+  Este archivo no depende de Arduino y compila también en el host.
+*/
+
+template <size_t N>
+class FftRadix2 {
+    static_assert(N >= 4 && (N & (N - 1)) == 0, "N debe ser potencia de 2");
+    static_assert(N <= 65536, "la tabla de inversión de bits usa uint16_t");
+
+private:
+    float cosTable[N / 2];
+    float sinTable[N / 2];
+    uint16_t bitReverse[N];
+
+public:
+    FftRadix2() {
+        for (size_t k = 0; k < N / 2; k++) {
+            // En doble precisión para que el error no crezca con N
+            double angle = 2.0 * M_PI * (double)k / (double)N;
+            cosTable[k] = (float)cos(angle);
+            sinTable[k] = (float)sin(angle);
+        }
+        size_t bits = 0;
+        while ((1u << bits) < N) bits++;
+        for (size_t i = 0; i < N; i++) {
+            size_t rev = 0;
+            for (size_t b = 0; b < bits; b++) {
+                if (i & (1u << b)) rev |= 1u << (bits - 1 - b);
+            }
+            bitReverse[i] = (uint16_t)rev;
+        }
+    }
+
+    static constexpr size_t size() { return N; }
+
+    // Transformada en el lugar. La inversa no divide por N: lo hace el llamador
+    // si necesita la escala.
+    void transform(float* re, float* im, bool inverse) const {
+        for (size_t i = 0; i < N; i++) {
+            size_t j = bitReverse[i];
+            if (j > i) {
+                float t = re[i]; re[i] = re[j]; re[j] = t;
+                t = im[i]; im[i] = im[j]; im[j] = t;
+            }
+        }
+
+        const float sign = inverse ? 1.0f : -1.0f;
+        for (size_t len = 2; len <= N; len <<= 1) {
+            size_t half = len / 2;
+            size_t step = N / len;
+            // El giro se carga una vez por columna de mariposas
+            for (size_t k = 0; k < half; k++) {
+                float wr = cosTable[k * step];
+                float wi = sign * sinTable[k * step];
+                for (size_t a = k; a < N; a += len) {
+                    size_t b = a + half;
+                    float tr = re[b] * wr - im[b] * wi;
+                    float ti = re[b] * wi + im[b] * wr;
+                    re[b] = re[a] - tr;
+                    im[b] = im[a] - ti;
+                    re[a] += tr;
+                    im[a] += ti;
+                }
+            }
+        }
+    }
+
+    void forward(float* re, float* im) const { transform(re, im, false); }
+    void inverse(float* re, float* im) const { transform(re, im, true); }
+};
@@ -0,0 +1,432 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "static_memory.h"
+
+/*
+  Log circular persistente de muestras (QSPI flash / SD)
+
+  - La memoria se divide en bloques de LOG_BLOCK_SIZE bytes. El bloque con
+    número de secuencia seq siempre vive en el slot seq % totalBlocks, así que
+    el log recorre toda la memoria en orden y cada sector se borra una vez por
+    vuelta (nivelado de desgaste implícito).
+  - Cada bloque lleva una cabecera con magic, seq y CRC32 de todo el bloque:
+    una escritura cortada por un reset o un corte de energía deja un bloque con
+    CRC inválido que se ignora al montar.
+  - Las muestras se comprimen: primer valor en la cabecera y luego deltas
+    zigzag+varint del valor cuantizado (LOG_VALUE_SCALE cuentas por mbar). El
+    timestamp se reconstruye con firstTimestampUs + i * periodUs; si el periodo
+    cambia se cierra el bloque.
+  - append() solo copia a un buffer en RAM. La escritura en flash la hace
+    poll() en pasos acotados (una página por llamada) desde el loop, fuera del
+    camino de adquisición. El borrado de un sector tarda decenas de ms: poll()
+    solo lo inicia (eraseStart) y en las llamadas siguientes consulta busy()
+    hasta que termina, sin esperar.
+  - mount() valida el CRC del bloque completo: un bloque con la cabecera
+    escrita y el resto cortado no cuenta como el más nuevo.
+
+  Este archivo no depende de Arduino: el acceso a la memoria se hace a través
+  de LogStorage (ver flash_log_qspi.h para la QSPI del Portenta).
+*/
+
+#define LOG_BLOCK_SIZE     512
+#define LOG_BLOCK_MAGIC    0x4C4F4731u   // "LOG1"
+#define LOG_BUFFERS        4             // Bloques en RAM esperando ser escritos
+#define LOG_VALUE_SCALE    1000.0f       // Resolución de 0.001 mbar
+
+// Acceso a la memoria no volátil
+class LogStorage {
+public:
+    virtual ~LogStorage() {}
+    virtual uint32_t size() const = 0;        // Bytes disponibles para el log
+    virtual uint32_t pageSize() const = 0;    // Tamaño de programación eficiente
+    virtual uint32_t sectorSize() const = 0;  // Tamaño de borrado
+    virtual bool read(uint32_t addr, void* data, uint32_t len) = 0;
+    virtual bool program(uint32_t addr, const void* data, uint32_t len) = 0;
+    // Inicia el borrado de un sector y vuelve sin esperar
+    virtual bool eraseStart(uint32_t addr, uint32_t len) = 0;
+    // true mientras el borrado sigue en curso (bit WIP de la flash)
+    virtual bool busy() = 0;
+};
+
+struct LogBlockHeader {
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t firstTimestampUs;
+    uint32_t periodUs;
+    int32_t firstValue;        // Valor cuantizado de la primera muestra
+    uint16_t sampleCount;
+    uint16_t payloadLen;
+    uint32_t crc;              // CRC32 de la cabecera (con crc = 0) y el payload
+};
+
+#define LOG_PAYLOAD_SIZE (LOG_BLOCK_SIZE - sizeof(LogBlockHeader))
+
+struct LogBlock {
+    LogBlockHeader header;
+    uint8_t payload[LOG_PAYLOAD_SIZE];
+};
+
+static_assert(sizeof(LogBlock) == LOG_BLOCK_SIZE, "LogBlock debe ocupar exactamente un bloque");
+
+inline uint32_t logCrc32(uint32_t crc, const uint8_t* data, size_t len) {
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+inline uint32_t logBlockCrc(const LogBlock& block) {
+    LogBlockHeader header = block.header;
+    header.crc = 0;
+    uint32_t crc = logCrc32(0, (const uint8_t*)&header, sizeof(header));
+    return logCrc32(crc, block.payload, block.header.payloadLen);
+}
+
+inline bool logBlockValid(const LogBlock& block) {
+    return block.header.magic == LOG_BLOCK_MAGIC &&
+           block.header.payloadLen <= LOG_PAYLOAD_SIZE &&
+           block.header.crc == logBlockCrc(block);
+}
+
+// Decodifica las muestras de un bloque; devuelve cuántas se escribieron
+inline uint16_t logDecodeBlock(const LogBlock& block, uint32_t* timestamps, float* values, uint16_t maxSamples) {
+    uint16_t count = 0;
+    int32_t value = block.header.firstValue;
+    size_t pos = 0;
+
+    while (count < block.header.sampleCount && count < maxSamples) {
+        if (count > 0) {
+            uint32_t zz = 0;
+            uint8_t shift = 0;
+            uint8_t b;
+            do {
+                if (pos >= block.header.payloadLen) return count;
+                b = block.payload[pos++];
+                zz |= (uint32_t)(b & 0x7F) << shift;
+                shift += 7;
+            } while (b & 0x80);
+            value += (int32_t)((zz >> 1) ^ (0u - (zz & 1u)));
+        }
+        timestamps[count] = block.header.firstTimestampUs + count * block.header.periodUs;
+        values[count] = value / LOG_VALUE_SCALE;
+        count++;
+    }
+    return count;
+}
+
+class FlashLog {
+private:
+    LogStorage& storage;
+    uint32_t totalBlocks;
+    uint32_t blocksPerSector;
+    uint32_t nextSeq;          // Secuencia del próximo bloque a escribir
+    bool hasBlocks;
+    uint32_t newest;
+
+    StaticPool<LogBlock, LOG_BUFFERS> pool;
+
+    // Bloque que se está llenando
+    LogBlock* filling;
+    int32_t lastValue;
+    uint32_t lastTimestampUs;
+
+    // Bloques cerrados esperando ser escritos (FIFO)
+    LogBlock* ready[LOG_BUFFERS];
+    uint8_t readyHead;
+    uint8_t readyCount;
+    uint32_t writeOffset;      // Bytes ya programados del bloque ready[readyHead]
+    bool sectorErased;
+    bool erasing;              // Borrado iniciado, esperando busy() == false
+
+    uint32_t slotAddress(uint32_t seq) const { return (seq % totalBlocks) * LOG_BLOCK_SIZE; }
+
+    bool blank(const LogBlockHeader& header) const {
+        const uint8_t* p = (const uint8_t*)&header;
+        for (size_t i = 0; i < sizeof(header); i++) {
+            if (p[i] != 0xFF) return false;
+        }
+        return true;
+    }
+
+    bool readHeader(uint32_t slot, LogBlockHeader& header) {
+        return storage.read(slot * LOG_BLOCK_SIZE, &header, sizeof(header));
+    }
+
+    // Bloque completo en el slot con la secuencia esperada y CRC válido
+    bool slotValid(uint32_t slot, uint32_t seq, LogBlock& block) {
+        if (!storage.read(slot * LOG_BLOCK_SIZE, &block, sizeof(LogBlock))) return false;
+        return block.header.seq == seq && logBlockValid(block);
+    }
+
+    void putVarint(uint32_t v) {
+        LogBlockHeader& h = filling->header;
+        while (v >= 0x80) {
+            filling->payload[h.payloadLen++] = (uint8_t)(v | 0x80);
+            v >>= 7;
+        }
+        filling->payload[h.payloadLen++] = (uint8_t)v;
+    }
+
+    void seal() {
+        if (filling == nullptr) return;
+        if (filling->header.sampleCount == 0 || readyCount >= LOG_BUFFERS) {
+            pool.destroy(filling);
+            filling = nullptr;
+            return;
+        }
+        filling->header.magic = LOG_BLOCK_MAGIC;
+        filling->header.seq = nextSeq++;
+        filling->header.crc = logBlockCrc(*filling);
+        // Bytes sin usar como 0xFF: no programan nada en la flash
+        memset(filling->payload + filling->header.payloadLen, 0xFF,
+               LOG_PAYLOAD_SIZE - filling->header.payloadLen);
+        ready[(readyHead + readyCount) % LOG_BUFFERS] = filling;
+        readyCount++;
+        filling = nullptr;
+    }
+
+public:
+    uint32_t droppedSamples;   // Muestras perdidas con todos los buffers ocupados
+    uint32_t writeErrors;
+
+    explicit FlashLog(LogStorage& logStorage)
+        : storage(logStorage), totalBlocks(0), blocksPerSector(1), nextSeq(0),
+          hasBlocks(false), newest(0), pool("flashlog"), filling(nullptr),
+          lastValue(0), lastTimestampUs(0), readyHead(0), readyCount(0),
+          writeOffset(0), sectorErased(false), erasing(false), droppedSamples(0), writeErrors(0) {}
+
+    // Recupera la posición de escritura a partir de lo que hay en la memoria
+    bool mount() {
+        totalBlocks = storage.size() / LOG_BLOCK_SIZE;
+        blocksPerSector = storage.sectorSize() / LOG_BLOCK_SIZE;
+        if (blocksPerSector == 0 || totalBlocks < 2 * blocksPerSector) return false;
+        totalBlocks -= totalBlocks % blocksPerSector;
+        erasing = false;
+
+        // El primer bloque de cada sector es el más viejo del sector: buscar
+        // el sector con la secuencia más alta y luego recorrerlo. Para elegir
+        // basta la cabecera; el candidato se valida entero y, si la escritura
+        // de su primer bloque se cortó, se prueba el siguiente más alto.
+        LogBlockHeader header;
+        LogBlock* block = pool.create();
+        if (block == nullptr) return false;
+        bool found = false;
+        uint32_t bestSector = 0;
+        uint32_t bestSeq = 0;
+        uint32_t limit = 0xFFFFFFFFu;
+        bool ok = true;
+        while (ok) {
+            found = false;
+            for (uint32_t slot = 0; slot < totalBlocks; slot += blocksPerSector) {
+                if (!readHeader(slot, header)) {
+                    ok = false;
+                    break;
+                }
+                if (header.magic == LOG_BLOCK_MAGIC && header.seq % totalBlocks == slot && header.seq < limit &&
+                    (!found || header.seq > bestSeq)) {
+                    found = true;
+                    bestSeq = header.seq;
+                    bestSector = slot;
+                }
+            }
+            if (!ok || !found || slotValid(bestSector, bestSeq, *block)) break;
+            limit = bestSeq;
+        }
+
+        if (ok && found) {
+            newest = bestSeq;
+            for (uint32_t i = 1; i < blocksPerSector; i++) {
+                if (!slotValid(bestSector + i, bestSeq + i, *block)) break;
+                newest = bestSeq + i;
+            }
+        }
+        pool.destroy(block);
+        if (!ok) return false;
+
+        if (!found) {
+            nextSeq = 0;
+            hasBlocks = false;
+            sectorErased = false;
+            return true;
+        }
+        hasBlocks = true;
+        nextSeq = newest + 1;
+
+        // Si el slot siguiente no está en blanco (escritura cortada), saltar al
+        // próximo sector para no programar sobre flash sin borrar
+        sectorErased = (nextSeq % blocksPerSector) != 0;
+        if (sectorErased) {
+            if (!readHeader(nextSeq % totalBlocks, header)) return false;
+            if (!blank(header)) {
+                nextSeq += blocksPerSector - (nextSeq % blocksPerSector);
+                sectorErased = false;
+            }
+        }
+        return true;
+    }
+
+    // Camino de adquisición: agrega una muestra al bloque en RAM (sin E/S)
+    bool append(uint32_t timestampUs, float value) {
+        int32_t q = (int32_t)(value * LOG_VALUE_SCALE + (value >= 0 ? 0.5f : -0.5f));
+
+        if (filling != nullptr) {
+            LogBlockHeader& h = filling->header;
+            uint32_t delta = timestampUs - lastTimestampUs;
+            bool periodBroken = false;
+            if (h.sampleCount == 1) {
+                h.periodUs = delta;
+            } else {
+                uint32_t diff = delta > h.periodUs ? delta - h.periodUs : h.periodUs - delta;
+                periodBroken = diff > h.periodUs / 2;
+            }
+            // Un varint de 32 bits ocupa hasta 5 bytes
+            if (periodBroken || h.payloadLen + 5u > LOG_PAYLOAD_SIZE || h.sampleCount == 0xFFFF) {
+                seal();
+            }
+        }
+
+        if (filling == nullptr) {
+            filling = pool.create();
+            if (filling == nullptr) {
+                droppedSamples++;
+                return false;
+            }
+            memset(&filling->header, 0, sizeof(LogBlockHeader));
+            filling->header.firstTimestampUs = timestampUs;
+            filling->header.firstValue = q;
+            filling->header.sampleCount = 1;
+        } else {
+            int32_t d = q - lastValue;
+            putVarint(((uint32_t)d << 1) ^ (uint32_t)(d >> 31));
+            filling->header.sampleCount++;
+        }
+
+        lastValue = q;
+        lastTimestampUs = timestampUs;
+        return true;
+    }
+
+    // Cierra el bloque parcial para que se escriba (p. ej. antes de descargar)
+    void flush() { seal(); }
+
+    // Paso de escritura en segundo plano: true si hizo alguna operación;
+    // false sin bloques pendientes o con un borrado todavía en curso
+    bool poll() {
+        if (readyCount == 0) return false;
+        LogBlock* block = ready[readyHead];
+        uint32_t addr = slotAddress(block->header.seq);
+
+        // Borrar el sector al entrar en él: se inicia y se espera en las
+        // llamadas siguientes
+        if (erasing) {
+            if (storage.busy()) return false;
+            erasing = false;
+            sectorErased = true;
+        }
+        if (!sectorErased) {
+            uint32_t sectorAddr = addr - (addr % storage.sectorSize());
+            if (storage.eraseStart(sectorAddr, storage.sectorSize())) {
+                erasing = true;
+            } else {
+                writeErrors++;
+                sectorErased = true;
+            }
+            return true;
+        }
+
+        // Programar una página por llamada
+        uint32_t chunk = storage.pageSize();
+        if (chunk > LOG_BLOCK_SIZE - writeOffset) chunk = LOG_BLOCK_SIZE - writeOffset;
+        if (!storage.program(addr + writeOffset, (const uint8_t*)block + writeOffset, chunk)) {
+            writeErrors++;
+        }
+        writeOffset += chunk;
+
+        if (writeOffset >= LOG_BLOCK_SIZE) {
+            newest = block->header.seq;
+            hasBlocks = true;
+            writeOffset = 0;
+            readyHead = (readyHead + 1) % LOG_BUFFERS;
+            readyCount--;
+            pool.destroy(block);
+            // El siguiente bloque empieza un sector nuevo: hay que borrarlo
+            if ((newest + 1) % blocksPerSector == 0) sectorErased = false;
+        }
+        return true;
+    }
+
+    bool pending() const { return readyCount > 0; }
+
+    // Borrado en curso: la flash no se puede leer hasta que termine
+    bool busy() const { return erasing; }
+
+    bool empty() const { return !hasBlocks; }
+
+    uint32_t newestSeq() const { return newest; }
+
+    // El bloque más viejo que sigue en la memoria: el primero del sector
+    // que viene después del siguiente al actual (el siguiente puede estar
+    // ya borrado o a medio borrar)
+    uint32_t oldestSeq() const {
+        if (!hasBlocks) return 0;
+        uint32_t span = totalBlocks - 2 * blocksPerSector;
+        uint32_t sectorStart = newest - (newest % blocksPerSector);
+        return sectorStart >= span ? sectorStart - span : 0;
+    }
+
+    uint32_t capacityBlocks() const { return totalBlocks; }
+
+    // Lee un bloque por secuencia; false si no existe, fue sobrescrito o hay
+    // un borrado en curso
+    bool readBlock(uint32_t seq, LogBlock& out) {
+        if (erasing) return false;
+        return slotValid(seq % totalBlocks, seq, out);
+    }
+};
+
+// Descarga incremental de bloques (CMD_LOG_READ): entrega los bytes de
+// 'count' bloques seguidos en trozos chicos, leyendo de la flash un bloque
+// cada LOG_BLOCK_SIZE bytes, para repartir la descarga en muchas porciones de
+// la tarea del host. Un bloque inexistente sale como 0xFF.
+class LogDownload {
+private:
+    FlashLog& log;
+    LogBlock block;            // Bloque que se está entregando
+    uint32_t first;
+    uint32_t total;            // Bytes de la descarga
+    uint32_t offset;           // Bytes ya entregados
+
+public:
+    explicit LogDownload(FlashLog& flashLog) : log(flashLog), first(0), total(0), offset(0) {}
+
+    void start(uint32_t firstSeq, uint16_t count) {
+        first = firstSeq;
+        total = (uint32_t)count * LOG_BLOCK_SIZE;
+        offset = 0;
+    }
+
+    bool active() const { return offset < total; }
+
+    // Copia el próximo trozo (hasta maxLen bytes) en data y su posición en
+    // *at; devuelve la longitud, 0 si terminó o si hay un borrado en curso
+    uint32_t next(uint8_t* data, uint32_t maxLen, uint32_t* at) {
+        if (!active()) return 0;
+        uint32_t inBlock = offset % LOG_BLOCK_SIZE;
+        if (inBlock == 0) {
+            if (log.busy()) return 0;
+            if (!log.readBlock(first + offset / LOG_BLOCK_SIZE, block)) memset(&block, 0xFF, sizeof(block));
+        }
+        uint32_t n = LOG_BLOCK_SIZE - inBlock;
+        if (n > maxLen) n = maxLen;
+        memcpy(data, (const uint8_t*)&block + inBlock, n);
+        *at = offset;
+        offset += n;
+        return n;
+    }
+};
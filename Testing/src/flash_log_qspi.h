@@ -0,0 +1,83 @@
+#pragma once
+#include <Arduino.h>
+#include "QSPIFBlockDevice.h"
+#include "drivers/QSPI.h"
+#include "flash_log.h"
+
+/*
+  LogStorage sobre la QSPI flash de 16 MB del Portenta H7 (mbed QSPIFBlockDevice)
+
+  Los primeros MB de la QSPI guardan el firmware del WiFi y la partición de
+  usuario/OTA; el log usa una ventana fija al final de la memoria. Para usar
+  una tarjeta SD basta con otra implementación de LogStorage sobre
+  SDMMCBlockDevice.
+
+  QSPIFBlockDevice::erase() espera a que termine el borrado (decenas de ms
+  por sector). El borrado va directo con mbed::QSPI sobre el mismo periférico
+  (mbed lo reconfigura al cambiar de objeto): write enable + sector erase y
+  después se consulta el bit WIP del registro de estado. Lectura y
+  programación siguen por el block device.
+*/
+
+#define LOG_QSPI_OFFSET  0x00C00000u   // 12 MB
+#define LOG_QSPI_SIZE    0x00400000u   // 4 MB (~8000 bloques, varios días a 2 kHz comprimido)
+#define LOG_QSPI_FREQ    40000000
+#define LOG_QSPI_SECTOR  4096u         // Sector del MX25L12833F (comando 0x20)
+
+#define LOG_QSPI_CMD_WREN   0x06
+#define LOG_QSPI_CMD_RDSR   0x05
+#define LOG_QSPI_CMD_SE     0x20
+#define LOG_QSPI_SR_WIP     0x01
+
+class QspiLogStorage : public LogStorage {
+private:
+    QSPIFBlockDevice device;
+    mbed::QSPI qspi;           // Comandos sueltos para el borrado sin espera
+    bool ready;
+
+    bool command(uint8_t instruction, int address, char* rx = NULL, size_t rxLength = 0) {
+        return qspi.command_transfer(instruction, address, NULL, 0, rx, rxLength) == QSPI_STATUS_OK;
+    }
+
+public:
+    QspiLogStorage()
+        : device(QSPI_SO0, QSPI_SO1, QSPI_SO2, QSPI_SO3, QSPI_SCK, QSPI_CS,
+                 QSPIF_POLARITY_MODE_1, LOG_QSPI_FREQ),
+          qspi(QSPI_SO0, QSPI_SO1, QSPI_SO2, QSPI_SO3, QSPI_SCK, QSPI_CS, QSPIF_POLARITY_MODE_1),
+          ready(false) {}
+
+    bool begin() {
+        ready = (device.init() == 0) && device.get_erase_size(LOG_QSPI_OFFSET) <= LOG_QSPI_SECTOR &&
+                qspi.set_frequency(LOG_QSPI_FREQ) == QSPI_STATUS_OK &&
+                qspi.configure_format(QSPI_CFG_BUS_SINGLE, QSPI_CFG_BUS_SINGLE, QSPI_CFG_ADDR_SIZE_24,
+                                      QSPI_CFG_BUS_SINGLE, QSPI_CFG_ALT_SIZE_8, QSPI_CFG_BUS_SINGLE, 0) == QSPI_STATUS_OK;
+        return ready;
+    }
+
+    uint32_t size() const override { return ready ? LOG_QSPI_SIZE : 0; }
+
+    uint32_t pageSize() const override { return 256; }
+
+    uint32_t sectorSize() const override { return LOG_QSPI_SECTOR; }
+
+    bool read(uint32_t addr, void* data, uint32_t len) override {
+        return device.read(data, LOG_QSPI_OFFSET + addr, len) == 0;
+    }
+
+    bool program(uint32_t addr, const void* data, uint32_t len) override {
+        return device.program(data, LOG_QSPI_OFFSET + addr, len) == 0;
+    }
+
+    bool eraseStart(uint32_t addr, uint32_t len) override {
+        if (len != LOG_QSPI_SECTOR || addr % LOG_QSPI_SECTOR != 0) return false;
+        return command(LOG_QSPI_CMD_WREN, -1) && command(LOG_QSPI_CMD_SE, (int)(LOG_QSPI_OFFSET + addr));
+    }
+
+    // Sin respuesta del registro de estado se da por terminado: la
+    // programación siguiente falla y cuenta en writeErrors
+    bool busy() override {
+        char status = 0;
+        if (!command(LOG_QSPI_CMD_RDSR, -1, &status, 1)) return false;
+        return (status & LOG_QSPI_SR_WIP) != 0;
+    }
+};
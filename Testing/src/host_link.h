@@ -0,0 +1,273 @@
+#pragma once
+#include <Arduino.h>
+#include "cmd_protocol.h"
+#include "cmd_handler.h"
+#include "runtime_config.h"
+#include "shared.h"
+#include "dev_i2c.h"
+#include "time_sync.h"
+#include "window_analysis.h"
+#ifdef ENABLE_FLASH_LOG
+#include "flash_log.h"
+#endif
+#ifdef ENABLE_CYCLES
+#include "cycle_segmenter.h"
+#endif
+
+/*
+  Enlace con el host por el puerto serie
+
+  Lee el puerto sin bloquear y separa las tramas binarias de comandos
+  (cmd_protocol.h) de las líneas de texto (pings SYNC). Un comando de
+  configuración aceptado queda en pendingConfig y corta la lectura: la tarea
+  del host lo aplica antes de la trama siguiente. Con ACQ_ON_M4 los cambios de
+  periodo y sensores se responden recién con el ack del M4 (hostFinishSet).
+
+  Las respuestas se escriben enteras desde la tarea del host, así que caen
+  entre dos renglones de texto y nunca en medio de uno; el decodificador del
+  host (stream_decoder.h) las saltea.
+*/
+
+#define HOST_LINE_MAX 24
+#define HOST_LOG_FRAMES_PER_POLL 4   // Tramas CMD_LOG_DATA por pasada (~150 bytes)
+
+// Sensores que acepta CMD_SET_SENSORS. Con el M4 la máscara la valida además
+// su perfil; en modo local el SM4291 por I2C se lee siempre y el analógico
+// solo con la redundancia.
+#if defined(ACQ_ON_M4)
+#define HOST_SENSORS_SUPPORTED  ((1u << SENSOR_COUNT) - 1)
+#define HOST_SENSORS_REQUIRED   0u
+#elif defined(ENABLE_REDUNDANCY)
+#define HOST_SENSORS_SUPPORTED  ((1u << SENSOR_SM4291_I2C) | (1u << SENSOR_SM4291_ANALOG))
+#define HOST_SENSORS_REQUIRED   (1u << SENSOR_SM4291_I2C)
+#else
+#define HOST_SENSORS_SUPPORTED  (1u << SENSOR_SM4291_I2C)
+#define HOST_SENSORS_REQUIRED   (1u << SENSOR_SM4291_I2C)
+#endif
+
+// Costo del tick de adquisición del M7 para el periodo mínimo (cmdMinPeriodUs):
+// filtro, etapas y renglón de salida (TASK_ACQUIRE_SLICE_US de main.cpp sin la
+// lectura I2C), más las lecturas que hace el propio M7. Con ACQ_ON_M4 las
+// lecturas son del M4, que valida el periodo contra su perfil.
+#ifdef ENABLE_CONTROL
+#define HOST_TICK_US            140     // Además la espera hasta la actuación
+#else
+#define HOST_TICK_US            90
+#endif
+#define HOST_SM4291_I2C_READ_US i2cTransactionUs(DEV_I2C_CLOCK_HZ, 1, 2)   // Registro 0x30, 2 bytes
+
+// Definida en main.cpp: estadísticas actuales para CMD_GET_STATS
+void fillRuntimeStats(RuntimeStats& stats);
+
+#ifdef ENABLE_FLASH_LOG
+// Definidos en main.cpp
+extern FlashLog flashLog;
+extern bool flashLogReady;
+#endif
+
+#ifdef ENABLE_CYCLES
+// Definido en main.cpp
+extern CycleSegmenter cycles;
+#endif
+
+static CmdParser hostParser;
+static char hostLine[HOST_LINE_MAX];
+static uint8_t hostLineLen = 0;
+#ifdef ENABLE_FLASH_LOG
+static LogDownload hostLogDownload(flashLog);
+#endif
+#ifdef ACQ_ON_M4
+static bool hostSetWaiting = false;      // SET esperando el ack del M4
+static uint8_t hostSetCmd = 0;
+#endif
+
+inline void hostSendResponse(uint8_t cmd, uint8_t status, const uint8_t* data = NULL, uint8_t len = 0) {
+    uint8_t payload[CMD_MAX_PAYLOAD];
+    uint8_t frame[CMD_MAX_PAYLOAD + CMD_FRAME_OVERHEAD];
+
+    payload[0] = status;
+    if (len > CMD_MAX_PAYLOAD - 1) len = CMD_MAX_PAYLOAD - 1;
+    if (len > 0) memcpy(&payload[1], data, len);
+
+    size_t n = cmdEncodeFrame(cmd | CMD_RESPONSE_FLAG, payload, len + 1, frame);
+    Serial.write(frame, n);
+}
+
+#ifdef ENABLE_FLASH_LOG
+// Siguiente tramo de la descarga del log en curso: unas pocas tramas
+// CMD_LOG_DATA por pasada, así una descarga de CMD_LOG_READ_MAX bloques no
+// ocupa el puerto ni la tarea del host de una sola vez
+inline void hostLogDownloadPoll() {
+    uint8_t data[CMD_MAX_PAYLOAD - 1];
+    for (uint8_t i = 0; i < HOST_LOG_FRAMES_PER_POLL; i++) {
+        uint32_t at;
+        uint32_t n = hostLogDownload.next(&data[2], CMD_LOG_DATA_CHUNK, &at);
+        if (n == 0) return;
+        cmdPutU16(&data[0], (uint16_t)at);
+        hostSendResponse(CMD_LOG_DATA, CMD_OK, data, (uint8_t)(n + 2));
+    }
+}
+#endif
+
+// Comandos SET: se validan sobre una copia de la configuración (la pendiente
+// si ya hay cambios, si no la activa) y solo si se aceptan pasan a pendingConfig
+inline uint8_t hostHandleSet(const CmdFrame& f) {
+    CmdCapabilities caps;
+    caps.sensorMask = HOST_SENSORS_SUPPORTED;
+    caps.requiredSensors = HOST_SENSORS_REQUIRED;
+    caps.maxWindow = WINDOW_SIZE;
+#ifdef ENABLE_CONTROL
+    caps.control = true;
+#else
+    caps.control = false;
+#endif
+    // La ventana de curtosis (window_analysis.h) no está conectada al
+    // procesamiento de las muestras: ventana y umbrales no tendrían efecto
+    caps.window = false;
+    caps.tickUs = HOST_TICK_US;
+    memset(caps.readUs, 0, sizeof(caps.readUs));
+#ifndef ACQ_ON_M4
+    caps.readUs[SENSOR_SM4291_I2C] = HOST_SM4291_I2C_READ_US;
+    caps.readUs[SENSOR_SM4291_ANALOG] = PROFILE_ADC_READ_US;
+#endif
+
+    RuntimeConfig staged = configPending ? pendingConfig : activeConfig;
+    uint8_t status = cmdApplySet(f, staged, caps);
+    if (status == CMD_OK) {
+        pendingConfig = staged;
+        configPending = true;
+    }
+    return status;
+}
+
+#ifdef ACQ_ON_M4
+// Respuesta del SET de periodo o sensores, con el resultado del M4 (main.cpp)
+inline void hostFinishSet(uint8_t status) {
+    hostSendResponse(hostSetCmd, status);
+    hostSetWaiting = false;
+}
+#endif
+
+inline void hostHandleFrame(const CmdFrame& f) {
+    uint8_t data[CMD_MAX_PAYLOAD - 1];
+
+    switch (f.cmd) {
+        case CMD_PING:
+            hostSendResponse(f.cmd, CMD_OK);
+            break;
+
+        case CMD_GET_CONFIG: {
+            const RuntimeConfig& c = configPending ? pendingConfig : activeConfig;
+            hostSendResponse(f.cmd, CMD_OK, data, cmdEncodeConfig(c, data));
+            break;
+        }
+
+        case CMD_GET_STATS: {
+            RuntimeStats stats;
+            fillRuntimeStats(stats);
+            hostSendResponse(f.cmd, CMD_OK, data, cmdEncodeStats(stats, data));
+            break;
+        }
+
+#ifdef ENABLE_FLASH_LOG
+        case CMD_LOG_INFO: {
+            if (!flashLogReady) {
+                hostSendResponse(f.cmd, CMD_ERR_UNKNOWN);
+                break;
+            }
+            cmdPutU32(&data[0], flashLog.empty() ? 0 : flashLog.oldestSeq());
+            cmdPutU32(&data[4], flashLog.empty() ? 0 : flashLog.newestSeq());
+            cmdPutU32(&data[8], flashLog.capacityBlocks());
+            cmdPutU16(&data[12], LOG_BLOCK_SIZE);
+            hostSendResponse(f.cmd, CMD_OK, data, 14);
+            break;
+        }
+
+        case CMD_LOG_READ: {
+            if (f.len != 6) {
+                hostSendResponse(f.cmd, CMD_ERR_LENGTH);
+                break;
+            }
+            uint32_t first = cmdGetU32(f.payload);
+            uint16_t count = cmdGetU16(f.payload + 4);
+            if (!flashLogReady || count == 0 || count > CMD_LOG_READ_MAX) {
+                hostSendResponse(f.cmd, CMD_ERR_RANGE);
+                break;
+            }
+            hostSendResponse(f.cmd, CMD_OK);
+            // Los bloques salen de a poco en hostLogDownloadPoll()
+            hostLogDownload.start(first, count);
+            break;
+        }
+#endif
+
+#ifdef ENABLE_CYCLES
+        case CMD_CYCLE_LEARN: {
+            if (f.len != 1) {
+                hostSendResponse(f.cmd, CMD_ERR_LENGTH);
+                break;
+            }
+            uint8_t slot = f.payload[0];
+            if (slot == CMD_CYCLE_CLEAR_ALL) {
+                cycles.clearTemplates();
+                hostSendResponse(f.cmd, CMD_OK);
+                break;
+            }
+            // Sin ciclos cerrados todavía no hay forma que guardar
+            hostSendResponse(f.cmd, cycles.learn(slot) ? CMD_OK : CMD_ERR_RANGE);
+            break;
+        }
+#endif
+
+        default: {
+            uint8_t status = hostHandleSet(f);
+#ifdef ACQ_ON_M4
+            if (status == CMD_OK && (pendingConfig.periodUs != activeConfig.periodUs ||
+                                     pendingConfig.sensorMask != activeConfig.sensorMask)) {
+                hostSetCmd = f.cmd;
+                hostSetWaiting = true;
+                break;
+            }
+#endif
+            hostSendResponse(f.cmd, status);
+            break;
+        }
+    }
+}
+
+// Lee el puerto serie sin bloquear y procesa tramas y líneas completas hasta
+// el primer SET aceptado; después sigue con la descarga del log, si hay una
+// en curso
+inline void hostLinkPoll() {
+    while (!configPending && Serial.available() > 0) {
+#ifdef ACQ_ON_M4
+        if (hostSetWaiting) break;
+#endif
+        uint8_t b = (uint8_t)Serial.read();
+
+        // Tramas binarias
+        if (hostParser.busy() || b == CMD_SYNC0) {
+            if (hostParser.feed(b)) {
+                hostHandleFrame(hostParser.frame());
+            }
+            continue;
+        }
+
+        // Líneas de texto
+        if (b == '\n' || b == '\r') {
+            if (hostLineLen > 0) {
+                hostLine[hostLineLen] = '\0';
+                timeSyncHandleLine(hostLine);
+                hostLineLen = 0;
+            }
+        } else if (hostLineLen < HOST_LINE_MAX - 1) {
+            hostLine[hostLineLen++] = (char)b;
+        } else {
+            // Línea demasiado larga: descartar
+            hostLineLen = 0;
+        }
+    }
+#ifdef ENABLE_FLASH_LOG
+    hostLogDownloadPoll();
+#endif
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include <Arduino.h>
+#include <mbed.h>
+#include <new>
+#include "board_profile.h"
+
+/*
+  Periféricos I2C del H7 con transacciones asincrónicas (perfiles con
+  ACQUIRE_CONCURRENT, ver board_profile.h)
+
+  Cada periférico usado por el perfil (I2C1, I2C3, I2C4) tiene su mbed::I2C
+  con el reloj del bus declarado. start() arranca la transacción por
+  interrupciones (I2C::transfer, DEVICE_I2C_ASYNCH) y vuelve enseguida, así
+  las de buses distintos corren a la vez; wait() espera el evento de fin. Si
+  el core no trae la API asincrónica, start() hace la transacción bloqueante
+  y el perfil funciona igual, pero sin solapar los buses.
+
+  Con el contador de ciclos DWT se mide cada transacción desde que se arranca
+  hasta la interrupción de fin: es la ocupación real del bus, que el M4
+  publica por sensor para compararla con la estimación del perfil.
+
+  mbed vuelve a fijar el reloj del periférico cuando otro objeto lo usó
+  (devI2cRecover() con dev_i2c sobre el I2C3), no hace falta reconfigurarlo.
+*/
+
+#define I2C_BUS_TIMEOUT_US   1000    // Una transacción de 3 bytes a 100 kHz tarda ~500 us
+#define I2C_BUS_PERIPHERALS  5       // Índices 1..4 del H7
+
+// Pin de mbed de un BoardPin de I2C
+inline PinName i2cPinName(BoardPin pin) {
+    switch (pin) {
+        case PIN_D11:       return PH_8;
+        case PIN_D12:       return PH_7;
+        case PIN_I2C1_SDA:  return PB_7;
+        case PIN_I2C1_SCL:  return PB_6;
+        case PIN_I2C4_SDA:  return PH_12;
+        case PIN_I2C4_SCL:  return PH_11;
+        default:            return NC;
+    }
+}
+
+// Activa el contador de ciclos DWT (si low_power.h ya lo activó no cambia nada)
+inline void i2cBusCyclesBegin() {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+#if defined(CORE_CM7)
+    DWT->LAR = 0xC5ACCE55;
+#endif
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+class I2cAsyncBus {
+public:
+    uint32_t lastCycles = 0;    // Duración de la última transacción
+
+    // Se llama una vez por sensor; solo el primero crea el periférico
+    void begin(BoardPin sda, BoardPin scl, uint32_t clockHz) {
+        if (i2c) return;
+        i2c = new (storage) mbed::I2C(i2cPinName(sda), i2cPinName(scl));
+        i2c->frequency(clockHz);
+    }
+
+    // Escribe txLength bytes y lee rxLength con START repetido. Los buffers
+    // tienen que seguir vivos hasta wait(). false si el bus está ocupado.
+    bool start(uint8_t address, const uint8_t* tx, uint8_t txLength, uint8_t* rx, uint8_t rxLength) {
+        pending = false;
+        done = false;
+        event = 0;
+        startCycles = DWT->CYCCNT;
+#if DEVICE_I2C_ASYNCH
+        if (i2c->transfer(address << 1, (const char*)tx, txLength, (char*)rx, rxLength,
+                          mbed::callback(this, &I2cAsyncBus::onEvent), I2C_EVENT_ALL) != 0) {
+            return false;
+        }
+#else
+        // Sin API asincrónica: la transacción termina acá
+        bool ok = txLength == 0 || i2c->write(address << 1, (const char*)tx, txLength, true) == 0;
+        ok = ok && (rxLength == 0 || i2c->read(address << 1, (char*)rx, rxLength) == 0);
+        event = ok ? I2C_EVENT_TRANSFER_COMPLETE : I2C_EVENT_ERROR;
+        endCycles = DWT->CYCCNT;
+        done = true;
+#endif
+        pending = true;
+        return true;
+    }
+
+    // Espera el fin de la transacción; true si terminó sin NACK ni error
+    bool wait() {
+        if (!pending) {
+            lastCycles = 0;
+            return false;
+        }
+        pending = false;
+        uint32_t waitStart = micros();
+        while (!done) {
+            if (micros() - waitStart > I2C_BUS_TIMEOUT_US) {
+#if DEVICE_I2C_ASYNCH
+                i2c->abort_transfer();
+#endif
+                lastCycles = DWT->CYCCNT - startCycles;
+                return false;
+            }
+        }
+        lastCycles = endCycles - startCycles;
+        return event == I2C_EVENT_TRANSFER_COMPLETE;
+    }
+
+private:
+    alignas(mbed::I2C) uint8_t storage[sizeof(mbed::I2C)];
+    mbed::I2C* i2c = nullptr;
+    uint32_t startCycles = 0;
+    bool pending = false;
+    volatile bool done = false;
+    volatile int event = 0;
+    volatile uint32_t endCycles = 0;
+
+    // Interrupción de fin de transacción
+    void onEvent(int e) {
+        endCycles = DWT->CYCCNT;
+        event = e;
+        done = true;
+    }
+};
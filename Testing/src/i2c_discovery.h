@@ -0,0 +1,126 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "shared.h"
+
+/*
+  Descubrimiento de dispositivos I2C sin bloquear el arranque
+
+  sensorELV_scan() y scanI2CDevices() recorren las 126 direcciones de una vez
+  (con delay(2) por dirección, ~250 ms). Acá el escaneo es incremental: el M7
+  prueba una dirección por vuelta de loop(), entre dos ticks, con una escritura
+  vacía de ~25 us a 400 kHz. El resultado queda en un caché en SRAM4
+  (RAM_SHARED, después del bloque compartido M4 <-> M7): la sección es NOLOAD
+  y el arranque del core no la pone en cero, así que sobrevive a un reset en
+  caliente. Al arrancar, si el caché es válido (marca, versión y
+  suma de control), los dispositivos se informan enseguida ("#BOOT i2c
+  cached") y el escaneo de fondo solo lo confirma. Después de un corte de
+  energía el contenido es basura, no valida y se parte de cero. El M7 tiene
+  que limpiar la línea de caché de datos después de escribirlo
+  (discoveryPersist() en main.cpp): lo que quede sucio se pierde en el reset.
+
+  Este archivo no depende de Arduino y compila también en el host.
+*/
+
+#define DISCOVERY_MAGIC       0x49324344u   // "I2CD"
+#define DISCOVERY_VERSION     1
+#define DISCOVERY_FIRST_ADDR  0x08          // 0x00-0x07 y 0x78-0x7F están reservadas
+#define DISCOVERY_LAST_ADDR   0x77
+
+// Se guarda tal cual en la RAM sin inicializar: solo tipos simples
+struct DiscoveryCache {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t boots;             // Arranques que reusaron este caché
+    uint32_t present[4];        // Bit por dirección de 7 bits
+    uint32_t check;
+};
+
+static_assert(IPC_SHARED_ADDR + sizeof(IpcShared) + sizeof(DiscoveryCache) <= IPC_SRAM4_END,
+              "el caché no entra en SRAM4 después del bloque compartido");
+
+// El caché en SRAM4 (en el host, una variable)
+inline DiscoveryCache& discoveryCacheRam() {
+    RAM_SHARED static DiscoveryCache cache;
+    return cache;
+}
+
+// FNV-1a de todo lo anterior a 'check'
+inline uint32_t discoveryChecksum(const DiscoveryCache& cache) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&cache);
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(DiscoveryCache, check); i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+inline bool discoveryValid(const DiscoveryCache& cache) {
+    return cache.magic == DISCOVERY_MAGIC && cache.version == DISCOVERY_VERSION &&
+           cache.check == discoveryChecksum(cache);
+}
+
+inline void discoverySeal(DiscoveryCache& cache) {
+    cache.magic = DISCOVERY_MAGIC;
+    cache.version = DISCOVERY_VERSION;
+    cache.check = discoveryChecksum(cache);
+}
+
+inline void discoveryClear(DiscoveryCache& cache) {
+    cache.boots = 0;
+    for (uint8_t i = 0; i < 4; i++) cache.present[i] = 0;
+    discoverySeal(cache);
+}
+
+inline bool discoveryHas(const DiscoveryCache& cache, uint8_t address) {
+    return address < 128 && (cache.present[address >> 5] & (1u << (address & 31)));
+}
+
+// Valida el caché al arrancar: true si trae resultados de un arranque anterior
+inline bool discoveryBoot(DiscoveryCache& cache) {
+    if (!discoveryValid(cache)) {
+        discoveryClear(cache);
+        return false;
+    }
+    if (cache.boots < 0xFFFF) cache.boots++;
+    discoverySeal(cache);
+    return true;
+}
+
+// Recorre DISCOVERY_FIRST_ADDR..DISCOVERY_LAST_ADDR de a una dirección.
+// Al completar una pasada copia el resultado al caché.
+class DiscoveryScan {
+public:
+    DiscoveryScan() { restart(); }
+
+    void restart() {
+        address = DISCOVERY_FIRST_ADDR;
+        for (uint8_t i = 0; i < 4; i++) found[i] = 0;
+    }
+
+    bool done() const { return address > DISCOVERY_LAST_ADDR; }
+
+    // Próxima dirección a probar
+    uint8_t next() const { return address; }
+
+    // Resultado de probar next(); true si con esta terminó una pasada que
+    // cambió el caché
+    bool record(bool ack, DiscoveryCache& cache) {
+        if (done()) return false;
+        if (ack) found[address >> 5] |= 1u << (address & 31);
+        address++;
+        if (!done()) return false;
+
+        bool changed = false;
+        for (uint8_t i = 0; i < 4; i++) {
+            if (cache.present[i] != found[i]) changed = true;
+            cache.present[i] = found[i];
+        }
+        discoverySeal(cache);
+        return changed;
+    }
+
+private:
+    uint8_t address;
+    uint32_t found[4];
+};
@@ -0,0 +1,157 @@
+#pragma once
+#include <stdint.h>
+
+/*
+  Modo de bajo consumo entre ticks
+
+  En lugar de girar en loop() esperando la bandera del timer, el núcleo
+  ejecuta WFI y duerme hasta la próxima interrupción (timer de muestreo, USB,
+  SysTick de mbed). Se mide con el contador de ciclos DWT:
+  - el tiempo despierto y dormido, para el modelo de energía
+  - la latencia de despertar: desde la entrada en la ISR del timer hasta que
+    loop() retoma el procesamiento de la muestra
+
+  Se usa el modo sleep (WFI) y no stop: en stop se detiene el reloj de TIM12,
+  que es el que genera el tick de muestreo.
+
+  El modelo de energía no depende de Arduino y compila también en el host.
+*/
+
+// Consumo típico de la placa alimentada por el PF1550 (ajustar con mediciones)
+#define POWER_RUN_MA        180.0f   // M7 a 480 MHz procesando
+#define POWER_SLEEP_MA      95.0f    // M7 en WFI, periféricos activos
+#define POWER_BATTERY_MAH   2000.0f  // Capacidad de la batería LiPo
+
+// Contabilidad de energía por estado
+struct EnergyAccount {
+    uint64_t runUs;
+    uint64_t sleepUs;
+    uint32_t markCycles;    // Último cambio de estado, en ciclos del contador
+
+    void reset() { runUs = 0; sleepUs = 0; }
+
+    void addRun(uint32_t us) { runUs += us; }
+    void addSleep(uint32_t us) { sleepUs += us; }
+
+    void start(uint32_t cycles) {
+        reset();
+        markCycles = cycles;
+    }
+
+    // Cuenta como despierto/dormido el tiempo desde el último cambio hasta
+    // 'cycles'. La marca avanza solo los microsegundos enteros: el resto de
+    // la división pasa al intervalo siguiente en lugar de perderse en cada
+    // vuelta del loop. Intervalos de menos de una vuelta del contador de 32
+    // bits (~8.9 s a 480 MHz).
+    void runUntil(uint32_t cycles, uint32_t cyclesPerUs) { runUs += advance(cycles, cyclesPerUs); }
+    void sleepUntil(uint32_t cycles, uint32_t cyclesPerUs) { sleepUs += advance(cycles, cyclesPerUs); }
+
+    uint32_t advance(uint32_t cycles, uint32_t cyclesPerUs) {
+        uint32_t us = (cycles - markCycles) / cyclesPerUs;
+        markCycles += us * cyclesPerUs;
+        return us;
+    }
+
+    // Fracción del tiempo despierto (0..1)
+    float dutyCycle() const {
+        uint64_t total = runUs + sleepUs;
+        return total ? (float)runUs / (float)total : 1.0f;
+    }
+
+    float averageMa(float runMa = POWER_RUN_MA, float sleepMa = POWER_SLEEP_MA) const {
+        float duty = dutyCycle();
+        return duty * runMa + (1.0f - duty) * sleepMa;
+    }
+
+    float consumedMah(float runMa = POWER_RUN_MA, float sleepMa = POWER_SLEEP_MA) const {
+        return (runUs * runMa + sleepUs * sleepMa) / 3.6e9f;
+    }
+
+    float batteryHours(float capacityMah = POWER_BATTERY_MAH) const {
+        return capacityMah / averageMa();
+    }
+};
+
+// Estadísticas de latencia de despertar
+struct WakeLatencyStats {
+    uint32_t count;
+    uint32_t minCycles;
+    uint32_t maxCycles;
+    uint64_t sumCycles;
+
+    void reset() { count = 0; minCycles = UINT32_MAX; maxCycles = 0; sumCycles = 0; }
+
+    void add(uint32_t cycles) {
+        count++;
+        sumCycles += cycles;
+        if (cycles < minCycles) minCycles = cycles;
+        if (cycles > maxCycles) maxCycles = cycles;
+    }
+
+    uint32_t averageCycles() const { return count ? (uint32_t)(sumCycles / count) : 0; }
+};
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+extern EnergyAccount energyAccount;
+extern WakeLatencyStats wakeLatency;
+
+// Ciclos DWT en la entrada de la ISR del timer (la escribe TimerHandler)
+extern volatile uint32_t timerIsrCycles;
+
+// Activa el contador de ciclos DWT
+inline void lowPowerBegin() {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+#if defined(CORE_CM7)
+    DWT->LAR = 0xC5ACCE55;  // Desbloquear el DWT en el Cortex-M7
+#endif
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    energyAccount.start(0);
+    wakeLatency.reset();
+}
+
+inline uint32_t lowPowerCycles() { return DWT->CYCCNT; }
+
+inline uint32_t cyclesPerUs() { return SystemCoreClock / 1000000u; }
+
+inline uint32_t cyclesToUs(uint32_t cycles) { return cycles / cyclesPerUs(); }
+
+// Duerme hasta la próxima interrupción salvo que wakeFlag ya esté activa.
+// Con las interrupciones deshabilitadas WFI igual despierta con una pendiente,
+// así que una ISR que llegue entre la comprobación y el WFI no se pierde.
+inline void lowPowerIdle(const volatile bool& wakeFlag) {
+    __disable_irq();
+    if (wakeFlag) {
+        __enable_irq();
+        return;
+    }
+    energyAccount.runUntil(lowPowerCycles(), cyclesPerUs());
+
+    __DSB();
+    __WFI();
+    __enable_irq();
+
+    energyAccount.sleepUntil(lowPowerCycles(), cyclesPerUs());
+}
+
+// Al retomar el procesamiento de una muestra: latencia desde la ISR del timer
+inline void lowPowerSampleWake() {
+    wakeLatency.add(lowPowerCycles() - timerIsrCycles);
+}
+
+// Línea de estado "#POWER ..." (el osciloscopio ignora las líneas con '#')
+inline void lowPowerReport(Print& out) {
+    out.print("#POWER duty=");
+    out.print(energyAccount.dutyCycle() * 100.0f, 1);
+    out.print("% avg_mA=");
+    out.print(energyAccount.averageMa(), 1);
+    out.print(" battery_h=");
+    out.print(energyAccount.batteryHours(), 1);
+    out.print(" wake_us(avg/max)=");
+    out.print(cyclesToUs(wakeLatency.averageCycles()));
+    out.print("/");
+    out.println(cyclesToUs(wakeLatency.maxCycles));
+}
+#endif
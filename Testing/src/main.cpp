@@ -1,7 +1,7 @@
 /*
   Sensor SM4291 con indicador LED RGB
   SENSOR DE SUCCIÓN: 0 a -500 mbar
-  USANDO digitalWrite() para compatibilidad con Portenta H7
+  LED con PWM y patrones no bloqueantes (portenta_rgb.h)
   
   Códigos de LED:
   - Azul claro: Succión baja (0 a -50 mbar)
@@ -13,9 +13,97 @@
   - Azul: Inicializando
 */
 
+// Opciones de compilación: deben estar antes de los includes
+
+// Descomentar para que el núcleo M4 haga la adquisición (Portenta_M4) y el M7
+// solo consuma las muestras del ring compartido
+//#define ACQ_ON_M4
+
+// Descomentar para guardar las muestras en el log circular de la QSPI flash
+//#define ENABLE_FLASH_LOG
+
+// Resúmenes de 1 s / 1 min / 1 h (líneas "#R ...") junto a los datos crudos
+#define ENABLE_ROLLUPS
+
+// Detector de anomalías de la línea (eventos "#A ..." y puntajes "#AS ...")
+#define ENABLE_ANOMALY
+
+// Un resumen por ciclo de succión con su plantilla (líneas "#C ..."); con el
+// flujo crudo detenido (CMD_STREAM_STOP) es lo único que sale por muestra
+#define ENABLE_CYCLES
+
+// Descomentar para leer el SM4291 por I2C y por la salida analógica y pasar al
+// canal sano si uno falla (eventos "#F ..."; requiere cablear la salida a A0)
+//#define ENABLE_REDUNDANCY
+
+// Descomentar para estimar retardo y coherencia entre los sensores leídos por
+// el M4 (líneas "#X ..."; requiere ACQ_ON_M4 y al menos dos sensores en la máscara)
+//#define ENABLE_XCORR
+
+// Descomentar para dormir (WFI) entre ticks y reportar consumo estimado
+//#define ENABLE_LOW_POWER
+
+// Descomentar para medir la conversión por bloques al arrancar ("#BENCH ...")
+//#define ENABLE_CONVERT_BENCH
+
+// Descomentar para regular la succión con un PID a la tasa de adquisición
+// (consigna con CMD_SET_SETPOINT, estado en líneas "#CTL ..."). Sale por PWM en
+// CONTROL_OUTPUT_PIN; con CONTROL_OUTPUT_DAC por el DAC. Con CONTROL_SENSOR_ELVH
+// regula con el ELVH en lugar del SM4291. Solo con adquisición local
+//#define ENABLE_CONTROL
+//#define CONTROL_OUTPUT_DAC
+//#define CONTROL_SENSOR_ELVH
+
+// Arranque rápido: la adquisición empieza sin esperar al host y el banner y las
+// fases del arranque ("#BOOT ...") salen cuando se conecta. Comentar para
+// esperar al puerto serie antes de arrancar, con las pausas de la versión anterior
+#define ENABLE_FAST_BOOT
+
 #include <Arduino.h>
 #include "SM_4000.h"
 #include "portenta_rgb.h"
+#include "host_link.h"
+#ifdef ENABLE_FLASH_LOG
+#include "flash_log_qspi.h"
+#endif
+#ifdef ENABLE_LOW_POWER
+#include "low_power.h"
+#endif
+#ifdef ENABLE_ROLLUPS
+#include "rollup.h"
+#endif
+#ifdef ENABLE_ANOMALY
+#include "anomaly_detector.h"
+#endif
+#ifdef ENABLE_CYCLES
+#include "cycle_segmenter.h"
+#endif
+#ifdef ENABLE_REDUNDANCY
+#include "sensor_redundancy.h"
+#endif
+#ifdef ENABLE_XCORR
+#ifndef ACQ_ON_M4
+#error "ENABLE_XCORR necesita ACQ_ON_M4: en modo local solo se lee el SM4291"
+#endif
+#include "cross_correlation.h"
+#endif
+#ifdef ENABLE_CONTROL
+#ifdef ACQ_ON_M4
+#error "ENABLE_CONTROL necesita la adquisición local: la latencia lectura -> actuación se fija en el M7"
+#endif
+#include "pressure_control.h"
+#ifdef CONTROL_SENSOR_ELVH
+#include "sensor_elv.h"
+#endif
+#endif
+#include "sample_pipeline.h"
+#include "static_memory.h"
+#include "shared.h"
+#include "boot_timeline.h"
+#include "task_scheduler.h"
+#ifndef ACQ_ON_M4
+#include "i2c_discovery.h"
+#endif
 
 // Estas definiciones deben estar antes del include
 #define _TIMERINTERRUPT_LOGLEVEL_     0
@@ -23,6 +111,82 @@
 
 // Variables para la interrupción
 volatile bool readSensor = false;
+volatile uint32_t sampleTimestampUs = 0;
+volatile uint32_t timerTicks = 0;
+uint32_t seenTimerTicks = 0;
+
+#ifdef ENABLE_LOW_POWER
+// Contabilidad de energía y latencia de despertar (low_power.h)
+EnergyAccount energyAccount;
+WakeLatencyStats wakeLatency;
+volatile uint32_t timerIsrCycles = 0;
+unsigned long lastPowerReport = 0;
+#define POWER_REPORT_MS 10000
+#endif
+
+// Fases del arranque (boot_timeline.h) y conexión del host al puerto serie
+BootTimeline bootTimeline;
+bool acquisitionStarted = false;
+bool hostAttached = false;
+
+// Grupos de renglones del banner (printBannerStep())
+enum BannerStep : uint8_t {
+  BANNER_TITLE,
+  BANNER_MEMORY,                          // "#MEM" por sección de RAM
+  BANNER_POOLS,
+  BANNER_STATUS,                          // Benchmark, log y adquisición
+  BANNER_PHASES,                          // Un renglón "#BOOT <fase> <micros>" por fase
+  BANNER_BUDGET = BANNER_PHASES + BOOT_PHASES,
+  BANNER_I2C,
+  BANNER_DONE
+};
+uint8_t bannerStep = BANNER_DONE;   // Próximo grupo a enviar
+
+#ifndef ACQ_ON_M4
+// Dispositivos del I2C3 (i2c_discovery.h). El caché va en una dirección fija
+// de SRAM4 que el arranque no pone en cero, así sobrevive a un reset en caliente.
+DiscoveryCache& discoveryCache = discoveryCacheRam();
+DiscoveryScan discoveryScan;
+bool discoveryCached = false;
+#endif
+
+// Trabajo de loop() repartido en tareas (task_scheduler.h). La adquisición
+// tiene el menor periodo y por lo tanto la mayor prioridad; el resto corre en
+// porciones que entran entre dos ticks. Presupuestos en microsegundos.
+#ifdef ENABLE_CONTROL
+#define TASK_ACQUIRE_SLICE_US     200     // Además la espera hasta CONTROL_LATENCY_US
+#else
+#define TASK_ACQUIRE_SLICE_US     150     // Lectura I2C (~60 us), filtro y renglón de salida
+#endif
+#define TASK_HOST_PERIOD_US       1000    // Mínimo entre comandos del host
+#define TASK_HOST_SLICE_US        200
+#define TASK_LED_PERIOD_US        10000
+#define TASK_LED_SLICE_US         20
+#define TASK_XCORR_SLICE_US       150     // Una FFT de 1024 puntos
+#define TASK_FLASH_PERIOD_US      10000
+#define TASK_FLASH_SLICE_US       300     // Una página, o iniciar/consultar el borrado de un sector
+#define TASK_DISCOVERY_PERIOD_US  1000
+#define TASK_DISCOVERY_SLICE_US   40      // Una dirección del escaneo del bus
+#define TASK_REPORT_PERIOD_US     100000
+#define TASK_REPORT_SLICE_US      300     // Un grupo de renglones "#..." por porción
+#define TASK_ATTACH_PERIOD_US     50000   // Consulta de la conexión del host
+#define TASK_ATTACH_SLICE_US      300     // Un grupo de renglones del banner por porción
+#define TASK_CONTROL_PERIOD_US    5000    // Vigilancia de la medida del control
+#define TASK_CONTROL_SLICE_US     20
+#define SCHED_REPORT_MS           10000
+
+uint32_t schedulerClock() { return micros(); }
+TaskScheduler scheduler(schedulerClock);
+int taskAcquire = -1;
+int taskHost = -1;
+int taskLed = -1;
+int taskReport = -1;
+int taskAttach = -1;
+int taskXcorr = -1;
+int taskFlash = -1;
+int taskDiscovery = -1;
+int taskControl = -1;
+unsigned long lastSchedReport = 0;
 
 // Init timer TIM12
 Portenta_H7_Timer ITimer(TIM12);
@@ -30,76 +194,138 @@ Portenta_H7_Timer ITimer(TIM12);
 // Crear instancia del LED RGB
 PortentaRGB rgb;
 
-// Variables para análisis del sensor
-float lastSuction = 0.0;
+// Filtro, contadores y formato de salida (sample_pipeline.h; el replay nativo usa el mismo código).
+// El estado que se toca en cada muestra va en DTCM (static_memory.h)
+RAM_HOT SamplePipeline pipeline;
 unsigned long lastReadTime = 0;
-int consecutiveErrors = 0;
-int readingCount = 0;
-
-// Rangos de succión para indicadores (valores negativos)
-const float SUCTION_MIN_NORMAL = 0.0;      // mbar (sin succión)
-const float SUCTION_MAX_NORMAL = -500.0;   // mbar (succión máxima)
-const float SUCTION_LOW_MIN = 0.0;         // mbar (succión baja/sin succión)
-const float SUCTION_LOW_MAX = -50.0;       // mbar
-const float SUCTION_MEDIUM_MIN = -50.0;    // mbar (succión media)
-const float SUCTION_MEDIUM_MAX = -200.0;   // mbar
-const float SUCTION_HIGH_MIN = -200.0;     // mbar (succión alta)
-const float SUCTION_HIGH_MAX = -500.0;     // mbar (succión máxima)
+uint32_t configChanges = 0;
+
+// Configuración en tiempo de ejecución (ver runtime_config.h / host_link.h)
+RuntimeConfig activeConfig = defaultRuntimeConfig();
+RuntimeConfig pendingConfig = defaultRuntimeConfig();
+bool configPending = false;
+
+#ifdef ENABLE_ANOMALY
+// Detector de anomalías sobre las muestras crudas (anomaly_detector.h)
+RAM_HOT AnomalyDetector anomaly;
+unsigned long lastAnomalyReport = 0;
+#define ANOMALY_REPORT_MS 10000
+#endif
+
+#ifdef ENABLE_CYCLES
+// Segmentación de ciclos y plantillas (cycle_segmenter.h); CMD_CYCLE_LEARN
+// guarda la forma del último ciclo como referencia
+RAM_HOT CycleSegmenter cycles;
+#endif
+
+#ifdef ENABLE_REDUNDANCY
+// Canales I2C y analógico del SM4291 (sensor_redundancy.h)
+RedundancyManager redundancy;
+#ifdef ACQ_ON_M4
+IpcSample pendingI2cSample;       // Muestra I2C esperando la analógica del mismo tick
+bool havePendingI2c = false;
+#endif
+#endif
+
+#ifdef ENABLE_XCORR
+// Correlación entre sensores (cross_correlation.h). Ventana de 512 muestras:
+// retardos hasta ±128 ms y una estimación cada 128 ms a 2 kHz
+#define XCORR_WINDOW     512
+#define XCORR_REPORT_MS  1000
+RAM_BULK FftCrossCorrelator<XCORR_WINDOW> xcorr;   // ~55 KB de ventanas y espectros
+uint8_t xcorrSensors[XCORR_MAX_CHANNELS];   // SensorId de cada canal (el 0 es la referencia)
+uint8_t xcorrChannels = 0;
+float xcorrFrame[XCORR_MAX_CHANNELS];       // Muestras del tick en armado
+uint16_t xcorrSequence = 0;
+bool xcorrFrameOpen = false;
+uint32_t xcorrFrameUs = 0;
+uint32_t xcorrMaxBlockUs = 0;              // Etapa más larga (una FFT, ver xcorrTask)
+unsigned long lastXcorrReport = 0;
+#endif
+
+#ifdef ACQ_ON_M4
+// Ocupación de los buses I2C medida por el M4: cada BUS_REPORT_MS una línea
+// "#BUS <sensor> i2c<n> <ocupación %> <us por lectura> <lecturas>" por sensor I2C
+#define BUS_REPORT_MS 10000
+#define M4_HELLO_TIMEOUT_MS 1000     // Desde bootM4() hasta el saludo del M4
+#define M4_COMMAND_TIMEOUT_MS 500    // Ack de un comando (menos que el timeout de portenta_cmd.py)
+uint32_t lastBusBusyUs[SENSOR_COUNT];
+uint32_t lastBusReads[SENSOR_COUNT];
+unsigned long lastBusReport = 0;
+#endif
+
+#ifdef ENABLE_CONTROL
+// Control de succión (pressure_control.h). La salida se escribe siempre
+// CONTROL_LATENCY_US después de empezar la lectura del sensor de control: la
+// lectura I2C (~60 us) varía con el bus y así la planta ve un retardo fijo.
+// La salida de 8 bits comparte la resolución de analogWrite con el LED RGB.
+#ifdef CONTROL_OUTPUT_DAC
+#define CONTROL_OUTPUT_PIN   A6       // DAC1 del H7
+#else
+#define CONTROL_OUTPUT_PIN   D5       // PWM
+#endif
+#define CONTROL_OUTPUT_MAX   255
+#define CONTROL_LATENCY_US   100      // Lectura -> actuación, un quinto del tick a 2 kHz
+#define CONTROL_REPORT_MS    1000
+PidController controller;
+ControlLatency controlLatency;
+uint32_t controlReadCycles = 0;      // DWT al empezar la lectura del sensor de control
+uint32_t controlWriteCycles = 0;     // Lo más que tardó controlWrite(): se adelanta la escritura eso
+unsigned long lastControlReport = 0;
+#endif
+
+#ifdef ENABLE_FLASH_LOG
+// Log persistente de muestras (se escribe en segundo plano desde loop())
+QspiLogStorage logStorage;
+RAM_BULK FlashLog flashLog(logStorage);
+bool flashLogReady = false;
+#endif
 
 // Función de callback de la interrupción del timer
 void TimerHandler() {
+#ifdef ENABLE_LOW_POWER
+  timerIsrCycles = lowPowerCycles();
+#endif
+  sampleTimestampUs = micros();
+  timerTicks++;
   readSensor = true;
 }
 
-void updateLEDStatus(float suction) {
-  if (suction == -1.0) {
-    // Error en la lectura
-    consecutiveErrors++;
-    if (consecutiveErrors > 5) {
-      rgb.red();  // Rojo para errores persistentes
-    } else {
-      // Parpadeo naranja para errores ocasionales (simulado con digital)
-      static bool blinkState = false;
-      blinkState = !blinkState;
-      if (blinkState) {
-        rgb.yellow(); // Amarillo como "naranja" digital
-      } else {
-        rgb.off();
-      }
-    }
-  } else {
-    consecutiveErrors = 0; // Reset contador de errores
-    
-    // Verificar rangos de succión
-    if (suction > SUCTION_MIN_NORMAL || suction < SUCTION_MAX_NORMAL) {
-      // Valor fuera del rango de succión normal (0 a -500 mbar)
-      rgb.yellow();
-    } else if (suction >= SUCTION_LOW_MIN && suction > SUCTION_LOW_MAX) {
-      // Succión baja o sin succión (0 a -50 mbar)
-      rgb.blue();  // Azul para succión baja (azul claro no disponible en digital)
-    } else if (suction <= SUCTION_LOW_MAX && suction > SUCTION_MEDIUM_MAX) {
-      // Succión media (-50 a -200 mbar)
-      rgb.green();      // Verde para succión normal/media
-    } else if (suction <= SUCTION_MEDIUM_MAX && suction >= SUCTION_HIGH_MAX) {
-      // Succión alta (-200 a -500 mbar)
-      rgb.cyan();       // Cyan para succión alta (óptima)
-    } else {
-      // Valor por defecto
+// Color del LED para el estado de la muestra (ver suctionStatus() en sample_pipeline.h)
+void updateLEDStatus(SuctionStatus status) {
+  switch (status) {
+    case STATUS_ERROR_PERSISTENT:
+      rgb.red();        // Rojo para errores persistentes
+      break;
+    case STATUS_ERROR:
+      rgb.setColor(rgb.COLOR_ORANGE);       // Naranja para errores ocasionales
+      break;
+    case STATUS_OUT_OF_RANGE:
+      rgb.yellow();     // Fuera del rango de succión normal (0 a -500 mbar)
+      break;
+    case STATUS_LOW:
+      rgb.setColor(rgb.COLOR_LIGHT_BLUE);   // Azul claro para succión baja (0 a -50 mbar)
+      break;
+    case STATUS_MEDIUM:
+      rgb.green();      // Verde para succión media (-50 a -200 mbar)
+      break;
+    case STATUS_HIGH:
+      rgb.cyan();       // Cyan para succión alta (-200 a -500 mbar)
+      break;
+    default:
       rgb.magenta();    // Magenta para casos no definidos
-    }
+      break;
   }
 }
 
+// Encola la secuencia de inicio; la reproduce rgb.update() desde loop(), así
+// el muestreo arranca enseguida
 void showStartupSequence() {
   Serial.println("Iniciando secuencia de startup...");
   
-  // Secuencia de colores de inicio (simplificada para digital)
-  rgb.blue();
-  delay(500);
-  rgb.magenta();
-  delay(500);
-  rgb.green();
-  delay(500);
+  rgb.play(RgbPattern::solid(rgb.COLOR_BLUE, 500));
+  rgb.play(RgbPattern::solid(rgb.COLOR_MAGENTA, 500));
+  rgb.play(RgbPattern::solid(rgb.COLOR_GREEN, 500));
   
   // Parpadeo para indicar listo
   rgb.blink(rgb.COLOR_WHITE, 200, 200, 3);
@@ -107,32 +333,893 @@ void showStartupSequence() {
   Serial.println("Sistema listo!");
 }
 
+#ifdef ENABLE_XCORR
+// Canales del correlador a partir de la máscara de sensores, en orden de
+// SensorId. La salida analógica del SM4291 no cuenta: es el mismo sensor.
+void xcorrConfigure(uint32_t sensorMask) {
+  static const uint8_t candidates[] = {SENSOR_SM4291_I2C, SENSOR_ELVH, SENSOR_ABPLLN, SENSOR_SSCDANN};
+  xcorrChannels = 0;
+  for (uint8_t id : candidates) {
+    if ((sensorMask & (1u << id)) && xcorrChannels < XCORR_MAX_CHANNELS) {
+      xcorrSensors[xcorrChannels++] = id;
+    }
+  }
+  if (xcorrChannels >= 2) xcorr.setChannels(xcorrChannels);
+  xcorrFrameOpen = false;
+  xcorrMaxBlockUs = 0;
+}
+
+// Entrega el tick armado al correlador
+void xcorrFlushFrame() {
+  xcorrFrameOpen = false;
+  if (xcorrChannels < 2) return;
+  // Solo copia las ventanas; las FFT corren en porciones en xcorrTask()
+  if (xcorr.append(xcorrFrame)) {
+    scheduler.release(taskXcorr, micros());
+  }
+}
+
+// Una etapa del bloque de correlación por porción
+TaskResult xcorrTask(void*) {
+  uint32_t start = micros();
+  bool more = xcorr.step();
+  uint32_t elapsed = micros() - start;
+  if (elapsed > xcorrMaxBlockUs) xcorrMaxBlockUs = elapsed;
+  return more ? TASK_MORE : TASK_DONE;
+}
+
+// Arma los ticks con las muestras del M4: todas las de un tick llevan la misma
+// secuencia. Una lectura con error repite el último valor del canal.
+void xcorrAddSample(const IpcSample& sample) {
+  int channel = -1;
+  for (uint8_t c = 0; c < xcorrChannels; c++) {
+    if (xcorrSensors[c] == sample.sensorId) channel = c;
+  }
+  if (channel < 0) return;
+  if (xcorrFrameOpen && sample.sequence != xcorrSequence) {
+    xcorrFlushFrame();
+  }
+  if (!xcorrFrameOpen) {
+    xcorrFrameOpen = true;
+    xcorrSequence = sample.sequence;
+    xcorrFrameUs = sample.timestampUs;
+  }
+  if (sample.status == SAMPLE_OK) {
+    xcorrFrame[channel] = sample.value;
+  }
+}
+
+// Un renglón por canal: "#X <micros> <sensor> <retardo ms> <pico> <coherencia> <válido>"
+// y uno de carga: "#XS <bloques> <peor etapa us>"
+void emitXcorrReport() {
+  if (xcorrChannels < 2 || xcorr.blocks == 0) return;
+  for (uint8_t c = 1; c < xcorrChannels; c++) {
+    const DelayEstimate& estimate = xcorr.estimate(c);
+    Serial.print("#X ");
+    Serial.print(xcorrFrameUs);
+    Serial.print(" ");
+    Serial.print(sensorName(xcorrSensors[c]));
+    Serial.print(" ");
+    Serial.print(estimate.delaySamples * activeConfig.periodUs / 1000.0f, 3);
+    Serial.print(" ");
+    Serial.print(estimate.peak, 3);
+    Serial.print(" ");
+    Serial.print(estimate.coherence, 3);
+    Serial.println(estimate.valid ? " 1" : " 0");
+  }
+  Serial.print("#XS ");
+  Serial.print(xcorr.blocks);
+  Serial.print(" ");
+  Serial.println(xcorrMaxBlockUs);
+}
+#endif
+
+#ifdef ACQ_ON_M4
+void emitBusReport() {
+  IpcShared* ipc = ipcShared();
+  ipcInvalidate(&ipc->busMap, sizeof(uint32_t) * (1 + 2 * SENSOR_COUNT));
+  unsigned long now = millis();
+  uint32_t elapsedUs = (now - lastBusReport) * 1000;
+  lastBusReport = now;
+
+  for (uint8_t id = 0; id < SENSOR_COUNT; id++) {
+    uint8_t bus = (ipc->busMap >> (4 * id)) & 0x0F;
+    if (bus == 0) continue;
+    uint32_t busyUs = ipc->busBusyUs[id] - lastBusBusyUs[id];
+    uint32_t reads = ipc->busReads[id] - lastBusReads[id];
+    lastBusBusyUs[id] = ipc->busBusyUs[id];
+    lastBusReads[id] = ipc->busReads[id];
+    if (reads == 0 || elapsedUs == 0) continue;
+
+    Serial.print("#BUS ");
+    Serial.print(sensorName(id));
+    Serial.print(" i2c");
+    Serial.print(bus);
+    Serial.print(" ");
+    Serial.print(100.0f * busyUs / elapsedUs, 2);
+    Serial.print(" ");
+    Serial.print((float)busyUs / reads, 1);
+    Serial.print(" ");
+    Serial.println(reads);
+  }
+}
+
+// Envía un comando al M4 y espera su confirmación (el buzón admite uno a la vez)
+bool m4Command(IpcCommand cmd, uint32_t arg) {
+  IpcShared* ipc = ipcShared();
+  uint32_t seq = ipcPostCommand(ipc, cmd, arg);
+  unsigned long waitStart = millis();
+  while (!ipcCommandAcked(ipc, seq)) {
+    if (millis() - waitStart > M4_COMMAND_TIMEOUT_MS) return false;
+  }
+  return ipc->result == 0;
+}
+
+// Cambio de periodo o sensores que espera el ack del M4. La tarea del host lo
+// consulta en cada pasada (m4ConfigPoll) en lugar de esperarlo, y mientras
+// tanto hostLinkPoll() no lee más tramas
+struct M4ConfigChange {
+  bool waiting;
+  uint32_t seq;
+  unsigned long postedMs;
+  RuntimeConfig previous;      // Se restaura si el M4 no acepta el cambio
+};
+M4ConfigChange m4Change;
+
+void m4ConfigPost(IpcCommand cmd, uint32_t arg, const RuntimeConfig& previous) {
+  m4Change.seq = ipcPostCommand(ipcShared(), cmd, arg);
+  m4Change.postedMs = millis();
+  m4Change.previous = previous;
+  m4Change.waiting = true;
+}
+#endif
+
+#ifndef ACQ_ON_M4
+// Dispositivos del caché: "#BOOT i2c <origen> <arranques> <direcciones...>"
+void emitDiscovery(const char* source) {
+  Serial.print("#BOOT i2c ");
+  Serial.print(source);
+  Serial.print(" ");
+  Serial.print(discoveryCache.boots);
+  for (uint8_t address = DISCOVERY_FIRST_ADDR; address <= DISCOVERY_LAST_ADDR; address++) {
+    if (!discoveryHas(discoveryCache, address)) continue;
+    Serial.print(" 0x");
+    if (address < 16) Serial.print("0");
+    Serial.print(address, HEX);
+  }
+  Serial.println();
+}
+
+// El caché de datos del M7 es write-back: sin limpiarlo, lo último escrito
+// en el caché de descubrimiento no llega a SRAM4 antes de un reset
+void discoveryPersist() {
+  ipcClean(&discoveryCache, sizeof(DiscoveryCache));
+}
+
+// Prueba una dirección del escaneo de fondo (~25 us a 400 kHz)
+TaskResult discoveryTask(void*) {
+  if (discoveryScan.done()) return TASK_DONE;
+  dev_i2c.beginTransmission(discoveryScan.next());
+  bool ack = dev_i2c.endTransmission() == 0;
+  bool changed = discoveryScan.record(ack, discoveryCache);
+  if (discoveryScan.done()) discoveryPersist();
+  if (changed && hostAttached) {
+    emitDiscovery("scan");
+  }
+  return TASK_DONE;
+}
+#endif
+
+// Banner y estado del arranque; se envían cada vez que el host se conecta, un
+// grupo de renglones por porción de la tarea "attach" (el banner entero no
+// entra en una porción). Envía el grupo bannerStep y avanza; false cuando ya
+// no queda nada.
+bool printBannerStep() {
+  switch (bannerStep) {
+    case BANNER_TITLE:
+      Serial.println("=== SENSOR SM4291 SUCCIÓN con LED RGB - 2kHz ===");
+      Serial.println("USANDO digitalWrite() - Compatible con Portenta H7");
+      break;
+    case BANNER_MEMORY:
+      memoryMapReport(Serial);
+      break;
+    case BANNER_POOLS:
+      poolReport(Serial);
+      break;
+    case BANNER_STATUS:
+#ifdef ENABLE_CONVERT_BENCH
+      pressureConvertBenchmark(Serial);
+#endif
+#ifdef ENABLE_FLASH_LOG
+      Serial.print("Log QSPI: ");
+      if (flashLogReady) {
+        Serial.print(flashLog.empty() ? 0 : flashLog.newestSeq() - flashLog.oldestSeq() + 1);
+        Serial.println(" bloques guardados");
+      } else {
+        Serial.println("no disponible");
+      }
+#endif
+#ifdef ACQ_ON_M4
+      Serial.println(acquisitionStarted ? "Adquisición en M4 a 2kHz (500us)" : "Error: el M4 no respondió");
+#else
+      Serial.println(acquisitionStarted ? "Timer configurado correctamente a 2kHz (500us)"
+                                        : "Error: No se pudo configurar el timer");
+#endif
+      break;
+    case BANNER_BUDGET:
+      Serial.print("#BOOT budget ");
+      Serial.print(bootTimeline.us[BOOT_ACQ_START]);
+      Serial.println(bootTimeline.withinBudget() ? " ok" : " late");
+      break;
+    case BANNER_I2C:
+#ifndef ACQ_ON_M4
+      if (discoveryScan.done()) {
+        emitDiscovery("scan");
+      } else if (discoveryCached) {
+        emitDiscovery("cached");
+      }
+#endif
+      break;
+    case BANNER_DONE:
+      return false;
+    default: {
+      uint8_t phase = bannerStep - BANNER_PHASES;
+      if (bootTimeline.has(phase)) {
+        Serial.print("#BOOT ");
+        Serial.print(bootPhaseName(phase));
+        Serial.print(" ");
+        Serial.println(bootTimeline.us[phase]);
+      }
+      break;
+    }
+  }
+  bannerStep++;
+  return bannerStep < BANNER_DONE;
+}
+
+// Detecta la conexión del host (DTR del puerto USB) sin bloquear el arranque
+// y le envía el banner de a porciones
+TaskResult attachTask(void*) {
+  if (printBannerStep()) return TASK_MORE;
+  bool connected = Serial;
+  if (connected && !hostAttached) {
+    bootTimeline.mark(BOOT_HOST, micros());
+    bannerStep = BANNER_TITLE;
+    hostAttached = connected;
+    return TASK_MORE;
+  }
+  hostAttached = connected;
+  return TASK_DONE;
+}
+
+// Arranca el muestreo periódico: el timer local o la adquisición en el M4
+bool startAcquisition() {
+#ifdef ACQ_ON_M4
+  // El M4 es dueño del timer: responder a su saludo de este arranque (recién
+  // entonces inicializa los sensores) y después configurarlo y arrancarlo
+  unsigned long waitStart = millis();
+  while (!ipcAnswerHello(ipcShared())) {
+    if (millis() - waitStart > M4_HELLO_TIMEOUT_MS) return false;
+  }
+  return m4Command(IPC_CMD_SET_PERIOD_US, activeConfig.periodUs) &&
+         m4Command(IPC_CMD_SET_SENSORS, activeConfig.sensorMask) &&
+         m4Command(IPC_CMD_START, 0);
+#else
+  // Configurar timer para 2kHz (500us)
+  return ITimer.attachInterruptInterval(activeConfig.periodUs, TimerHandler);
+#endif
+}
+
+#ifdef ENABLE_ROLLUPS
+// Emite un resumen: "#R <nivel> <micros inicio> <n> <min> <max> <media> <desvío> <p50> <p95> <p99>"
+// Se envía aunque el flujo crudo esté detenido (CMD_STREAM_STOP)
+void emitRollup(uint8_t level, const Rollup& rollup) {
+  Serial.print("#R ");
+  Serial.print(level);
+  Serial.print(" ");
+  Serial.print(rollup.startUs);
+  Serial.print(" ");
+  Serial.print(rollup.count);
+  Serial.print(" ");
+  Serial.print(rollup.minValue, 3);
+  Serial.print(" ");
+  Serial.print(rollup.maxValue, 3);
+  Serial.print(" ");
+  Serial.print(rollup.mean, 3);
+  Serial.print(" ");
+  Serial.print(sqrt(rollup.variance()), 3);
+  Serial.print(" ");
+  Serial.print(rollup.quantile(0.50f), 3);
+  Serial.print(" ");
+  Serial.print(rollup.quantile(0.95f), 3);
+  Serial.print(" ");
+  Serial.println(rollup.quantile(0.99f), 3);
+}
+
+RollupCascade rollups(emitRollup);
+#endif
+
+#ifdef ENABLE_ANOMALY
+// Un evento por bandera que cambió: "#A <micros> <tipo> on|off <puntaje>"
+// Se envía aunque el flujo crudo esté detenido (CMD_STREAM_STOP)
+void emitAnomalyEvents(uint32_t sampleUs, uint8_t changed) {
+  uint8_t active = anomaly.activeFlags();
+  for (uint8_t flag = 1; flag; flag <<= 1) {
+    if (!(changed & flag)) continue;
+    Serial.print("#A ");
+    Serial.print(sampleUs);
+    Serial.print(" ");
+    Serial.print(anomalyFlagName(flag));
+    Serial.print((active & flag) ? " on " : " off ");
+    Serial.println(anomalyFlagScore(anomaly.currentScores(), flag), 2);
+  }
+}
+
+// Puntajes actuales: "#AS <banderas> <z> <cusum fuga> <cusum oclusión> <deriva> <ruido> <bandas dB...>"
+void emitAnomalyScores() {
+  const AnomalyScores& scores = anomaly.currentScores();
+  Serial.print("#AS ");
+  Serial.print(anomaly.learned() ? anomaly.activeFlags() : -1);
+  Serial.print(" ");
+  Serial.print(scores.levelZ, 2);
+  Serial.print(" ");
+  Serial.print(scores.cusumLeak, 1);
+  Serial.print(" ");
+  Serial.print(scores.cusumOcclusion, 1);
+  Serial.print(" ");
+  Serial.print(scores.driftSigma, 2);
+  Serial.print(" ");
+  Serial.print(scores.noiseRatio, 2);
+  for (int b = 0; b < ANOMALY_BANDS; b++) {
+    Serial.print(" ");
+    Serial.print(scores.bandDeltaDb[b], 1);
+  }
+  Serial.println();
+}
+#endif
+
+#ifdef ENABLE_CYCLES
+// Un ciclo cerrado: "#C <n> <micros inicio> <duración us> <pico mbar> <subida us>
+// <bajada us> <meseta us> <área mbar·s> <plantilla> <ncc> <dtw> <banderas>"
+// Se envía aunque el flujo crudo esté detenido (CMD_STREAM_STOP)
+void emitCycle(const CycleFeatures& cycle) {
+  Serial.print("#C ");
+  Serial.print(cycle.index);
+  Serial.print(" ");
+  Serial.print(cycle.startUs);
+  Serial.print(" ");
+  Serial.print(cycle.durationUs);
+  Serial.print(" ");
+  Serial.print(cycle.peakMbar, 2);
+  Serial.print(" ");
+  Serial.print(cycle.riseUs);
+  Serial.print(" ");
+  Serial.print(cycle.fallUs);
+  Serial.print(" ");
+  Serial.print(cycle.plateauUs);
+  Serial.print(" ");
+  Serial.print(cycle.areaMbarS, 3);
+  Serial.print(" ");
+  Serial.print(cycle.templateId);
+  Serial.print(" ");
+  Serial.print(cycle.ncc, 3);
+  Serial.print(" ");
+  Serial.print(cycle.dtw, 3);
+  Serial.print(" ");
+  Serial.println(cycle.flags);
+}
+#endif
+
+#ifdef ENABLE_CONTROL
+inline void controlWrite(float output) {
+  analogWrite(CONTROL_OUTPUT_PIN, (int)(output * CONTROL_OUTPUT_MAX + 0.5f));
+}
+
+// Salida en failsafe antes de arrancar la adquisición y contador DWT para la
+// latencia (si low_power.h ya lo activó no cambia nada)
+void controlBegin() {
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->LAR = 0xC5ACCE55;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  controller.setFilterAlpha(activeConfig.filterAlpha);
+  controller.setGains({activeConfig.controlKp, activeConfig.controlKi, activeConfig.controlKd, activeConfig.controlKff});
+  controller.setSetpoint(activeConfig.controlSetpoint);
+  controlWrite(controller.currentOutput());
+  // La primera escritura además configura el pin: se mide la segunda
+  uint32_t start = DWT->CYCCNT;
+  controlWrite(controller.currentOutput());
+  controlWriteCycles = DWT->CYCCNT - start;
+  controlLatency.reset();
+}
+
+// Muestra del sensor de control (lectura empezada en controlReadCycles):
+// calcula la salida y la escribe de modo que termine a CONTROL_LATENCY_US.
+// La latencia se toma después de controlWrite(), con la escritura incluida.
+void controlStep(uint32_t sampleUs, float mbar) {
+  float output = controller.update(sampleUs, mbar, mbar != -1.0);
+  uint32_t budgetCycles = CONTROL_LATENCY_US * (SystemCoreClock / 1000000u);
+  uint32_t waitCycles = budgetCycles > controlWriteCycles ? budgetCycles - controlWriteCycles : 0;
+  while (DWT->CYCCNT - controlReadCycles < waitCycles) {
+  }
+  uint32_t writeStart = DWT->CYCCNT;
+  controlWrite(output);
+  uint32_t written = DWT->CYCCNT;
+  if (written - writeStart > controlWriteCycles) controlWriteCycles = written - writeStart;
+  uint32_t elapsed = written - controlReadCycles;
+  controlLatency.add((float)elapsed / (float)(SystemCoreClock / 1000000u), CONTROL_LATENCY_US);
+}
+
+#ifdef CONTROL_SENSOR_ELVH
+// El ELVH se lee solo para el control, antes de la muestra del SM4291
+void controlSampleElvh(uint32_t sampleUs) {
+  controlReadCycles = DWT->CYCCNT;
+  int counts;
+  bool ok = sensorELV_readRaw(&counts);
+  controlStep(sampleUs, ok ? 1000.0f * pressureConvert(counts, CAL_ELVH_BAR) : -1.0f);
+}
+#endif
+
+// Estado del control: "#CTL <estado> <consigna> <medida> <salida> <latencia
+// media us> <mín> <máx> <tarde>"; la latencia es del último intervalo
+void emitControlReport() {
+  Serial.print("#CTL ");
+  Serial.print(controlStateName(controller.currentState()));
+  Serial.print(" ");
+  Serial.print(controller.setpoint(), 1);
+  Serial.print(" ");
+  Serial.print(controller.measurement(), 2);
+  Serial.print(" ");
+  Serial.print(controller.currentOutput(), 3);
+  Serial.print(" ");
+  Serial.print(controlLatency.averageUs(), 1);
+  Serial.print(" ");
+  Serial.print(controlLatency.count ? controlLatency.minUs : 0.0f, 1);
+  Serial.print(" ");
+  Serial.print(controlLatency.maxUs, 1);
+  Serial.print(" ");
+  Serial.println(controlLatency.late);
+  controlLatency.reset();
+}
+#endif
+
+// Periodo de muestreo de las tareas que dependen de él
+void setAcquisitionPeriod(uint32_t periodUs) {
+  scheduler.setPeriod(taskAcquire, periodUs);
+#ifdef ENABLE_XCORR
+  scheduler.setPeriod(taskXcorr, XCORR_WINDOW / 2 * periodUs);
+#endif
+#ifdef ENABLE_ANOMALY
+  anomaly.setPeriodUs(periodUs);
+#endif
+}
+
+// Aplica la configuración recibida del host entre dos ticks
+void applyRuntimeConfig() {
+  RuntimeConfig previous = activeConfig;
+  activeConfig = pendingConfig;
+  configPending = false;
+  configChanges++;
+
+#ifdef ACQ_ON_M4
+  // Periodo y sensores los aplica el M4: el resto del cambio (y la respuesta
+  // al host) espera su ack en m4ConfigPoll(). hostLinkPoll() entrega un SET
+  // por pasada, así que cambia uno solo de los dos
+  if (activeConfig.periodUs != previous.periodUs) {
+    m4ConfigPost(IPC_CMD_SET_PERIOD_US, activeConfig.periodUs, previous);
+  } else if (activeConfig.sensorMask != previous.sensorMask) {
+    m4ConfigPost(IPC_CMD_SET_SENSORS, activeConfig.sensorMask, previous);
+  }
+#else
+  // En modo local se usa el SM4291 por I2C (y su salida analógica si
+  // ENABLE_REDUNDANCY y el bit está en la máscara); la máscara se lee por tick
+  if (activeConfig.periodUs != previous.periodUs) {
+    ITimer.setInterval(activeConfig.periodUs, TimerHandler);
+    setAcquisitionPeriod(activeConfig.periodUs);
+  }
+#endif
+#ifdef ENABLE_CONTROL
+  controller.setFilterAlpha(activeConfig.filterAlpha);
+  controller.setGains({activeConfig.controlKp, activeConfig.controlKi, activeConfig.controlKd, activeConfig.controlKff});
+  controller.setSetpoint(activeConfig.controlSetpoint);
+#endif
+}
+
+#ifdef ACQ_ON_M4
+// Ack del cambio enviado al M4: si lo acepta se completa en el M7; si lo
+// rechaza o no contesta en M4_COMMAND_TIMEOUT_MS, activeConfig vuelve a la
+// anterior. En los dos casos el host recibe ahora la respuesta del SET
+void m4ConfigPoll() {
+  if (!m4Change.waiting) return;
+  IpcShared* ipc = ipcShared();
+  uint8_t status;
+  if (ipcCommandAcked(ipc, m4Change.seq)) {
+    status = ipc->result == 0 ? CMD_OK : CMD_ERR_RANGE;
+  } else if (millis() - m4Change.postedMs > M4_COMMAND_TIMEOUT_MS) {
+    status = CMD_ERR_TIMEOUT;
+  } else {
+    return;
+  }
+  m4Change.waiting = false;
+
+  if (status != CMD_OK) {
+    activeConfig = m4Change.previous;
+  } else if (activeConfig.periodUs != m4Change.previous.periodUs) {
+    setAcquisitionPeriod(activeConfig.periodUs);
+  } else {
+#ifdef ENABLE_XCORR
+    xcorrConfigure(activeConfig.sensorMask);
+#endif
+  }
+  hostFinishSet(status);
+}
+#endif
+
+// Estadísticas para CMD_GET_STATS (host_link.h)
+void fillRuntimeStats(RuntimeStats& stats) {
+  stats.readings = pipeline.readings;
+  stats.errors = pipeline.errors;
+  stats.consecutiveErrors = pipeline.consecutiveErrors;
+  stats.configChanges = configChanges;
+#ifdef ACQ_ON_M4
+  ipcInvalidate(&ipcShared()->dropped, sizeof(uint32_t));
+  stats.dropped = ipcShared()->dropped;
+#else
+  stats.dropped = 0;
+#endif
+  stats.uptimeMs = millis();
+  stats.lastValue = pipeline.lastValue;
+}
+
+// Procesa una muestra de succión (leída aquí o recibida del M4)
+void processSample(uint32_t sampleUs, float suctionMbar) {
+  bootTimeline.mark(BOOT_FIRST_SAMPLE, micros());
+
+#if defined(ENABLE_CONTROL) && !defined(CONTROL_SENSOR_ELVH)
+  // Primero el actuador: nada de lo que sigue entra en la latencia
+  controlStep(sampleUs, suctionMbar);
+#endif
+
+#ifdef ENABLE_FLASH_LOG
+  // Guardar la muestra sin filtrar (solo copia a RAM; la flash se escribe en loop)
+  if (flashLogReady && suctionMbar != -1.0) {
+    flashLog.append(sampleUs, suctionMbar);
+  }
+#endif
+  
+#ifdef ENABLE_ANOMALY
+  // El detector ve la muestra sin filtrar (el filtro atenuaría las pulsaciones)
+  if (suctionMbar != -1.0) {
+    uint8_t changed = anomaly.update(suctionMbar);
+    if (changed) emitAnomalyEvents(sampleUs, changed);
+  }
+#endif
+
+#ifdef ENABLE_CYCLES
+  // Los ciclos se segmentan sobre la muestra sin filtrar (el filtro corre
+  // los flancos y cambia la subida y la bajada)
+  if (suctionMbar != -1.0 && cycles.add(sampleUs, suctionMbar)) {
+    emitCycle(cycles.lastCycle());
+  }
+#endif
+
+  SampleResult result = pipeline.process(suctionMbar, activeConfig);
+#ifdef ENABLE_ROLLUPS
+  if (result.ok) {
+    rollups.add(sampleUs, result.value);
+  }
+#endif
+  
+  // Actualizar LED según el valor leído
+  updateLEDStatus(result.status);
+  if (result.ok) {
+    lastReadTime = millis();
+  }
+  
+  // Un solo write por muestra: <micros del dispositivo> <succión en mbar>
+  char line[PIPELINE_LINE_SIZE];
+  size_t length = formatSampleLine(sampleUs, result, activeConfig, line);
+  if (length > 0) {
+    Serial.write((const uint8_t*)line, length);
+  }
+}
+
+#ifdef ENABLE_REDUNDANCY
+// Combina las lecturas de los dos canales de un tick y procesa la elegida
+void processRedundantSample(uint32_t sampleUs, float i2cMbar, bool i2cOk, float analogMbar, bool analogPresent) {
+  bool wasDisagreeing = redundancy.channelsDisagree();
+  RedundancyOutput out = redundancy.update(i2cMbar, i2cOk, analogMbar, analogPresent);
+
+  // Eventos: "#F <micros> <canal activo> <motivo>" y "#F <micros> disagree <diferencia>"
+  if (out.switched) {
+    Serial.print("#F ");
+    Serial.print(sampleUs);
+    Serial.print(" ");
+    Serial.print(channelName(out.channel));
+    Serial.print(" ");
+    Serial.println(channelFaultName(out.reason));
+  }
+  if (redundancy.channelsDisagree() && !wasDisagreeing) {
+    Serial.print("#F ");
+    Serial.print(sampleUs);
+    Serial.print(" disagree ");
+    Serial.println(i2cMbar - analogMbar, 2);
+  }
+
+  processSample(sampleUs, out.valid ? out.value : -1.0);
+}
+#endif
+
+// Muestra del tick (modo local) o las publicadas por el M4
+TaskResult acquireTask(void*) {
+#ifdef ACQ_ON_M4
+  // Consumir las muestras publicadas por el M4
+  IpcSample sample;
+  while (ipcPopSample(ipcShared(), &sample)) {
+#ifdef ENABLE_XCORR
+    xcorrAddSample(sample);
+#endif
+#ifdef ENABLE_REDUNDANCY
+    // El M4 publica los dos canales de un tick seguidos y con la misma secuencia
+    bool analogEnabled = activeConfig.sensorMask & (1u << SENSOR_SM4291_ANALOG);
+    if (sample.sensorId == SENSOR_SM4291_I2C) {
+      if (analogEnabled) {
+        pendingI2cSample = sample;
+        havePendingI2c = true;
+      } else {
+        processRedundantSample(sample.timestampUs, sample.value, sample.status == SAMPLE_OK, 0.0f, false);
+      }
+    } else if (sample.sensorId == SENSOR_SM4291_ANALOG && havePendingI2c &&
+               sample.sequence == pendingI2cSample.sequence) {
+      havePendingI2c = false;
+      processRedundantSample(pendingI2cSample.timestampUs, pendingI2cSample.value,
+                             pendingI2cSample.status == SAMPLE_OK,
+                             pressureConvert(sample.raw, CAL_SM4291_ANALOG), true);
+    }
+#else
+    if (sample.sensorId == SENSOR_SM4291_I2C) {
+      float suctionMbar = (sample.status == SAMPLE_OK) ? sample.value : -1.0;
+      processSample(sample.timestampUs, suctionMbar);
+    }
+#endif
+  }
+#else
+  // Liberada por el tick del timer, con el instante de la interrupción
+  uint32_t sampleUs = scheduler.releaseUs(taskAcquire);
+#ifdef ENABLE_LOW_POWER
+  lowPowerSampleWake();
+#endif
+
+#ifdef ENABLE_CONTROL
+#ifdef CONTROL_SENSOR_ELVH
+  controlSampleElvh(sampleUs);
+#else
+  controlReadCycles = DWT->CYCCNT;
+#endif
+#endif
+
+#ifdef ENABLE_REDUNDANCY
+  float i2cMbar = SM_4000_readI2C_pressure();
+  bool analogEnabled = activeConfig.sensorMask & (1u << SENSOR_SM4291_ANALOG);
+  float analogMbar = analogEnabled ? SM_4000_readAnalogUnclamped() : 0.0f;
+  processRedundantSample(sampleUs, i2cMbar, i2cMbar != -1.0, analogMbar, analogEnabled);
+
+  // Bus trabado: liberarlo aquí, después de entregar la muestra del tick
+  if (redundancy.wantsBusRecovery()) {
+    devI2cRecover();
+    redundancy.busRecovered();
+  }
+#else
+  float suctionMbar = SM_4000_readI2C_pressure();
+  processSample(sampleUs, suctionMbar);
+#endif
+#endif
+  return TASK_DONE;
+}
+
+// Comandos y pings de sincronización del host
+TaskResult hostTask(void*) {
+#ifdef ACQ_ON_M4
+  m4ConfigPoll();
+#endif
+  hostLinkPoll();
+  if (configPending) {
+    applyRuntimeConfig();
+  }
+  return TASK_DONE;
+}
+
+#ifdef ENABLE_CONTROL
+// Sin muestras (timer detenido, sensor colgado en la lectura): failsafe
+TaskResult controlTask(void*) {
+  if (controller.stale(micros())) controlWrite(controller.currentOutput());
+  return TASK_DONE;
+}
+#endif
+
+TaskResult ledTask(void*) {
+  rgb.update(millis());
+  return TASK_DONE;
+}
+
+#ifdef ENABLE_FLASH_LOG
+// Escritura del log en segundo plano: una página o el inicio de un borrado por
+// porción; mientras la flash borra, poll() devuelve false y se espera al
+// próximo periodo
+TaskResult flashTask(void*) {
+  if (!flashLogReady || !flashLog.poll()) return TASK_DONE;
+  return flashLog.pending() ? TASK_MORE : TASK_DONE;
+}
+#endif
+
+// Por tarea: "#SCHED <tarea> <trabajos> <plazos perdidos> <excesos> <postergadas>
+// <peor porción us> <peor respuesta us>", con los contadores del intervalo
+void emitSchedulerReport() {
+  for (uint8_t id = 0; id < scheduler.taskCount(); id++) {
+    const TaskStats& stats = scheduler.stats(id);
+    Serial.print("#SCHED ");
+    Serial.print(scheduler.name(id));
+    Serial.print(" ");
+    Serial.print(stats.jobs);
+    Serial.print(" ");
+    Serial.print(stats.misses);
+    Serial.print(" ");
+    Serial.print(stats.overruns);
+    Serial.print(" ");
+    Serial.print(stats.deferred);
+    Serial.print(" ");
+    Serial.print(stats.maxSliceUs);
+    Serial.print(" ");
+    Serial.println(stats.maxResponseUs);
+    scheduler.resetStats(id);
+  }
+}
+
+// Renglones periódicos de telemetría: un reporte por porción, así varios que
+// venzan juntos no suman una porción larga
+TaskResult reportTask(void*) {
+#ifdef ENABLE_ANOMALY
+  if (millis() - lastAnomalyReport >= ANOMALY_REPORT_MS) {
+    lastAnomalyReport = millis();
+    emitAnomalyScores();
+    return TASK_MORE;
+  }
+#endif
+
+#ifdef ENABLE_XCORR
+  if (millis() - lastXcorrReport >= XCORR_REPORT_MS) {
+    lastXcorrReport = millis();
+    emitXcorrReport();
+    return TASK_MORE;
+  }
+#endif
+
+#ifdef ACQ_ON_M4
+  if (millis() - lastBusReport >= BUS_REPORT_MS) {
+    emitBusReport();
+    return TASK_MORE;
+  }
+#endif
+
+#ifdef ENABLE_CONTROL
+  if (millis() - lastControlReport >= CONTROL_REPORT_MS) {
+    lastControlReport = millis();
+    emitControlReport();
+    return TASK_MORE;
+  }
+#endif
+
+#ifdef ENABLE_LOW_POWER
+  if (millis() - lastPowerReport >= POWER_REPORT_MS) {
+    lastPowerReport = millis();
+    lowPowerReport(Serial);
+    return TASK_MORE;
+  }
+#endif
+
+  if (millis() - lastSchedReport >= SCHED_REPORT_MS) {
+    lastSchedReport = millis();
+    emitSchedulerReport();
+  }
+  return TASK_DONE;
+}
+
+// Registra las tareas; la prioridad sale del periodo (rate-monotonic)
+void schedulerBegin() {
+#ifdef ACQ_ON_M4
+  // Vaciar el ring una vez por periodo de muestreo
+  taskAcquire = scheduler.add({"acq", acquireTask, nullptr, activeConfig.periodUs, TASK_ACQUIRE_SLICE_US, 0, false, 0});
+#else
+  // La libera el tick del timer desde loop()
+  taskAcquire = scheduler.add({"acq", acquireTask, nullptr, activeConfig.periodUs, TASK_ACQUIRE_SLICE_US, 0, true, 0});
+  taskDiscovery = scheduler.add({"i2c", discoveryTask, nullptr, TASK_DISCOVERY_PERIOD_US, TASK_DISCOVERY_SLICE_US, 0, false, 0});
+#endif
+#ifdef ENABLE_CONTROL
+  taskControl = scheduler.add({"ctl", controlTask, nullptr, TASK_CONTROL_PERIOD_US, TASK_CONTROL_SLICE_US, 0, false, 0});
+#endif
+  taskHost = scheduler.add({"host", hostTask, nullptr, TASK_HOST_PERIOD_US, TASK_HOST_SLICE_US, 0, true, 0});
+  taskLed = scheduler.add({"led", ledTask, nullptr, TASK_LED_PERIOD_US, TASK_LED_SLICE_US, 0, false, 0});
+  taskReport = scheduler.add({"report", reportTask, nullptr, TASK_REPORT_PERIOD_US, TASK_REPORT_SLICE_US, 0, false, 0});
+  taskAttach = scheduler.add({"attach", attachTask, nullptr, TASK_ATTACH_PERIOD_US, TASK_ATTACH_SLICE_US, 0, false, 0});
+#ifdef ENABLE_XCORR
+  // Un bloque cada N/2 muestras, en (canales + 1) / 2 + 1 + canales / 2 etapas
+  taskXcorr = scheduler.add({"xcorr", xcorrTask, nullptr, XCORR_WINDOW / 2 * activeConfig.periodUs,
+                             TASK_XCORR_SLICE_US, 5 * TASK_XCORR_SLICE_US, true, 0});
+#endif
+#ifdef ENABLE_FLASH_LOG
+  taskFlash = scheduler.add({"flash", flashTask, nullptr, TASK_FLASH_PERIOD_US, TASK_FLASH_SLICE_US,
+                             2 * TASK_FLASH_SLICE_US, false, 0});   // Un bloque: dos páginas
+#endif
+}
+
+// Todo lo que puede esperar (host, animación del LED, escaneo del bus, montar
+// el log) va después de arrancar la adquisición; ver boot_timeline.h
 void setup() {
+  bootTimeline.mark(BOOT_SETUP, micros());
   Serial.begin(115200);
+#ifndef ENABLE_FAST_BOOT
   while (!Serial);
+#endif
   
   // Inicializar LED RGB
   rgb.begin();
   rgb.blue(); // Azul durante inicialización
+  bootTimeline.mark(BOOT_LED, micros());
   
+#ifdef ACQ_ON_M4
+  // El bloque compartido debe estar listo antes de que arranque el M4; el M4
+  // inicializa sus sensores mientras el M7 sigue con el resto del arranque
+  ipcInit(ipcShared());
+#else
+  // El M7 lee los buses: un bloque de un arranque anterior con ACQ_ON_M4 no
+  // puede hacer que el M4 arranque su adquisición
+  ipcRevoke(ipcShared());
+#endif
   bootM4();
+  bootTimeline.mark(BOOT_M4, micros());
   
-  // Inicializar solo sensor SM4291
+#ifndef ACQ_ON_M4
+  // Inicializar solo sensor SM4291; el bus se escanea de fondo desde loop()
   SM_4000_begin();
-  
-  Serial.println("=== SENSOR SM4291 SUCCIÓN con LED RGB - 2kHz ===");
-  Serial.println("USANDO digitalWrite() - Compatible con Portenta H7");
-  
-  // Configurar timer para 2kHz (500us)
-  if (ITimer.attachInterruptInterval(500, TimerHandler)) {
-    Serial.println("Timer configurado correctamente a 2kHz (500us)");
-    rgb.green(); // Verde si timer OK
-    delay(1000);
-  } else {
-    Serial.println("Error: No se pudo configurar el timer");
-    rgb.red(); // Rojo si error en timer
-    delay(2000);
-  }
+  discoveryCached = discoveryBoot(discoveryCache);
+  discoveryPersist();
+#endif
+  bootTimeline.mark(BOOT_SENSORS, micros());
+
+#ifdef ENABLE_ANOMALY
+  anomaly.setPeriodUs(activeConfig.periodUs);
+#endif
+
+#ifdef ENABLE_CONTROL
+  // El actuador queda en failsafe hasta la primera muestra
+  controlBegin();
+#endif
+
+#ifdef ENABLE_XCORR
+  xcorrConfigure(activeConfig.sensorMask);
+#endif
+
+#ifdef ENABLE_LOW_POWER
+  lowPowerBegin();
+#endif
+
+  schedulerBegin();
+  acquisitionStarted = startAcquisition();
+  bootTimeline.mark(BOOT_ACQ_START, micros());
+  RGBColor statusColor = acquisitionStarted ? rgb.COLOR_GREEN : rgb.COLOR_RED;
+  uint16_t statusMs = acquisitionStarted ? 1000 : 2000;
+#ifdef ENABLE_FAST_BOOT
+  rgb.play(RgbPattern::solid(statusColor, statusMs));
+#else
+  rgb.setColor(statusColor);
+  delay(statusMs);
+#endif
+
+#ifdef ENABLE_FLASH_LOG
+  // Recorre un encabezado por sector de la QSPI: en modo local se pierden los
+  // ticks que caigan mientras tanto, con el M4 quedan en el ring
+  flashLogReady = logStorage.begin() && flashLog.mount();
+  bootTimeline.mark(BOOT_STORAGE, micros());
+#endif
   
   // Mostrar secuencia de inicio
   showStartupSequence();
@@ -140,45 +1227,32 @@ void setup() {
 }
 
 void loop() {
+#ifndef ACQ_ON_M4
   // Verificar si el timer disparó la interrupción
   if (readSensor) {
     readSensor = false; // Limpiar flag
-    
-    float suctionMbar = SM_4000_readI2C_pressure();
-    readingCount++;
-    
-    // Actualizar LED según el valor leído
-    updateLEDStatus(suctionMbar);
-    
-    if (suctionMbar != -1.0) {
-      Serial.print(suctionMbar, 6);
-      
-      // Agregar información de estado cada 1000 lecturas
-      if (readingCount % 1000 == 0) {
-        Serial.print(" [Lecturas: ");
-        Serial.print(readingCount);
-        Serial.print(", Errores: ");
-        Serial.print(consecutiveErrors);
-        
-        // Mostrar nivel de succión
-        if (suctionMbar >= -50.0) {
-          Serial.print(", Nivel: BAJO");
-        } else if (suctionMbar >= -200.0) {
-          Serial.print(", Nivel: MEDIO");
-        } else if (suctionMbar >= -500.0) {
-          Serial.print(", Nivel: ALTO");
-        } else {
-          Serial.print(", Nivel: EXTREMO");
-        }
-        Serial.print("]");
-      }
-      Serial.println();
-      
-      lastSuction = suctionMbar;
-      lastReadTime = millis();
-    } else {
-      Serial.println("ERROR");
-    }
-    
+    // Ticks que pisaron la bandera sin que el loop los viera
+    uint32_t ticks = timerTicks;
+    scheduler.release(taskAcquire, sampleTimestampUs, ticks - seenTimerTicks - 1);
+    seenTimerTicks = ticks;
+  }
+#endif
+  if (Serial.available() > 0 && !scheduler.active(taskHost)) {
+    scheduler.release(taskHost, micros());
+  }
+
+  if (scheduler.runOnce()) return;
+
+#ifdef ENABLE_LOW_POWER
+  // Dormir hasta el próximo evento si no queda trabajo pendiente
+  if (!scheduler.pending() && Serial.available() == 0) {
+#ifdef ACQ_ON_M4
+    // Las muestras del M4 no generan interrupción en el M7: basta el SysTick
+    static const volatile bool noFlag = false;
+    lowPowerIdle(noFlag);
+#else
+    lowPowerIdle(readSensor);
+#endif
   }
-}
\ No newline at end of file
+#endif
+}
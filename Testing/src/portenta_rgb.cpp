@@ -1,6 +1,6 @@
 #include "portenta_rgb.h"
 
-// Solo colores básicos necesarios
+// Colores (naranja y azul claro solo se distinguen con PWM)
 const RGBColor PortentaRGB::COLOR_RED = {255, 0, 0};
 const RGBColor PortentaRGB::COLOR_GREEN = {0, 255, 0};
 const RGBColor PortentaRGB::COLOR_BLUE = {0, 0, 255};
@@ -9,10 +9,13 @@ const RGBColor PortentaRGB::COLOR_BLACK = {0, 0, 0};
 const RGBColor PortentaRGB::COLOR_YELLOW = {255, 255, 0};
 const RGBColor PortentaRGB::COLOR_CYAN = {0, 255, 255};
 const RGBColor PortentaRGB::COLOR_MAGENTA = {255, 0, 255};
+const RGBColor PortentaRGB::COLOR_ORANGE = {255, 80, 0};
+const RGBColor PortentaRGB::COLOR_LIGHT_BLUE = {60, 140, 255};
 
 // Constructor
 PortentaRGB::PortentaRGB(bool invertedLogic) {
     inverted = invertedLogic;
+    base = RGBColor{0, 0, 0};
 }
 
 // Inicialización
@@ -20,24 +23,32 @@ void PortentaRGB::begin() {
     pinMode(LED_RED, OUTPUT);
     pinMode(LED_GREEN, OUTPUT);
     pinMode(LED_BLUE, OUTPUT);
+    output.invalidate();
     off(); // Empezar con LEDs apagados
 }
 
-// Control básico
+void PortentaRGB::writeChannel(int pin, uint8_t value) {
+#ifdef RGB_USE_PWM
+    analogWrite(pin, inverted ? 255 - value : value);
+#else
+    bool on = (value > 127);
+    digitalWrite(pin, (on != inverted) ? HIGH : LOW);
+#endif
+}
+
+// Escribe solo los canales que cambiaron
+void PortentaRGB::write(RGBColor color) {
+    uint8_t changed = output.update(color);
+    if (changed & RGB_CHANNEL_RED) writeChannel(LED_RED, color.red);
+    if (changed & RGB_CHANNEL_GREEN) writeChannel(LED_GREEN, color.green);
+    if (changed & RGB_CHANNEL_BLUE) writeChannel(LED_BLUE, color.blue);
+}
+
+// Control básico: fija el color de estado (un patrón en curso tiene prioridad)
 void PortentaRGB::setColor(uint8_t red, uint8_t green, uint8_t blue) {
-    bool redOn = (red > 127);
-    bool greenOn = (green > 127);
-    bool blueOn = (blue > 127);
-    
-    if (inverted) {
-        // Lógica invertida para Portenta H7 (LOW = encendido)
-        digitalWrite(LED_RED, redOn ? LOW : HIGH);
-        digitalWrite(LED_GREEN, greenOn ? LOW : HIGH);
-        digitalWrite(LED_BLUE, blueOn ? LOW : HIGH);
-    } else {
-        digitalWrite(LED_RED, redOn ? HIGH : LOW);
-        digitalWrite(LED_GREEN, greenOn ? HIGH : LOW);
-        digitalWrite(LED_BLUE, blueOn ? HIGH : LOW);
+    base = createColor(red, green, blue);
+    if (!patterns.active()) {
+        write(base);
     }
 }
 
@@ -49,7 +60,7 @@ void PortentaRGB::off() {
     setColor(0, 0, 0);
 }
 
-// Solo colores básicos
+// Colores básicos
 void PortentaRGB::red() { setColor(COLOR_RED); }
 void PortentaRGB::green() { setColor(COLOR_GREEN); }
 void PortentaRGB::blue() { setColor(COLOR_BLUE); }
@@ -59,15 +70,26 @@ void PortentaRGB::cyan() { setColor(COLOR_CYAN); }
 void PortentaRGB::magenta() { setColor(COLOR_MAGENTA); }
 void PortentaRGB::black() { setColor(COLOR_BLACK); }
 
-// Solo efecto de parpadeo básico
-void PortentaRGB::blink(RGBColor color, uint16_t onTime, uint16_t offTime, uint8_t times) {
-    for (uint8_t i = 0; i < times; i++) {
-        setColor(color);
-        delay(onTime);
-        off();
-        if (i < times - 1) {
-            delay(offTime);
-        }
+// Patrones
+bool PortentaRGB::play(const RgbPattern& pattern) {
+    return patterns.push(pattern);
+}
+
+bool PortentaRGB::blink(RGBColor color, uint16_t onTime, uint16_t offTime, uint8_t times) {
+    return play(RgbPattern::blink(color, onTime, offTime, times));
+}
+
+void PortentaRGB::clearPatterns() {
+    patterns.clear();
+    write(base);
+}
+
+void PortentaRGB::update(uint32_t nowMs) {
+    RGBColor color;
+    if (patterns.render(nowMs, &color)) {
+        write(color);
+    } else {
+        write(base);
     }
 }
 
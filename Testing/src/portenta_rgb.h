@@ -2,23 +2,32 @@
 #define PORTENTA_RGB_H
 
 #include <Arduino.h>
+#include "rgb_pattern.h"
 
 // Definición de pines RGB del Portenta H7
 #define LED_RED    LEDR    // Pin del LED rojo
 #define LED_GREEN  LEDG    // Pin del LED verde  
 #define LED_BLUE   LEDB    // Pin del LED azul
 
-// Estructura para colores RGB
-struct RGBColor {
-    uint8_t red;
-    uint8_t green;
-    uint8_t blue;
-};
+// PWM por hardware (analogWrite) para colores y brillo intermedios.
+// Comentar para volver a encendido/apagado con digitalWrite (umbral 127).
+#define RGB_USE_PWM
 
-// Clase para manejar el LED RGB del Portenta H7 (Versión reducida)
+// Clase para manejar el LED RGB del Portenta H7
+//
+// setColor() fija el color de estado y solo escribe los pines que cambiaron,
+// así se puede llamar en cada muestra sin costo. Los patrones (parpadeo,
+// respiración, códigos de error) se encolan y los reproduce update(), que se
+// llama desde loop(): nada bloquea ni usa delay().
 class PortentaRGB {
 private:
     bool inverted;  // Los LEDs del Portenta son lógica invertida (LOW = encendido)
+    RGBColor base;           // Color de estado (se ve cuando no hay patrones)
+    RgbOutputState output;   // Último color escrito en los pines
+    RgbPatternQueue patterns;
+
+    void writeChannel(int pin, uint8_t value);
+    void write(RGBColor color);
     
 public:
     // Constructor
@@ -32,7 +41,7 @@ public:
     void setColor(RGBColor color);
     void off();
     
-    // Solo colores básicos
+    // Colores básicos
     void red();
     void green();
     void blue();
@@ -42,13 +51,19 @@ public:
     void magenta();
     void black();
     
-    // Solo efecto básico
-    void blink(RGBColor color, uint16_t onTime = 500, uint16_t offTime = 500, uint8_t times = 3);
+    // Patrones (no bloquean; devuelven false si la cola está llena)
+    bool play(const RgbPattern& pattern);
+    bool blink(RGBColor color, uint16_t onTime = 500, uint16_t offTime = 500, uint8_t times = 3);
+    void clearPatterns();
+    bool busy() const { return patterns.active(); }
+
+    // Avanza los patrones; llamar desde loop()
+    void update(uint32_t nowMs);
     
-    // Solo utilidad básica
+    // Utilidad básica
     RGBColor createColor(uint8_t red, uint8_t green, uint8_t blue);
     
-    // Solo colores básicos como constantes
+    // Colores como constantes
     static const RGBColor COLOR_RED;
     static const RGBColor COLOR_GREEN;
     static const RGBColor COLOR_BLUE;
@@ -57,6 +72,8 @@ public:
     static const RGBColor COLOR_YELLOW;
     static const RGBColor COLOR_CYAN;
     static const RGBColor COLOR_MAGENTA;
+    static const RGBColor COLOR_ORANGE;
+    static const RGBColor COLOR_LIGHT_BLUE;
 };
 
-#endif // PORTENTA_RGB_H
\ No newline at end of file
+#endif // PORTENTA_RGB_H
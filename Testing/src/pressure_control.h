@@ -0,0 +1,268 @@
+#pragma once
+#include <stdint.h>
+#include <math.h>
+
+/*
+  Control de la succión: PID con anti-windup y prealimentación
+
+  Se ejecuta una vez por muestra, a la tasa de adquisición, sobre la presión
+  del sensor de control. Trabaja en profundidad (-mbar, la succión es
+  negativa) y entrega la salida del actuador (bomba o válvula) en 0..1:
+      u = kff * consigna + kp * e + integral - kd * d(medida)/dt
+  - Prealimentación: kff es la inversa de la ganancia estática de la planta
+    (1 / mbar a salida plena), así el PID solo corrige el resto
+  - Derivada sobre la medida (un cambio de consigna no da un salto) con un
+    filtro de primer orden de constante CONTROL_DERIV_TAU_S
+  - Anti-windup por retrocálculo: cuando la salida satura, la integral se
+    lleva hacia el valor que la deja en el límite (ganancia ki / kp), así al
+    salir de la saturación no arrastra el error acumulado
+
+  Seguridad (la salida pasa a failsafeOutput, bomba apagada o válvula
+  venteada):
+  - Consigna 0: control apagado
+  - Falla del sensor: faultSamples lecturas erróneas seguidas. Mientras
+    tanto se mantiene la última salida; se retoma después de recoverSamples
+    lecturas válidas seguidas, con la integral en cero
+  - Sobrepresión: la medida pasa maxSuctionMbar. Se retoma cuando vuelve
+    limitHysteresisMbar por debajo del límite
+  - Medida vieja: stale() si no hubo update() en staleUs (el timer o la
+    tarea de adquisición se detuvieron); el firmware la revisa aparte
+
+  ControlLatency acumula la latencia lectura -> actuación de cada muestra
+  contra un presupuesto. El firmware fija esa latencia esperando hasta el
+  presupuesto antes de escribir la salida (ver controlStep() en main.cpp).
+
+  Este archivo no depende de Arduino y compila también en el host.
+*/
+
+#define CONTROL_OUT_MIN             0.0f
+#define CONTROL_OUT_MAX             1.0f
+#define CONTROL_FAILSAFE_OUTPUT     0.0f      // Bomba apagada / válvula venteada
+#define CONTROL_MAX_SUCTION_MBAR    -450.0f   // Más succión dispara el corte
+#define CONTROL_LIMIT_HYSTERESIS    20.0f     // mbar para rearmar después del corte
+#define CONTROL_FAULT_SAMPLES       3         // Lecturas erróneas seguidas para el failsafe
+#define CONTROL_RECOVER_SAMPLES     20        // Lecturas válidas seguidas para retomar (10 ms a 2 kHz)
+#define CONTROL_STALE_US            10000     // Sin muestras por más tiempo: failsafe
+#define CONTROL_DERIV_TAU_S         0.002f    // Filtro de la derivada
+#define CONTROL_MAX_DT_S            0.01f     // Huecos más largos no se integran de una vez
+
+enum ControlState : uint8_t {
+    CONTROL_OFF,        // Consigna 0
+    CONTROL_RUN,
+    CONTROL_FAULT,      // Sensor en falla
+    CONTROL_LIMIT,      // Corte por sobrepresión
+    CONTROL_STALE,      // Sin muestras recientes
+};
+
+inline const char* controlStateName(uint8_t state) {
+    switch (state) {
+        case CONTROL_OFF:   return "off";
+        case CONTROL_RUN:   return "run";
+        case CONTROL_FAULT: return "fault";
+        case CONTROL_LIMIT: return "limit";
+        case CONTROL_STALE: return "stale";
+        default:            return "?";
+    }
+}
+
+struct PidGains {
+    float kp;       // Salida por mbar de error
+    float ki;       // Salida por mbar·s
+    float kd;       // Salida por mbar/s
+    float kff;      // Salida por mbar de consigna
+};
+
+struct ControlLimits {
+    float outMin;
+    float outMax;
+    float failsafeOutput;
+    float maxSuctionMbar;
+    float limitHysteresisMbar;
+    uint16_t faultSamples;
+    uint16_t recoverSamples;
+    uint32_t staleUs;
+    bool antiWindup;            // Solo se apaga para comparar en la simulación
+};
+
+inline ControlLimits defaultControlLimits() {
+    ControlLimits limits;
+    limits.outMin = CONTROL_OUT_MIN;
+    limits.outMax = CONTROL_OUT_MAX;
+    limits.failsafeOutput = CONTROL_FAILSAFE_OUTPUT;
+    limits.maxSuctionMbar = CONTROL_MAX_SUCTION_MBAR;
+    limits.limitHysteresisMbar = CONTROL_LIMIT_HYSTERESIS;
+    limits.faultSamples = CONTROL_FAULT_SAMPLES;
+    limits.recoverSamples = CONTROL_RECOVER_SAMPLES;
+    limits.staleUs = CONTROL_STALE_US;
+    limits.antiWindup = true;
+    return limits;
+}
+
+class PidController {
+public:
+    PidController() : limits(defaultControlLimits()), setpointMbar(0.0f), filterAlpha(1.0f) {
+        gains.kp = gains.ki = gains.kd = gains.kff = 0.0f;
+        reset();
+    }
+
+    // Olvida la historia (integral, derivada, filtro y estado de falla)
+    void reset() {
+        state = CONTROL_OFF;
+        integral = 0.0f;
+        derivative = 0.0f;
+        output = limits.failsafeOutput;
+        haveMeasure = false;
+        filteredMbar = 0.0f;
+        lastDepth = 0.0f;
+        errorRun = 0;
+        validRun = 0;
+        lastUs = 0;
+    }
+
+    void setGains(const PidGains& g) { gains = g; }
+    void setLimits(const ControlLimits& l) { limits = l; }
+    // Filtro IIR de la medida, el mismo alfa que el de la salida (runtime_config.h)
+    void setFilterAlpha(float alpha) { filterAlpha = alpha; }
+
+    // Consigna en mbar (negativa); 0 apaga el control
+    void setSetpoint(float mbar) {
+        if (mbar == setpointMbar) return;
+        setpointMbar = mbar;
+        if (mbar == 0.0f) integral = 0.0f;
+    }
+
+    // Una muestra; valid = false si la lectura falló. Devuelve la salida a
+    // escribir en el actuador.
+    float update(uint32_t sampleUs, float mbar, bool valid) {
+        float dt = haveMeasure ? (float)(sampleUs - lastUs) * 1e-6f : 0.0f;
+        if (dt > CONTROL_MAX_DT_S) dt = CONTROL_MAX_DT_S;
+        lastUs = sampleUs;
+
+        if (!valid) {
+            validRun = 0;
+            if (errorRun < 0xFFFF) errorRun++;
+            // Pocas lecturas perdidas: se mantiene la salida
+            if (errorRun >= limits.faultSamples) enterFailsafe(CONTROL_FAULT);
+            return output;
+        }
+        errorRun = 0;
+        if (validRun < 0xFFFF) validRun++;
+
+        filteredMbar = haveMeasure ? filteredMbar + filterAlpha * (mbar - filteredMbar) : mbar;
+        float depth = -filteredMbar;
+        if (!haveMeasure) lastDepth = depth;
+        haveMeasure = true;
+
+        // El corte usa la muestra sin filtrar: el filtro lo atrasaría
+        if (mbar < limits.maxSuctionMbar) {
+            enterFailsafe(CONTROL_LIMIT);
+            lastDepth = depth;
+            return output;
+        }
+        if (state == CONTROL_LIMIT && mbar < limits.maxSuctionMbar + limits.limitHysteresisMbar) {
+            lastDepth = depth;
+            return output;
+        }
+        if ((state == CONTROL_FAULT || state == CONTROL_STALE) && validRun < limits.recoverSamples) {
+            lastDepth = depth;
+            return output;
+        }
+        if (setpointMbar == 0.0f) {
+            enterFailsafe(CONTROL_OFF);
+            lastDepth = depth;
+            return output;
+        }
+        if (state != CONTROL_RUN) {
+            // Arranque sin salto: la derivada parte de cero
+            integral = 0.0f;
+            derivative = 0.0f;
+            lastDepth = depth;
+            state = CONTROL_RUN;
+        }
+
+        float target = -setpointMbar;
+        float error = target - depth;
+        if (dt > 0.0f) {
+            float rate = (depth - lastDepth) / dt;
+            derivative += (rate - derivative) * dt / (CONTROL_DERIV_TAU_S + dt);
+        }
+        lastDepth = depth;
+
+        float unclamped = gains.kff * target + gains.kp * error + integral - gains.kd * derivative;
+        float clamped = unclamped;
+        if (clamped > limits.outMax) clamped = limits.outMax;
+        if (clamped < limits.outMin) clamped = limits.outMin;
+
+        integral += gains.ki * error * dt;
+        if (limits.antiWindup && gains.kp > 0.0f) {
+            integral += (gains.ki / gains.kp) * (clamped - unclamped) * dt;
+        }
+        output = clamped;
+        return output;
+    }
+
+    // Sin update() desde hace más de staleUs: failsafe hasta que vuelvan las
+    // muestras (y recoverSamples válidas). true si la salida cambió.
+    bool stale(uint32_t nowUs) {
+        if (!haveMeasure || (state != CONTROL_RUN && state != CONTROL_FAULT && state != CONTROL_LIMIT)) return false;
+        if (nowUs - lastUs <= limits.staleUs) return false;
+        enterFailsafe(CONTROL_STALE);
+        return true;
+    }
+
+    ControlState currentState() const { return state; }
+    float currentOutput() const { return output; }
+    float setpoint() const { return setpointMbar; }
+    float measurement() const { return filteredMbar; }
+    float integralTerm() const { return integral; }
+    const PidGains& currentGains() const { return gains; }
+
+private:
+    PidGains gains;
+    ControlLimits limits;
+    float setpointMbar;
+    float filterAlpha;
+
+    ControlState state;
+    float integral;
+    float derivative;           // d(profundidad)/dt filtrada
+    float output;
+    bool haveMeasure;
+    float filteredMbar;
+    float lastDepth;
+    uint16_t errorRun;
+    uint16_t validRun;
+    uint32_t lastUs;
+
+    void enterFailsafe(ControlState reason) {
+        state = reason;
+        integral = 0.0f;
+        validRun = 0;
+        output = limits.failsafeOutput;
+    }
+};
+
+// Latencia lectura -> actuación de cada muestra (us)
+struct ControlLatency {
+    uint32_t count;
+    uint32_t late;              // Más que el presupuesto
+    float minUs;
+    float maxUs;
+    float sumUs;
+
+    void reset() {
+        count = late = 0;
+        minUs = 1e9f;
+        maxUs = sumUs = 0.0f;
+    }
+
+    void add(float us, float budgetUs) {
+        count++;
+        sumUs += us;
+        if (us < minUs) minUs = us;
+        if (us > maxUs) maxUs = us;
+        if (us > budgetUs) late++;
+    }
+
+    float averageUs() const { return count ? sumUs / (float)count : 0.0f; }
+};
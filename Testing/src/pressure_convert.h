@@ -0,0 +1,127 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+
+/*
+  Conversión de cuentas crudas a presión para todos los sensores
+
+  Cada sensor se describe con una calibración lineal que se arma con las
+  cuentas en los extremos de la banda válida (10%–90% del datasheet) y la
+  presión correspondiente. Los drivers convierten de a una muestra y el
+  procesamiento por bloques (la etapa driver de tools/replay.cpp y el
+  "#BENCH convert" del arranque) usa el kernel por bloques, con los mismos
+  coeficientes y el mismo resultado bit a bit (tools/convert_bench.cpp).
+
+  El kernel por bloques es un bucle sin dependencias entre iteraciones ni
+  saltos (el recorte se reduce a min/max sobre la salida): GCC lo vectoriza
+  con -O3 en el host (SSE/AVX) y en el M7, que no tiene SIMD de punto
+  flotante, queda en VFMA + VMAXNM/VMINNM sin saltos.
+
+  Este archivo no depende de Arduino y compila también en el host.
+*/
+
+struct LinearCal {
+    float scale;       // Unidades físicas por cuenta
+    float offset;      // Unidades físicas en 0 cuentas
+    float outLow;      // Menor valor físico de la banda válida
+    float outHigh;     // Mayor valor físico de la banda válida
+};
+
+// Calibración a partir de las cuentas en los extremos de la banda 10%–90%
+// y la presión correspondiente (outMax puede ser menor que outMin)
+constexpr LinearCal makeLinearCal(float countsMin, float countsMax, float outMin, float outMax) {
+    return LinearCal{(outMax - outMin) / (countsMax - countsMin),
+                     outMin - countsMin * (outMax - outMin) / (countsMax - countsMin),
+                     outMin < outMax ? outMin : outMax,
+                     outMin < outMax ? outMax : outMin};
+}
+
+// ABPLLN (I2C, 14 bits): 10%–90% de 16383 cuentas -> 0..600 mbar
+// (cuentas truncadas a entero como en el cálculo original del driver)
+constexpr LinearCal CAL_ABPLLN = makeLinearCal(1638.0f, 14744.0f, 0.0f, 600.0f);
+
+// ELVH-015D (I2C, 14 bits): 1638..14745 cuentas -> -1.03..1.03 bar
+constexpr LinearCal CAL_ELVH_BAR = makeLinearCal(1638.0f, 14745.0f, -1.03f, 1.03f);
+
+// SSCDANN / CCDANN600MDSA3 (SPI, 12 bits): 409.6..3686.4 cuentas -> -600..600 mbar
+constexpr LinearCal CAL_SSCDANN = makeLinearCal(409.6f, 3686.4f, -600.0f, 600.0f);
+
+// SM4291 digital (I2C, int16): -26214..26214 cuentas -> 0..-500 mbar
+constexpr LinearCal CAL_SM4291_I2C = makeLinearCal(-26214.0f, 26214.0f, 0.0f, -500.0f);
+
+// SM4291 analógico (ADC 16 bits, 10%–90% de VDD) -> 0..-500 mbar
+constexpr LinearCal CAL_SM4291_ANALOG = makeLinearCal(0.10f * 65535.0f, 0.90f * 65535.0f, 0.0f, -500.0f);
+
+// La misma calibración sin recorte, para pasar por pressureConvertBatch los
+// sensores que dejan ver los valores fuera de banda
+constexpr LinearCal unclampedCal(const LinearCal& cal) {
+    return LinearCal{cal.scale, cal.offset, -INFINITY, INFINITY};
+}
+
+// Conversión de una muestra sin recortar (para valores fuera de banda visibles)
+inline float pressureConvert(float counts, const LinearCal& cal) {
+    return counts * cal.scale + cal.offset;
+}
+
+// Conversión de una muestra recortada a la banda válida. Recortar la salida
+// equivale a recortar las cuentas porque la conversión es lineal.
+inline float pressureConvertClamped(float counts, const LinearCal& cal) {
+    float value = counts * cal.scale + cal.offset;
+    value = cal.outLow > value ? cal.outLow : value;
+    value = cal.outHigh < value ? cal.outHigh : value;
+    return value;
+}
+
+// Conversión por bloques con recorte a la banda válida
+template <typename RawT>
+inline void pressureConvertBatch(const RawT* __restrict raw, float* __restrict out, size_t n,
+                                 const LinearCal& cal) {
+    const float scale = cal.scale;
+    const float offset = cal.offset;
+    const float lo = cal.outLow;
+    const float hi = cal.outHigh;
+    for (size_t i = 0; i < n; i++) {
+        // Este orden de operandos coincide con maxps/minps (vmaxnm/vminnm en
+        // ARM), así GCC lo vectoriza sin -ffast-math
+        float value = (float)raw[i] * scale + offset;
+        value = lo > value ? lo : value;
+        value = hi < value ? hi : value;
+        out[i] = value;
+    }
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+// Mide el kernel por bloques contra la conversión muestra a muestra y lo
+// reporta como "#BENCH ..." (el osciloscopio ignora las líneas con '#')
+#define PRESSURE_BENCH_SAMPLES 1024
+
+inline void pressureConvertBenchmark(Print& out) {
+    static uint16_t raw[PRESSURE_BENCH_SAMPLES];
+    static float converted[PRESSURE_BENCH_SAMPLES];
+    for (size_t i = 0; i < PRESSURE_BENCH_SAMPLES; i++) {
+        raw[i] = (uint16_t)((i * 37u) & 0x3FFF);
+    }
+
+    uint32_t start = micros();
+    for (size_t i = 0; i < PRESSURE_BENCH_SAMPLES; i++) {
+        converted[i] = pressureConvertClamped(raw[i], CAL_ABPLLN);
+    }
+    uint32_t scalarUs = micros() - start;
+
+    start = micros();
+    pressureConvertBatch(raw, converted, PRESSURE_BENCH_SAMPLES, CAL_ABPLLN);
+    uint32_t batchUs = micros() - start;
+
+    out.print("#BENCH convert n=");
+    out.print(PRESSURE_BENCH_SAMPLES);
+    out.print(" scalar_us=");
+    out.print(scalarUs);
+    out.print(" batch_us=");
+    out.print(batchUs);
+    out.print(" ns_per_sample=");
+    out.println(batchUs * 1000.0f / PRESSURE_BENCH_SAMPLES, 1);
+}
+#endif
@@ -0,0 +1,215 @@
+#pragma once
+#include <stdint.h>
+
+/*
+  Motor de patrones del LED RGB
+
+  Los patrones (color fijo por un tiempo, parpadeo, respiración, códigos de
+  error) se encolan y se reproducen uno detrás de otro. render() solo calcula
+  el color que corresponde al instante pedido: no escribe pines ni usa delay(),
+  así que se puede llamar desde loop() y probar con un reloj simulado.
+
+  Este archivo no depende de Arduino y compila también en el host.
+*/
+
+#define RGB_QUEUE_SIZE      8
+#define RGB_CODE_ON_MS      200    // Pulso de un código de error
+#define RGB_CODE_OFF_MS     300
+#define RGB_CODE_PAUSE_MS   1500   // Pausa entre repeticiones del código
+
+// Estructura para colores RGB
+struct RGBColor {
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+};
+
+inline bool sameColor(RGBColor a, RGBColor b) {
+    return a.red == b.red && a.green == b.green && a.blue == b.blue;
+}
+
+// Color escalado por un brillo 0..255
+inline RGBColor scaleColor(RGBColor color, uint8_t level) {
+    RGBColor out = {(uint8_t)((color.red * level + 127) / 255),
+                    (uint8_t)((color.green * level + 127) / 255),
+                    (uint8_t)((color.blue * level + 127) / 255)};
+    return out;
+}
+
+// Canales a escribir en los pines
+#define RGB_CHANNEL_RED     (1u << 0)
+#define RGB_CHANNEL_GREEN   (1u << 1)
+#define RGB_CHANNEL_BLUE    (1u << 2)
+#define RGB_CHANNEL_ALL     (RGB_CHANNEL_RED | RGB_CHANNEL_GREEN | RGB_CHANNEL_BLUE)
+
+// Último color escrito: dice qué canales cambian, así solo se escriben los
+// pines que hace falta (todos en la primera escritura)
+class RgbOutputState {
+private:
+    RGBColor shown;
+    bool valid;
+
+public:
+    RgbOutputState() { invalidate(); }
+
+    void invalidate() {
+        shown = RGBColor{0, 0, 0};
+        valid = false;
+    }
+
+    // Registra el color y devuelve la máscara RGB_CHANNEL_* de lo que cambió
+    uint8_t update(RGBColor color) {
+        uint8_t changed = RGB_CHANNEL_ALL;
+        if (valid) {
+            changed = (color.red != shown.red ? RGB_CHANNEL_RED : 0) |
+                      (color.green != shown.green ? RGB_CHANNEL_GREEN : 0) |
+                      (color.blue != shown.blue ? RGB_CHANNEL_BLUE : 0);
+        }
+        shown = color;
+        valid = true;
+        return changed;
+    }
+};
+
+enum RgbPatternType : uint8_t {
+    PATTERN_SOLID,      // Color fijo durante onMs
+    PATTERN_BLINK,      // onMs encendido, offMs apagado
+    PATTERN_BREATHE,    // Sube y baja el brillo en onMs
+    PATTERN_CODE,       // 'code' pulsos cortos y una pausa
+};
+
+struct RgbPattern {
+    RgbPatternType type;
+    RGBColor color;
+    uint16_t onMs;
+    uint16_t offMs;
+    uint8_t code;       // Pulsos por ciclo (PATTERN_CODE)
+    uint8_t cycles;     // Repeticiones; 0 = hasta que se encole otro patrón
+
+    // Duración de un ciclo
+    uint32_t cycleMs() const {
+        switch (type) {
+            case PATTERN_BLINK: return (uint32_t)onMs + offMs;
+            case PATTERN_CODE:  return (uint32_t)code * (RGB_CODE_ON_MS + RGB_CODE_OFF_MS) + RGB_CODE_PAUSE_MS;
+            default:            return onMs;
+        }
+    }
+
+    // Color en el instante 'elapsed' dentro de un ciclo
+    RGBColor colorAt(uint32_t elapsed) const {
+        const RGBColor black = {0, 0, 0};
+        switch (type) {
+            case PATTERN_BLINK:
+                return elapsed < onMs ? color : black;
+            case PATTERN_BREATHE: {
+                // Triángulo al cuadrado: el brillo percibido sube de forma más pareja
+                uint32_t half = onMs / 2 ? onMs / 2 : 1;
+                uint32_t ramp = elapsed < half ? elapsed : (onMs - elapsed);
+                uint32_t level = ramp * 255 / half;
+                if (level > 255) level = 255;
+                return scaleColor(color, (uint8_t)(level * level / 255));
+            }
+            case PATTERN_CODE: {
+                uint32_t pulse = elapsed / (RGB_CODE_ON_MS + RGB_CODE_OFF_MS);
+                uint32_t within = elapsed % (RGB_CODE_ON_MS + RGB_CODE_OFF_MS);
+                return (pulse < code && within < RGB_CODE_ON_MS) ? color : black;
+            }
+            default:
+                return color;
+        }
+    }
+
+    static RgbPattern solid(RGBColor color, uint16_t durationMs) {
+        return RgbPattern{PATTERN_SOLID, color, durationMs, 0, 0, 1};
+    }
+    static RgbPattern blink(RGBColor color, uint16_t onMs, uint16_t offMs, uint8_t times) {
+        return RgbPattern{PATTERN_BLINK, color, onMs, offMs, 0, times};
+    }
+    static RgbPattern breathe(RGBColor color, uint16_t periodMs, uint8_t cycles) {
+        return RgbPattern{PATTERN_BREATHE, color, periodMs, 0, 0, cycles};
+    }
+    static RgbPattern errorCode(RGBColor color, uint8_t code, uint8_t cycles = 0) {
+        return RgbPattern{PATTERN_CODE, color, 0, 0, code, cycles};
+    }
+};
+
+class RgbPatternQueue {
+private:
+    RgbPattern queue[RGB_QUEUE_SIZE];
+    uint8_t head;        // Patrón en reproducción
+    uint8_t count;
+    bool started;
+    uint32_t startMs;    // Comienzo del ciclo actual
+    uint8_t cycleIndex;
+
+    void advance() {
+        head = (head + 1) % RGB_QUEUE_SIZE;
+        count--;
+        started = false;
+    }
+
+public:
+    RgbPatternQueue() { clear(); }
+
+    void clear() {
+        head = 0;
+        count = 0;
+        started = false;
+        startMs = 0;
+        cycleIndex = 0;
+    }
+
+    // Encola un patrón; false si la cola está llena
+    bool push(const RgbPattern& pattern) {
+        if (count >= RGB_QUEUE_SIZE) return false;
+        queue[(head + count) % RGB_QUEUE_SIZE] = pattern;
+        count++;
+        return true;
+    }
+
+    bool active() const { return count > 0; }
+
+    // Color del patrón en curso en nowMs. Devuelve false si la cola está vacía
+    // (entonces se muestra el color de estado).
+    bool render(uint32_t nowMs, RGBColor* out) {
+        while (count > 0) {
+            const RgbPattern& pattern = queue[head];
+            if (!started) {
+                started = true;
+                startMs = nowMs;
+                cycleIndex = 0;
+            }
+            uint32_t cycle = pattern.cycleMs();
+            if (cycle == 0) {
+                advance();
+                continue;
+            }
+
+            uint32_t elapsed = nowMs - startMs;
+            if (elapsed < cycle) {
+                *out = pattern.colorAt(elapsed);
+                return true;
+            }
+
+            bool infinite = pattern.cycles == 0;
+            if (infinite && count == 1) {
+                // Nadie espera: saltar los ciclos completos de una vez
+                startMs += (elapsed / cycle) * cycle;
+                continue;
+            }
+
+            // Terminó un ciclo; el siguiente empieza donde terminó este (sin deriva)
+            startMs += cycle;
+            cycleIndex++;
+            if (infinite || cycleIndex >= pattern.cycles) {
+                uint32_t nextStart = startMs;
+                advance();
+                started = true;
+                startMs = nextStart;
+                cycleIndex = 0;
+            }
+        }
+        started = false;
+        return false;
+    }
+};
@@ -0,0 +1,175 @@
+#pragma once
+#include <stdint.h>
+#include <math.h>
+#include <string.h>
+
+/*
+  Agregados multi-resolución (1 s / 1 min / 1 h)
+
+  Cada nivel mantiene count, min, max, media y varianza (Welford) más un
+  histograma de tamaño fijo para aproximar p50/p95/p99. Al cerrarse un nivel
+  se emite y se fusiona en el siguiente: los agregados y los histogramas se
+  combinan exactamente, así que el resumen de 1 min es el mismo que daría
+  procesar sus 120000 muestras de una vez.
+
+  Error de los percentiles: como máximo un bin ((ROLLUP_MAX_MBAR -
+  ROLLUP_MIN_MBAR) / ROLLUP_BINS, 3 mbar) dentro del rango, porque la
+  interpolación supone las muestras repartidas parejo dentro del bin; fuera
+  del rango se devuelve el min/max observado. Ver tools/rollup_check.cpp.
+
+  Este archivo no depende de Arduino y compila también en el host.
+*/
+
+#define ROLLUP_BINS        200
+#define ROLLUP_MIN_MBAR    -550.0f
+#define ROLLUP_MAX_MBAR    50.0f
+#define ROLLUP_LEVELS      3
+#define ROLLUP_BASE_US     1000000u   // Nivel 0: 1 s
+#define ROLLUP_FANOUT      60         // Cada nivel agrupa 60 del anterior
+
+// Histograma fijo: fusión exacta, percentiles con error acotado
+struct QuantileSketch {
+    uint32_t bins[ROLLUP_BINS];
+    uint32_t below;
+    uint32_t above;
+
+    void reset() {
+        memset(bins, 0, sizeof(bins));
+        below = 0;
+        above = 0;
+    }
+
+    void add(float value) {
+        float pos = (value - ROLLUP_MIN_MBAR) * (ROLLUP_BINS / (ROLLUP_MAX_MBAR - ROLLUP_MIN_MBAR));
+        if (pos < 0.0f) {
+            below++;
+        } else if (pos >= ROLLUP_BINS) {
+            above++;
+        } else {
+            bins[(int)pos]++;
+        }
+    }
+
+    void merge(const QuantileSketch& other) {
+        for (int i = 0; i < ROLLUP_BINS; i++) bins[i] += other.bins[i];
+        below += other.below;
+        above += other.above;
+    }
+
+    // q en [0, 1]; minValue/maxValue acotan las colas fuera del rango
+    float quantile(float q, uint32_t count, float minValue, float maxValue) const {
+        if (count == 0) return NAN;
+        float target = q * (float)count;
+        float cumulative = (float)below;
+        if (target <= cumulative) return minValue;
+
+        const float width = (ROLLUP_MAX_MBAR - ROLLUP_MIN_MBAR) / ROLLUP_BINS;
+        for (int i = 0; i < ROLLUP_BINS; i++) {
+            if (bins[i] == 0) continue;
+            if (cumulative + bins[i] >= target) {
+                // Interpolación lineal dentro del bin
+                float fraction = (target - cumulative) / (float)bins[i];
+                float value = ROLLUP_MIN_MBAR + (i + fraction) * width;
+                if (value < minValue) value = minValue;
+                if (value > maxValue) value = maxValue;
+                return value;
+            }
+            cumulative += bins[i];
+        }
+        return maxValue;
+    }
+};
+
+struct Rollup {
+    uint32_t count;
+    float minValue;
+    float maxValue;
+    double mean;
+    double m2;            // Suma de cuadrados de desvíos (Welford)
+    uint32_t startUs;     // micros() de la primera muestra
+    QuantileSketch sketch;
+
+    void reset() {
+        count = 0;
+        minValue = INFINITY;
+        maxValue = -INFINITY;
+        mean = 0.0;
+        m2 = 0.0;
+        startUs = 0;
+        sketch.reset();
+    }
+
+    void add(uint32_t timestampUs, float value) {
+        if (count == 0) startUs = timestampUs;
+        count++;
+        double delta = value - mean;
+        mean += delta / count;
+        m2 += delta * (value - mean);
+        if (value < minValue) minValue = value;
+        if (value > maxValue) maxValue = value;
+        sketch.add(value);
+    }
+
+    // Fusión de Chan et al. para media y varianza
+    void merge(const Rollup& other) {
+        if (other.count == 0) return;
+        if (count == 0) {
+            *this = other;
+            return;
+        }
+        uint32_t total = count + other.count;
+        double delta = other.mean - mean;
+        mean += delta * other.count / total;
+        m2 += other.m2 + delta * delta * ((double)count * other.count / total);
+        count = total;
+        if (other.minValue < minValue) minValue = other.minValue;
+        if (other.maxValue > maxValue) maxValue = other.maxValue;
+        sketch.merge(other.sketch);
+    }
+
+    float variance() const { return count > 1 ? (float)(m2 / (count - 1)) : 0.0f; }
+
+    float quantile(float q) const { return sketch.quantile(q, count, minValue, maxValue); }
+};
+
+// Se llama al cerrar cada ventana de cada nivel
+typedef void (*RollupEmitFn)(uint8_t level, const Rollup& rollup);
+
+class RollupCascade {
+private:
+    Rollup levels[ROLLUP_LEVELS];
+    uint8_t closedChildren[ROLLUP_LEVELS];
+    RollupEmitFn emit;
+
+    void close(uint8_t level) {
+        if (levels[level].count > 0) emit(level, levels[level]);
+
+        if (level + 1 < ROLLUP_LEVELS) {
+            levels[level + 1].merge(levels[level]);
+            if (++closedChildren[level + 1] >= ROLLUP_FANOUT) {
+                close(level + 1);
+            }
+        }
+        levels[level].reset();
+        closedChildren[level] = 0;
+    }
+
+public:
+    explicit RollupCascade(RollupEmitFn emitFn) : emit(emitFn) {
+        for (uint8_t i = 0; i < ROLLUP_LEVELS; i++) {
+            levels[i].reset();
+            closedChildren[i] = 0;
+        }
+    }
+
+    void add(uint32_t timestampUs, float value) {
+        // El nivel 0 se cierra por tiempo; los demás cuentan cierres del anterior
+        // (así el desborde de micros() cada ~71 min no afecta a la ventana de 1 h)
+        if (levels[0].count > 0 && timestampUs - levels[0].startUs >= ROLLUP_BASE_US) {
+            close(0);
+        }
+        levels[0].add(timestampUs, value);
+    }
+
+    const Rollup& level(uint8_t index) const { return levels[index]; }
+};
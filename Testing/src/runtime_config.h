@@ -0,0 +1,83 @@
+#pragma once
+#include <stdint.h>
+
+/*
+  Configuración modificable en tiempo de ejecución (sin recompilar ni reflashear)
+
+  Los comandos del host solo modifican pendingConfig. El loop copia la
+  configuración pendiente en activeConfig al comienzo de un tick, de modo que
+  un cambio nunca se aplica a mitad del procesamiento de una muestra.
+*/
+
+// Valores por defecto (los que antes eran #define / const)
+#define DEFAULT_PERIOD_US          500      // 2 kHz
+#ifdef ENABLE_REDUNDANCY
+#define DEFAULT_SENSOR_MASK        0x03     // SM4291 por I2C y analógico (redundancia)
+#else
+#define DEFAULT_SENSOR_MASK        0x01     // Solo SM4291 por I2C
+#endif
+#define DEFAULT_WINDOW_LENGTH      50
+#define DEFAULT_SUCTION_LOW_MAX    -50.0f   // mbar
+#define DEFAULT_SUCTION_MEDIUM_MAX -200.0f  // mbar
+#define DEFAULT_FILTER_ALPHA       1.0f     // Sin filtrado
+#define DEFAULT_KURTOSIS_LOW       4.0f
+#define DEFAULT_KURTOSIS_HIGH      12.0f
+// Control de succión (pressure_control.h). Ganancias para la planta de
+// tools/control_sim.cpp (480 mbar a salida plena, tau 60 ms); la salida va de 0 a 1
+#define DEFAULT_CONTROL_SETPOINT   0.0f     // mbar; 0 = control apagado
+#define DEFAULT_CONTROL_KP         0.03f    // Por mbar de error
+#define DEFAULT_CONTROL_KI         0.3f     // Por mbar·s
+#define DEFAULT_CONTROL_KD         0.0f     // Por mbar/s
+#define DEFAULT_CONTROL_KFF        0.00208f // Por mbar de consigna (1 / 480 mbar)
+
+#define MAX_PERIOD_US              1000000  // El mínimo depende del build (cmdMinPeriodUs en cmd_handler.h)
+
+struct RuntimeConfig {
+    uint32_t periodUs;
+    uint32_t sensorMask;
+    uint16_t windowLength;
+    bool streaming;
+    float suctionLowMax;      // Límite succión baja / media
+    float suctionMediumMax;   // Límite succión media / alta
+    float filterAlpha;        // y += alfa * (x - y)
+    float kurtosisLow;
+    float kurtosisHigh;
+    float controlSetpoint;    // mbar, 0 = control apagado
+    float controlKp;
+    float controlKi;
+    float controlKd;
+    float controlKff;
+};
+
+struct RuntimeStats {
+    uint32_t readings;
+    uint32_t errors;
+    uint32_t consecutiveErrors;
+    uint32_t configChanges;
+    uint32_t dropped;          // Muestras perdidas (ring del M4)
+    uint32_t uptimeMs;
+    float lastValue;
+};
+
+extern RuntimeConfig activeConfig;
+extern RuntimeConfig pendingConfig;
+extern bool configPending;
+
+inline RuntimeConfig defaultRuntimeConfig() {
+    RuntimeConfig config;
+    config.periodUs = DEFAULT_PERIOD_US;
+    config.sensorMask = DEFAULT_SENSOR_MASK;
+    config.windowLength = DEFAULT_WINDOW_LENGTH;
+    config.streaming = true;
+    config.suctionLowMax = DEFAULT_SUCTION_LOW_MAX;
+    config.suctionMediumMax = DEFAULT_SUCTION_MEDIUM_MAX;
+    config.filterAlpha = DEFAULT_FILTER_ALPHA;
+    config.kurtosisLow = DEFAULT_KURTOSIS_LOW;
+    config.kurtosisHigh = DEFAULT_KURTOSIS_HIGH;
+    config.controlSetpoint = DEFAULT_CONTROL_SETPOINT;
+    config.controlKp = DEFAULT_CONTROL_KP;
+    config.controlKi = DEFAULT_CONTROL_KI;
+    config.controlKd = DEFAULT_CONTROL_KD;
+    config.controlKff = DEFAULT_CONTROL_KFF;
+    return config;
+}
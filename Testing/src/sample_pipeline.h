@@ -0,0 +1,220 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include "runtime_config.h"
+
+/*
+  Procesamiento determinístico de una muestra de succión
+
+  Es la parte de processSample() (main.cpp) que no toca hardware: filtro IIR,
+  contadores de errores, estado del LED según la succión y el renglón de
+  salida. No lee sensores, no escribe pines ni consulta el reloj, así el
+  replay nativo (tools/replay.cpp) corre exactamente el mismo código que el
+  firmware y puede comparar la salida byte a byte con una traza de referencia.
+
+  El renglón se arma en un buffer con el mismo algoritmo que
+  Print::print(float, digits) del core de Arduino y se envía con un solo
+  write, en lugar de varios print() por muestra.
+
+  Este archivo no depende de Arduino y compila también en el host.
+*/
+
+#define SUCTION_ERROR_VALUE        -1.0f   // Valor que marca una lectura fallida
+#define PIPELINE_LINE_SIZE         96      // Renglón más largo con el resumen de estado
+#define PIPELINE_STATUS_EVERY      1000    // Lecturas entre resúmenes de estado
+#define PIPELINE_PERSISTENT_ERRORS 5       // Errores seguidos para pasar a rojo
+
+// Rangos de succión para indicadores (valores negativos)
+// Los límites bajo/medio son configurables: suctionLowMax (-50 mbar) y
+// suctionMediumMax (-200 mbar)
+#define SUCTION_MIN_NORMAL   0.0f      // mbar (sin succión)
+#define SUCTION_MAX_NORMAL   -500.0f   // mbar (succión máxima)
+#define SUCTION_LOW_MIN      0.0f      // mbar (succión baja/sin succión)
+#define SUCTION_HIGH_MAX     -500.0f   // mbar (succión máxima)
+
+// Estado que muestra el LED RGB
+enum SuctionStatus : uint8_t {
+    STATUS_ERROR_PERSISTENT,   // Rojo
+    STATUS_ERROR,              // Naranja: errores ocasionales
+    STATUS_OUT_OF_RANGE,       // Amarillo
+    STATUS_LOW,                // Azul claro
+    STATUS_MEDIUM,             // Verde
+    STATUS_HIGH,               // Cyan
+    STATUS_UNDEFINED,          // Magenta
+};
+
+inline const char* suctionStatusName(uint8_t status) {
+    switch (status) {
+        case STATUS_ERROR_PERSISTENT: return "error";
+        case STATUS_ERROR:            return "error_occasional";
+        case STATUS_OUT_OF_RANGE:     return "out_of_range";
+        case STATUS_LOW:              return "low";
+        case STATUS_MEDIUM:           return "medium";
+        case STATUS_HIGH:             return "high";
+        default:                      return "undefined";
+    }
+}
+
+// Estado del LED para una muestra (suction == SUCTION_ERROR_VALUE si falló)
+inline SuctionStatus suctionStatus(float suction, int consecutiveErrors, const RuntimeConfig& config) {
+    if (suction == SUCTION_ERROR_VALUE) {
+        return consecutiveErrors > PIPELINE_PERSISTENT_ERRORS ? STATUS_ERROR_PERSISTENT : STATUS_ERROR;
+    }
+    if (suction > SUCTION_MIN_NORMAL || suction < SUCTION_MAX_NORMAL) {
+        return STATUS_OUT_OF_RANGE;
+    } else if (suction >= SUCTION_LOW_MIN && suction > config.suctionLowMax) {
+        return STATUS_LOW;
+    } else if (suction <= config.suctionLowMax && suction > config.suctionMediumMax) {
+        return STATUS_MEDIUM;
+    } else if (suction <= config.suctionMediumMax && suction >= SUCTION_HIGH_MAX) {
+        return STATUS_HIGH;
+    }
+    return STATUS_UNDEFINED;
+}
+
+// Entero sin signo en decimal; devuelve los caracteres escritos
+inline size_t formatUnsigned(char* out, unsigned long value) {
+    char digits[12];
+    size_t n = 0;
+    do {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+    for (size_t i = 0; i < n; i++) out[i] = digits[n - 1 - i];
+    return n;
+}
+
+inline size_t formatText(char* out, const char* text) {
+    size_t n = 0;
+    while (text[n]) {
+        out[n] = text[n];
+        n++;
+    }
+    return n;
+}
+
+// Número con 'digits' decimales, igual que Print::printFloat del core de
+// Arduino (redondeo sumando 0.5e-digits y decimales por multiplicaciones
+// sucesivas), así el texto coincide con el que daba Serial.print(valor, digits)
+inline size_t formatFloat(char* out, double number, uint8_t digits) {
+    if (isnan(number)) return formatText(out, "nan");
+    if (isinf(number)) return formatText(out, "inf");
+    if (number > 4294967040.0 || number < -4294967040.0) return formatText(out, "ovf");
+
+    size_t n = 0;
+    if (number < 0.0) {
+        out[n++] = '-';
+        number = -number;
+    }
+    double rounding = 0.5;
+    for (uint8_t i = 0; i < digits; ++i) rounding /= 10.0;
+    number += rounding;
+
+    unsigned long intPart = (unsigned long)number;
+    double remainder = number - (double)intPart;
+    n += formatUnsigned(&out[n], intPart);
+    if (digits > 0) out[n++] = '.';
+    while (digits-- > 0) {
+        remainder *= 10.0;
+        unsigned int toPrint = (unsigned int)remainder;
+        n += formatUnsigned(&out[n], toPrint);
+        remainder -= toPrint;
+    }
+    return n;
+}
+
+// Resultado del procesamiento de una muestra
+struct SampleResult {
+    float value;            // Valor filtrado (SUCTION_ERROR_VALUE si la lectura falló)
+    bool ok;
+    SuctionStatus status;
+    uint32_t reading;       // Número de lectura (1 = primera)
+    int consecutiveErrors;
+};
+
+class SamplePipeline {
+public:
+    float filtered;
+    bool filterPrimed;
+    int consecutiveErrors;
+    uint32_t readings;
+    uint32_t errors;
+    float lastValue;        // Último valor válido
+
+    SamplePipeline() { reset(); }
+
+    void reset() {
+        filtered = 0.0f;
+        filterPrimed = false;
+        consecutiveErrors = 0;
+        readings = 0;
+        errors = 0;
+        lastValue = 0.0f;
+    }
+
+    // Filtro, contadores y estado del LED para una muestra en mbar
+    SampleResult process(float suctionMbar, const RuntimeConfig& config) {
+        readings++;
+        SampleResult result;
+        result.ok = suctionMbar != SUCTION_ERROR_VALUE;
+        if (result.ok) {
+            // Filtro IIR de primer orden (alfa = 1 deja pasar la muestra sin cambios)
+            if (!filterPrimed) {
+                filtered = suctionMbar;
+                filterPrimed = true;
+            } else {
+                filtered += config.filterAlpha * (suctionMbar - filtered);
+            }
+            result.value = filtered;
+            consecutiveErrors = 0;
+            lastValue = filtered;
+        } else {
+            result.value = SUCTION_ERROR_VALUE;
+            errors++;
+            consecutiveErrors++;
+        }
+        result.status = suctionStatus(result.value, consecutiveErrors, config);
+        result.reading = readings;
+        result.consecutiveErrors = consecutiveErrors;
+        return result;
+    }
+};
+
+// Renglón de salida con '\n' (sin terminador nulo); 0 si el flujo está
+// detenido. Formato: <micros del dispositivo> <succión en mbar>, con un
+// resumen de estado cada PIPELINE_STATUS_EVERY lecturas, o "ERROR".
+inline size_t formatSampleLine(uint32_t sampleUs, const SampleResult& result, const RuntimeConfig& config,
+                               char* line) {
+    if (!config.streaming) return 0;
+    size_t n = 0;
+    if (!result.ok) {
+        n += formatText(&line[n], "ERROR\r\n");
+        return n;
+    }
+    n += formatUnsigned(&line[n], sampleUs);
+    line[n++] = ' ';
+    n += formatFloat(&line[n], result.value, 6);
+
+    if (result.reading % PIPELINE_STATUS_EVERY == 0) {
+        n += formatText(&line[n], " [Lecturas: ");
+        n += formatUnsigned(&line[n], result.reading);
+        n += formatText(&line[n], ", Errores: ");
+        n += formatUnsigned(&line[n], (unsigned long)result.consecutiveErrors);
+
+        // Nivel de succión
+        if (result.value >= -50.0f) {
+            n += formatText(&line[n], ", Nivel: BAJO");
+        } else if (result.value >= -200.0f) {
+            n += formatText(&line[n], ", Nivel: MEDIO");
+        } else if (result.value >= -500.0f) {
+            n += formatText(&line[n], ", Nivel: ALTO");
+        } else {
+            n += formatText(&line[n], ", Nivel: EXTREMO");
+        }
+        line[n++] = ']';
+    }
+    line[n++] = '\r';
+    line[n++] = '\n';
+    return n;
+}
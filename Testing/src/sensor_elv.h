@@ -1,10 +1,9 @@
 #pragma once
-#include <Wire.h>
+#include "dev_i2c.h"
+#include "pressure_convert.h"
 
-// Dirección I2C y pines del sensor
+// Dirección I2C del sensor
 #define SENSOR_I2C_ADDR 0x28
-#define I2C3_SCL    D12
-#define I2C3_SDA    D11
 
 // Rango de salida del sensor (ajusta según tu modelo)
 const int OUTPUT_MIN = 1638;  // 10% del rango de 14 bits (2^14 * 0.10)
@@ -18,14 +17,9 @@ const float P_MAX = 1.03;     // Presión máxima en bares
 const float T_MIN = -50.0;   // Temperatura mínima en grados C
 const float T_MAX = 150.0;   // Temperatura máxima en grados C
 
-// Buffer para almacenar los 4 bytes leídos del sensor
-static byte sensorData[4];
-#ifndef DEV_I2C_DEFINED
-#define DEV_I2C_DEFINED
-static TwoWire dev_i2c(I2C3_SDA, I2C3_SCL);
-#endif
 inline void sensorELV_begin() {
     dev_i2c.begin();
+    dev_i2c.setClock(DEV_I2C_CLOCK_HZ);
 }
 
 inline void sensorELV_scan() {
@@ -43,10 +37,24 @@ inline void sensorELV_scan() {
 
 // Convierte un valor raw de presión a presión en bares
 inline float pressure_raw_to_pressure_mbar(int pressure_raw) {
-    return ((float)pressure_raw - OUTPUT_MIN) * (P_MAX - P_MIN) / (OUTPUT_MAX - OUTPUT_MIN) + P_MIN;
+    return pressureConvert(pressure_raw, CAL_ELVH_BAR);
+}
+
+// Cuentas crudas de presión (14 bits) para la adquisición periódica. Lee solo
+// los dos bytes de presión (el sensor permite cortar la lectura ahí); false si
+// no respondió o informa diagnóstico.
+inline bool sensorELV_readRaw(int* raw) {
+    dev_i2c.requestFrom(SENSOR_I2C_ADDR, 2);
+    if (dev_i2c.available() != 2) return false;
+    byte hi = dev_i2c.read();
+    byte lo = dev_i2c.read();
+    if (((hi >> 6) & 0b11) == 0b11) return false;
+    *raw = ((hi & 0x3F) << 8) | lo;
+    return true;
 }
 
 inline int sensorELV_read(bool print = false, bool crudo = false) {
+    byte sensorData[4];  // Los 4 bytes leídos del sensor
     dev_i2c.requestFrom(SENSOR_I2C_ADDR, 4);
     if (dev_i2c.available() == 4) {
         for (int i = 0; i < 4; i++) {
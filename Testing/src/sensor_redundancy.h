@@ -0,0 +1,269 @@
+#pragma once
+#include <stdint.h>
+#include <math.h>
+
+/*
+  Redundancia entre los dos canales del SM4291 (I2C digital y salida analógica)
+
+  Los dos canales miden el mismo puerto de succión. En cada tick se evalúa la
+  salud de cada canal y se entrega el valor del canal activo; si el activo
+  falla y el otro está sano, se cambia en ese mismo tick, así el flujo de datos
+  sigue sin huecos. Se vuelve al canal preferido (I2C, más resolución) cuando
+  estuvo sano REDUNDANCY_RECOVER_SAMPLES muestras seguidas.
+
+  Fallas que se detectan por canal:
+  - Bus: la lectura I2C falló (tras REDUNDANCY_BUS_RECOVERY_ERRORS seguidas se
+    pide la recuperación del bus, ver devI2cRecover())
+  - Fuera de rango: fuera del rango físico del sensor más un margen
+  - Trabado: el mismo valor exacto durante REDUNDANCY_STUCK_SAMPLES muestras.
+    Es un límite de la detección: un valor repetido no se distingue de una
+    señal quieta hasta cumplir ese plazo, así que durante las primeras
+    REDUNDANCY_STUCK_SAMPLES muestras (100 ms a 2 kHz) el valor trabado se
+    sigue entregando como válido (lo comprueba tools/failover_sim.cpp)
+  - Ruidoso: la varianza de las diferencias entre muestras supera la máxima
+
+  Además se comparan los dos canales: si ambos están sanos pero difieren más de
+  REDUNDANCY_DISAGREE_MBAR durante un tiempo, se reporta el desacuerdo (con dos
+  canales no se puede decidir cuál está mal, así que se mantiene el activo).
+
+  Este archivo no depende de Arduino y compila también en el host.
+*/
+
+#define REDUNDANCY_CHANNELS              2
+#define REDUNDANCY_RANGE_MIN_MBAR        -525.0f   // 0..-500 mbar con margen
+#define REDUNDANCY_RANGE_MAX_MBAR        25.0f
+#define REDUNDANCY_STUCK_SAMPLES         200       // 100 ms a 2 kHz
+#define REDUNDANCY_NOISE_ALPHA           0.01f
+#define REDUNDANCY_NOISE_MAX_MBAR        10.0f     // Desvío máximo entre muestras consecutivas
+#define REDUNDANCY_RECOVER_SAMPLES       400       // 200 ms sano para volver a confiar
+#define REDUNDANCY_DISAGREE_MBAR         20.0f
+#define REDUNDANCY_DISAGREE_SAMPLES      200
+#define REDUNDANCY_BUS_RECOVERY_ERRORS   10
+#define REDUNDANCY_BUS_RECOVERY_INTERVAL 200       // Muestras entre intentos de recuperación
+
+enum RedundantChannel : uint8_t {
+    CHANNEL_I2C = 0,      // Preferido
+    CHANNEL_ANALOG = 1,
+};
+
+enum ChannelFault : uint8_t {
+    FAULT_NONE = 0,
+    FAULT_BUS,
+    FAULT_OUT_OF_RANGE,
+    FAULT_STUCK,
+    FAULT_NOISY,
+    FAULT_ABSENT,         // El canal no se está leyendo
+};
+
+inline const char* channelName(uint8_t channel) {
+    return channel == CHANNEL_I2C ? "i2c" : "analog";
+}
+
+inline const char* channelFaultName(uint8_t fault) {
+    switch (fault) {
+        case FAULT_NONE:         return "ok";
+        case FAULT_BUS:          return "bus";
+        case FAULT_OUT_OF_RANGE: return "range";
+        case FAULT_STUCK:        return "stuck";
+        case FAULT_NOISY:        return "noisy";
+        case FAULT_ABSENT:       return "absent";
+        default:                 return "?";
+    }
+}
+
+// Salud de un canal a partir de sus lecturas
+class ChannelMonitor {
+private:
+    float lastValue;
+    bool hasLast;
+    bool lastInRange;
+    uint16_t sameCount;
+    float noiseVar;
+    uint16_t healthyRun;      // Muestras sanas seguidas
+    uint16_t busErrorRun;     // Errores de bus seguidos
+    uint8_t fault;
+
+public:
+    uint32_t faultCount;      // Veces que el canal pasó a falla
+
+    ChannelMonitor() { reset(); }
+
+    void reset() {
+        lastValue = 0.0f;
+        hasLast = false;
+        lastInRange = true;
+        sameCount = 0;
+        noiseVar = 0.0f;
+        healthyRun = 0;
+        busErrorRun = 0;
+        fault = FAULT_NONE;       // Se confía en el canal hasta ver una falla
+        faultCount = 0;
+    }
+
+    // Evalúa una lectura (ok = false si el bus falló o el canal no se leyó)
+    void update(float value, bool ok, bool present = true) {
+        uint8_t detected = FAULT_NONE;
+
+        if (!present) {
+            detected = FAULT_ABSENT;
+            hasLast = false;
+        } else if (!ok) {
+            detected = FAULT_BUS;
+            if (busErrorRun < UINT16_MAX) busErrorRun++;
+            hasLast = false;
+        } else {
+            busErrorRun = 0;
+            bool inRange = value >= REDUNDANCY_RANGE_MIN_MBAR && value <= REDUNDANCY_RANGE_MAX_MBAR;
+            if (hasLast) {
+                float diff = value - lastValue;
+                sameCount = (diff == 0.0f) ? (uint16_t)(sameCount + (sameCount < UINT16_MAX)) : 0;
+                // El salto al entrar o salir de rango no es ruido
+                if (inRange && lastInRange) {
+                    noiseVar += REDUNDANCY_NOISE_ALPHA * (diff * diff - noiseVar);
+                }
+            }
+            lastValue = value;
+            lastInRange = inRange;
+            hasLast = true;
+
+            const float noiseMax2 = REDUNDANCY_NOISE_MAX_MBAR * REDUNDANCY_NOISE_MAX_MBAR;
+            if (!inRange) {
+                detected = FAULT_OUT_OF_RANGE;
+            } else if (sameCount >= REDUNDANCY_STUCK_SAMPLES) {
+                detected = FAULT_STUCK;
+            } else if (noiseVar > noiseMax2 ||
+                       (fault == FAULT_NOISY && noiseVar > 0.25f * noiseMax2)) {
+                // Histéresis: se despeja con la mitad del desvío
+                detected = FAULT_NOISY;
+            }
+        }
+
+        if (detected != FAULT_NONE) {
+            if (fault == FAULT_NONE) faultCount++;
+            fault = detected;
+            healthyRun = 0;
+        } else {
+            if (healthyRun < UINT16_MAX) healthyRun++;
+            // Un canal en falla vuelve a estar sano tras un periodo sin problemas
+            if (fault != FAULT_NONE && healthyRun >= REDUNDANCY_RECOVER_SAMPLES) {
+                fault = FAULT_NONE;
+            }
+        }
+    }
+
+    bool healthy() const { return fault == FAULT_NONE; }
+
+    // La última lectura llegó, está en rango y no está trabada (aunque el canal
+    // todavía no haya cumplido el periodo de recuperación)
+    bool usable() const {
+        return hasLast && lastInRange && sameCount < REDUNDANCY_STUCK_SAMPLES;
+    }
+    uint8_t currentFault() const { return fault; }
+    uint16_t consecutiveBusErrors() const { return busErrorRun; }
+    float noiseSigma() const { return sqrtf(noiseVar); }
+
+    // La primera lectura después de reiniciar el canal no tiene historia
+    void forgetHistory() { hasLast = false; sameCount = 0; }
+};
+
+// Resultado de un tick
+struct RedundancyOutput {
+    float value;
+    bool valid;             // false si ningún canal sirve
+    bool switched;          // Cambió el canal activo en este tick
+    uint8_t channel;        // Canal activo
+    uint8_t reason;         // Falla que motivó el cambio (FAULT_NONE al volver al preferido)
+};
+
+class RedundancyManager {
+private:
+    ChannelMonitor monitors[REDUNDANCY_CHANNELS];
+    uint8_t active;
+    uint16_t disagreeRun;
+    bool disagreeing;
+    uint16_t sinceRecovery;
+
+public:
+    uint32_t switchCount;
+    uint32_t disagreeEvents;
+    uint32_t busRecoveries;
+
+    RedundancyManager() { reset(); }
+
+    void reset() {
+        for (int i = 0; i < REDUNDANCY_CHANNELS; i++) monitors[i].reset();
+        active = CHANNEL_I2C;
+        disagreeRun = 0;
+        disagreeing = false;
+        sinceRecovery = REDUNDANCY_BUS_RECOVERY_INTERVAL;
+        switchCount = 0;
+        disagreeEvents = 0;
+        busRecoveries = 0;
+    }
+
+    // Procesa las lecturas de un tick y elige el valor a entregar.
+    // analogPresent = false si el canal analógico no se está leyendo.
+    RedundancyOutput update(float i2cValue, bool i2cOk, float analogValue, bool analogPresent) {
+        monitors[CHANNEL_I2C].update(i2cValue, i2cOk);
+        monitors[CHANNEL_ANALOG].update(analogValue, true, analogPresent);
+        if (sinceRecovery < UINT16_MAX) sinceRecovery++;
+
+        const float values[REDUNDANCY_CHANNELS] = {i2cValue, analogValue};
+        RedundancyOutput out;
+        out.switched = false;
+        out.reason = FAULT_NONE;
+
+        uint8_t other = active == CHANNEL_I2C ? CHANNEL_ANALOG : CHANNEL_I2C;
+        if (!monitors[active].healthy() && monitors[other].healthy()) {
+            // Cambio inmediato: el valor de este tick ya sale del canal sano
+            out.switched = true;
+            out.reason = monitors[active].currentFault();
+            active = other;
+        } else if (active != CHANNEL_I2C && monitors[CHANNEL_I2C].healthy()) {
+            // El preferido se recuperó (healthy() ya exige el periodo sin fallas)
+            out.switched = true;
+            active = CHANNEL_I2C;
+        }
+        if (out.switched) switchCount++;
+
+        // Comparación cruzada cuando ambos canales están sanos
+        if (monitors[CHANNEL_I2C].healthy() && monitors[CHANNEL_ANALOG].healthy() &&
+            fabsf(i2cValue - analogValue) > REDUNDANCY_DISAGREE_MBAR) {
+            if (disagreeRun < UINT16_MAX) disagreeRun++;
+        } else {
+            disagreeRun = 0;
+        }
+        bool nowDisagreeing = disagreeRun >= REDUNDANCY_DISAGREE_SAMPLES;
+        if (nowDisagreeing && !disagreeing) disagreeEvents++;
+        disagreeing = nowDisagreeing;
+
+        // Sin ningún canal sano (modo degradado): entregar la lectura de este
+        // tick que sea utilizable, preferentemente la del activo
+        uint8_t source = active;
+        other = active == CHANNEL_I2C ? CHANNEL_ANALOG : CHANNEL_I2C;
+        if (!monitors[active].healthy() && !monitors[active].usable() && monitors[other].usable()) {
+            source = other;
+        }
+
+        out.channel = active;
+        out.valid = monitors[source].healthy() || monitors[source].usable();
+        out.value = values[source];
+        return out;
+    }
+
+    // true si conviene intentar recuperar el bus I2C (rate limited)
+    bool wantsBusRecovery() const {
+        return monitors[CHANNEL_I2C].consecutiveBusErrors() >= REDUNDANCY_BUS_RECOVERY_ERRORS &&
+               sinceRecovery >= REDUNDANCY_BUS_RECOVERY_INTERVAL;
+    }
+
+    void busRecovered() {
+        sinceRecovery = 0;
+        busRecoveries++;
+        monitors[CHANNEL_I2C].forgetHistory();
+    }
+
+    bool channelsDisagree() const { return disagreeing; }
+    uint8_t activeChannel() const { return active; }
+    const ChannelMonitor& monitor(uint8_t channel) const { return monitors[channel]; }
+};
@@ -1,6 +1,10 @@
 #ifndef SHARED_H
 #define SHARED_H
 
+#include <stdint.h>
+#include <stddef.h>
+#include "static_memory.h"
+
 #define BUF_SIZE 128
 
 // Buffer circular simple en SRAM compartida
@@ -16,5 +20,310 @@ struct SharedBuffer {
 __attribute__((section(".ccmram"))) extern volatile SharedBuffer msgBuffer;
 #endif
 
+/*
+  Canal de adquisición M4 -> M7
+
+  El M4 es dueño del timer y de los sensores: captura cada muestra con su
+  timestamp y la publica en un ring SPSC en SRAM4. El M7 solo consume muestras
+  y envía comandos de control (frecuencia, sensores activos, start/stop) por un
+  buzón en la misma región.
+
+  Cada campo escrito por un núcleo distinto vive en su propia línea de caché
+  (32 bytes) para que la limpieza/invalidación de caché del M7 nunca pise lo
+  que escribió el M4.
+
+  SRAM4 conserva su contenido en un reset en caliente, así que un magic válido
+  puede venir de un arranque anterior (o de un firmware del M7 sin
+  ACQ_ON_M4, que no usa el bloque). Por eso el M4 no toca los sensores hasta
+  que el M7 responde al saludo de este arranque: el M4 escribe un hello
+  nuevo (ipcHello()) y espera que el M7 lo copie en welcome
+  (ipcAnswerHello()). Un M7 sin ACQ_ON_M4 invalida el bloque al arrancar
+  (ipcRevoke()) y nunca responde.
+
+  Este código no depende de Arduino y compila también en el host.
+*/
+
+#define IPC_MAGIC          0x49504331u  // "IPC1"
+#define IPC_VERSION        3
+#define IPC_CACHE_LINE     32
+#define IPC_RING_SIZE      256          // Potencia de 2
+#define IPC_RING_MASK      (IPC_RING_SIZE - 1)
+
+// SRAM4 (D3, 64 KB): la primera mitad queda para el core (buffers del RPC entre
+// núcleos) y el bloque compartido va al comienzo de la segunda: la sección
+// .sram4_data de linker_script.ld (RAM_IPC) empieza en IPC_SHARED_ADDR
+#define IPC_SRAM4_START    0x38000000u
+#define IPC_SRAM4_END      0x38010000u
+#define IPC_SRAM4_CORE     0x8000u      // Bytes del comienzo que usa el core
+#define IPC_SHARED_ADDR    0x38008000u
+
+// Identificadores de sensores (bit en la máscara de sensores activos)
+enum SensorId : uint8_t {
+    SENSOR_SM4291_I2C = 0,
+    SENSOR_SM4291_ANALOG = 1,
+    SENSOR_ELVH = 2,
+    SENSOR_ABPLLN = 3,
+    SENSOR_SSCDANN = 4,
+    SENSOR_COUNT
+};
+
+// Nombre corto de un sensor para las líneas de metadatos ("#X", "#BUS")
+inline const char* sensorName(uint8_t sensorId) {
+    switch (sensorId) {
+        case SENSOR_SM4291_I2C:    return "sm4291";
+        case SENSOR_SM4291_ANALOG: return "sm4291a";
+        case SENSOR_ELVH:          return "elvh";
+        case SENSOR_ABPLLN:        return "abplln";
+        case SENSOR_SSCDANN:       return "sscdann";
+        default:                   return "?";
+    }
+}
+
+// Estado de una muestra
+enum SampleStatus : uint8_t {
+    SAMPLE_OK = 0,
+    SAMPLE_BUS_ERROR = 1,
+    SAMPLE_OUT_OF_RANGE = 2
+};
+
+// Muestra tipada (16 bytes)
+struct IpcSample {
+    uint32_t timestampUs;   // micros() del M4 capturado en la interrupción
+    uint8_t sensorId;       // SensorId
+    uint8_t status;         // SampleStatus
+    uint16_t sequence;      // Contador de ticks del M4 (detecta huecos)
+    int32_t raw;            // Cuentas crudas del sensor
+    float value;            // Presión en mbar
+};
+
+// Comandos del M7 al M4
+enum IpcCommand : uint32_t {
+    IPC_CMD_NONE = 0,
+    IPC_CMD_SET_PERIOD_US = 1,   // arg = periodo del timer en us
+    IPC_CMD_SET_SENSORS = 2,     // arg = máscara de SensorId
+    IPC_CMD_START = 3,
+    IPC_CMD_STOP = 4
+};
+
+struct alignas(IPC_CACHE_LINE) IpcLine {
+    volatile uint32_t value;
+};
+
+struct IpcShared {
+    // Escrito por el M7 en el arranque
+    alignas(IPC_CACHE_LINE) volatile uint32_t magic;
+    volatile uint32_t version;
+    volatile uint32_t welcome;        // Último hello del M4 respondido
+
+    // Saludo del M4 en cada arranque (solo lo escribe el M4)
+    IpcLine hello;
+
+    // Ring de muestras: head lo escribe el M4, tail el M7
+    IpcLine head;
+    IpcLine tail;
+    alignas(IPC_CACHE_LINE) IpcSample samples[IPC_RING_SIZE];
+
+    // Buzón de control: el M7 escribe comando y argumento y por último cmdSeq;
+    // el M4 responde copiando cmdSeq en ackSeq
+    alignas(IPC_CACHE_LINE) volatile uint32_t command;
+    volatile uint32_t argument;
+    volatile uint32_t cmdSeq;
+    alignas(IPC_CACHE_LINE) volatile uint32_t ackSeq;
+    volatile int32_t result;
+
+    // Estadísticas del M4 (solo las escribe el M4)
+    alignas(IPC_CACHE_LINE) volatile uint32_t ticks;
+    volatile uint32_t dropped;        // Muestras perdidas con el ring lleno
+    volatile uint32_t maxJitterUs;    // Máxima desviación del periodo del timer
+    volatile uint32_t periodUs;
+    volatile uint32_t sensorMask;
+
+    // Ocupación de los buses I2C medida por el M4 (acumulados; el M7 usa diferencias)
+    alignas(IPC_CACHE_LINE) volatile uint32_t busMap;   // Periférico I2C de cada SensorId, 4 bits (0 = no es I2C)
+    volatile uint32_t busBusyUs[SENSOR_COUNT];          // Tiempo de transacción
+    volatile uint32_t busReads[SENSOR_COUNT];
+};
+
+static_assert(IPC_SHARED_ADDR % IPC_CACHE_LINE == 0, "el bloque compartido debe empezar en una línea de caché");
+static_assert(IPC_SHARED_ADDR >= IPC_SRAM4_START + IPC_SRAM4_CORE, "el bloque compartido pisa la mitad de SRAM4 reservada al core");
+static_assert(IPC_SHARED_ADDR + sizeof(IpcShared) <= IPC_SRAM4_END, "el bloque compartido no entra en SRAM4");
+
+// Barreras de memoria y mantenimiento de caché
+#if defined(CORE_CM4) || defined(CORE_CM7)
+#include <Arduino.h>
+inline void ipcBarrier() { __DMB(); }
+#else
+#include <atomic>
+inline void ipcBarrier() { std::atomic_thread_fence(std::memory_order_seq_cst); }
+#endif
+
+// Líneas de caché enteras que cubren [addr, addr + size): el mantenimiento por
+// dirección trabaja de a líneas, así que el rango se redondea hacia afuera en
+// los dos extremos y no toca más líneas que las del objeto
+struct IpcCacheRange {
+    uintptr_t start;
+    int32_t size;
+};
+
+inline IpcCacheRange ipcCacheRange(volatile const void* addr, size_t size) {
+    uintptr_t first = (uintptr_t)addr & ~(uintptr_t)(IPC_CACHE_LINE - 1);
+    uintptr_t end = ((uintptr_t)addr + size + IPC_CACHE_LINE - 1) & ~(uintptr_t)(IPC_CACHE_LINE - 1);
+    IpcCacheRange range;
+    range.start = first;
+    range.size = (int32_t)(end - first);
+    return range;
+}
+
+#if defined(CORE_CM7)
+// El M7 tiene caché de datos; el M4 no
+inline void ipcInvalidate(volatile const void* addr, size_t size) {
+    IpcCacheRange range = ipcCacheRange(addr, size);
+    SCB_InvalidateDCache_by_Addr((uint32_t*)range.start, range.size);
+}
+inline void ipcClean(volatile const void* addr, size_t size) {
+    IpcCacheRange range = ipcCacheRange(addr, size);
+    SCB_CleanDCache_by_Addr((uint32_t*)range.start, range.size);
+}
+#else
+inline void ipcInvalidate(volatile const void*, size_t) {}
+inline void ipcClean(volatile const void*, size_t) {}
 #endif
 
+// El único objeto en RAM_IPC: queda en IPC_SHARED_ADDR en las dos imágenes
+inline IpcShared* ipcShared() {
+    RAM_IPC static IpcShared shared;
+    return &shared;
+}
+
+// M7: inicializa el bloque compartido antes de arrancar el M4
+inline void ipcInit(IpcShared* ipc) {
+    ipc->welcome = 0;
+    ipc->hello.value = 0;
+    ipc->head.value = 0;
+    ipc->tail.value = 0;
+    ipc->command = IPC_CMD_NONE;
+    ipc->argument = 0;
+    ipc->cmdSeq = 0;
+    ipc->ackSeq = 0;
+    ipc->result = 0;
+    ipc->ticks = 0;
+    ipc->dropped = 0;
+    ipc->maxJitterUs = 0;
+    ipc->busMap = 0;
+    for (int i = 0; i < SENSOR_COUNT; i++) {
+        ipc->busBusyUs[i] = 0;
+        ipc->busReads[i] = 0;
+    }
+    ipc->version = IPC_VERSION;
+    ipcBarrier();
+    ipc->magic = IPC_MAGIC;
+    ipcClean(ipc, sizeof(IpcShared));
+}
+
+inline bool ipcReady(IpcShared* ipc) {
+    ipcInvalidate(&ipc->magic, sizeof(uint32_t) * 3);
+    return ipc->magic == IPC_MAGIC && ipc->version == IPC_VERSION;
+}
+
+// M7 sin ACQ_ON_M4: el bloque de un arranque anterior deja de valer, así el M4
+// no arranca la adquisición sobre los buses que lee el M7
+inline void ipcRevoke(IpcShared* ipc) {
+    ipc->magic = 0;
+    ipc->welcome = 0;
+    ipcBarrier();
+    ipcClean(&ipc->magic, sizeof(uint32_t) * 3);
+}
+
+// M4: saludo de este arranque, distinto del hello y del welcome que hayan
+// quedado en SRAM4 (y de 0): solo una respuesta nueva del M7 lo iguala
+inline uint32_t ipcHello(IpcShared* ipc) {
+    uint32_t hello = ipc->hello.value + 1;
+    while (hello == 0 || hello == ipc->welcome) hello++;
+    ipc->hello.value = hello;
+    ipcBarrier();
+    return hello;
+}
+
+// M4: true cuando el M7 de este arranque respondió a hello
+inline bool ipcWelcomed(IpcShared* ipc, uint32_t hello) {
+    return ipcReady(ipc) && ipc->welcome == hello;
+}
+
+// M7: responde al saludo pendiente del M4; true si el M4 ya saludó y quedó respondido
+inline bool ipcAnswerHello(IpcShared* ipc) {
+    ipcInvalidate(&ipc->hello, sizeof(IpcLine));
+    uint32_t hello = ipc->hello.value;
+    if (hello == 0) return false;
+    if (ipc->welcome != hello) {
+        ipc->welcome = hello;
+        ipcBarrier();
+        ipcClean(&ipc->magic, sizeof(uint32_t) * 3);
+    }
+    return true;
+}
+
+// M4 (productor): publica una muestra; false si el ring está lleno
+inline bool ipcPushSample(IpcShared* ipc, const IpcSample& sample) {
+    uint32_t head = ipc->head.value;
+    ipcInvalidate(&ipc->tail, sizeof(IpcLine));
+    if (head - ipc->tail.value >= IPC_RING_SIZE) {
+        ipc->dropped = ipc->dropped + 1;
+        return false;
+    }
+    ipc->samples[head & IPC_RING_MASK] = sample;
+    ipcBarrier();
+    ipc->head.value = head + 1;
+    return true;
+}
+
+// M7 (consumidor): extrae una muestra; false si no hay datos
+inline bool ipcPopSample(IpcShared* ipc, IpcSample* out) {
+    uint32_t tail = ipc->tail.value;
+    ipcInvalidate(&ipc->head, sizeof(IpcLine));
+    if (ipc->head.value == tail) return false;
+    ipcBarrier();
+
+    IpcSample* slot = &ipc->samples[tail & IPC_RING_MASK];
+    ipcInvalidate(slot, sizeof(IpcSample));
+    *out = *slot;
+    ipcBarrier();
+    ipc->tail.value = tail + 1;
+    ipcClean(&ipc->tail, sizeof(IpcLine));
+    return true;
+}
+
+// M7: envía un comando; devuelve el número de secuencia para esperar el ack
+inline uint32_t ipcPostCommand(IpcShared* ipc, IpcCommand cmd, uint32_t arg) {
+    uint32_t seq = ipc->cmdSeq + 1;
+    ipc->command = cmd;
+    ipc->argument = arg;
+    ipcBarrier();
+    ipc->cmdSeq = seq;
+    ipcClean(&ipc->command, IPC_CACHE_LINE);
+    return seq;
+}
+
+// M7: true cuando el M4 confirmó el comando seq
+inline bool ipcCommandAcked(IpcShared* ipc, uint32_t seq) {
+    ipcInvalidate(&ipc->ackSeq, IPC_CACHE_LINE);
+    return (int32_t)(ipc->ackSeq - seq) >= 0;
+}
+
+// M4: true si hay un comando pendiente (se copia en cmd/arg)
+inline bool ipcPollCommand(IpcShared* ipc, IpcCommand* cmd, uint32_t* arg) {
+    uint32_t seq = ipc->cmdSeq;
+    if (seq == ipc->ackSeq) return false;
+    ipcBarrier();
+    *cmd = (IpcCommand)ipc->command;
+    *arg = ipc->argument;
+    return true;
+}
+
+// M4: confirma el último comando con su resultado (0 = OK)
+inline void ipcAckCommand(IpcShared* ipc, int32_t result) {
+    ipc->result = result;
+    ipcBarrier();
+    ipc->ackSeq = ipc->cmdSeq;
+}
+
+#endif
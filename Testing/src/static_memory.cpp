@@ -0,0 +1,58 @@
+#include "static_memory.h"
+
+#ifdef ARDUINO
+
+#if defined(CORE_CM7)
+// Símbolos de linker_script.ld
+extern "C" {
+extern char __dtcm_data_start__[];
+extern char __dtcm_data_end__[];
+extern char __ram_dtcm_end__[];
+extern char __axi_data_start__[];
+extern char __axi_data_end__[];
+extern char __ram_axi_end__[];
+extern char __sram4_data_start__[];
+extern char __sram4_data_end__[];
+extern char __ram_sram4_end__[];
+}
+
+static void printRegion(Print& out, const char* name, const char* start, const char* end, const char* regionEnd) {
+    out.print("#MEM ");
+    out.print(name);
+    out.print(" 0x");
+    out.print((unsigned long)start, HEX);
+    out.print(" ");
+    out.print((unsigned long)(end - start));
+    out.print(" ");
+    out.println((unsigned long)(regionEnd - end));
+}
+#endif
+
+void memoryMapReport(Print& out) {
+#if defined(CORE_CM7)
+    printRegion(out, "dtcm", __dtcm_data_start__, __dtcm_data_end__, __ram_dtcm_end__);
+    printRegion(out, "axi", __axi_data_start__, __axi_data_end__, __ram_axi_end__);
+    printRegion(out, "sram4", __sram4_data_start__, __sram4_data_end__, __ram_sram4_end__);
+#endif
+}
+
+void poolReport(Print& out) {
+    out.println("=== POOLS ===");
+    for (PoolBase* pool = PoolBase::first(); pool != nullptr; pool = pool->next) {
+        out.print("  Pool ");
+        out.print(pool->name);
+        out.print(": bloque ");
+        out.print((unsigned long)pool->blockSize);
+        out.print(" B x ");
+        out.print((unsigned long)pool->capacity);
+        out.print(", en uso ");
+        out.print((unsigned long)pool->used);
+        out.print(", pico ");
+        out.print((unsigned long)pool->peak);
+        out.print(", fallos ");
+        out.println((unsigned long)pool->failures);
+    }
+    out.println("=============");
+}
+
+#endif
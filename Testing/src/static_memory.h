@@ -0,0 +1,141 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+
+/*
+  Memoria estática para el runtime del firmware
+
+  Todo el estado del camino crítico se reserva en tiempo de compilación; nada
+  llama a malloc/new después del arranque, así que no hay fragmentación aunque
+  el equipo funcione semanas sin reiniciar.
+
+  Ubicación en las regiones de RAM del STM32H747 (secciones de
+  linker_script.ld, que ram_sections.py inserta en el script de enlazado del
+  core):
+  - RAM_HOT    -> DTCM (0x20000000): estado que se toca en cada muestra, sin
+                  caché ni esperas. Solo M7: el M4 no ve la DTCM.
+  - RAM_BULK   -> AXI SRAM (0x24000000): bloques grandes (correlación, log)
+  - RAM_IPC    -> SRAM4 en IPC_SHARED_ADDR: el bloque de intercambio M4 <-> M7,
+                  primero en la sección para que quede en la misma dirección
+                  en las dos imágenes (un solo objeto)
+  - RAM_SHARED -> SRAM4 a continuación: lo que sobrevive a un reset en caliente
+
+  Las secciones son NOLOAD: el arranque no las copia desde flash ni las pone
+  en cero. Solo van objetos que su constructor inicializa entero, o que se
+  validan antes de usarse (el caché de descubrimiento, el bloque IPC).
+
+  Los pools se registran en una lista para el reporte de arranque
+  (memoryMapReport(): regiones y pools). Este archivo no depende de Arduino y
+  compila también en el host.
+*/
+
+#if defined(CORE_CM7)
+#define RAM_HOT    __attribute__((section(".dtcm_data")))
+#define RAM_BULK   __attribute__((section(".axi_data")))
+#define RAM_IPC    __attribute__((section(".sram4_ipc")))
+#define RAM_SHARED __attribute__((section(".sram4_data")))
+#elif defined(CORE_CM4)
+#define RAM_HOT
+#define RAM_BULK
+#define RAM_IPC    __attribute__((section(".sram4_ipc")))
+#define RAM_SHARED __attribute__((section(".sram4_data")))
+#else
+// Compilación nativa (host): la ubicación no importa
+#define RAM_HOT
+#define RAM_BULK
+#define RAM_IPC
+#define RAM_SHARED
+#endif
+
+// Datos comunes a todos los pools para el reporte de memoria
+class PoolBase {
+public:
+    const char* name;
+    size_t blockSize;
+    size_t capacity;
+    size_t used;
+    size_t peak;
+    size_t failures;     // Peticiones rechazadas por falta de bloques
+    PoolBase* next;
+
+    // Lista de todos los pools registrados
+    static PoolBase*& first() {
+        static PoolBase* head = nullptr;
+        return head;
+    }
+
+protected:
+    PoolBase(const char* poolName, size_t block, size_t count)
+        : name(poolName), blockSize(block), capacity(count),
+          used(0), peak(0), failures(0), next(first()) {
+        first() = this;
+    }
+};
+
+// Pool de bloques de tamaño fijo con lista libre: alloc/free en O(1), sin heap.
+// No es reentrante: usar desde un único contexto (loop o ISR, no ambos).
+template <typename T, size_t N>
+class StaticPool : public PoolBase {
+private:
+    union Slot {
+        Slot* next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    Slot slots[N];
+    Slot* freeList;
+
+public:
+    explicit StaticPool(const char* poolName) : PoolBase(poolName, sizeof(Slot), N) {
+        reset();
+    }
+
+    // Devuelve todos los bloques a la lista libre (no llama destructores)
+    void reset() {
+        for (size_t i = 0; i < N - 1; i++) {
+            slots[i].next = &slots[i + 1];
+        }
+        slots[N - 1].next = nullptr;
+        freeList = &slots[0];
+        used = 0;
+    }
+
+    template <typename... Args>
+    T* create(Args... args) {
+        Slot* slot = freeList;
+        if (slot == nullptr) {
+            failures++;
+            return nullptr;
+        }
+        freeList = slot->next;
+        used++;
+        if (used > peak) peak = used;
+        return new (slot->storage) T(args...);
+    }
+
+    void destroy(T* obj) {
+        if (obj == nullptr) return;
+        obj->~T();
+        Slot* slot = reinterpret_cast<Slot*>(obj);
+        slot->next = freeList;
+        freeList = slot;
+        used--;
+    }
+
+    bool owns(const T* obj) const {
+        const Slot* slot = reinterpret_cast<const Slot*>(obj);
+        return slot >= &slots[0] && slot < &slots[N];
+    }
+
+    size_t available() const { return capacity - used; }
+};
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+// Reporte de arranque: un renglón "#MEM <región> 0x<inicio> <bytes usados>
+// <bytes libres en la región>" por sección y la ocupación de cada pool
+void memoryMapReport(Print& out);
+void poolReport(Print& out);
+#endif
@@ -0,0 +1,304 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include <string.h>
+#include "cmd_protocol.h"
+
+/*
+  Decodificador incremental de la salida serie del dispositivo
+
+  Es la inversa de formatSampleLine() (sample_pipeline.h): recibe los bytes
+  tal como llegan por el puerto, de a uno (push) o por bloques (feed), y al
+  completar cada renglón informa su tipo:
+  - "<micros> <mbar>[ [resumen]]": muestra con timestamp del dispositivo
+  - "<mbar>": muestra sin timestamp (firmware anterior)
+  - "ERROR": lectura fallida
+  - "#...": metadatos (#SYNC, #POWER, #R, ...), el renglón queda en line[]
+  - cualquier otra cosa (mensajes de arranque, texto): se cuenta y se ignora
+
+  Las respuestas binarias a comandos (cmd_protocol.h) llegan por el mismo
+  puerto entre dos renglones: una trama que empieza al comienzo de un renglón
+  se saltea entera por su longitud (aunque traiga bytes '\n') y se cuenta en
+  frames.
+
+  Los números se leen con un parser propio y no con strtof, que depende del
+  locale (con una configuración regional en español el separador decimal
+  pasaría a ser la coma). También estima la frecuencia de muestreo con los
+  timestamps del dispositivo, sin el jitter de llegada al host.
+
+  Este archivo no depende de Arduino y compila también en el host.
+*/
+
+#define DECODER_LINE_SIZE    128      // Renglón más largo aceptado
+#define DECODER_RATE_ALPHA   0.01f    // Suavizado del intervalo entre muestras
+#define DECODER_MAX_GAP_US   1000000  // Intervalos mayores no cuentan para la frecuencia
+
+enum DecodedKind : uint8_t {
+    DECODED_NONE,       // Renglón incompleto o vacío
+    DECODED_SAMPLE,
+    DECODED_ERROR,
+    DECODED_META,
+    DECODED_OTHER,
+};
+
+struct DecodedSample {
+    uint32_t us;
+    float value;
+    bool timed;         // false si el renglón no traía timestamp
+};
+
+// Número decimal sin exponente ("-12.345678", "nan", "inf"); avanza *pos.
+// false si no hay un número en la posición.
+inline bool decodeNumber(const char* text, size_t length, size_t* pos, double* out) {
+    size_t i = *pos;
+    bool negative = false;
+    if (i < length && (text[i] == '-' || text[i] == '+')) negative = text[i++] == '-';
+
+    if (i + 3 <= length && text[i] == 'n' && text[i + 1] == 'a' && text[i + 2] == 'n') {
+        *out = NAN;
+        *pos = i + 3;
+        return true;
+    }
+    if (i + 3 <= length && text[i] == 'i' && text[i + 1] == 'n' && text[i + 2] == 'f') {
+        *out = negative ? -INFINITY : INFINITY;
+        *pos = i + 3;
+        return true;
+    }
+
+    // Mantisa entera (hasta 19 dígitos exactos) y escala decimal aparte
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int scale = 0;
+    bool any = false;
+    while (i < length && text[i] >= '0' && text[i] <= '9') {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (uint64_t)(text[i] - '0');
+            if (mantissa) digits++;
+        } else {
+            scale++;
+        }
+        any = true;
+        i++;
+    }
+    if (i < length && text[i] == '.') {
+        i++;
+        while (i < length && text[i] >= '0' && text[i] <= '9') {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (uint64_t)(text[i] - '0');
+                if (mantissa) digits++;
+                scale--;
+            }
+            any = true;
+            i++;
+        }
+    }
+    if (!any) return false;
+
+    static const double POWERS[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+                                    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19};
+    int magnitude = scale < 0 ? -scale : scale;
+    double power = magnitude < 20 ? POWERS[magnitude] : pow(10.0, magnitude);
+    double value = scale < 0 ? (double)mantissa / power : (double)mantissa * power;
+    *out = negative ? -value : value;
+    *pos = i;
+    return true;
+}
+
+class StreamDecoder {
+public:
+    char line[DECODER_LINE_SIZE];   // Último renglón completo (sin '\r'/'\n', con terminador nulo)
+    size_t length;
+    bool overflow;                  // El renglón en curso no entró en line[]
+
+    uint32_t lines;
+    uint32_t samples;
+    uint32_t errors;
+    uint32_t metadata;
+    uint32_t other;
+    uint32_t frames;                // Tramas binarias salteadas
+
+    float intervalUs;               // Intervalo medio entre muestras (0 hasta tener dos)
+    uint32_t lastUs;
+    bool haveLast;
+
+    StreamDecoder() { reset(); }
+
+    void reset() {
+        line[0] = '\0';
+        length = 0;
+        overflow = false;
+        lines = 0;
+        samples = 0;
+        errors = 0;
+        metadata = 0;
+        other = 0;
+        frames = 0;
+        frameState = FRAME_NONE;
+        frameLeft = 0;
+        intervalUs = 0.0f;
+        lastUs = 0;
+        haveLast = false;
+    }
+
+    float rateHz() const { return intervalUs > 0.0f ? 1e6f / intervalUs : 0.0f; }
+
+    // Procesa un byte; al terminar un renglón devuelve su tipo (y la muestra en *sample)
+    DecodedKind push(char c, DecodedSample* sample) {
+        if (inFrame(c)) {
+            skipFrame((uint8_t)c);
+            return DECODED_NONE;
+        }
+        if (c == '\r') return DECODED_NONE;
+        if (c != '\n') {
+            if (length + 1 < DECODER_LINE_SIZE) {
+                line[length++] = c;
+            } else {
+                overflow = true;
+            }
+            return DECODED_NONE;
+        }
+        return finishLine(sample);
+    }
+
+    // Procesa un bloque; llama a onLine(kind, sample) por cada renglón completo.
+    // Busca los '\n' con memchr y copia cada renglón de una vez: por byte sale
+    // varias veces más barato que push().
+    template <typename OnLine>
+    void feed(const char* data, size_t n, OnLine onLine) {
+        DecodedSample sample;
+        while (n > 0) {
+            if (inFrame(*data)) {
+                skipFrame((uint8_t)*data);
+                data++;
+                n--;
+                continue;
+            }
+            const char* end = (const char*)memchr(data, '\n', n);
+            size_t take = end ? (size_t)(end - data) : n;
+            append(data, take);
+            if (!end) return;
+            data += take + 1;
+            n -= take + 1;
+            DecodedKind kind = finishLine(&sample);
+            if (kind != DECODED_NONE) onLine(kind, sample);
+        }
+    }
+
+private:
+    enum FrameState : uint8_t { FRAME_NONE, FRAME_SYNC1, FRAME_CMD, FRAME_LEN, FRAME_BODY };
+
+    FrameState frameState;
+    uint8_t frameLeft;              // Bytes de payload + CRC por saltear
+
+    // true si el byte pertenece a una trama: una en curso o un 0xA5 al
+    // comienzo de un renglón (no aparece en el texto ASCII del firmware)
+    bool inFrame(char c) {
+        if (frameState == FRAME_SYNC1 && (uint8_t)c != CMD_SYNC1) frameState = FRAME_NONE;
+        return frameState != FRAME_NONE || (length == 0 && (uint8_t)c == CMD_SYNC0);
+    }
+
+    void skipFrame(uint8_t b) {
+        switch (frameState) {
+            case FRAME_NONE:
+                frameState = FRAME_SYNC1;
+                break;
+            case FRAME_SYNC1:
+                frameState = FRAME_CMD;
+                break;
+            case FRAME_CMD:
+                frameState = FRAME_LEN;
+                break;
+            case FRAME_LEN:
+                if (b > CMD_MAX_PAYLOAD) {
+                    frameState = FRAME_NONE;
+                } else {
+                    frameLeft = (uint8_t)(b + 1);
+                    frameState = FRAME_BODY;
+                }
+                break;
+            case FRAME_BODY:
+                if (--frameLeft == 0) {
+                    frameState = FRAME_NONE;
+                    frames++;
+                }
+                break;
+        }
+    }
+
+    // Los '\r' quedan en line[] y finishLine() saca el del final
+    void append(const char* data, size_t n) {
+        size_t room = DECODER_LINE_SIZE - 1 - length;
+        if (n > room) {
+            n = room;
+            overflow = true;
+        }
+        memcpy(&line[length], data, n);
+        length += n;
+    }
+
+    DecodedKind finishLine(DecodedSample* sample) {
+        while (length > 0 && line[length - 1] == '\r') length--;
+        line[length] = '\0';
+        size_t n = length;
+        bool truncated = overflow;
+        length = 0;
+        overflow = false;
+        if (n == 0) return DECODED_NONE;
+
+        lines++;
+        if (truncated) {
+            other++;
+            return DECODED_OTHER;
+        }
+        if (line[0] == '#') {
+            metadata++;
+            return DECODED_META;
+        }
+        if (n == 5 && line[0] == 'E' && line[1] == 'R' && line[2] == 'R' && line[3] == 'O' && line[4] == 'R') {
+            errors++;
+            return DECODED_ERROR;
+        }
+        if (parseSample(n, sample)) {
+            samples++;
+            if (sample->timed) updateRate(sample->us);
+            return DECODED_SAMPLE;
+        }
+        other++;
+        return DECODED_OTHER;
+    }
+
+    bool parseSample(size_t n, DecodedSample* sample) {
+        size_t pos = 0;
+        double first;
+        if (!decodeNumber(line, n, &pos, &first)) return false;
+        if (pos == n) {
+            sample->us = 0;
+            sample->value = (float)first;
+            sample->timed = false;
+            return true;
+        }
+        if (line[pos] != ' ' || !(first >= 0.0 && first <= 4294967295.0)) return false;
+        pos++;
+        double value;
+        if (!decodeNumber(line, n, &pos, &value)) return false;
+        // Después del valor solo puede venir el resumen de estado
+        if (pos != n && line[pos] != ' ') return false;
+        sample->us = (uint32_t)first;
+        sample->value = (float)value;
+        sample->timed = true;
+        return true;
+    }
+
+    void updateRate(uint32_t us) {
+        if (haveLast) {
+            uint32_t delta = us - lastUs;   // Correcto a través del desborde de micros()
+            if (delta > 0 && delta < DECODER_MAX_GAP_US) {
+                intervalUs = intervalUs > 0.0f ? intervalUs + DECODER_RATE_ALPHA * ((float)delta - intervalUs)
+                                               : (float)delta;
+            }
+        }
+        lastUs = us;
+        haveLast = true;
+    }
+};
@@ -0,0 +1,282 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+  Planificador cooperativo estático para el trabajo de loop()
+
+  Las tareas se registran una vez en setup() y no se crean ni destruyen
+  después. Cada una tiene:
+  - periodo: las periódicas se liberan solas cada periodUs; las esporádicas
+    las libera el loop con release() (el tick del timer, un bloque listo de
+    la correlación) y el periodo es el mínimo entre liberaciones
+  - plazo: por defecto el periodo; un trabajo que termina después, o que
+    sigue pendiente cuando llega la liberación siguiente, es un plazo perdido
+  - presupuesto por porción (sliceUs): lo que puede tardar una llamada a la
+    función de la tarea. Un trabajo largo (FFT, escritura en flash, respuesta
+    HTTP) devuelve TASK_MORE y sigue en la próxima porción
+  - costo por trabajo (costUs): suma de sus porciones, para el análisis
+
+  La prioridad es rate-monotonic: menor periodo, mayor prioridad. No hay
+  desalojo: runOnce() elige la tarea liberada de mayor prioridad y ejecuta
+  una porción. Para que una porción larga no atrase a una tarea más
+  prioritaria, antes de arrancarla se comprueba que su presupuesto entre
+  (con guardUs de margen) antes de la próxima liberación prevista de cada
+  tarea más prioritaria; si no entra se posterga y se cuenta. Así la tarea de
+  adquisición solo espera por porciones que excedan su presupuesto, y cada
+  exceso queda contado.
+
+  responseBoundUs() da la cota clásica de tiempo de respuesta sin desalojo
+  (costo propio, bloqueo de una porción de menor prioridad e interferencia de
+  las más prioritarias), sin contar la postergación: es la garantía aun si el
+  control de holgura no pudiera prever una liberación.
+
+  El reloj es una función (micros() en el equipo, un reloj simulado en
+  tools/sched_sim.cpp). Este archivo no depende de Arduino y compila también
+  en el host.
+*/
+
+#define SCHED_MAX_TASKS  10
+#define SCHED_GUARD_US   20       // Margen para el jitter de las liberaciones
+
+enum TaskResult : uint8_t {
+    TASK_DONE,      // Trabajo terminado
+    TASK_MORE,      // Porción terminada, el trabajo sigue en la próxima
+};
+
+typedef TaskResult (*TaskFn)(void* context);
+typedef uint32_t (*SchedClock)();
+
+struct TaskConfig {
+    const char* name;
+    TaskFn run;
+    void* context;
+    uint32_t periodUs;      // Periodo, o mínimo entre liberaciones si es esporádica
+    uint32_t sliceUs;       // Presupuesto de una porción
+    uint32_t costUs;        // Presupuesto de un trabajo completo (0 = una porción)
+    bool sporadic;          // Solo la libera release()
+    uint32_t deadlineUs;    // 0 = el periodo
+};
+
+struct TaskStats {
+    uint32_t jobs;          // Trabajos terminados
+    uint32_t slices;
+    uint32_t misses;        // Plazos perdidos
+    uint32_t overruns;      // Porciones más largas que el presupuesto
+    uint32_t deferred;      // Porciones postergadas por falta de holgura
+    uint32_t maxSliceUs;
+    uint32_t maxResponseUs; // De la liberación al fin del trabajo
+};
+
+class TaskScheduler {
+public:
+    explicit TaskScheduler(SchedClock clock) : clock(clock), count(0), guardUs(SCHED_GUARD_US) {}
+
+    // Registra una tarea y devuelve su identificador (el orden de registro,
+    // no la prioridad). -1 si no hay lugar.
+    int add(const TaskConfig& config) {
+        if (count >= SCHED_MAX_TASKS) return -1;
+        uint8_t id = count++;
+        Task& task = tasks[id];
+        task.config = config;
+        if (task.config.costUs < task.config.sliceUs) task.config.costUs = task.config.sliceUs;
+        task.active = false;
+        task.released = false;
+        task.releaseUs = 0;
+        task.nextReleaseUs = clock() + config.periodUs;
+        resetStats(id);
+
+        // Inserción ordenada por periodo (a igual periodo, la registrada antes)
+        uint8_t pos = id;
+        while (pos > 0 && tasks[order[pos - 1]].config.periodUs > config.periodUs) {
+            order[pos] = order[pos - 1];
+            pos--;
+        }
+        order[pos] = id;
+        return id;
+    }
+
+    // Libera un trabajo de una tarea esporádica en el instante atUs (el tick
+    // del timer, no el momento en que el loop lo ve). 'lost' son las
+    // liberaciones que el loop no llegó a ver (ticks que pisaron la bandera
+    // de la interrupción) y cuentan como plazos perdidos.
+    void release(int id, uint32_t atUs, uint32_t lost = 0) {
+        Task& task = tasks[id];
+        task.stats.misses += lost;
+        if (task.active) task.stats.misses++;   // El anterior no terminó a tiempo
+        task.active = true;
+        task.released = true;
+        task.releaseUs = atUs;
+        task.nextReleaseUs = atUs + task.config.periodUs;
+    }
+
+    // Cambia el periodo (p. ej. CMD_SET_PERIOD); las periódicas lo aplican
+    // desde su próxima liberación y el orden de prioridades se recalcula
+    void setPeriod(int id, uint32_t periodUs) {
+        Task& task = tasks[id];
+        task.nextReleaseUs += periodUs - task.config.periodUs;
+        task.config.periodUs = periodUs;
+        for (uint8_t i = 1; i < count; i++) {
+            for (uint8_t j = i; j > 0 && tasks[order[j - 1]].config.periodUs > tasks[order[j]].config.periodUs; j--) {
+                uint8_t t = order[j];
+                order[j] = order[j - 1];
+                order[j - 1] = t;
+            }
+        }
+    }
+
+    void setGuardUs(uint32_t us) { guardUs = us; }
+
+    // Ejecuta una porción de la tarea liberada de mayor prioridad que entre
+    // en la holgura; false si no ejecutó nada
+    bool runOnce() {
+        uint32_t now = clock();
+        releasePeriodic(now);
+
+        for (uint8_t rank = 0; rank < count; rank++) {
+            Task& task = tasks[order[rank]];
+            if (!task.active) continue;
+            if (!fits(rank, now)) {
+                task.stats.deferred++;
+                continue;
+            }
+
+            TaskResult result = task.config.run(task.config.context);
+            uint32_t end = clock();
+            uint32_t sliceUs = end - now;
+            task.stats.slices++;
+            if (sliceUs > task.stats.maxSliceUs) task.stats.maxSliceUs = sliceUs;
+            if (sliceUs > task.config.sliceUs) task.stats.overruns++;
+
+            if (result == TASK_DONE) {
+                task.active = false;
+                task.stats.jobs++;
+                uint32_t responseUs = end - task.releaseUs;
+                if (responseUs > task.stats.maxResponseUs) task.stats.maxResponseUs = responseUs;
+                if (responseUs > deadline(task)) task.stats.misses++;
+            }
+            return true;
+        }
+        return false;
+    }
+
+    // Algún trabajo liberado sin terminar (para no dormir con trabajo pendiente)
+    bool pending() const {
+        for (uint8_t i = 0; i < count; i++) {
+            if (tasks[i].active) return true;
+        }
+        return false;
+    }
+
+    bool active(int id) const { return tasks[id].active; }
+
+    // Instante de la liberación del trabajo en curso
+    uint32_t releaseUs(int id) const { return tasks[id].releaseUs; }
+
+    uint8_t taskCount() const { return count; }
+    const char* name(int id) const { return tasks[id].config.name; }
+    const TaskConfig& config(int id) const { return tasks[id].config; }
+    const TaskStats& stats(int id) const { return tasks[id].stats; }
+
+    void resetStats(int id) {
+        TaskStats& s = tasks[id].stats;
+        s.jobs = s.slices = s.misses = s.overruns = s.deferred = 0;
+        s.maxSliceUs = s.maxResponseUs = 0;
+    }
+
+    // Prioridad (0 = la más alta)
+    uint8_t rank(int id) const {
+        for (uint8_t r = 0; r < count; r++) {
+            if (order[r] == id) return r;
+        }
+        return count;
+    }
+
+    // Cota del tiempo de respuesta: R = C + B + sum(ceil(R / T_j) C_j) sobre
+    // las más prioritarias, con B la porción más larga de las menos
+    // prioritarias. 0 si no converge antes del plazo.
+    uint32_t responseBoundUs(int id) const {
+        uint8_t r = rank(id);
+        const Task& task = tasks[id];
+        uint32_t blocking = 0;
+        for (uint8_t lower = r + 1; lower < count; lower++) {
+            uint32_t slice = tasks[order[lower]].config.sliceUs;
+            if (slice > blocking) blocking = slice;
+        }
+        uint32_t limit = deadline(task);
+        uint32_t response = task.config.costUs + blocking;
+        while (response <= limit) {
+            uint32_t next = task.config.costUs + blocking;
+            for (uint8_t higher = 0; higher < r; higher++) {
+                const TaskConfig& c = tasks[order[higher]].config;
+                next += ((response + c.periodUs - 1) / c.periodUs) * c.costUs;
+            }
+            if (next == response) return response;
+            response = next;
+        }
+        return 0;
+    }
+
+    // Utilización declarada: sum(C / T)
+    float utilization() const {
+        float u = 0.0f;
+        for (uint8_t i = 0; i < count; i++) {
+            u += (float)tasks[i].config.costUs / (float)tasks[i].config.periodUs;
+        }
+        return u;
+    }
+
+private:
+    struct Task {
+        TaskConfig config;
+        TaskStats stats;
+        bool active;            // Trabajo liberado sin terminar
+        bool released;          // Ya tuvo al menos una liberación (prevé la próxima)
+        uint32_t releaseUs;
+        uint32_t nextReleaseUs;
+    };
+
+    SchedClock clock;
+    Task tasks[SCHED_MAX_TASKS];
+    uint8_t order[SCHED_MAX_TASKS];     // Identificadores de mayor a menor prioridad
+    uint8_t count;
+    uint32_t guardUs;
+
+    static uint32_t deadline(const Task& task) {
+        return task.config.deadlineUs ? task.config.deadlineUs : task.config.periodUs;
+    }
+
+    void releasePeriodic(uint32_t now) {
+        for (uint8_t i = 0; i < count; i++) {
+            Task& task = tasks[i];
+            if (task.config.sporadic || (int32_t)(now - task.nextReleaseUs) < 0) continue;
+            if (task.active) task.stats.misses++;
+            task.active = true;
+            task.released = true;
+            task.releaseUs = task.nextReleaseUs;
+            task.nextReleaseUs += task.config.periodUs;
+            // Atrasada más de un periodo: las liberaciones salteadas no se recuperan
+            if ((int32_t)(now - task.nextReleaseUs) >= 0) {
+                uint32_t behind = (now - task.releaseUs) / task.config.periodUs;
+                task.stats.misses += behind;
+                task.releaseUs += behind * task.config.periodUs;
+                task.nextReleaseUs = task.releaseUs + task.config.periodUs;
+            }
+        }
+    }
+
+    // La porción de la tarea en 'rank' termina antes de la próxima liberación
+    // prevista de cada tarea más prioritaria
+    bool fits(uint8_t rank, uint32_t now) const {
+        uint32_t need = tasks[order[rank]].config.sliceUs + guardUs;
+        for (uint8_t higher = 0; higher < rank; higher++) {
+            const Task& h = tasks[order[higher]];
+            if (!h.released) continue;
+            int32_t slack = (int32_t)(h.nextReleaseUs - now);
+            // Atrasada más de un periodo: la fuente se detuvo (timer parado)
+            if (slack < -(int32_t)h.config.periodUs) continue;
+            if (slack < (int32_t)need) return false;
+        }
+        return true;
+    }
+};
@@ -0,0 +1,33 @@
+#pragma once
+#include <Arduino.h>
+
+/*
+  Sincronización de tiempo host <-> dispositivo
+
+  El host envía periódicamente un ping por el puerto serie:
+      SYNC <seq>\n
+  y el dispositivo responde con su contador de microsegundos:
+      #SYNC <seq> <micros>\n
+
+  El host mide el tiempo de ida y vuelta de cada ping y estima offset y deriva
+  del reloj del dispositivo (ver time_sync.py). Cada muestra se envía con el
+  micros() capturado en la interrupción del timer, de modo que el host puede
+  mapearla a su propio reloj sin el jitter del buffer USB/serie.
+*/
+
+// Timestamp (micros) capturado en la interrupción del timer para la muestra actual
+extern volatile uint32_t sampleTimestampUs;
+
+// Responde a un ping "SYNC <seq>" con el contador de microsegundos actual
+inline void timeSyncHandleLine(const char* line) {
+    if (strncmp(line, "SYNC ", 5) != 0) return;
+
+    // Capturar el tiempo lo antes posible para minimizar el error de medición
+    uint32_t nowUs = micros();
+    unsigned long seq = strtoul(line + 5, NULL, 10);
+
+    Serial.print("#SYNC ");
+    Serial.print(seq);
+    Serial.print(" ");
+    Serial.println(nowUs);
+}
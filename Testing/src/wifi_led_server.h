@@ -8,6 +8,16 @@ char pass[] = SECRET_PASS;
 int status = WL_IDLE_STATUS;
 WiFiServer server(80);
 
+// Línea HTTP actual en un buffer fijo (sin String: no toca el heap)
+#define HTTP_LINE_MAX 128
+static char currentLine[HTTP_LINE_MAX];
+static size_t currentLineLen = 0;
+
+inline bool currentLineEndsWith(const char* suffix) {
+  size_t n = strlen(suffix);
+  return currentLineLen >= n && memcmp(currentLine + currentLineLen - n, suffix, n) == 0;
+}
+
 void printWifiStatus();
 void sendHttpResponse(WiFiClient client);
 
@@ -47,136 +57,199 @@ inline void wifiLedServerSetup() {
   printWifiStatus();
 }
 
-inline void wifiLedServerLoop() {
-  if (status != WiFi.status()) {
-    status = WiFi.status();
-    if (status == WL_AP_CONNECTED) {
-      Serial.println("Device connected to AP");
-    } else {
-      Serial.println("Device disconnected from AP");
+// Estado del cliente en curso: cada llamada a wifiLedServerLoop() hace un paso
+// acotado y vuelve, así el servidor puede correr como tarea del planificador
+// (task_scheduler.h) sin atrasar el muestreo
+enum HttpState : uint8_t {
+  HTTP_IDLE,
+  HTTP_READING,       // Leyendo el pedido
+  HTTP_SENDING,       // Enviando la página de a HTTP_LINES_PER_STEP renglones
+  HTTP_FLUSH_WAIT,    // Pausa antes de vaciar el buffer
+  HTTP_CLOSE_WAIT,    // Pausa antes de cerrar la conexión
+};
+
+#define HTTP_READ_PER_STEP   64      // Bytes del pedido por paso
+#define HTTP_LINES_PER_STEP  8       // Renglones de la respuesta por paso
+#define HTTP_REQUEST_TIMEOUT 5000    // ms
+#define HTTP_FLUSH_DELAY_MS  200
+#define HTTP_CLOSE_DELAY_MS  100
+
+static const char* const HTTP_RESPONSE[] = {
+  "HTTP/1.1 200 OK",
+  "Content-Type: text/html",
+  "Connection: close",
+  "Cache-Control: no-cache, no-store, must-revalidate",
+  "Pragma: no-cache",
+  "Expires: 0",
+  "",
+  "<!DOCTYPE HTML>",
+  "<html>",
+  "<head>",
+  "<meta name=\"viewport\" content=\"width=device-width, initial-scale=1\">",
+  "<meta charset=\"UTF-8\">",
+  "<title>Portenta LED Control</title>",
+  "<style>",
+  "body { font-family: Arial, sans-serif; text-align: center; margin: 20px; background-color: #f5f5f5; }",
+  "h1 { color: #333; margin-bottom: 30px; }",
+  "h2 { margin-top: 30px; color: #555; }",
+  "a { display: inline-block; margin: 10px; padding: 15px 25px; background-color: #4CAF50; color: white; text-decoration: none; border-radius: 5px; font-weight: bold; box-shadow: 0 2px 5px rgba(0,0,0,0.2); }",
+  "a:hover { background-color: #45a049; transform: translateY(-2px); box-shadow: 0 4px 8px rgba(0,0,0,0.2); }",
+  "a:active { transform: translateY(1px); box-shadow: 0 1px 3px rgba(0,0,0,0.2); }",
+  ".red { color: #e74c3c; }",
+  ".green { color: #2ecc71; }",
+  ".blue { color: #3498db; }",
+  ".container { max-width: 600px; margin: 0 auto; background-color: white; padding: 20px; border-radius: 10px; box-shadow: 0 0 10px rgba(0,0,0,0.1); }",
+  ".led-control { margin-bottom: 20px; padding: 15px; border-radius: 8px; background-color: #f9f9f9; }",
+  "</style>",
+  "</head>",
+  "<body>",
+  "<div class=\"container\">",
+  "<h1>Portenta H7 LED Control</h1>",
+  "<div class=\"led-control\">",
+  "<h2><span class=\"red\">RED</span> LED</h2>",
+  "<a href=\"/Hr\">ON</a>",
+  "<a href=\"/Lr\">OFF</a>",
+  "</div>",
+  "<div class=\"led-control\">",
+  "<h2><span class=\"green\">GREEN</span> LED</h2>",
+  "<a href=\"/Hg\">ON</a>",
+  "<a href=\"/Lg\">OFF</a>",
+  "</div>",
+  "<div class=\"led-control\">",
+  "<h2><span class=\"blue\">BLUE</span> LED</h2>",
+  "<a href=\"/Hb\">ON</a>",
+  "<a href=\"/Lb\">OFF</a>",
+  "</div>",
+  "</div>",
+  "</body>",
+  "</html>"
+};
+#define HTTP_RESPONSE_LINES (sizeof(HTTP_RESPONSE) / sizeof(HTTP_RESPONSE[0]))
+
+static WiFiClient httpClient;
+static HttpState httpState = HTTP_IDLE;
+static unsigned long httpStateStart = 0;
+static size_t httpLinesSent = 0;
+
+inline void httpEnter(HttpState state) {
+  httpState = state;
+  httpStateStart = millis();
+}
+
+// Procesa los bytes del pedido; true al ver la línea vacía que lo termina
+inline bool httpReadRequest() {
+  for (int n = 0; n < HTTP_READ_PER_STEP && httpClient.available(); n++) {
+    char c = httpClient.read();
+    Serial.write(c);
+
+    if (c == '\n') {
+      if (currentLineLen == 0) {
+        Serial.println("End of HTTP request detected");
+        return true;
+      }
+      currentLineLen = 0;
+    } else if (c != '\r' && currentLineLen < HTTP_LINE_MAX) {
+      // Solo interesa el comienzo de la línea ("GET /Xx"): el resto se descarta
+      currentLine[currentLineLen++] = c;
     }
-  }
 
-  WiFiClient client = server.available();
-
-  if (client) {
-    Serial.println("new client");
-    String currentLine = "";
-    bool requestComplete = false;
-    unsigned long requestStartTime = millis();
-    const unsigned long requestTimeout = 5000;
-
-    while (client.connected() && !requestComplete) {
-      if (client.available()) {
-        char c = client.read();
-        Serial.write(c);
-
-        if (c == '\n') {
-          if (currentLine.length() == 0) {
-            Serial.println("End of HTTP request detected");
-            requestComplete = true;
-          } else {
-            currentLine = "";
-          }
-        } else if (c != '\r') {
-          currentLine += c;
-        }
+    if (currentLineEndsWith("GET /Hr")) {
+      digitalWrite(LEDR, LOW);
+      Serial.println("Red LED ON");
+    }
+    if (currentLineEndsWith("GET /Lr")) {
+      digitalWrite(LEDR, HIGH);
+      Serial.println("Red LED OFF");
+    }
+    if (currentLineEndsWith("GET /Hg")) {
+      digitalWrite(LEDG, LOW);
+      Serial.println("Green LED ON");
+    }
+    if (currentLineEndsWith("GET /Lg")) {
+      digitalWrite(LEDG, HIGH);
+      Serial.println("Green LED OFF");
+    }
+    if (currentLineEndsWith("GET /Hb")) {
+      digitalWrite(LEDB, LOW);
+      Serial.println("Blue LED ON");
+    }
+    if (currentLineEndsWith("GET /Lb")) {
+      digitalWrite(LEDB, HIGH);
+      Serial.println("Blue LED OFF");
+    }
+  }
+  return false;
+}
 
-        if (currentLine.endsWith("GET /Hr")) {
-          digitalWrite(LEDR, LOW);
-          Serial.println("Red LED ON");
-        }
-        if (currentLine.endsWith("GET /Lr")) {
-          digitalWrite(LEDR, HIGH);
-          Serial.println("Red LED OFF");
-        }
-        if (currentLine.endsWith("GET /Hg")) {
-          digitalWrite(LEDG, LOW);
-          Serial.println("Green LED ON");
-        }
-        if (currentLine.endsWith("GET /Lg")) {
-          digitalWrite(LEDG, HIGH);
-          Serial.println("Green LED OFF");
-        }
-        if (currentLine.endsWith("GET /Hb")) {
-          digitalWrite(LEDB, LOW);
-          Serial.println("Blue LED ON");
-        }
-        if (currentLine.endsWith("GET /Lb")) {
-          digitalWrite(LEDB, HIGH);
-          Serial.println("Blue LED OFF");
+// Un paso del servidor; true si queda un cliente en curso
+inline bool wifiLedServerLoop() {
+  switch (httpState) {
+    case HTTP_IDLE:
+      if (status != WiFi.status()) {
+        status = WiFi.status();
+        if (status == WL_AP_CONNECTED) {
+          Serial.println("Device connected to AP");
+        } else {
+          Serial.println("Device disconnected from AP");
         }
       }
+      httpClient = server.available();
+      if (!httpClient) return false;
+      Serial.println("new client");
+      currentLineLen = 0;
+      httpEnter(HTTP_READING);
+      return true;
 
-      if (millis() - requestStartTime > requestTimeout) {
+    case HTTP_READING:
+      if (!httpClient.connected()) {
+        // Se fue sin terminar el pedido: cerrar sin responder
+        httpEnter(HTTP_CLOSE_WAIT);
+      } else if (httpReadRequest()) {
+        Serial.println("Sending HTTP response");
+        httpLinesSent = 0;
+        httpEnter(HTTP_SENDING);
+      } else if (millis() - httpStateStart > HTTP_REQUEST_TIMEOUT) {
         Serial.println("Request timeout");
-        requestComplete = true;
+        Serial.println("Sending HTTP response");
+        httpLinesSent = 0;
+        httpEnter(HTTP_SENDING);
       }
-    }
+      return true;
 
-    if (requestComplete) {
-      Serial.println("Sending HTTP response");
-      sendHttpResponse(client);
-      delay(200);
-      client.flush();
-    }
+    case HTTP_SENDING:
+      for (int n = 0; n < HTTP_LINES_PER_STEP && httpLinesSent < HTTP_RESPONSE_LINES; n++) {
+        httpClient.println(HTTP_RESPONSE[httpLinesSent++]);
+      }
+      if (httpLinesSent >= HTTP_RESPONSE_LINES) {
+        Serial.println("HTTP response sent successfully");
+        httpEnter(HTTP_FLUSH_WAIT);
+      }
+      return true;
 
-    delay(100);
-    client.stop();
-    Serial.println("client disconnected");
+    case HTTP_FLUSH_WAIT:
+      if (millis() - httpStateStart >= HTTP_FLUSH_DELAY_MS) {
+        httpClient.flush();
+        httpEnter(HTTP_CLOSE_WAIT);
+      }
+      return true;
+
+    case HTTP_CLOSE_WAIT:
+      if (millis() - httpStateStart >= HTTP_CLOSE_DELAY_MS) {
+        httpClient.stop();
+        Serial.println("client disconnected");
+        httpEnter(HTTP_IDLE);
+        return false;
+      }
+      return true;
   }
+  return false;
 }
 
+// Envía la página completa de una vez (fuera del servidor por pasos)
 inline void sendHttpResponse(WiFiClient client) {
-  // ...existing code from sendHttpResponse...
-  client.println("HTTP/1.1 200 OK");
-  client.println("Content-Type: text/html");
-  client.println("Connection: close");
-  client.println("Cache-Control: no-cache, no-store, must-revalidate");
-  client.println("Pragma: no-cache");
-  client.println("Expires: 0");
-  client.println();
-  client.println("<!DOCTYPE HTML>");
-  client.println("<html>");
-  client.println("<head>");
-  client.println("<meta name=\"viewport\" content=\"width=device-width, initial-scale=1\">");
-  client.println("<meta charset=\"UTF-8\">");
-  client.println("<title>Portenta LED Control</title>");
-  client.println("<style>");
-  client.println("body { font-family: Arial, sans-serif; text-align: center; margin: 20px; background-color: #f5f5f5; }");
-  client.println("h1 { color: #333; margin-bottom: 30px; }");
-  client.println("h2 { margin-top: 30px; color: #555; }");
-  client.println("a { display: inline-block; margin: 10px; padding: 15px 25px; background-color: #4CAF50; color: white; text-decoration: none; border-radius: 5px; font-weight: bold; box-shadow: 0 2px 5px rgba(0,0,0,0.2); }");
-  client.println("a:hover { background-color: #45a049; transform: translateY(-2px); box-shadow: 0 4px 8px rgba(0,0,0,0.2); }");
-  client.println("a:active { transform: translateY(1px); box-shadow: 0 1px 3px rgba(0,0,0,0.2); }");
-  client.println(".red { color: #e74c3c; }");
-  client.println(".green { color: #2ecc71; }");
-  client.println(".blue { color: #3498db; }");
-  client.println(".container { max-width: 600px; margin: 0 auto; background-color: white; padding: 20px; border-radius: 10px; box-shadow: 0 0 10px rgba(0,0,0,0.1); }");
-  client.println(".led-control { margin-bottom: 20px; padding: 15px; border-radius: 8px; background-color: #f9f9f9; }");
-  client.println("</style>");
-  client.println("</head>");
-  client.println("<body>");
-  client.println("<div class=\"container\">");
-  client.println("<h1>Portenta H7 LED Control</h1>");
-  client.println("<div class=\"led-control\">");
-  client.println("<h2><span class=\"red\">RED</span> LED</h2>");
-  client.println("<a href=\"/Hr\">ON</a>");
-  client.println("<a href=\"/Lr\">OFF</a>");
-  client.println("</div>");
-  client.println("<div class=\"led-control\">");
-  client.println("<h2><span class=\"green\">GREEN</span> LED</h2>");
-  client.println("<a href=\"/Hg\">ON</a>");
-  client.println("<a href=\"/Lg\">OFF</a>");
-  client.println("</div>");
-  client.println("<div class=\"led-control\">");
-  client.println("<h2><span class=\"blue\">BLUE</span> LED</h2>");
-  client.println("<a href=\"/Hb\">ON</a>");
-  client.println("<a href=\"/Lb\">OFF</a>");
-  client.println("</div>");
-  client.println("</div>");
-  client.println("</body>");
-  client.println("</html>");
+  for (size_t i = 0; i < HTTP_RESPONSE_LINES; i++) {
+    client.println(HTTP_RESPONSE[i]);
+  }
   Serial.println("HTTP response sent successfully");
 }
 
@@ -4,26 +4,17 @@
 int windowBuffer[WINDOW_SIZE];
 size_t windowIndex = 0;
 bool windowFilled = false;
+size_t windowLength = WINDOW_SIZE;
+
+float kurtosisLow = 4.0f;
+float kurtosisHigh = 12.0f;
 
 // Estados de LED
 LedState ledState = LED_OFF;
 unsigned long greenLedStart = 0;
 
 float calcularCurtosis(const int* data, size_t n) {
-  if (n < 4) return NAN;
-  float mean = 0, m2 = 0, m4 = 0;
-  for (size_t i = 0; i < n; i++) mean += data[i];
-  mean /= n;
-  for (size_t i = 0; i < n; i++) {
-    float d = data[i] - mean;
-    m2 += d * d;
-    m4 += d * d * d * d;
-  }
-  m2 /= n;
-  m4 /= n;
-  if (m2 == 0) return NAN;
-  float kurtosis = m4 / (m2 * m2);
-  return kurtosis;
+  return windowKurtosis(data, n);
 }
 
 void setLed(LedState state) {
@@ -47,9 +38,17 @@ void setLed(LedState state) {
   }
 }
 
+void setWindowLength(size_t length) {
+  if (length < 4) length = 4;
+  if (length > WINDOW_SIZE) length = WINDOW_SIZE;
+  windowLength = length;
+  windowIndex = 0;
+  windowFilled = false;
+}
+
 void addSampleToWindow(int sample) {
   windowBuffer[windowIndex++] = sample;
-  if (windowIndex >= WINDOW_SIZE) {
+  if (windowIndex >= windowLength) {
     windowIndex = 0;
     windowFilled = true;
   }
@@ -57,39 +56,16 @@ void addSampleToWindow(int sample) {
 
 void processWindowAnalysis() {
   if (windowFilled) {
-    float kurt = calcularCurtosis(windowBuffer, WINDOW_SIZE);
-    Serial.println(kurt, 6);
-
-    // Si la curtosis supera 12, prende verde por 1 segundo
-    if (kurt > 12) {
-      setLed(LED_GREEN_);
-      ledState = LED_GREEN_;
-      greenLedStart = millis();
-    } else if (ledState != LED_GREEN_) {
-      if (kurt < 4) {
-        setLed(LED_RED_);
-        ledState = LED_RED_;
-      } else {
-        setLed(LED_YELLOW_);
-        ledState = LED_YELLOW_;
-      }
-    }
+    Serial.println(calcularCurtosis(windowBuffer, windowLength), 6);
   }
 
-  // Apaga el verde después de 1 segundo y vuelve a mostrar el color según la curtosis actual
-  if (ledState == LED_GREEN_ && (millis() - greenLedStart > 1000)) {
-    // Recalcula la curtosis para decidir el color actual
-    float kurt = calcularCurtosis(windowBuffer, WINDOW_SIZE);
-    if (kurt < 4) {
-      setLed(LED_RED_);
-      ledState = LED_RED_;
-    } else if (kurt <= 12) {
-      setLed(LED_YELLOW_);
-      ledState = LED_YELLOW_;
-    } else {
-      // Si sigue siendo >12, vuelve a prender verde y reinicia el timer
-      setLed(LED_GREEN_);
-      greenLedStart = millis();
-    }
+  // Misma lógica que en el replay nativo (window_core.h)
+  uint32_t greenStart = greenLedStart;
+  LedState next = windowLedStep(ledState, windowFilled, windowBuffer, windowLength, millis(),
+                                &greenStart, kurtosisLow, kurtosisHigh);
+  greenLedStart = greenStart;
+  if (next != ledState || windowFilled) {
+    setLed(next);
+    ledState = next;
   }
-}
\ No newline at end of file
+}
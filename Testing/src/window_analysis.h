@@ -2,16 +2,20 @@
 #define WINDOW_ANALYSIS_H
 
 #include <Arduino.h>
+#include "window_core.h"
 
-#define WINDOW_SIZE 50
+#define WINDOW_SIZE 50   // Capacidad máxima de la ventana
 
-// Buffer circular para la ventana de 50 muestras
+// Buffer circular para la ventana de hasta 50 muestras
 extern int windowBuffer[WINDOW_SIZE];
 extern size_t windowIndex;
 extern bool windowFilled;
+extern size_t windowLength;     // Muestras usadas de la ventana (<= WINDOW_SIZE)
+
+// Umbrales de curtosis para los colores del LED
+extern float kurtosisLow;
+extern float kurtosisHigh;
 
-// Estados de LED
-enum LedState { LED_OFF, LED_GREEN_, LED_YELLOW_, LED_RED_ };
 extern LedState ledState;
 extern unsigned long greenLedStart;
 
@@ -21,6 +25,9 @@ float calcularCurtosis(const int* data, size_t n);
 // Función para configurar LED
 void setLed(LedState state);
 
+// Cambia el tamaño de la ventana y la reinicia
+void setWindowLength(size_t length);
+
 // Función para agregar muestra a la ventana
 void addSampleToWindow(int sample);
 
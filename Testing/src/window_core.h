@@ -0,0 +1,75 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+
+/*
+  Lógica de la ventana de curtosis sin E/S
+
+  window_analysis.cpp guarda la ventana y maneja los pines; aquí queda el
+  cálculo y la máquina de estados del LED, con el tiempo como parámetro, para
+  poder repetirlos en el host (tools/replay.cpp).
+
+  Este archivo no depende de Arduino y compila también en el host.
+*/
+
+#define WINDOW_GREEN_HOLD_MS 1000   // Tiempo mínimo en verde tras una curtosis alta
+
+// Estados de LED
+enum LedState { LED_OFF, LED_GREEN_, LED_YELLOW_, LED_RED_ };
+
+inline const char* ledStateName(LedState state) {
+  switch (state) {
+    case LED_GREEN_:  return "green";
+    case LED_YELLOW_: return "yellow";
+    case LED_RED_:    return "red";
+    default:          return "off";
+  }
+}
+
+inline float windowKurtosis(const int* data, size_t n) {
+  if (n < 4) return NAN;
+  float mean = 0, m2 = 0, m4 = 0;
+  for (size_t i = 0; i < n; i++) mean += data[i];
+  mean /= n;
+  for (size_t i = 0; i < n; i++) {
+    float d = data[i] - mean;
+    m2 += d * d;
+    m4 += d * d * d * d;
+  }
+  m2 /= n;
+  m4 /= n;
+  if (m2 == 0) return NAN;
+  float kurtosis = m4 / (m2 * m2);
+  return kurtosis;
+}
+
+// Próximo estado del LED. Con la ventana llena: verde si la curtosis supera
+// 'high' (y se reinicia el tiempo en verde); si no estaba en verde, rojo bajo
+// 'low' y amarillo entre ambos. El verde se mantiene WINDOW_GREEN_HOLD_MS y
+// luego vuelve al color que corresponda a la curtosis actual.
+inline LedState windowLedStep(LedState state, bool windowFull, const int* data, size_t n,
+                              uint32_t nowMs, uint32_t* greenStart, float low, float high) {
+  if (windowFull) {
+    float kurt = windowKurtosis(data, n);
+    if (kurt > high) {
+      state = LED_GREEN_;
+      *greenStart = nowMs;
+    } else if (state != LED_GREEN_) {
+      state = kurt < low ? LED_RED_ : LED_YELLOW_;
+    }
+  }
+
+  if (state == LED_GREEN_ && (nowMs - *greenStart > WINDOW_GREEN_HOLD_MS)) {
+    float kurt = windowKurtosis(data, n);
+    if (kurt < low) {
+      state = LED_RED_;
+    } else if (kurt <= high) {
+      state = LED_YELLOW_;
+    } else {
+      // Si sigue alta, sigue en verde y se reinicia el tiempo
+      *greenStart = nowMs;
+    }
+  }
+  return state;
+}
@@ -0,0 +1,105 @@
+#!/usr/bin/env python3
+"""
+Sincronización de reloj host <-> Portenta H7
+
+El host envía "SYNC <seq>" y el dispositivo responde "#SYNC <seq> <micros>".
+Con cada intercambio se obtiene un par (tiempo del dispositivo, tiempo del host
+en el punto medio del viaje de ida y vuelta). Sobre los intercambios con menor
+RTT se ajusta una recta host = offset + deriva * dispositivo por mínimos
+cuadrados, lo que permite mapear el timestamp de cada muestra al reloj del host.
+
+Solo los intercambios extienden el contador de 32 bits (en orden de llegada).
+Las muestras se extienden contra el último intercambio: se toma la vuelta que
+las deja más cerca de él, así un lote de muestras viejas o el arranque antes del
+primer SYNC no alteran el estado del desenrollado.
+"""
+
+from collections import deque
+
+import numpy as np
+
+MICROS_WRAP = 1 << 32
+
+
+class MicrosUnwrapper:
+    """Extiende el contador micros() de 32 bits (desborda cada ~71.6 min)"""
+
+    def __init__(self):
+        self.last = None
+        self.offset = 0
+
+    def unwrap(self, device_us):
+        if self.last is not None and device_us < self.last and \
+                self.last - device_us > MICROS_WRAP // 2:
+            self.offset += MICROS_WRAP
+        self.last = device_us
+        return device_us + self.offset
+
+
+class ClockSync:
+    """Estimador lineal de offset y deriva entre el reloj del dispositivo y el del host"""
+
+    def __init__(self, history=64, rtt_quantile=0.5):
+        self.exchanges = deque(maxlen=history)  # (device_s, host_s, rtt_s)
+        self.rtt_quantile = rtt_quantile
+        self.unwrapper = MicrosUnwrapper()
+        self.last_device_us = None   # Último intercambio, ya extendido
+        self.offset = None   # segundos de host en device_s = 0
+        self.drift = 1.0     # segundos de host por segundo de dispositivo
+
+    def add_exchange(self, host_send, device_us, host_recv):
+        """Registrar un ping: tiempos del host en segundos, dispositivo en micros"""
+        rtt = host_recv - host_send
+        if rtt < 0:
+            return
+        self.last_device_us = self.unwrapper.unwrap(device_us)
+        device_s = self.last_device_us * 1e-6
+        self.exchanges.append((device_s, (host_send + host_recv) * 0.5, rtt))
+        self._fit()
+
+    def _fit(self):
+        # Descartar los intercambios con RTT alto (afectados por buffering)
+        rtts = sorted(e[2] for e in self.exchanges)
+        limit = rtts[int((len(rtts) - 1) * self.rtt_quantile)]
+        points = [e for e in self.exchanges if e[2] <= limit]
+
+        if len(points) == 1:
+            device_s, host_s, _ = points[0]
+            self.offset = host_s - self.drift * device_s
+            return
+
+        # Mínimos cuadrados centrados para no perder precisión con valores grandes
+        n = len(points)
+        mean_d = sum(p[0] for p in points) / n
+        mean_h = sum(p[1] for p in points) / n
+        sxx = sum((p[0] - mean_d) ** 2 for p in points)
+        sxy = sum((p[0] - mean_d) * (p[1] - mean_h) for p in points)
+        if sxx > 0:
+            self.drift = sxy / sxx
+        self.offset = mean_h - self.drift * mean_d
+
+    @property
+    def synced(self):
+        return self.offset is not None
+
+    def _near_exchange(self, device_us):
+        # Vuelta de 2^32 que deja la muestra a menos de media vuelta del último intercambio
+        turns = (self.last_device_us - device_us + MICROS_WRAP // 2) // MICROS_WRAP
+        return device_us + turns * MICROS_WRAP
+
+    def to_host(self, device_us):
+        """Convertir un timestamp del dispositivo (micros) a tiempo del host (s)"""
+        if self.offset is None:
+            return None
+        return self.offset + self.drift * self._near_exchange(int(device_us)) * 1e-6
+
+    def to_host_array(self, device_us):
+        """to_host() de un arreglo de timestamps; None si todavía no hay sincronización"""
+        if self.offset is None:
+            return None
+        device_us = np.asarray(device_us, dtype=np.int64)
+        return self.offset + self.drift * self._near_exchange(device_us) * 1e-6
+
+    @property
+    def drift_ppm(self):
+        return (self.drift - 1.0) * 1e6
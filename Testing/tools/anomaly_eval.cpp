@@ -0,0 +1,172 @@
+/*
+  Evaluación offline del detector de anomalías (build nativo)
+
+  Compilar desde Testing/:
+    g++ -O2 -std=gnu++14 -Isrc tools/anomaly_eval.cpp -o anomaly_eval
+
+  Uso:
+    ./anomaly_eval                      traza sintética con eventos inyectados
+    ./anomaly_eval --capture < cap.txt  líneas "<micros> <mbar>" del puerto serie
+                                        (ignora las líneas que empiezan con '#')
+
+  Imprime una línea por cada cambio de bandera, con el mismo formato que el
+  firmware ("#A <micros> <tipo> on|off <puntaje>") más algunos puntajes para
+  ajustar umbrales. La traza sintética tiene: oclusión 30-40 s, fuga 60-70 s,
+  deriva 80-120 s (queda desplazada), pulsación de 8 Hz 140-150 s y ruido
+  170-180 s. Con ella se comprueba:
+  - cada evento enciende su bandera dentro de su latencia máxima
+  - las banderas de eventos pasajeros se apagan a lo sumo EVAL_CLEAR_S
+    después de terminado el evento
+  - las banderas que se encienden fuera de un evento de su tipo (falsas
+    alarmas) no pasan de EVAL_MAX_FALSE_ALARMS
+
+  Devuelve 1 si falla alguna comprobación.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "anomaly_detector.h"
+
+#define EVAL_PERIOD_US          500
+#define EVAL_SECONDS            200
+#define EVAL_CLEAR_S            10.0f   // Tiempo para apagar la bandera al terminar el evento
+#define EVAL_MAX_FALSE_ALARMS   0
+
+static AnomalyDetector detector;
+
+// Eventos de la traza sintética
+struct InjectedEvent {
+    uint8_t flag;
+    float startS;
+    float endS;
+    float maxLatencyS;     // Desde startS hasta que se enciende la bandera
+    bool persists;         // La señal no vuelve a la línea (la bandera puede seguir)
+    float onS;             // Encendido de la bandera (-1 si nunca)
+    float offS;            // Apagado posterior al encendido (-1 si nunca)
+};
+
+static InjectedEvent events[] = {
+    {ANOMALY_OCCLUSION, 30.0f,  40.0f,  0.5f,  false, -1.0f, -1.0f},
+    {ANOMALY_LEAK,      60.0f,  70.0f,  0.5f,  false, -1.0f, -1.0f},
+    {ANOMALY_DRIFT,     80.0f,  120.0f, 40.0f, true,  -1.0f, -1.0f},
+    {ANOMALY_PULSATION, 140.0f, 150.0f, 2.0f,  false, -1.0f, -1.0f},
+    {ANOMALY_NOISE,     170.0f, 180.0f, 0.5f,  false, -1.0f, -1.0f},
+};
+
+static int failures = 0;
+static int falseAlarms = 0;
+
+static void check(bool ok, const char* what) {
+    if (!ok) {
+        printf("  FALLA: %s\n", what);
+        failures++;
+    }
+}
+
+// Asigna cada cambio de bandera de la traza sintética a su evento
+static void score(uint32_t timestampUs, uint8_t changed) {
+    float t = timestampUs / 1e6f;
+    for (uint8_t flag = 1; flag; flag <<= 1) {
+        if (!(changed & flag)) continue;
+        bool on = detector.activeFlags() & flag;
+        InjectedEvent* match = nullptr;
+        for (InjectedEvent& e : events) {
+            float until = e.persists ? (float)EVAL_SECONDS : e.endS + EVAL_CLEAR_S;
+            if (e.flag == flag && t >= e.startS && t < until) match = &e;
+        }
+        if (!match) {
+            if (on) falseAlarms++;
+            continue;
+        }
+        if (on && match->onS < 0.0f) match->onS = t;
+        if (!on && match->onS >= 0.0f) match->offS = t;
+    }
+}
+
+static void report(uint32_t timestampUs, uint8_t changed) {
+    const AnomalyScores& s = detector.currentScores();
+    for (uint8_t flag = 1; flag; flag <<= 1) {
+        if (!(changed & flag)) continue;
+        printf("#A %u %s %s %.2f   (t=%.3f s z=%.2f drift=%.2f noise=%.2f)\n",
+               timestampUs, anomalyFlagName(flag),
+               (detector.activeFlags() & flag) ? "on" : "off",
+               anomalyFlagScore(s, flag), timestampUs / 1e6, s.levelZ, s.driftSigma, s.noiseRatio);
+    }
+}
+
+// Ruido gaussiano (Box-Muller) con semilla fija para que la traza sea reproducible
+static float gaussian() {
+    float u1 = (rand() + 1.0f) / (RAND_MAX + 2.0f);
+    float u2 = (rand() + 1.0f) / (RAND_MAX + 2.0f);
+    return sqrtf(-2.0f * logf(u1)) * cosf(2.0f * (float)M_PI * u2);
+}
+
+// Línea a -200 mbar con ripple de bomba de 2 Hz y eventos en tiempos conocidos
+static float syntheticSample(float t) {
+    float value = -200.0f + 2.0f * sinf(2.0f * (float)M_PI * 2.0f * t);
+    float noise = 0.5f;
+
+    if (t >= 30.0f && t < 40.0f) value -= 40.0f;                      // oclusión
+    if (t >= 60.0f && t < 70.0f) value += 30.0f;                      // fuga
+    if (t >= 80.0f && t < 120.0f) value += (t - 80.0f) * 0.25f;       // deriva lenta
+    if (t >= 120.0f) value += 10.0f;                                  // queda desplazada
+    if (t >= 140.0f && t < 150.0f) value += 6.0f * sinf(2.0f * (float)M_PI * 8.0f * t);  // pulsación
+    if (t >= 170.0f && t < 180.0f) noise *= 4.0f;                     // ruido
+
+    return value + noise * gaussian();
+}
+
+static int runSynthetic() {
+    srand(1);
+    const uint32_t samples = EVAL_SECONDS * (1000000u / EVAL_PERIOD_US);
+    for (uint32_t i = 0; i < samples; i++) {
+        uint32_t timestampUs = i * EVAL_PERIOD_US;
+        uint8_t changed = detector.update(syntheticSample(timestampUs / 1e6f));
+        if (changed) {
+            report(timestampUs, changed);
+            score(timestampUs, changed);
+        }
+    }
+
+    char what[96];
+    for (const InjectedEvent& e : events) {
+        const char* name = anomalyFlagName(e.flag);
+        snprintf(what, sizeof(what), "%s en %.0f s no detectada", name, e.startS);
+        check(e.onS >= 0.0f, what);
+        if (e.onS < 0.0f) continue;
+        printf("%-10s latencia %.3f s (máximo %.1f s)\n", name, e.onS - e.startS, e.maxLatencyS);
+        snprintf(what, sizeof(what), "%s detectada %.3f s después del inicio", name, e.onS - e.startS);
+        check(e.onS - e.startS <= e.maxLatencyS, what);
+        if (!e.persists) {
+            snprintf(what, sizeof(what), "%s no se apagó al terminar el evento", name);
+            check(e.offS >= e.endS, what);
+        }
+    }
+    printf("falsas alarmas: %d (máximo %d)\n", falseAlarms, EVAL_MAX_FALSE_ALARMS);
+    check(falseAlarms <= EVAL_MAX_FALSE_ALARMS, "demasiadas falsas alarmas");
+    printf("%s\n", failures ? "FALLA" : "OK");
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    detector.setPeriodUs(EVAL_PERIOD_US);
+
+    if (argc < 2 || strcmp(argv[1], "--synthetic") == 0) return runSynthetic();
+    if (strcmp(argv[1], "--capture") != 0) {
+        fprintf(stderr, "opción desconocida: %s\n", argv[1]);
+        return 2;
+    }
+
+    char line[64];
+    while (fgets(line, sizeof(line), stdin)) {
+        if (line[0] == '#') continue;
+        unsigned long timestampUs;
+        float value;
+        if (sscanf(line, "%lu %f", &timestampUs, &value) != 2) continue;
+        uint8_t changed = detector.update(value);
+        if (changed) report((uint32_t)timestampUs, changed);
+    }
+    return 0;
+}
@@ -0,0 +1,327 @@
+/*
+  Arranque rápido: fases, caché de descubrimiento y banner (build nativo)
+
+  Compilar desde Testing/:
+    g++ -O2 -std=gnu++14 -Isrc tools/boot_check.cpp -o boot_check
+
+  1) BootTimeline: solo cuenta la primera marca de cada fase y el presupuesto
+     de BOOT_ACQ_BUDGET_US se cumple hasta el límite inclusive.
+  2) Caché de descubrimiento: con basura (después de un corte de energía) no
+     valida y se limpia; los mismos bytes después de un reset en caliente
+     validan con los dispositivos de la pasada anterior; un byte cambiado lo
+     invalida. DiscoveryScan prueba exactamente 0x08..0x77 y solo informa un
+     cambio cuando la pasada encuentra otra cosa.
+  3) setup() con ENABLE_FAST_BOOT en tiempo simulado (costos estimados de cada
+     fase) y después 1 s de loop() con las tareas y presupuestos de main.cpp:
+     - la adquisición arranca antes de BOOT_ACQ_BUDGET_US
+     - el escaneo de fondo (una dirección por milisegundo) termina sin que la
+       adquisición pierda ticks ni plazos y ninguna porción se pase
+     - la conexión del host se detecta dentro de TASK_ATTACH_PERIOD_US y el
+       banner sale de a grupos dentro de TASK_ATTACH_SLICE_US
+     El arranque anterior (escaneo con delay(2) por dirección antes de
+     arrancar el timer) se informa para comparar y tiene que dar "late".
+
+  Devuelve 1 si falla alguna comprobación.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "boot_timeline.h"
+#include "i2c_discovery.h"
+#include "task_scheduler.h"
+
+// Mismos periodos y presupuestos que main.cpp
+#define SIM_PERIOD_US             500
+#define TASK_ACQUIRE_SLICE_US     150
+#define TASK_DISCOVERY_PERIOD_US  1000
+#define TASK_DISCOVERY_SLICE_US   40
+#define TASK_LED_PERIOD_US        10000
+#define TASK_LED_SLICE_US         20
+#define TASK_REPORT_PERIOD_US     100000
+#define TASK_REPORT_SLICE_US      300
+#define TASK_ATTACH_PERIOD_US     50000
+#define TASK_ATTACH_SLICE_US      300
+
+#define SIM_LOOP_US               1
+#define SIM_RUN_US                1000000
+#define SIM_HOST_AT_US            37000      // El host abre el puerto durante el escaneo
+#define SIM_LINE_US               30         // Un renglón por el CDC USB con lugar en el buffer
+#define SIM_MEMORY_LINES          3          // Renglones "#MEM" de memoryMapReport()
+#define SIM_POOL_LINES            6          // Renglones de poolReport()
+
+static const uint8_t busDevices[] = {0x28, 0x48, 0x76};   // SM4291, ELVH, ABPLLN
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    if (!ok) {
+        printf("  FALLA: %s\n", what);
+        failures++;
+    }
+}
+
+static uint32_t simNow = 0;
+static uint32_t lcgState = 2024;
+
+static uint32_t simClock() { return simNow; }
+
+static uint32_t uniform(uint32_t low, uint32_t high) {
+    lcgState = lcgState * 1664525u + 1013904223u;
+    return low + (lcgState >> 8) % (high - low + 1);
+}
+
+static bool busAck(uint8_t address) {
+    for (uint8_t device : busDevices) {
+        if (device == address) return true;
+    }
+    return false;
+}
+
+// ---- 1) BootTimeline ----
+
+static void checkTimeline() {
+    printf("1) BootTimeline\n");
+    BootTimeline timeline;
+    timeline.reset();
+    check(!timeline.withinBudget(), "sin la fase acq no puede estar en presupuesto");
+    timeline.mark(BOOT_SETUP, 1200);
+    timeline.mark(BOOT_SETUP, 5000);
+    check(timeline.has(BOOT_SETUP) && timeline.us[BOOT_SETUP] == 1200, "la segunda marca pisó la primera");
+    check(!timeline.has(BOOT_HOST), "fase sin marcar");
+    timeline.mark(BOOT_ACQ_START, BOOT_ACQ_BUDGET_US);
+    check(timeline.withinBudget(), "acq justo en el presupuesto");
+    timeline.reset();
+    timeline.mark(BOOT_ACQ_START, BOOT_ACQ_BUDGET_US + 1);
+    check(!timeline.withinBudget(), "acq pasado el presupuesto");
+}
+
+// ---- 2) Caché de descubrimiento ----
+
+static uint32_t runScan(DiscoveryScan& scan, DiscoveryCache& cache, bool* changed) {
+    uint32_t probes = 0;
+    bool inOrder = true;
+    scan.restart();
+    *changed = false;
+    while (!scan.done()) {
+        uint8_t address = scan.next();
+        inOrder = inOrder && address == DISCOVERY_FIRST_ADDR + probes;
+        *changed = scan.record(busAck(address), cache) || *changed;
+        probes++;
+    }
+    check(inOrder, "el escaneo salteó o repitió direcciones");
+    return probes;
+}
+
+static void checkCache() {
+    printf("2) Caché de descubrimiento\n");
+    // El caché tal como queda en SRAM4 (discoveryCacheRam() en el host)
+    DiscoveryCache& ram = discoveryCacheRam();
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(&ram);
+
+    // Encendido: basura
+    for (size_t i = 0; i < sizeof(DiscoveryCache); i++) bytes[i] = (uint8_t)uniform(0, 255);
+    check(!discoveryBoot(ram), "la basura del encendido validó");
+    check(discoveryValid(ram) && ram.boots == 0, "el caché no quedó limpio después del encendido");
+    for (uint8_t a = DISCOVERY_FIRST_ADDR; a <= DISCOVERY_LAST_ADDR; a++) {
+        if (discoveryHas(ram, a)) {
+            check(false, "caché limpio con dispositivos");
+            break;
+        }
+    }
+
+    DiscoveryScan scan;
+    bool changed;
+    uint32_t probes = runScan(scan, ram, &changed);
+    check(probes == DISCOVERY_LAST_ADDR - DISCOVERY_FIRST_ADDR + 1, "cantidad de direcciones probadas");
+    check(changed, "la primera pasada no informó los dispositivos");
+    for (uint8_t a = DISCOVERY_FIRST_ADDR; a <= DISCOVERY_LAST_ADDR; a++) {
+        if (discoveryHas(ram, a) != busAck(a)) {
+            check(false, "el caché no coincide con el bus");
+            break;
+        }
+    }
+
+    // Reset en caliente: los mismos bytes siguen ahí
+    uint8_t saved[sizeof(DiscoveryCache)];
+    memcpy(saved, bytes, sizeof(saved));
+    check(discoveryBoot(ram) && ram.boots == 1, "el caché no sobrevivió al reset en caliente");
+    check(discoveryHas(ram, 0x28) && discoveryHas(ram, 0x48) && discoveryHas(ram, 0x76),
+          "dispositivos perdidos en el reset");
+    runScan(scan, ram, &changed);
+    check(!changed, "una pasada igual informó un cambio");
+
+    // Un byte distinto invalida el caché
+    memcpy(bytes, saved, sizeof(saved));
+    bytes[offsetof(DiscoveryCache, present) + 1] ^= 0x10;
+    check(!discoveryBoot(ram), "un byte cambiado validó");
+    printf("   %u direcciones, caché de %zu bytes\n", (unsigned)probes, sizeof(DiscoveryCache));
+}
+
+// ---- 3) Arranque y primer segundo de loop() ----
+
+struct Sim {
+    uint32_t nextTickUs;
+    bool tickFlag;
+    uint32_t tickStampUs;
+    uint32_t ticks;
+    uint32_t seen;
+    uint32_t lost;
+    bool serialOpen;
+    bool hostAttached;
+    uint8_t bannerStep;
+    uint32_t bannerStartUs;
+    uint32_t bannerEndUs;
+    uint32_t hostSeenUs;
+    uint32_t scanDoneUs;
+    DiscoveryScan scan;
+    BootTimeline timeline;
+};
+
+static Sim sim;
+
+// Grupos del banner como en printBannerStep(): renglones de cada uno
+enum { BANNER_TITLE, BANNER_MEMORY, BANNER_POOLS, BANNER_STATUS, BANNER_PHASES,
+       BANNER_BUDGET = BANNER_PHASES + BOOT_PHASES, BANNER_I2C, BANNER_DONE };
+
+static uint32_t bannerLines(uint8_t step) {
+    switch (step) {
+        case BANNER_TITLE:  return 2;
+        case BANNER_MEMORY: return SIM_MEMORY_LINES;
+        case BANNER_POOLS:  return SIM_POOL_LINES;
+        case BANNER_STATUS: return 3;
+        default:            return 1;
+    }
+}
+
+static TaskResult acqTask(void*) { simNow += uniform(60, 120); return TASK_DONE; }
+static TaskResult ledTask(void*) { simNow += uniform(5, 15); return TASK_DONE; }
+static TaskResult reportTask(void*) { simNow += uniform(50, 280); return TASK_DONE; }
+
+static TaskResult discoveryTask(void*) {
+    if (sim.scan.done()) return TASK_DONE;
+    simNow += uniform(25, 35);
+    sim.scan.record(busAck(sim.scan.next()), discoveryCacheRam());
+    if (sim.scan.done()) sim.scanDoneUs = simNow;
+    return TASK_DONE;
+}
+
+static TaskResult attachTask(void*) {
+    if (sim.bannerStep < BANNER_DONE) {
+        simNow += bannerLines(sim.bannerStep) * SIM_LINE_US;
+        sim.bannerStep++;
+        if (sim.bannerStep < BANNER_DONE) return TASK_MORE;
+        sim.bannerEndUs = simNow;
+    }
+    simNow += 2;
+    if (sim.serialOpen && !sim.hostAttached) {
+        sim.timeline.mark(BOOT_HOST, simNow);
+        sim.hostSeenUs = simNow;
+        sim.bannerStartUs = simNow;
+        sim.bannerStep = BANNER_TITLE;
+        sim.hostAttached = true;
+        return TASK_MORE;
+    }
+    sim.hostAttached = sim.serialOpen;
+    return TASK_DONE;
+}
+
+// setup(): costos estimados de cada fase. Devuelve el instante de BOOT_ACQ_START.
+static uint32_t simulateSetup(bool legacy, BootTimeline& timeline) {
+    simNow = 0;
+    timeline.reset();
+    simNow += 2000;                              // Runtime del core hasta setup()
+    timeline.mark(BOOT_SETUP, simNow);
+    simNow += 1000;                              // Serial.begin()
+    timeline.mark(BOOT_LED, simNow += 50);
+    timeline.mark(BOOT_M4, simNow += 500);
+    simNow += 1500;                              // SM_4000_begin(): Wire a 400 kHz y configuración
+    if (legacy) {
+        simNow += 126 * (2000 + 30);             // scanI2CDevices(): delay(2) por dirección
+    } else {
+        discoveryBoot(discoveryCacheRam());
+        simNow += 5;
+    }
+    timeline.mark(BOOT_SENSORS, simNow);
+    simNow += 200;                               // schedulerBegin() y el timer
+    timeline.mark(BOOT_ACQ_START, simNow);
+    return simNow;
+}
+
+static void checkBoot() {
+    printf("3) Arranque con ENABLE_FAST_BOOT y 1 s de loop()\n");
+    BootTimeline legacy;
+    uint32_t legacyUs = simulateSetup(true, legacy);
+
+    sim = Sim();
+    sim.bannerStep = BANNER_DONE;
+    uint32_t acqStartUs = simulateSetup(false, sim.timeline);
+    check(sim.timeline.withinBudget(), "la adquisición no arranca dentro del presupuesto");
+    printf("   adquisición a %u us (presupuesto %u us); arranque anterior %u us: %s\n", (unsigned)acqStartUs,
+           (unsigned)BOOT_ACQ_BUDGET_US, (unsigned)legacyUs, legacy.withinBudget() ? "ok" : "late");
+    check(!legacy.withinBudget(), "el arranque anterior tendría que pasarse del presupuesto");
+
+    TaskScheduler scheduler(simClock);
+    int taskAcq = scheduler.add({"acq", acqTask, nullptr, SIM_PERIOD_US, TASK_ACQUIRE_SLICE_US, 0, true, 0});
+    scheduler.add({"i2c", discoveryTask, nullptr, TASK_DISCOVERY_PERIOD_US, TASK_DISCOVERY_SLICE_US, 0, false, 0});
+    scheduler.add({"led", ledTask, nullptr, TASK_LED_PERIOD_US, TASK_LED_SLICE_US, 0, false, 0});
+    scheduler.add({"report", reportTask, nullptr, TASK_REPORT_PERIOD_US, TASK_REPORT_SLICE_US, 0, false, 0});
+    int taskAttach = scheduler.add({"attach", attachTask, nullptr, TASK_ATTACH_PERIOD_US, TASK_ATTACH_SLICE_US,
+                                    0, false, 0});
+
+    sim.nextTickUs = acqStartUs + SIM_PERIOD_US;
+    bool firstSample = false;
+    while (simNow < acqStartUs + SIM_RUN_US) {
+        while ((int32_t)(simNow - sim.nextTickUs) >= 0) {
+            if (sim.tickFlag) sim.lost++;
+            sim.tickFlag = true;
+            sim.tickStampUs = sim.nextTickUs;
+            sim.ticks++;
+            sim.nextTickUs += SIM_PERIOD_US;
+        }
+        if (!sim.serialOpen && simNow >= SIM_HOST_AT_US) sim.serialOpen = true;
+        if (sim.tickFlag) {
+            sim.tickFlag = false;
+            scheduler.release(taskAcq, sim.tickStampUs, sim.ticks - sim.seen - 1);
+            sim.seen = sim.ticks;
+        }
+        scheduler.runOnce();
+        if (!firstSample && scheduler.stats(taskAcq).jobs > 0) {
+            sim.timeline.mark(BOOT_FIRST_SAMPLE, simNow);
+            firstSample = true;
+        }
+        simNow += SIM_LOOP_US;
+    }
+
+    uint32_t overruns = 0;
+    for (uint8_t id = 0; id < scheduler.taskCount(); id++) overruns += scheduler.stats(id).overruns;
+    const TaskStats& acq = scheduler.stats(taskAcq);
+    const TaskStats& attach = scheduler.stats(taskAttach);
+    uint32_t scanUs = sim.scanDoneUs - acqStartUs;
+    printf("   primera muestra %u us, escaneo completo %.1f ms después de acq\n",
+           (unsigned)sim.timeline.us[BOOT_FIRST_SAMPLE], scanUs / 1000.0);
+    printf("   host abierto a %u us, detectado a %u us; banner en %u us (peor porción %u us)\n",
+           (unsigned)SIM_HOST_AT_US, (unsigned)sim.hostSeenUs, (unsigned)(sim.bannerEndUs - sim.bannerStartUs),
+           (unsigned)attach.maxSliceUs);
+    printf("   ticks %u, perdidos %u, plazos %u, excesos %u\n", (unsigned)sim.ticks, (unsigned)sim.lost,
+           (unsigned)acq.misses, (unsigned)overruns);
+
+    check(sim.timeline.us[BOOT_FIRST_SAMPLE] <= acqStartUs + 2 * SIM_PERIOD_US, "primera muestra tardía");
+    check(sim.scan.done() && scanUs <= (DISCOVERY_LAST_ADDR - DISCOVERY_FIRST_ADDR + 1) * TASK_DISCOVERY_PERIOD_US +
+                                           2 * TASK_DISCOVERY_PERIOD_US,
+          "el escaneo de fondo no terminó a una dirección por milisegundo");
+    check(sim.lost == 0 && acq.misses == 0, "la adquisición perdió ticks o plazos durante el escaneo y el banner");
+    check(overruns == 0, "alguna porción excedió su presupuesto");
+    check(sim.hostSeenUs >= SIM_HOST_AT_US && sim.hostSeenUs - SIM_HOST_AT_US <= TASK_ATTACH_PERIOD_US + 1000,
+          "el host no se detectó dentro de un periodo de attach");
+    check(sim.bannerEndUs > sim.bannerStartUs && sim.bannerEndUs - sim.bannerStartUs < TASK_ATTACH_PERIOD_US,
+          "el banner no terminó antes de la próxima consulta");
+}
+
+int main() {
+    checkTimeline();
+    checkCache();
+    checkBoot();
+    printf("%s\n", failures ? "FALLA" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,308 @@
+#!/usr/bin/env python3
+"""
+Prueba del protocolo de comandos contra el dispositivo nativo (tools/cmd_device.cpp)
+
+Ejecutar desde Testing/ (después de compilar cmd_device, ver ese archivo):
+    python3 tools/cmd_check.py [./cmd_device]
+
+Corre PortentaLink (portenta_cmd.py) contra el binario nativo, que usa el mismo
+parser y la misma validación que el firmware, por un pipe en lugar del puerto:
+- cada comando SET se refleja en CMD_GET_CONFIG y se aplica entre ticks
+  (config_changes en CMD_GET_STATS)
+- valores fuera de rango, longitudes incorrectas y comandos desconocidos
+  devuelven su error y no tocan la configuración; el periodo mínimo es el del
+  build (con la lectura I2C en el M7 en local, sin ella con --acq-on-m4)
+- CMD_SET_SENSORS con sensores que el build local no lee devuelve "no
+  disponible"; con --acq-on-m4 se aceptan
+- con --acq-on-m4, periodo y sensores se responden con el ack del M4: si el
+  M4 rechaza la máscara (--m4-sensors) el error es "fuera de rango" y si no
+  contesta (--m4-mute) "sin respuesta del M4"; en los dos casos la
+  configuración vuelve a la anterior
+- CMD_SET_WINDOW/CMD_SET_KURTOSIS devuelven "no disponible": la ventana de
+  curtosis no está conectada al procesamiento; con --window se aceptan y
+  validan su rango
+- CMD_SET_SETPOINT/CMD_SET_PID devuelven "no disponible" sin ENABLE_CONTROL
+  (el build por defecto); con --control se aceptan y validan su rango
+- stop/start cortan y retoman los renglones de muestra
+- todo lo recibido (respuestas binarias mezcladas con el texto) se pasa por
+  StreamDecoder ("cmd_device --decode"): tiene que contar las mismas muestras
+  que renglones de muestra hubo, saltear todas las tramas y no dar renglones
+  basura
+- con --flash-log, download_log() baja por tramas CMD_LOG_DATA (mezcladas con
+  el stream y con borrados en curso) las mismas muestras que salieron por
+  texto, y el flujo sigue siendo decodificable
+"""
+
+import os
+import select
+import struct
+import subprocess
+import sys
+import time
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
+import portenta_cmd as pc  # noqa: E402
+
+
+class PipeTransport:
+    """Hace las veces del puerto serie sobre stdin/stdout de un proceso; guarda
+    todo lo recibido"""
+
+    def __init__(self, args):
+        self.process = subprocess.Popen(args, stdin=subprocess.PIPE, stdout=subprocess.PIPE, bufsize=0)
+        self.received = bytearray()
+
+    @property
+    def in_waiting(self):
+        ready, _, _ = select.select([self.process.stdout], [], [], 0)
+        return 4096 if ready else 0
+
+    def read(self, n):
+        ready, _, _ = select.select([self.process.stdout], [], [], 0.05)
+        if not ready:
+            return b""
+        data = os.read(self.process.stdout.fileno(), max(n, 1))
+        self.received.extend(data)
+        return data
+
+    def write(self, data):
+        self.process.stdin.write(data)
+        self.process.stdin.flush()
+
+    def drain(self, seconds):
+        """Lee (y guarda) lo que llegue durante 'seconds'; devuelve los bytes"""
+        data = bytearray()
+        deadline = time.time() + seconds
+        while time.time() < deadline:
+            data.extend(self.read(4096))
+        return bytes(data)
+
+    def close(self):
+        self.process.stdin.close()
+        self.process.wait(timeout=5)
+
+
+failures = []
+
+
+def check(ok, what):
+    if not ok:
+        failures.append(what)
+        print("  FALLA: " + what)
+
+
+def expect_error(call, name, what):
+    try:
+        call()
+    except pc.CommandError as e:
+        check(str(e) == name, f"{what}: error '{e}', se esperaba '{name}'")
+        return
+    check(False, f"{what}: aceptado")
+
+
+def sample_lines(data):
+    """Renglones de muestra completos en un flujo mezclado"""
+    _, lines = pc.FrameReader().feed(data)
+    return [line for line in lines if line and not line.startswith("#")]
+
+
+def run_local(device):
+    print("1) Build local")
+    transport = PipeTransport([device])
+    link = pc.PortentaLink(None, transport=transport)
+    responses = 0
+
+    link.ping()
+    responses += 1
+    config = link.get_config()
+    responses += 1
+    check(config["period_us"] == 500 and config["sensor_mask"] == 1 and config["window_length"] == 50 and
+          config["streaming"] == 1, f"configuración por defecto {config}")
+
+    before = link.get_stats()["config_changes"]
+    responses += 1
+    link.set_period(1000)
+    link.set_thresholds(-40.0, -180.0)
+    link.set_filter(0.25)
+    link.set_sensors(["sm4291"])
+    responses += 4
+    config = link.get_config()
+    responses += 1
+    check(config["period_us"] == 1000, "periodo")
+    check(abs(config["suction_low_max"] + 40.0) < 1e-6 and abs(config["suction_medium_max"] + 180.0) < 1e-6,
+          "umbrales")
+    check(abs(config["filter_alpha"] - 0.25) < 1e-6, "filtro")
+    transport.drain(0.05)
+    check(link.get_stats()["config_changes"] > before, "los cambios no se aplicaron entre ticks")
+    responses += 1
+
+    # Errores: ninguno cambia la configuración
+    snapshot = link.get_config()
+    responses += 1
+    expect_error(lambda: link.set_period(50), "fuera de rango", "periodo 50 us")
+    # Tick local: 90 us más la lectura I2C de 141 us al 80 %
+    expect_error(lambda: link.set_period(288), "fuera de rango", "periodo por debajo del mínimo local")
+    expect_error(lambda: link.set_window(20), "no disponible en este firmware", "ventana sin análisis conectado")
+    expect_error(lambda: link.set_thresholds(-200.0, -40.0), "fuera de rango", "umbrales invertidos")
+    expect_error(lambda: link.set_filter(0.0), "fuera de rango", "alfa 0")
+    expect_error(lambda: link.set_kurtosis(3.0, 9.0), "no disponible en este firmware",
+                 "curtosis sin análisis conectado")
+    expect_error(lambda: link.set_setpoint(-200.0), "no disponible en este firmware", "consigna sin ENABLE_CONTROL")
+    expect_error(lambda: link.set_pid(0.05, 0.5, 0.001, 0.002), "no disponible en este firmware",
+                 "ganancias sin ENABLE_CONTROL")
+    expect_error(lambda: link.set_sensors(["elvh"]), "no disponible en este firmware", "ELVH en el build local")
+    expect_error(lambda: link.set_sensors(["sm4291_analog"]), "no disponible en este firmware",
+                 "apagar el SM4291 por I2C")
+    expect_error(lambda: link.request(pc.CMD_SET_PERIOD, b"\x01\x02"), "longitud incorrecta", "periodo de 2 bytes")
+    expect_error(lambda: link.request(0x7F), "comando desconocido", "comando 0x7F")
+    expect_error(lambda: link.log_info(), "comando desconocido", "log sin ENABLE_FLASH_LOG")
+    responses += 13
+    check(link.get_config() == snapshot, "un comando rechazado cambió la configuración")
+    responses += 1
+
+    # Stream
+    link.stop_stream()
+    responses += 1
+    transport.drain(0.05)   # Renglones ya en camino
+    stopped = sample_lines(transport.drain(0.2))
+    check(len(stopped) == 0, f"{len(stopped)} muestras con el stream detenido")
+    link.start_stream()
+    responses += 1
+    running = sample_lines(transport.drain(0.2))
+    check(len(running) > 20, f"solo {len(running)} muestras después de start")
+    stats = link.get_stats()
+    responses += 1
+    check(stats["readings"] > 0 and stats["uptime_ms"] > 0, f"estadísticas {stats}")
+
+    transport.close()
+    received = bytes(transport.received)
+
+    # Flujo mezclado por el decodificador del firmware
+    out = subprocess.run([device, "--decode"], input=received, stdout=subprocess.PIPE, check=True)
+    counts = dict(zip(*[iter(out.stdout.decode().split())] * 2))
+    expected = len(sample_lines(received))
+    print(f"   recibidos {len(received)} bytes: {expected} renglones de muestra, {responses} respuestas; "
+          f"decodificador: {out.stdout.decode().strip()}")
+    check(int(counts["muestras"]) == expected, "el decodificador perdió o inventó muestras")
+    check(int(counts["tramas"]) == responses, "tramas sin saltear")
+    check(int(counts["otros"]) == 0 and int(counts["errores"]) == 0, "renglones basura por las tramas")
+
+
+def run_log(device):
+    print("3) Log en flash (--flash-log)")
+    transport = PipeTransport([device, "--flash-log"])
+    link = pc.PortentaLink(None, transport=transport)
+    transport.drain(3.0)    # Unos 10 bloques: varios borrados de sector
+    info = link.log_info()
+    check(info["newest"] >= 8, f"log {info}")
+    start = time.time()
+    logged = link.download_log()
+    elapsed = time.time() - start
+    expect_error(lambda: link.request(pc.CMD_LOG_READ, struct.pack("<IH", 0, pc.CMD_LOG_READ_MAX + 1)),
+                 "fuera de rango", "descarga de más de CMD_LOG_READ_MAX bloques")
+    transport.close()
+    received = bytes(transport.received)
+
+    streamed = [line.split() for line in sample_lines(received)]
+    streamed = [(int(ts), float(v)) for ts, v in streamed]
+    print(f"   bloques {info['oldest']}..{info['newest']}: {len(logged)} muestras en {elapsed:.2f} s; "
+          f"{len(streamed)} por texto")
+    check(len(logged) > 0 and len(streamed) >= len(logged), "muestras del log")
+    first = next((i for i, s in enumerate(streamed) if s[0] == logged[0][0]), None) if logged else None
+    check(first is not None, "el log no empieza en una muestra del stream")
+    if first is not None:
+        mismatched = sum(1 for (ts, v), (sts, sv) in zip(logged, streamed[first:])
+                         if ts != sts or abs(v - sv) > 0.0015)
+        check(mismatched == 0 and first + len(logged) <= len(streamed),
+              f"{mismatched} muestras del log distintas del stream")
+
+    out = subprocess.run([device, "--decode"], input=received, stdout=subprocess.PIPE, check=True)
+    counts = dict(zip(*[iter(out.stdout.decode().split())] * 2))
+    print(f"   decodificador: {out.stdout.decode().strip()}")
+    check(int(counts["muestras"]) == len(streamed), "el decodificador perdió muestras con la descarga")
+    check(int(counts["otros"]) == 0 and int(counts["errores"]) == 0, "renglones basura por la descarga")
+
+
+def run_m4(device):
+    print("2) Build con ACQ_ON_M4")
+    transport = PipeTransport([device, "--acq-on-m4"])
+    link = pc.PortentaLink(None, transport=transport)
+    link.set_sensors(["sm4291", "elvh", "abplln"])
+    mask = link.get_config()["sensor_mask"]
+    check(mask == 0b1101, f"máscara {mask:#x}")
+    expect_error(lambda: link.request(pc.CMD_SET_SENSORS, struct.pack("<I", 1 << 7)), "fuera de rango",
+                 "sensor inexistente")
+    transport.close()
+
+    # El perfil del M4 solo lee SM4291 y ELVH: rechaza el ABP y se vuelve atrás
+    transport = PipeTransport([device, "--acq-on-m4", "--m4-sensors", "0x5"])
+    link = pc.PortentaLink(None, transport=transport)
+    link.set_period(200)
+    check(link.get_config()["period_us"] == 200, "periodo del M4 por debajo del mínimo local")
+    expect_error(lambda: link.set_period(112), "fuera de rango", "periodo por debajo del tick del M7")
+    link.set_period(1000)
+    snapshot = link.get_config()
+    check(snapshot["period_us"] == 1000, "periodo confirmado por el M4")
+    expect_error(lambda: link.set_sensors(["sm4291", "abplln"]), "fuera de rango", "sensor fuera del perfil del M4")
+    check(link.get_config() == snapshot, "el rechazo del M4 cambió la configuración")
+    link.set_sensors(["sm4291", "elvh"])
+    check(link.get_config()["sensor_mask"] == 0b101, "máscara confirmada por el M4")
+    transport.close()
+
+    # M4 sin responder: el SET vence antes que el timeout del host
+    transport = PipeTransport([device, "--acq-on-m4", "--m4-mute"])
+    link = pc.PortentaLink(None, transport=transport)
+    expect_error(lambda: link.set_period(1000), "sin respuesta del M4", "periodo sin ack del M4")
+    check(link.get_config()["period_us"] == 500, "periodo sin ack aplicado")
+    link.set_filter(0.25)
+    check(abs(link.get_config()["filter_alpha"] - 0.25) < 1e-6, "SET local después de un timeout del M4")
+    transport.close()
+
+
+def run_control(device):
+    print("4) Build con ENABLE_CONTROL (--control)")
+    transport = PipeTransport([device, "--control"])
+    link = pc.PortentaLink(None, transport=transport)
+    before = link.get_stats()["config_changes"]
+    link.set_setpoint(-200.0)
+    link.set_pid(0.05, 0.5, 0.001, 0.002)
+    snapshot = link.get_config()
+    expect_error(lambda: link.set_setpoint(-500.0), "fuera de rango", "consigna más allá del corte")
+    expect_error(lambda: link.set_setpoint(10.0), "fuera de rango", "consigna positiva")
+    expect_error(lambda: link.set_pid(-1.0, 0.0, 0.0, 0.0), "fuera de rango", "kp negativa")
+    expect_error(lambda: link.request(pc.CMD_SET_PID, b"\x00" * 12), "longitud incorrecta", "ganancias de 12 bytes")
+    check(link.get_config() == snapshot, "un comando de control rechazado cambió la configuración")
+    transport.drain(0.05)
+    check(link.get_stats()["config_changes"] > before, "consigna y ganancias no se aplicaron")
+    transport.close()
+
+
+def run_window(device):
+    print("5) Ventana de curtosis (--window)")
+    transport = PipeTransport([device, "--window"])
+    link = pc.PortentaLink(None, transport=transport)
+    link.set_window(20)
+    link.set_kurtosis(3.0, 9.0)
+    config = link.get_config()
+    check(config["window_length"] == 20, "ventana")
+    check(abs(config["kurtosis_low"] - 3.0) < 1e-6 and abs(config["kurtosis_high"] - 9.0) < 1e-6, "curtosis")
+    expect_error(lambda: link.set_window(51), "fuera de rango", "ventana 51")
+    expect_error(lambda: link.set_window(3), "fuera de rango", "ventana 3")
+    expect_error(lambda: link.set_kurtosis(5.0, 4.0), "fuera de rango", "curtosis invertida")
+    check(link.get_config() == config, "un comando de ventana rechazado cambió la configuración")
+    transport.close()
+
+
+def main():
+    device = sys.argv[1] if len(sys.argv) > 1 else "./cmd_device"
+    run_local(device)
+    run_m4(device)
+    run_log(device)
+    run_control(device)
+    run_window(device)
+    print("FALLA" if failures else "OK")
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
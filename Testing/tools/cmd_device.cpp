@@ -0,0 +1,305 @@
+/*
+  Dispositivo nativo para probar el protocolo de comandos (build nativo)
+
+  Compilar desde Testing/:
+    g++ -O2 -std=gnu++14 -Isrc tools/cmd_device.cpp -o cmd_device
+
+  Hace de firmware por entrada/salida estándar: lee tramas de comandos por
+  stdin con el mismo parser y el mismo cmd_handler.h que host_link.h y
+  escribe por stdout las respuestas mezcladas con renglones de muestra
+  "<micros> <mbar>" mientras el streaming está activo, como el puerto serie
+  real. Como hostLinkPoll(), deja de leer tramas después de un SET aceptado
+  hasta aplicarlo en el tick siguiente (un tick por milisegundo de reloj, con
+  timestamps que avanzan periodUs). Termina al cerrarse stdin.
+
+  Opciones:
+    --acq-on-m4   acepta todos los sensores (como con ACQ_ON_M4); por defecto
+                  solo el SM4291 por I2C, como el build local, y el periodo
+                  mínimo cuenta su lectura en el tick. Los cambios de
+                  periodo y sensores se responden con el ack de un M4 simulado
+                  (CMD_DEVICE_M4_ACK_TICKS después); si lo rechaza o no
+                  contesta, la configuración vuelve a la anterior
+    --m4-sensors <máscara>
+                  sensores del perfil del M4 simulado (por defecto todos): una
+                  máscara con otros la rechaza como IPC_CMD_SET_SENSORS
+    --m4-mute     el M4 simulado no confirma nada (CMD_ERR_TIMEOUT a los
+                  CMD_DEVICE_M4_TIMEOUT_TICKS)
+    --control     acepta consigna y ganancias (como con ENABLE_CONTROL); por
+                  defecto las rechaza como no disponibles
+    --window      acepta ventana y umbrales de curtosis (como si
+                  window_analysis.h estuviera conectado); por defecto los
+                  rechaza como no disponibles, igual que el firmware
+    --flash-log   guarda las muestras en un FlashLog sobre una flash en RAM
+                  (borrado de CMD_DEVICE_ERASE_POLLS ticks) y atiende
+                  CMD_LOG_INFO/CMD_LOG_READ como con ENABLE_FLASH_LOG
+    --decode      no hace de dispositivo: pasa stdin por StreamDecoder e
+                  imprime "muestras N tramas N errores N otros N"
+
+  Lo usa tools/cmd_check.py, que corre portenta_cmd.py contra este binario.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include "cmd_handler.h"
+#include "stream_decoder.h"
+#include "flash_log.h"
+
+#define CMD_DEVICE_WINDOW_SIZE   50    // WINDOW_SIZE de window_analysis.h
+#define CMD_DEVICE_I2C_CLOCK_HZ  400000   // DEV_I2C_CLOCK_HZ de dev_i2c.h
+#define CMD_DEVICE_LOG_SECTORS   4
+#define CMD_DEVICE_SECTOR        4096
+#define CMD_DEVICE_ERASE_POLLS   20    // Ticks que tarda un borrado
+#define CMD_DEVICE_LOG_FRAMES    4     // HOST_LOG_FRAMES_PER_POLL de host_link.h
+#define CMD_DEVICE_M4_ACK_TICKS  3     // Ticks hasta el ack del M4 simulado
+#define CMD_DEVICE_M4_TIMEOUT_TICKS 500 // M4_COMMAND_TIMEOUT_MS de main.cpp
+
+// Flash NOR en RAM: programar solo baja bits y el borrado tarda unos ticks
+class RamLogStorage : public LogStorage {
+private:
+    uint8_t memory[CMD_DEVICE_LOG_SECTORS * CMD_DEVICE_SECTOR];
+    uint32_t erasePolls = 0;
+
+public:
+    RamLogStorage() { memset(memory, 0xFF, sizeof(memory)); }
+    uint32_t size() const override { return sizeof(memory); }
+    uint32_t pageSize() const override { return 256; }
+    uint32_t sectorSize() const override { return CMD_DEVICE_SECTOR; }
+
+    bool read(uint32_t addr, void* data, uint32_t len) override {
+        if (erasePolls > 0 || addr + len > sizeof(memory)) return false;
+        memcpy(data, &memory[addr], len);
+        return true;
+    }
+
+    bool program(uint32_t addr, const void* data, uint32_t len) override {
+        if (erasePolls > 0 || addr + len > sizeof(memory)) return false;
+        for (uint32_t i = 0; i < len; i++) memory[addr + i] &= ((const uint8_t*)data)[i];
+        return true;
+    }
+
+    bool eraseStart(uint32_t addr, uint32_t len) override {
+        if (erasePolls > 0 || addr % CMD_DEVICE_SECTOR != 0 || addr + len > sizeof(memory)) return false;
+        memset(&memory[addr], 0xFF, len);
+        erasePolls = CMD_DEVICE_ERASE_POLLS;
+        return true;
+    }
+
+    bool busy() override {
+        if (erasePolls == 0) return false;
+        erasePolls--;
+        return true;
+    }
+};
+
+RuntimeConfig activeConfig = defaultRuntimeConfig();
+RuntimeConfig pendingConfig;
+bool configPending = false;
+
+static CmdParser parser;
+static CmdCapabilities caps;
+static RuntimeStats stats;
+static uint32_t deviceUs = 0;
+
+static bool logEnabled = false;
+static RamLogStorage logStorage;
+static FlashLog flashLog(logStorage);
+static LogDownload logDownload(flashLog);
+
+// M4 simulado (--acq-on-m4): como m4ConfigPoll() en main.cpp
+static bool acqOnM4 = false;
+static bool m4Mute = false;
+static uint32_t m4Sensors = (1u << SENSOR_COUNT) - 1;
+static bool m4Waiting = false;
+static uint32_t m4Ticks = 0;
+static uint8_t m4SetCmd = 0;
+static RuntimeConfig m4Previous;
+
+static void writeAll(const void* data, size_t n) {
+    const uint8_t* p = (const uint8_t*)data;
+    while (n > 0) {
+        ssize_t written = write(STDOUT_FILENO, p, n);
+        if (written <= 0) return;
+        p += written;
+        n -= (size_t)written;
+    }
+}
+
+static void sendResponse(uint8_t cmd, uint8_t status, const uint8_t* data = NULL, uint8_t len = 0) {
+    uint8_t payload[CMD_MAX_PAYLOAD];
+    uint8_t frame[CMD_MAX_PAYLOAD + CMD_FRAME_OVERHEAD];
+    payload[0] = status;
+    if (len > 0) memcpy(&payload[1], data, len);
+    writeAll(frame, cmdEncodeFrame(cmd | CMD_RESPONSE_FLAG, payload, (uint8_t)(len + 1), frame));
+}
+
+// Igual que hostHandleFrame() sin los comandos de ciclos
+static void handleFrame(const CmdFrame& f) {
+    uint8_t data[CMD_MAX_PAYLOAD - 1];
+    if (logEnabled && f.cmd == CMD_LOG_INFO) {
+        cmdPutU32(&data[0], flashLog.empty() ? 0 : flashLog.oldestSeq());
+        cmdPutU32(&data[4], flashLog.empty() ? 0 : flashLog.newestSeq());
+        cmdPutU32(&data[8], flashLog.capacityBlocks());
+        cmdPutU16(&data[12], LOG_BLOCK_SIZE);
+        sendResponse(f.cmd, CMD_OK, data, 14);
+        return;
+    }
+    if (logEnabled && f.cmd == CMD_LOG_READ) {
+        uint16_t count = f.len == 6 ? cmdGetU16(f.payload + 4) : 0;
+        if (f.len != 6) {
+            sendResponse(f.cmd, CMD_ERR_LENGTH);
+        } else if (count == 0 || count > CMD_LOG_READ_MAX) {
+            sendResponse(f.cmd, CMD_ERR_RANGE);
+        } else {
+            sendResponse(f.cmd, CMD_OK);
+            logDownload.start(cmdGetU32(f.payload), count);
+        }
+        return;
+    }
+    switch (f.cmd) {
+        case CMD_PING:
+            sendResponse(f.cmd, CMD_OK);
+            break;
+        case CMD_GET_CONFIG:
+            sendResponse(f.cmd, CMD_OK, data, cmdEncodeConfig(configPending ? pendingConfig : activeConfig, data));
+            break;
+        case CMD_GET_STATS:
+            sendResponse(f.cmd, CMD_OK, data, cmdEncodeStats(stats, data));
+            break;
+        default: {
+            RuntimeConfig staged = configPending ? pendingConfig : activeConfig;
+            uint8_t status = cmdApplySet(f, staged, caps);
+            if (status == CMD_OK) {
+                pendingConfig = staged;
+                configPending = true;
+                if (acqOnM4 && (staged.periodUs != activeConfig.periodUs ||
+                                staged.sensorMask != activeConfig.sensorMask)) {
+                    m4SetCmd = f.cmd;
+                    m4Ticks = 0;
+                    m4Waiting = true;
+                    break;
+                }
+            }
+            sendResponse(f.cmd, status);
+            break;
+        }
+    }
+}
+
+// Ack del M4 simulado: el cambio queda o vuelve a la configuración anterior
+static void m4Poll() {
+    if (!m4Waiting) return;
+    m4Ticks++;
+    uint8_t status;
+    if (!m4Mute && m4Ticks >= CMD_DEVICE_M4_ACK_TICKS) {
+        status = (activeConfig.sensorMask & ~m4Sensors) ? CMD_ERR_RANGE : CMD_OK;
+    } else if (m4Ticks > CMD_DEVICE_M4_TIMEOUT_TICKS) {
+        status = CMD_ERR_TIMEOUT;
+    } else {
+        return;
+    }
+    m4Waiting = false;
+    if (status != CMD_OK) activeConfig = m4Previous;
+    sendResponse(m4SetCmd, status);
+}
+
+static void tick() {
+    if (configPending) {
+        m4Previous = activeConfig;
+        activeConfig = pendingConfig;
+        configPending = false;
+        stats.configChanges++;
+    }
+    m4Poll();
+    deviceUs += activeConfig.periodUs;
+    stats.uptimeMs = deviceUs / 1000;
+    if (!activeConfig.streaming) return;
+
+    // Rampa triangular en la banda de succión, con 3 decimales como el firmware
+    float mbar = -150.0f - 100.0f * (float)((stats.readings % 2000) < 1000 ? stats.readings % 1000
+                                                                              : 1000 - stats.readings % 1000) / 1000.0f;
+    char line[48];
+    int n = snprintf(line, sizeof(line), "%lu %.3f\n", (unsigned long)deviceUs, (double)mbar);
+    writeAll(line, (size_t)n);
+    stats.readings++;
+    stats.lastValue = mbar;
+    if (logEnabled) flashLog.append(deviceUs, mbar);
+}
+
+// Tareas de segundo plano: una operación de flash y unas tramas de descarga
+static void background() {
+    if (!logEnabled) return;
+    flashLog.poll();
+    uint8_t data[CMD_MAX_PAYLOAD - 1];
+    for (int i = 0; i < CMD_DEVICE_LOG_FRAMES; i++) {
+        uint32_t at;
+        uint32_t n = logDownload.next(&data[2], CMD_LOG_DATA_CHUNK, &at);
+        if (n == 0) break;
+        cmdPutU16(&data[0], (uint16_t)at);
+        sendResponse(CMD_LOG_DATA, CMD_OK, data, (uint8_t)(n + 2));
+    }
+}
+
+static int runDevice() {
+    stats = RuntimeStats();
+    struct pollfd in = {STDIN_FILENO, POLLIN, 0};
+    uint8_t buffer[256];
+    ssize_t length = 0;
+    ssize_t at = 0;
+    while (true) {
+        if (at == length && poll(&in, 1, 1) > 0) {
+            length = read(STDIN_FILENO, buffer, sizeof(buffer));
+            if (length <= 0) return 0;
+            at = 0;
+        }
+        // Hasta el primer SET aceptado; el resto espera al tick siguiente
+        while (at < length && !configPending && !m4Waiting) {
+            if (parser.feed(buffer[at++])) handleFrame(parser.frame());
+        }
+        tick();
+        background();
+    }
+}
+
+static int runDecode() {
+    StreamDecoder decoder;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(STDIN_FILENO, buffer, sizeof(buffer))) > 0) {
+        decoder.feed(buffer, (size_t)n, [](DecodedKind, const DecodedSample&) {});
+    }
+    printf("muestras %u tramas %u errores %u otros %u\n", decoder.samples, decoder.frames, decoder.errors,
+           decoder.other);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    caps.sensorMask = 1u << SENSOR_SM4291_I2C;
+    caps.requiredSensors = 1u << SENSOR_SM4291_I2C;
+    caps.maxWindow = CMD_DEVICE_WINDOW_SIZE;
+    caps.control = false;
+    caps.window = false;
+    // Periodo mínimo como hostHandleSet(): HOST_TICK_US más las lecturas del M7
+    caps.tickUs = 90;
+    caps.readUs[SENSOR_SM4291_I2C] = i2cTransactionUs(CMD_DEVICE_I2C_CLOCK_HZ, 1, 2);
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--decode") == 0) return runDecode();
+        if (strcmp(argv[i], "--acq-on-m4") == 0) {
+            caps.sensorMask = (1u << SENSOR_COUNT) - 1;
+            caps.requiredSensors = 0;
+            caps.readUs[SENSOR_SM4291_I2C] = 0;
+            acqOnM4 = true;
+        }
+        if (strcmp(argv[i], "--m4-sensors") == 0 && i + 1 < argc) m4Sensors = strtoul(argv[++i], NULL, 0);
+        if (strcmp(argv[i], "--m4-mute") == 0) m4Mute = true;
+        if (strcmp(argv[i], "--window") == 0) caps.window = true;
+        if (strcmp(argv[i], "--control") == 0) {
+            caps.control = true;
+            caps.tickUs = 140;
+        }
+        if (strcmp(argv[i], "--flash-log") == 0) logEnabled = flashLog.mount();
+    }
+    return runDevice();
+}
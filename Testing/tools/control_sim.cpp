@@ -0,0 +1,406 @@
+/*
+  Simulación de lazo cerrado del control de succión (build nativo)
+
+  Compilar desde Testing/:
+    g++ -O2 -std=gnu++14 -Isrc tools/control_sim.cpp -o control_sim
+
+  Planta: bomba + línea de vacío de primer orden, integrada cada 5 us,
+      tau * d(profundidad)/dt = ganancia * u - profundidad
+  con ruido del sensor (SIM_NOISE mbar). En cada tick (2 kHz) se lee la
+  presión (SIM_READ_US más un jitter del bus de hasta SIM_READ_JITTER_US),
+  corre PidController (pressure_control.h, el mismo código del firmware) y la
+  salida se aplica a la planta recién al cumplirse la latencia:
+  - fija: se espera hasta CONTROL_LATENCY_US desde el inicio de la lectura,
+    como controlStep() en main.cpp
+  - sin espera: apenas termina el cálculo (latencia con el jitter del bus)
+  - un tick: la salida se escribe en el tick siguiente (referencia)
+
+  Escenarios:
+  1) Escalón 0 -> -200 mbar: subida, sobrepaso, establecimiento (±2 %) y
+     error permanente, con las tres latencias
+  2) Saturación: consigna -420 mbar con la bomba debilitada 300 ms (no
+     llega) y luego normal; sobrepaso con y sin anti-windup
+  3) Fuga: la ganancia cae 40 % en régimen; desvío máximo y recuperación
+  4) Falla del sensor: 2 lecturas malas mantienen la salida, 5 llevan al
+     failsafe en CONTROL_FAULT_SAMPLES ticks y se retoma después de
+     CONTROL_RECOVER_SAMPLES válidas
+  5) Sobrepresión: una fuente externa lleva la línea más allá del límite
+  6) Medida vieja: sin muestras por 20 ms, stale() pasa al failsafe
+  y la distribución de la latencia lectura -> actuación en 60 s.
+
+  Devuelve 1 si alguna comprobación falla.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "pressure_control.h"
+
+#define SIM_PERIOD_US        500
+#define SIM_STEP_US          5
+#define SIM_GAIN_MBAR        480.0    // Profundidad con la bomba a pleno
+#define SIM_TAU_S            0.060
+#define SIM_NOISE            0.5      // mbar
+#define SIM_READ_US          60       // Lectura I2C del SM4291
+#define SIM_READ_JITTER_US   25       // Estiramiento del reloj, reintentos
+#define SIM_COMPUTE_US       2        // PID + escritura del PWM en el M7
+#define CONTROL_LATENCY_US   100      // El mismo presupuesto que main.cpp
+
+// Ganancias para la planta de arriba (las de runtime_config.h)
+#ifndef SIM_GAINS
+#define SIM_GAINS 0.03f, 0.3f, 0.0f, 1.0f / 480.0f
+#endif
+static const PidGains GAINS = {SIM_GAINS};
+
+enum LatencyMode { LATENCY_FIXED, LATENCY_FREE, LATENCY_TICK, LATENCY_MODES };
+static const char* latencyName[LATENCY_MODES] = {"fija", "sin espera", "un tick"};
+
+static double uniform() { return rand() / (RAND_MAX + 1.0); }
+
+static double gaussian() {
+    double u1 = uniform() + 1e-12, u2 = uniform();
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+struct Plant {
+    double gain = SIM_GAIN_MBAR;
+    double tau = SIM_TAU_S;
+    double external = 0.0;      // Profundidad que agrega otra fuente (escenario 5)
+    double depth = 0.0;
+    double u = 0.0;
+
+    void advance(double us) {
+        double dt = us * 1e-6;
+        depth += dt / tau * (gain * u + external - depth);
+    }
+};
+
+// Eventos de un escenario en cada tick: ajusta la planta, la consigna o la lectura
+struct Scenario {
+    virtual ~Scenario() {}
+    virtual void tick(long k, Plant& plant, PidController& pid) { (void)k; (void)plant; (void)pid; }
+    virtual bool readOk(long k) { (void)k; return true; }
+    virtual bool skip(long k) { (void)k; return false; }   // Tick sin muestra
+};
+
+struct Trace {
+    long ticks;
+    float* depth;       // Profundidad real al inicio de cada tick
+    float* output;
+    uint8_t* state;
+    ControlLatency latency;
+};
+
+// Corre 'ticks' ticks y guarda la traza; la latencia se mide por tick
+static void runLoop(PidController& pid, Plant& plant, Scenario& scenario, LatencyMode mode, Trace& trace) {
+    trace.latency.reset();
+    double pendingU = plant.u;
+    bool pending = false;
+    for (long k = 0; k < trace.ticks; k++) {
+        scenario.tick(k, plant, pid);
+        trace.depth[k] = (float)plant.depth;
+        double elapsed = 0.0;
+
+        // La salida calculada en el tick anterior (modo un tick)
+        if (mode == LATENCY_TICK && pending) {
+            plant.u = pendingU;
+            pending = false;
+        }
+
+        if (!scenario.skip(k)) {
+            // La muestra se toma al comienzo de la lectura
+            float mbar = (float)(-plant.depth + SIM_NOISE * gaussian());
+            double readUs = SIM_READ_US + SIM_READ_JITTER_US * uniform();
+            float u = pid.update((uint32_t)(k * SIM_PERIOD_US), mbar, scenario.readOk(k));
+            double doneUs = readUs + SIM_COMPUTE_US;
+            double actUs = doneUs;
+            if (mode == LATENCY_FIXED && doneUs < CONTROL_LATENCY_US) actUs = CONTROL_LATENCY_US;
+
+            if (mode == LATENCY_TICK) {
+                pendingU = u;
+                pending = true;
+            } else {
+                while (elapsed < actUs) {
+                    plant.advance(SIM_STEP_US);
+                    elapsed += SIM_STEP_US;
+                }
+                plant.u = u;
+                trace.latency.add((float)actUs, CONTROL_LATENCY_US);
+            }
+        }
+        while (elapsed < SIM_PERIOD_US) {
+            plant.advance(SIM_STEP_US);
+            elapsed += SIM_STEP_US;
+        }
+        trace.output[k] = (float)plant.u;
+        trace.state[k] = pid.currentState();
+    }
+}
+
+static Trace makeTrace(long ticks) {
+    Trace trace;
+    trace.ticks = ticks;
+    trace.depth = (float*)malloc(sizeof(float) * ticks);
+    trace.output = (float*)malloc(sizeof(float) * ticks);
+    trace.state = (uint8_t*)malloc(ticks);
+    return trace;
+}
+
+static void freeTrace(Trace& trace) {
+    free(trace.depth);
+    free(trace.output);
+    free(trace.state);
+}
+
+static PidController makePid(bool antiWindup = true) {
+    PidController pid;
+    pid.setGains(GAINS);
+    ControlLimits limits = defaultControlLimits();
+    limits.antiWindup = antiWindup;
+    pid.setLimits(limits);
+    return pid;
+}
+
+struct StepResponse {
+    double riseMs, overshootPct, settleMs, steadyError, peak;
+};
+
+// Respuesta a un escalón de 0 a 'target' de profundidad en el tick 'from'
+static StepResponse measureStep(const Trace& trace, long from, long to, double target) {
+    StepResponse r = {0, 0, 0, 0, 0};
+    long t10 = -1, t90 = -1, lastOut = from;
+    for (long k = from; k < to; k++) {
+        double y = trace.depth[k];
+        if (t10 < 0 && y >= 0.1 * target) t10 = k;
+        if (t90 < 0 && y >= 0.9 * target) t90 = k;
+        if (y > r.peak) r.peak = y;
+        if (fabs(y - target) > 0.02 * target) lastOut = k;
+    }
+    long tail = (to - from) / 5;
+    double sum = 0.0;
+    for (long k = to - tail; k < to; k++) sum += trace.depth[k];
+    r.riseMs = (t90 - t10) * SIM_PERIOD_US / 1000.0;
+    r.overshootPct = r.peak > target ? 100.0 * (r.peak - target) / target : 0.0;
+    r.settleMs = (lastOut + 1 - from) * SIM_PERIOD_US / 1000.0;
+    r.steadyError = sum / tail - target;
+    return r;
+}
+
+struct StepScenario : Scenario {
+    void tick(long k, Plant&, PidController& pid) override {
+        if (k == 200) pid.setSetpoint(-200.0f);
+    }
+};
+
+struct WindupScenario : Scenario {
+    void tick(long k, Plant& plant, PidController& pid) override {
+        if (k == 200) pid.setSetpoint(-200.0f);
+        if (k == 1200) {
+            pid.setSetpoint(-420.0f);
+            plant.gain = 0.7 * SIM_GAIN_MBAR;   // La bomba no llega (336 mbar)
+        }
+        if (k == 1800) plant.gain = SIM_GAIN_MBAR;
+    }
+};
+
+struct LeakScenario : Scenario {
+    void tick(long k, Plant& plant, PidController& pid) override {
+        if (k == 0) pid.setSetpoint(-200.0f);
+        if (k == 1000) plant.gain = 0.6 * SIM_GAIN_MBAR;
+    }
+};
+
+struct FaultScenario : Scenario {
+    void tick(long k, Plant&, PidController& pid) override {
+        if (k == 0) pid.setSetpoint(-200.0f);
+    }
+    bool readOk(long k) override {
+        return !(k >= 1000 && k < 1002) && !(k >= 1500 && k < 1505);
+    }
+};
+
+struct LimitScenario : Scenario {
+    void tick(long k, Plant& plant, PidController& pid) override {
+        if (k == 0) pid.setSetpoint(-300.0f);
+        if (k == 1000) plant.external = 550.0;   // Otra fuente de vacío en la línea
+    }
+};
+
+struct StaleScenario : Scenario {
+    void tick(long k, Plant& plant, PidController& pid) override {
+        if (k == 0) pid.setSetpoint(-200.0f);
+        // Con la adquisición detenida el firmware solo ve el reloj (controlTask)
+        if (k >= 1000 && k < 1040 && pid.stale((uint32_t)(k * SIM_PERIOD_US))) plant.u = pid.currentOutput();
+    }
+    bool skip(long k) override { return k >= 1000 && k < 1040; }
+};
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    if (!ok) {
+        printf("  FALLA: %s\n", what);
+        failures++;
+    }
+}
+
+int main(int argc, char** argv) {
+    srand(argc > 1 ? (unsigned)atoi(argv[1]) : 1);
+    printf("planta: ganancia %.0f mbar, tau %.0f ms, ruido %.1f mbar; tick %d us, latencia fija %d us\n\n",
+           SIM_GAIN_MBAR, SIM_TAU_S * 1000.0, SIM_NOISE, SIM_PERIOD_US, CONTROL_LATENCY_US);
+
+    // 1) Escalón con cada latencia
+    printf("1) escalón 0 -> -200 mbar\n");
+    printf("   latencia      subida   sobrepaso  establec.  error perm.\n");
+    StepResponse fixedStep = {0, 0, 0, 0, 0};
+    for (int mode = 0; mode < LATENCY_MODES; mode++) {
+        PidController pid = makePid();
+        Plant plant;
+        StepScenario scenario;
+        Trace trace = makeTrace(1200);
+        runLoop(pid, plant, scenario, (LatencyMode)mode, trace);
+        StepResponse r = measureStep(trace, 200, 1200, 200.0);
+        printf("   %-12s %5.1f ms  %6.2f %%  %6.1f ms  %+7.2f mbar\n", latencyName[mode], r.riseMs,
+               r.overshootPct, r.settleMs, r.steadyError);
+        if (mode == LATENCY_FIXED) fixedStep = r;
+        freeTrace(trace);
+    }
+    check(fixedStep.overshootPct < 5.0, "sobrepaso del escalón >= 5 %");
+    check(fixedStep.settleMs < 100.0, "establecimiento del escalón >= 100 ms");
+    check(fabs(fixedStep.steadyError) < 1.0, "error permanente >= 1 mbar");
+
+    // 2) Saturación con y sin anti-windup
+    printf("\n2) consigna -420 mbar con la bomba al 70 %% durante 300 ms\n");
+    double overshoot[2] = {0, 0};
+    bool tripped[2] = {false, false};
+    for (int aw = 1; aw >= 0; aw--) {
+        PidController pid = makePid(aw == 1);
+        Plant plant;
+        WindupScenario scenario;
+        Trace trace = makeTrace(3000);
+        runLoop(pid, plant, scenario, LATENCY_FIXED, trace);
+        double peak = 0.0;
+        for (long k = 1800; k < 3000; k++) {
+            if (trace.depth[k] > peak) peak = trace.depth[k];
+            if (trace.state[k] == CONTROL_LIMIT) tripped[aw] = true;
+        }
+        overshoot[aw] = peak - 420.0;
+        StepResponse r = measureStep(trace, 1800, 3000, 420.0);
+        printf("   %-14s pico %.1f mbar (sobrepaso %+.1f), establec. %.1f ms%s\n",
+               aw ? "anti-windup" : "sin anti-windup", peak, overshoot[aw], r.settleMs,
+               tripped[aw] ? ", corte por sobrepresión" : "");
+        freeTrace(trace);
+    }
+    check(overshoot[1] < 10.0 && !tripped[1], "con anti-windup el sobrepaso llega a 10 mbar o corta");
+    check(overshoot[1] < overshoot[0], "el anti-windup no reduce el sobrepaso");
+
+    // 3) Fuga en régimen
+    {
+        printf("\n3) fuga: la ganancia cae 40 %% con la línea en -200 mbar\n");
+        PidController pid = makePid();
+        Plant plant;
+        LeakScenario scenario;
+        Trace trace = makeTrace(2000);
+        runLoop(pid, plant, scenario, LATENCY_FIXED, trace);
+        double worst = 0.0;
+        long lastOut = 1000;
+        for (long k = 1000; k < 2000; k++) {
+            double dev = 200.0 - trace.depth[k];
+            if (dev > worst) worst = dev;
+            if (fabs(dev) > 4.0) lastOut = k;
+        }
+        double recoverMs = (lastOut + 1 - 1000) * SIM_PERIOD_US / 1000.0;
+        printf("   desvío máximo %.1f mbar, vuelve a ±2 %% en %.1f ms\n", worst, recoverMs);
+        check(recoverMs < 150.0, "la fuga no se corrige en 150 ms");
+        freeTrace(trace);
+    }
+
+    // 4) Falla del sensor
+    {
+        printf("\n4) falla del sensor: 2 lecturas malas en el tick 1000, 5 en el 1500\n");
+        PidController pid = makePid();
+        Plant plant;
+        FaultScenario scenario;
+        Trace trace = makeTrace(2000);
+        runLoop(pid, plant, scenario, LATENCY_FIXED, trace);
+        bool heldShort = true;
+        for (long k = 1000; k < 1010; k++) {
+            if (trace.state[k] != CONTROL_RUN) heldShort = false;
+        }
+        long failsafeAt = -1, resumedAt = -1;
+        for (long k = 1500; k < 2000; k++) {
+            if (failsafeAt < 0 && trace.state[k] == CONTROL_FAULT) failsafeAt = k;
+            if (failsafeAt >= 0 && resumedAt < 0 && trace.state[k] == CONTROL_RUN) resumedAt = k;
+        }
+        printf("   2 malas: %s; 5 malas: failsafe en el tick %+ld (salida %.2f), retoma en %+ld\n",
+               heldShort ? "mantiene la salida" : "cambió de estado", failsafeAt - 1500,
+               failsafeAt >= 0 ? trace.output[failsafeAt] : -1.0f, resumedAt - 1505);
+        check(heldShort, "dos lecturas malas no deben disparar el failsafe");
+        check(failsafeAt == 1500 + CONTROL_FAULT_SAMPLES - 1 && trace.output[failsafeAt] == CONTROL_FAILSAFE_OUTPUT,
+              "el failsafe no llega en CONTROL_FAULT_SAMPLES ticks");
+        check(resumedAt == 1505 + CONTROL_RECOVER_SAMPLES - 1, "no retoma después de CONTROL_RECOVER_SAMPLES válidas");
+        freeTrace(trace);
+    }
+
+    // 5) Sobrepresión
+    {
+        printf("\n5) sobrepresión: otra fuente agrega 550 mbar con la consigna en -300\n");
+        PidController pid = makePid();
+        Plant plant;
+        LimitScenario scenario;
+        Trace trace = makeTrace(2000);
+        runLoop(pid, plant, scenario, LATENCY_FIXED, trace);
+        long crossed = -1, cut = -1;
+        for (long k = 1000; k < 2000; k++) {
+            if (crossed < 0 && -trace.depth[k] < CONTROL_MAX_SUCTION_MBAR) crossed = k;
+            if (cut < 0 && trace.state[k] == CONTROL_LIMIT) cut = k;
+        }
+        printf("   cruza el límite en el tick %ld, corte en el %ld (salida %.2f)\n", crossed, cut,
+               cut >= 0 ? trace.output[cut] : -1.0f);
+        check(cut >= 0 && cut - crossed <= 1 && trace.output[cut] == CONTROL_FAILSAFE_OUTPUT,
+              "el corte por sobrepresión tarda más de un tick");
+        freeTrace(trace);
+    }
+
+    // 6) Medida vieja
+    {
+        printf("\n6) sin muestras entre los ticks 1000 y 1040\n");
+        PidController pid = makePid();
+        Plant plant;
+        StaleScenario scenario;
+        Trace trace = makeTrace(1200);
+        runLoop(pid, plant, scenario, LATENCY_FIXED, trace);
+        long staleAt = -1;
+        for (long k = 1000; k < 1040; k++) {
+            if (staleAt < 0 && trace.state[k] == CONTROL_STALE) staleAt = k;
+        }
+        double staleMs = (staleAt - 1000 + 1) * SIM_PERIOD_US / 1000.0;
+        printf("   failsafe por medida vieja a los %.1f ms (límite %d ms), estado final %s\n", staleMs,
+               CONTROL_STALE_US / 1000, controlStateName(trace.state[1199]));
+        check(staleAt >= 0 && trace.output[staleAt] == CONTROL_FAILSAFE_OUTPUT, "sin failsafe por medida vieja");
+        check(trace.state[1199] == CONTROL_RUN, "no retoma después de la medida vieja");
+        freeTrace(trace);
+    }
+
+    // Latencia lectura -> actuación en 60 s
+    printf("\nlatencia lectura -> actuación, 60 s:\n");
+    float fixedSpread = 0.0f;
+    for (int mode = LATENCY_FIXED; mode <= LATENCY_FREE; mode++) {
+        PidController pid = makePid();
+        Plant plant;
+        StepScenario scenario;
+        Trace trace = makeTrace(120000);
+        runLoop(pid, plant, scenario, (LatencyMode)mode, trace);
+        const ControlLatency& l = trace.latency;
+        printf("   %-12s mín %.1f us, media %.1f us, máx %.1f us, sobre %d us: %u\n", latencyName[mode], l.minUs,
+               l.averageUs(), l.maxUs, CONTROL_LATENCY_US, l.late);
+        if (mode == LATENCY_FIXED) fixedSpread = l.maxUs - l.minUs;
+        freeTrace(trace);
+    }
+    printf("   un tick      %d us\n", SIM_PERIOD_US);
+    check(fixedSpread == 0.0f, "la latencia fija varía");
+    check(CONTROL_LATENCY_US * 2 <= SIM_PERIOD_US, "la latencia pasa de medio tick");
+
+    printf("\n%s\n", failures ? "FALLA" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,147 @@
+/*
+  Kernel de conversión por bloques contra la conversión muestra a muestra (build nativo)
+
+  Compilar desde Testing/:
+    g++ -O3 -std=gnu++14 -Isrc tools/convert_bench.cpp -o convert_bench
+  (con -mavx2 el kernel por bloques se vectoriza con AVX en lugar de SSE)
+
+  1) Igualdad: pressureConvertBatch da bit a bit lo mismo que
+     pressureConvertClamped para cada calibración de pressure_convert.h, con
+     todas las cuentas de 16 bits (uint16_t e int16_t) y un barrido de
+     int32_t; con unclampedCal() da lo mismo que pressureConvert. También
+     con bloques cortos y desalineados, que pasan por la cola escalar del
+     bucle vectorizado.
+  2) Throughput: bloques de 1024 cuentas como el "#BENCH convert" del
+     firmware, muestra a muestra (sin vectorizar) y por bloques, en ns por
+     muestra.
+
+  Devuelve 1 si falla alguna comprobación.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "pressure_convert.h"
+
+#define BENCH_BLOCK    1024      // PRESSURE_BENCH_SAMPLES del firmware
+#define BENCH_ROUNDS   20000
+
+struct NamedCal {
+    const char* name;
+    const LinearCal* cal;
+};
+
+static const NamedCal cals[] = {
+    {"abplln",        &CAL_ABPLLN},
+    {"elvh",          &CAL_ELVH_BAR},
+    {"sscdann",       &CAL_SSCDANN},
+    {"sm4291",        &CAL_SM4291_I2C},
+    {"sm4291-analog", &CAL_SM4291_ANALOG},
+};
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    if (!ok) {
+        if (failures < 10) printf("  FALLA: %s\n", what);
+        failures++;
+    }
+}
+
+// Compara el kernel por bloques con la conversión de a una muestra sobre
+// raw[0..n), desde varios desplazamientos y largos
+template <typename RawT>
+static void checkEqual(const std::vector<RawT>& raw, const NamedCal& c) {
+    const LinearCal unclamped = unclampedCal(*c.cal);
+    const size_t n = raw.size();
+    std::vector<float> batch(n), batchRaw(n), scalar(n), scalarRaw(n);
+    for (size_t i = 0; i < n; i++) {
+        scalar[i] = pressureConvertClamped((float)raw[i], *c.cal);
+        scalarRaw[i] = pressureConvert((float)raw[i], *c.cal);
+    }
+
+    pressureConvertBatch(raw.data(), batch.data(), n, *c.cal);
+    pressureConvertBatch(raw.data(), batchRaw.data(), n, unclamped);
+    char what[96];
+    snprintf(what, sizeof(what), "%s: bloque recortado distinto (%zu cuentas)", c.name, n);
+    check(memcmp(batch.data(), scalar.data(), n * sizeof(float)) == 0, what);
+    snprintf(what, sizeof(what), "%s: bloque sin recortar distinto (%zu cuentas)", c.name, n);
+    check(memcmp(batchRaw.data(), scalarRaw.data(), n * sizeof(float)) == 0, what);
+
+    // Bloques cortos y desalineados
+    for (size_t offset = 1; offset < 4 && offset < n; offset++) {
+        for (size_t len = 1; len <= 19 && offset + len <= n; len++) {
+            float out[19];
+            pressureConvertBatch(raw.data() + offset, out, len, *c.cal);
+            snprintf(what, sizeof(what), "%s: bloque de %zu desde %zu", c.name, len, offset);
+            check(memcmp(out, &scalar[offset], len * sizeof(float)) == 0, what);
+        }
+    }
+}
+
+static double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// La conversión como la hacen los drivers, sin que GCC la vectorice
+__attribute__((noinline, optimize("no-tree-vectorize")))
+static void convertScalar(const uint16_t* raw, float* out, size_t n, const LinearCal& cal) {
+    for (size_t i = 0; i < n; i++) out[i] = pressureConvertClamped(raw[i], cal);
+}
+
+__attribute__((noinline))
+static void convertBatch(const uint16_t* raw, float* out, size_t n, const LinearCal& cal) {
+    pressureConvertBatch(raw, out, n, cal);
+}
+
+int main() {
+    printf("1) Igualdad por bloques / de a una muestra\n");
+    std::vector<uint16_t> all16(65536);
+    std::vector<int16_t> allSigned16(65536);
+    std::vector<int32_t> sweep32;
+    for (uint32_t i = 0; i < 65536; i++) {
+        all16[i] = (uint16_t)i;
+        allSigned16[i] = (int16_t)(i - 32768);
+    }
+    for (int64_t v = -(1LL << 31); v < (1LL << 31); v += 65537) sweep32.push_back((int32_t)v);
+    sweep32.push_back(INT32_MAX);
+    for (const NamedCal& c : cals) {
+        checkEqual(all16, c);
+        checkEqual(allSigned16, c);
+        checkEqual(sweep32, c);
+    }
+    printf("   %zu calibraciones x %zu cuentas\n", sizeof(cals) / sizeof(cals[0]),
+           all16.size() + allSigned16.size() + sweep32.size());
+
+#if defined(__AVX2__)
+    const char* isa = "AVX2";
+#elif defined(__AVX__)
+    const char* isa = "AVX";
+#elif defined(__SSE2__)
+    const char* isa = "SSE2";
+#else
+    const char* isa = "sin SIMD";
+#endif
+    printf("2) Throughput (%s), bloques de %d cuentas\n", isa, BENCH_BLOCK);
+    static uint16_t raw[BENCH_BLOCK];
+    static float out[BENCH_BLOCK];
+    for (size_t i = 0; i < BENCH_BLOCK; i++) raw[i] = (uint16_t)((i * 37u) & 0x3FFF);
+
+    double start = nowSeconds();
+    for (int r = 0; r < BENCH_ROUNDS; r++) convertScalar(raw, out, BENCH_BLOCK, CAL_ABPLLN);
+    double scalarNs = (nowSeconds() - start) * 1e9 / ((double)BENCH_ROUNDS * BENCH_BLOCK);
+    float scalarLast = out[BENCH_BLOCK - 1];
+
+    start = nowSeconds();
+    for (int r = 0; r < BENCH_ROUNDS; r++) convertBatch(raw, out, BENCH_BLOCK, CAL_ABPLLN);
+    double batchNs = (nowSeconds() - start) * 1e9 / ((double)BENCH_ROUNDS * BENCH_BLOCK);
+    check(out[BENCH_BLOCK - 1] == scalarLast, "el bloque medido difiere del escalar");
+
+    printf("   de a una muestra %.3f ns/muestra, por bloques %.3f ns/muestra (x%.1f)\n", scalarNs, batchNs,
+           scalarNs / batchNs);
+    printf("%s\n", failures ? "FALLA" : "OK");
+    return failures ? 1 : 0;
+}
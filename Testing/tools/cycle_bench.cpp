@@ -0,0 +1,275 @@
+/*
+  Prueba con ciclos sintéticos y costo por ciclo del segmentador (build nativo)
+
+  Compilar desde Testing/:
+    g++ -O2 -std=gnu++14 -Isrc tools/cycle_bench.cpp -o cycle_bench
+
+  1) Ciclos sintéticos a 2 kHz con ruido (desvío SIM_NOISE mbar), pausas de
+     reposo al azar y duraciones y profundidades que varían ±10 % por ciclo:
+     - trapecio: subida lineal, meseta y bajada lineal (rasgos exactos conocidos)
+     - escalón: sube a la mitad, espera y sube al total (otra forma de ciclo)
+     - fuga: como el trapecio pero la meseta pierde la mitad de la succión
+     Se comprueba que se detecte cada ciclo, que los rasgos del trapecio estén
+     dentro de tolerancia y que cada familia quede en su propia plantilla
+     (aprendidas solas), con NCC y con DTW.
+  2) Un ciclo de 70 s se cierra truncado a los 60 s.
+  3) Costo: ns por muestra del flujo completo y us por cierre de ciclo con
+     CYCLE_MAX_TEMPLATES plantillas cargadas, para cada métrica.
+
+  Devuelve 1 si alguna comprobación falla.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "cycle_segmenter.h"
+
+#define SIM_RATE_HZ     2000.0
+#define SIM_PERIOD_US   500
+#define SIM_NOISE       1.0      // mbar
+#define SIM_BASELINE    -2.0     // mbar en reposo
+#define SIM_CYCLES      300
+#define BENCH_ROUNDS    5
+
+enum Family { FAMILY_TRAPEZOID, FAMILY_STEP, FAMILY_LEAK, FAMILIES };
+static const char* familyName[FAMILIES] = {"trapecio", "escalón", "fuga"};
+
+struct SimCycle {
+    Family family;
+    double depth;       // mbar bajo la línea de base
+    double riseMs, plateauMs, fallMs;
+    long startSample;   // Inicio de la subida
+};
+
+static double uniform() { return rand() / (RAND_MAX + 1.0); }
+
+static double gaussian() {
+    double u1 = uniform() + 1e-12, u2 = uniform();
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+static double vary(double value) { return value * (0.9 + 0.2 * uniform()); }
+
+// Profundidad del ciclo t ms después del inicio de la subida
+static double cycleDepth(const SimCycle& c, double t) {
+    double r = c.riseMs, p = c.plateauMs, f = c.fallMs, d = c.depth;
+    if (t < 0.0 || t > r + p + f) return 0.0;
+    double top = d;
+    if (c.family == FAMILY_LEAK && t > r) top = d * (1.0 - 0.5 * fmin(t - r, p) / p);
+    if (c.family == FAMILY_STEP) {
+        // Media subida, un tercio de la meseta esperando y la otra media
+        double half = r / 2.0, wait = p / 3.0;
+        if (t < half) return 0.5 * d * t / half;
+        if (t < half + wait) return 0.5 * d;
+        if (t < r + wait) return 0.5 * d + 0.5 * d * (t - half - wait) / half;
+        if (t < r + p) return d;
+        return d * (1.0 - (t - r - p) / f);
+    }
+    if (t < r) return d * t / r;
+    if (t < r + p) return top;
+    return top * (1.0 - (t - r - p) / f);
+}
+
+static double totalMs(const SimCycle& c) { return c.riseMs + c.plateauMs + c.fallMs; }
+
+static double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static SimCycle cycles[SIM_CYCLES];
+static float* stream;
+static long streamLength;
+
+// Secuencia de ciclos con pausas y ruido; las fugas y los escalones se
+// intercalan entre los trapecios
+static void buildStream() {
+    long sample = (long)(0.5 * SIM_RATE_HZ);
+    for (int i = 0; i < SIM_CYCLES; i++) {
+        SimCycle& c = cycles[i];
+        c.family = (i % 10 == 7) ? FAMILY_LEAK : (i % 3 == 1) ? FAMILY_STEP : FAMILY_TRAPEZOID;
+        c.depth = vary(300.0);
+        c.riseMs = vary(60.0);
+        c.plateauMs = vary(400.0);
+        c.fallMs = vary(40.0);
+        c.startSample = sample;
+        sample += (long)(totalMs(c) * SIM_RATE_HZ / 1000.0) + (long)((0.2 + 0.2 * uniform()) * SIM_RATE_HZ);
+    }
+    streamLength = sample + (long)(0.5 * SIM_RATE_HZ);
+    stream = (float*)malloc(sizeof(float) * streamLength);
+    int next = 0;
+    for (long n = 0; n < streamLength; n++) {
+        double depth = 0.0;
+        while (next < SIM_CYCLES && n > cycles[next].startSample + (long)(totalMs(cycles[next]) * SIM_RATE_HZ / 1000.0) + 1) next++;
+        if (next < SIM_CYCLES) depth = cycleDepth(cycles[next], (n - cycles[next].startSample) * 1000.0 / SIM_RATE_HZ);
+        stream[n] = (float)(SIM_BASELINE - depth + SIM_NOISE * gaussian());
+    }
+}
+
+static bool within(double value, double expected, double tolerance) {
+    return fabs(value - expected) <= tolerance;
+}
+
+// Pasa el flujo por el segmentador y compara con los ciclos generados
+static int checkStream(CycleMetric metric) {
+    CycleSegmenter segmenter;
+    CycleConfig config = defaultCycleConfig();
+    config.metric = metric;
+    segmenter.setConfig(config);
+
+    int failures = 0, detected = 0, featureErrors = 0;
+    int familyTemplate[FAMILIES] = {-1, -1, -1};
+    int misassigned = 0;
+    double worstRise = 0.0, worstFall = 0.0, worstPlateau = 0.0, worstArea = 0.0, worstPeak = 0.0;
+    for (long n = 0; n < streamLength; n++) {
+        if (!segmenter.add((uint32_t)(n * SIM_PERIOD_US), stream[n])) continue;
+        const CycleFeatures& f = segmenter.lastCycle();
+        if (detected >= SIM_CYCLES) {
+            detected++;
+            continue;
+        }
+        const SimCycle& c = cycles[detected++];
+
+        // El inicio es el cruce del borde durante la subida
+        double startUs = (c.startSample * 1000.0 / SIM_RATE_HZ + CYCLE_EDGE_MBAR / c.depth * c.riseMs) * 1000.0;
+        if (!within(f.startUs, startUs, 2000.0)) {
+            printf("  ciclo %d (%s): inicio %u us, esperado %.0f\n", detected - 1, familyName[c.family], f.startUs, startUs);
+            featureErrors++;
+        }
+
+        int& assigned = familyTemplate[c.family];
+        if (assigned < 0) assigned = f.templateId;
+        if (f.templateId < 0 || f.templateId != assigned) misassigned++;
+
+        if (c.family != FAMILY_TRAPEZOID) continue;
+        // Rasgos exactos del trapecio
+        double d = c.depth, e = CYCLE_EDGE_MBAR;
+        double riseMs = 0.8 * c.riseMs, fallMs = 0.8 * c.fallMs;
+        double plateauMs = c.plateauMs + 0.1 * (c.riseMs + c.fallMs);
+        double durationMs = totalMs(c) - e / d * (c.riseMs + c.fallMs);
+        double areaMbarS = (d * (c.plateauMs + 0.5 * (c.riseMs + c.fallMs)) - 0.5 * e * e / d * (c.riseMs + c.fallMs)) / 1000.0;
+        double peakMbar = SIM_BASELINE - d;
+
+        double errRise = f.riseUs / 1000.0 - riseMs, errFall = f.fallUs / 1000.0 - fallMs;
+        double errPlateau = f.plateauUs / 1000.0 - plateauMs;
+        double errArea = (f.areaMbarS - areaMbarS) / areaMbarS;
+        double errPeak = f.peakMbar - peakMbar;
+        if (fabs(errRise) > worstRise) worstRise = fabs(errRise);
+        if (fabs(errFall) > worstFall) worstFall = fabs(errFall);
+        if (fabs(errPlateau) > worstPlateau) worstPlateau = fabs(errPlateau);
+        if (fabs(errArea) > worstArea) worstArea = fabs(errArea);
+        if (fabs(errPeak) > worstPeak) worstPeak = fabs(errPeak);
+        // Tolerancias: ~2 puntos de envolvente en los tiempos, el ruido en el pico
+        if (fabs(errRise) > 8.0 || fabs(errFall) > 8.0 || fabs(errPlateau) > 12.0 ||
+            !within(f.durationUs / 1000.0, durationMs, 3.0) || fabs(errArea) > 0.02 ||
+            errPeak > 0.5 || errPeak < -6.0 * SIM_NOISE) {
+            printf("  ciclo %d: subida %+.1f ms, bajada %+.1f ms, meseta %+.1f ms, duración %u us (%.0f), área %+.2f %%, pico %+.1f mbar\n",
+                   detected - 1, errRise, errFall, errPlateau, f.durationUs, durationMs * 1000.0, errArea * 100.0, errPeak);
+            featureErrors++;
+        }
+    }
+
+    printf("%s: %d de %d ciclos detectados\n", metric == CYCLE_METRIC_NCC ? "NCC" : "DTW", detected, SIM_CYCLES);
+    printf("  peor error del trapecio: subida %.2f ms, bajada %.2f ms, meseta %.2f ms, área %.2f %%, pico %.2f mbar\n",
+           worstRise, worstFall, worstPlateau, worstArea * 100.0, worstPeak);
+    printf("  plantillas:");
+    for (int fam = 0; fam < FAMILIES; fam++) printf(" %s=%d", familyName[fam], familyTemplate[fam]);
+    printf("  (ciclos mal asignados: %d)\n", misassigned);
+    for (uint8_t t = 0; t < CYCLE_MAX_TEMPLATES; t++) {
+        if (segmenter.hasTemplate(t)) printf("  plantilla %u: %u ciclos\n", t, segmenter.matches(t));
+    }
+
+    if (detected != SIM_CYCLES) failures++;
+    if (featureErrors) failures++;
+    if (misassigned) failures++;
+    for (int a = 0; a < FAMILIES; a++) {
+        for (int b = a + 1; b < FAMILIES; b++) {
+            if (familyTemplate[a] == familyTemplate[b]) {
+                printf("  %s y %s comparten plantilla\n", familyName[a], familyName[b]);
+                failures++;
+            }
+        }
+    }
+    return failures;
+}
+
+// Un ciclo de 70 s se cierra a los 60 s con CYCLE_TRUNCATED
+static int checkTruncation() {
+    CycleSegmenter segmenter;
+    int closed = 0, truncated = 0;
+    long total = (long)(75 * SIM_RATE_HZ);
+    for (long n = 0; n < total; n++) {
+        double t = n / SIM_RATE_HZ;
+        float mbar = (float)(SIM_BASELINE - ((t > 1.0 && t < 71.0) ? 200.0 : 0.0) + SIM_NOISE * gaussian());
+        if (segmenter.add((uint32_t)(n * SIM_PERIOD_US), mbar)) {
+            closed++;
+            if (segmenter.lastCycle().flags & CYCLE_TRUNCATED) truncated++;
+        }
+    }
+    printf("ciclo de 70 s: %d cierres, %d truncados (tamaño del segmentador %u bytes)\n", closed, truncated,
+           (unsigned)sizeof(CycleSegmenter));
+    // El resto después del corte (10 s) es un segundo ciclo
+    return (closed == 2 && truncated == 1) ? 0 : 1;
+}
+
+// Costo por muestra y por cierre, con todas las plantillas cargadas
+static void benchmark(CycleMetric metric) {
+    CycleSegmenter segmenter;
+    CycleConfig config = defaultCycleConfig();
+    config.metric = metric;
+    config.autoLearn = false;
+    segmenter.setConfig(config);
+    // Plantillas: las formas de los primeros ciclos del flujo
+    uint8_t loaded = 0;
+    for (long n = 0; n < streamLength && loaded < CYCLE_MAX_TEMPLATES; n++) {
+        if (segmenter.add((uint32_t)(n * SIM_PERIOD_US), stream[n])) segmenter.learn(loaded++);
+    }
+
+    double closeSeconds = 0.0, bestClose = 1e9;
+    long closes = 0;
+    double start = nowSeconds();
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        segmenter.reset();
+        for (long n = 0; n < streamLength; n++) {
+            uint32_t us = (uint32_t)(n * SIM_PERIOD_US);
+            // Los cierres se miden aparte: solo la muestra que cierra
+            if (segmenter.inCycle() && stream[n] > segmenter.baseline() - CYCLE_EDGE_MBAR) {
+                double t0 = nowSeconds();
+                bool closedNow = segmenter.add(us, stream[n]);
+                double dt = nowSeconds() - t0;
+                if (closedNow) {
+                    closeSeconds += dt;
+                    if (dt < bestClose) bestClose = dt;
+                    closes++;
+                }
+            } else {
+                segmenter.add(us, stream[n]);
+            }
+        }
+    }
+    double totalSeconds = nowSeconds() - start;
+    long samples = streamLength * BENCH_ROUNDS;
+    printf("costo %s (%u plantillas): %.1f ns por muestra (%.0fx tiempo real), cierre %.2f us promedio, %.2f us mínimo\n",
+           metric == CYCLE_METRIC_NCC ? "NCC" : "DTW", loaded, totalSeconds * 1e9 / samples,
+           (samples / SIM_RATE_HZ) / totalSeconds, closeSeconds * 1e6 / closes, bestClose * 1e6);
+}
+
+int main(int argc, char** argv) {
+    srand(argc > 1 ? (unsigned)atoi(argv[1]) : 1);
+    buildStream();
+    printf("%d ciclos sintéticos, %.0f s a %.0f Hz, ruido %.1f mbar\n\n", SIM_CYCLES, streamLength / SIM_RATE_HZ,
+           SIM_RATE_HZ, SIM_NOISE);
+
+    int failures = checkStream(CYCLE_METRIC_NCC);
+    failures += checkStream(CYCLE_METRIC_DTW);
+    failures += checkTruncation();
+    printf("\n");
+    benchmark(CYCLE_METRIC_NCC);
+    benchmark(CYCLE_METRIC_DTW);
+    free(stream);
+
+    printf("\n%s\n", failures ? "FALLA" : "OK");
+    return failures ? 1 : 0;
+}
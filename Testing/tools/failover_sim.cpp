@@ -0,0 +1,162 @@
+/*
+  Simulación de fallas para la redundancia I2C / analógico (build nativo)
+
+  Compilar desde Testing/:
+    g++ -O2 -std=gnu++14 -Isrc tools/failover_sim.cpp -o failover_sim
+
+  Cada escenario genera 5 s de una línea a -200 mbar con ripple y ruido en los
+  dos canales, inyecta una falla entre 1 s y 3 s y reporta:
+  - det: ticks desde el comienzo de la falla hasta el cambio de canal (-1 si
+    no hizo falta cambiar: la falla fue del canal de respaldo)
+  - huecos: ticks sin valor válido (solo esperables si fallan los dos canales)
+  - err: máximo error de la salida respecto de la presión real mientras la
+    salida viene del canal sano (debe quedar en el orden del ruido)
+  - vuelta: ticks desde el fin de la falla hasta volver al I2C
+  - trabado: ticks en que se entregó como válido el valor trabado del I2C
+
+  Cada escenario tiene sus límites (tabla expectations): detección, huecos,
+  error, vuelta y cantidad de cambios. Con el I2C trabado se comprueba el
+  límite documentado en sensor_redundancy.h: la falla se detecta a los
+  REDUNDANCY_STUCK_SAMPLES ticks y hasta entonces el valor trabado sale como
+  válido.
+
+  Devuelve 1 si falla alguna comprobación.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "sensor_redundancy.h"
+
+#define SIM_RATE_HZ     2000
+#define SIM_TICKS       (5 * SIM_RATE_HZ)
+#define FAULT_START     (1 * SIM_RATE_HZ)
+#define FAULT_END       (3 * SIM_RATE_HZ)
+
+enum Scenario {
+    I2C_BUS, I2C_STUCK, I2C_RANGE, I2C_NOISY, ANALOG_OPEN, ANALOG_STUCK, BOTH_BUS, SCENARIOS
+};
+
+// Límites de cada escenario (det = -1: no debe cambiar de canal)
+struct Expectation {
+    int minDetect;
+    int maxDetect;
+    int gaps;              // Huecos exactos
+    float maxError;        // mbar
+    int maxReturn;         // -1: no debe volver (nunca cambió)
+    uint32_t switches;
+};
+
+#define ANALOG_NOISE_MAX  1.5f     // Ruido uniforme de desvío 0.8: a lo sumo 1.39 mbar
+
+static const Expectation expectations[SCENARIOS] = {
+    /* I2C_BUS      */ {0, 0, 0, ANALOG_NOISE_MAX, REDUNDANCY_RECOVER_SAMPLES, 2},
+    /* I2C_STUCK    */ {REDUNDANCY_STUCK_SAMPLES, REDUNDANCY_STUCK_SAMPLES, 0, ANALOG_NOISE_MAX,
+                        REDUNDANCY_RECOVER_SAMPLES, 2},
+    /* I2C_RANGE    */ {0, 0, 0, ANALOG_NOISE_MAX, REDUNDANCY_RECOVER_SAMPLES, 2},
+    /* I2C_NOISY    */ {1, 20, 0, ANALOG_NOISE_MAX, 3 * REDUNDANCY_RECOVER_SAMPLES, 2},
+    /* ANALOG_OPEN  */ {-1, -1, 0, 0.0f, -1, 0},
+    /* ANALOG_STUCK */ {-1, -1, 0, 0.0f, -1, 0},
+    /* BOTH_BUS     */ {-1, -1, FAULT_END - FAULT_START, 0.0f, -1, 0},
+};
+
+static int failures = 0;
+
+static void check(bool ok, const char* scenario, const char* what) {
+    if (!ok) {
+        printf("  FALLA: %s: %s\n", scenario, what);
+        failures++;
+    }
+}
+
+static const char* scenarioName(int s) {
+    switch (s) {
+        case I2C_BUS:      return "i2c sin respuesta";
+        case I2C_STUCK:    return "i2c trabado";
+        case I2C_RANGE:    return "i2c fuera de rango";
+        case I2C_NOISY:    return "i2c ruidoso";
+        case ANALOG_OPEN:  return "analogico cortado";
+        case ANALOG_STUCK: return "analogico trabado";
+        case BOTH_BUS:     return "i2c sin respuesta + analogico cortado";
+        default:           return "?";
+    }
+}
+
+static float noise(float sigma) {
+    return sigma * ((rand() / (float)RAND_MAX) - 0.5f) * 3.46f;  // uniforme con desvío sigma
+}
+
+int main() {
+    srand(1);
+    printf("%-40s %6s %7s %8s %7s %8s %8s\n", "escenario", "det", "huecos", "err", "vuelta", "cambios",
+           "trabado");
+
+    for (int scenario = 0; scenario < SCENARIOS; scenario++) {
+        RedundancyManager manager;
+        int detectTick = -1, returnTick = -1, gaps = 0, stuckForwarded = 0;
+        float maxError = 0.0f;
+        float stuckI2c = 0.0f, stuckAnalog = 0.0f;
+
+        for (int tick = 0; tick < SIM_TICKS; tick++) {
+            float t = tick / (float)SIM_RATE_HZ;
+            float truth = -200.0f + 3.0f * sinf(2.0f * (float)M_PI * 2.0f * t);
+            float i2c = truth + noise(0.2f);
+            float analog = truth + noise(0.8f);
+            bool i2cOk = true;
+            bool inFault = tick >= FAULT_START && tick < FAULT_END;
+
+            if (tick == FAULT_START) {
+                stuckI2c = i2c;
+                stuckAnalog = analog;
+            }
+            if (inFault) {
+                switch (scenario) {
+                    case I2C_BUS:      i2cOk = false; i2c = -1.0f; break;
+                    case I2C_STUCK:    i2c = stuckI2c; break;
+                    case I2C_RANGE:    i2c = -600.0f; break;
+                    case I2C_NOISY:    i2c += noise(40.0f); break;
+                    case ANALOG_OPEN:  analog = 62.5f; break;
+                    case ANALOG_STUCK: analog = stuckAnalog; break;
+                    case BOTH_BUS:     i2cOk = false; i2c = -1.0f; analog = 62.5f; break;
+                }
+            }
+
+            RedundancyOutput out = manager.update(i2c, i2cOk, analog, true);
+            if (manager.wantsBusRecovery()) manager.busRecovered();
+
+            if (scenario == I2C_STUCK && inFault && out.valid && out.channel == CHANNEL_I2C &&
+                out.value == stuckI2c) {
+                stuckForwarded++;
+            }
+            if (!out.valid) {
+                gaps++;
+            } else if (tick >= FAULT_START && out.channel == CHANNEL_ANALOG) {
+                float error = fabsf(out.value - truth);
+                if (error > maxError) maxError = error;
+            }
+            if (out.switched && out.channel == CHANNEL_ANALOG && detectTick < 0) {
+                detectTick = tick - FAULT_START;
+            }
+            if (out.switched && out.channel == CHANNEL_I2C && tick >= FAULT_END && returnTick < 0) {
+                returnTick = tick - FAULT_END;
+            }
+        }
+
+        printf("%-40s %6d %7d %8.2f %7d %8u %8d\n", scenarioName(scenario), detectTick, gaps,
+               maxError, returnTick, (unsigned)manager.switchCount, stuckForwarded);
+
+        const Expectation& e = expectations[scenario];
+        const char* name = scenarioName(scenario);
+        check(detectTick >= e.minDetect && detectTick <= e.maxDetect, name, "tick de detección");
+        check(gaps == e.gaps, name, "huecos");
+        check(maxError <= e.maxError, name, "error máximo");
+        check(e.maxReturn < 0 ? returnTick < 0 : returnTick >= 0 && returnTick <= e.maxReturn, name,
+              "vuelta al I2C");
+        check(manager.switchCount == e.switches, name, "cambios de canal");
+        if (scenario == I2C_STUCK) {
+            check(stuckForwarded == REDUNDANCY_STUCK_SAMPLES, name, "valores trabados entregados");
+        }
+    }
+    printf("%s\n", failures ? "FALLA" : "OK");
+    return failures ? 1 : 0;
+}
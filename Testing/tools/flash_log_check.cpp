@@ -0,0 +1,386 @@
+/*
+  Prueba del log circular de flash_log.h sobre una flash emulada en un archivo
+  (build nativo)
+
+  Compilar desde Testing/:
+    g++ -O2 -std=gnu++14 -Isrc tools/flash_log_check.cpp -o flash_log_check
+
+  La flash vive en un archivo con semántica NOR: programar solo baja bits,
+  borrar deja 0xFF y el borrado tarda FLASH_ERASE_POLLS consultas de busy().
+  Cada arranque abre otra FileStorage y monta otro FlashLog sobre el mismo
+  archivo, como el firmware después de un reset.
+
+  1) Vueltas completas: desde la memoria en blanco se escriben varias vueltas;
+     cada bloque terminado se decodifica y se compara con las muestras
+     generadas, y los que siguen entre oldestSeq() y newestSeq() se releen
+     intactos.
+  2) Borrado sin espera: poll() inicia el borrado y vuelve; mientras
+     busy() es true no programa ni lee (readBlock() devuelve false), y nunca
+     programa sobre bytes sin borrar.
+  3) Cortes de energía: tras un número al azar de operaciones se corta la
+     alimentación en medio de una página (un prefijo escrito y el último
+     byte a medias) o de un borrado (bytes al azar en 0xFF). Al remontar:
+     newestSeq() es el último bloque completo, todos los bloques completos
+     del rango se leen intactos, ninguno cortado pasa el CRC y lo que se
+     escribe después sigue con secuencias mayores.
+  4) CRC al montar: un bloque con la cabecera intacta y un byte del payload
+     cambiado (en medio de un sector y al principio de uno) no cuenta como
+     el más nuevo.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <map>
+#include <memory>
+#include "flash_log.h"
+
+#define FLASH_SECTOR        4096
+#define FLASH_SECTORS       16         // 128 bloques
+#define FLASH_PAGE          256
+#define FLASH_ERASE_POLLS   12
+#define FLASH_PERIOD_US     500
+#define FLASH_POLL_EVERY    4          // Muestras por llamada a poll()
+#define FLASH_WRAP_SAMPLES  150000     // Unas 5 vueltas
+#define FLASH_CUTS          60
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    if (!ok) {
+        if (failures < 10) printf("  FALLA: %s\n", what);
+        failures++;
+    }
+}
+
+// Flash NOR en un archivo, con corte de energía programable
+class FileStorage : public LogStorage {
+private:
+    FILE* file;
+    int32_t erasingSector;       // -1 sin borrado en curso
+    uint32_t erasePolls;
+    int64_t opsBeforeCut;        // -1 sin corte
+
+    void load(uint32_t addr, uint8_t* data, uint32_t len) {
+        fseek(file, (long)addr, SEEK_SET);
+        if (fread(data, 1, len, file) != len) memset(data, 0xFF, len);
+    }
+
+    void store(uint32_t addr, const uint8_t* data, uint32_t len) {
+        fseek(file, (long)addr, SEEK_SET);
+        fwrite(data, 1, len, file);
+    }
+
+    // true si esta operación es la del corte
+    bool cutNow() {
+        if (opsBeforeCut < 0) return false;
+        if (opsBeforeCut-- > 0) return false;
+        powerLost = true;
+        return true;
+    }
+
+    void finishErase(bool partial) {
+        uint8_t sector[FLASH_SECTOR];
+        load((uint32_t)erasingSector * FLASH_SECTOR, sector, FLASH_SECTOR);
+        for (uint32_t i = 0; i < FLASH_SECTOR; i++) {
+            if (!partial || rand() % 2) sector[i] = 0xFF;
+        }
+        store((uint32_t)erasingSector * FLASH_SECTOR, sector, FLASH_SECTOR);
+        erasingSector = -1;
+    }
+
+public:
+    bool powerLost = false;
+    uint32_t programs = 0, erases = 0, busyPolls = 0;
+    uint32_t programWhileErasing = 0, readWhileErasing = 0, programNotErased = 0;
+    uint32_t cutPages = 0, cutErases = 0;
+
+    FileStorage(FILE* f, int64_t cutAfter)
+        : file(f), erasingSector(-1), erasePolls(0), opsBeforeCut(cutAfter) {}
+
+    uint32_t size() const override { return FLASH_SECTOR * FLASH_SECTORS; }
+    uint32_t pageSize() const override { return FLASH_PAGE; }
+    uint32_t sectorSize() const override { return FLASH_SECTOR; }
+
+    bool read(uint32_t addr, void* data, uint32_t len) override {
+        if (powerLost || addr + len > size()) return false;
+        if (erasingSector >= 0) {
+            readWhileErasing++;
+            return false;
+        }
+        load(addr, (uint8_t*)data, len);
+        return true;
+    }
+
+    bool program(uint32_t addr, const void* data, uint32_t len) override {
+        if (powerLost || addr + len > size() || len > FLASH_PAGE) return false;
+        if (erasingSector >= 0) {
+            programWhileErasing++;
+            return false;
+        }
+        uint8_t page[FLASH_PAGE];
+        const uint8_t* in = (const uint8_t*)data;
+        load(addr, page, len);
+        for (uint32_t i = 0; i < len; i++) {
+            if ((page[i] & in[i]) != in[i]) programNotErased++;
+        }
+        uint32_t written = len;
+        if (cutNow()) {
+            // Corte en medio de la página: un prefijo y un byte a medias
+            written = (uint32_t)rand() % len;
+            page[written] &= in[written] | (uint8_t)rand();
+            cutPages++;
+        }
+        for (uint32_t i = 0; i < written; i++) page[i] &= in[i];
+        store(addr, page, len);
+        programs++;
+        return !powerLost;
+    }
+
+    bool eraseStart(uint32_t addr, uint32_t len) override {
+        if (powerLost || len != FLASH_SECTOR || addr % FLASH_SECTOR != 0 || addr >= size()) return false;
+        if (erasingSector >= 0) return false;
+        erasingSector = (int32_t)(addr / FLASH_SECTOR);
+        erasePolls = FLASH_ERASE_POLLS;
+        erases++;
+        return true;
+    }
+
+    bool busy() override {
+        if (powerLost || erasingSector < 0) return false;
+        busyPolls++;
+        if (cutNow()) {
+            finishErase(true);
+            cutErases++;
+            return false;
+        }
+        if (--erasePolls > 0) return true;
+        finishErase(false);
+        return false;
+    }
+};
+
+// Señal de prueba: succión que oscila con un poco de ruido determinista
+static float sampleValue(uint32_t i) {
+    return -150.0f - 80.0f * sinf((float)i * 0.003f) + (float)((i * 2654435761u >> 28) & 7) * 0.013f;
+}
+
+static int32_t quantize(float value) {
+    return (int32_t)(value * LOG_VALUE_SCALE + (value >= 0 ? 0.5f : -0.5f));
+}
+
+// Bloque terminado: índice de su primera muestra y cantidad
+struct Committed {
+    uint32_t first;
+    uint16_t count;
+};
+
+struct Harness {
+    FILE* file;
+    std::map<uint32_t, Committed> committed;
+    uint32_t nextSample = 0;
+    uint32_t lastSampleLogged = 0;   // Índice + 1 de la última muestra en un bloque terminado
+    bool anyLogged = false;
+    uint32_t blockErrors = 0;        // Bloques terminados que no se leen o no coinciden
+    uint32_t rereadErrors = 0;
+
+    // Decodifica el bloque seq y lo compara con la señal; guarda el rango
+    bool record(FlashLog& log, uint32_t seq) {
+        LogBlock block;
+        static uint32_t timestamps[LOG_PAYLOAD_SIZE + 1];
+        static float values[LOG_PAYLOAD_SIZE + 1];
+        if (!log.readBlock(seq, block)) return false;
+        uint16_t n = logDecodeBlock(block, timestamps, values, LOG_PAYLOAD_SIZE + 1);
+        if (n == 0 || n != block.header.sampleCount) return false;
+        uint32_t first = timestamps[0] / FLASH_PERIOD_US;
+        if (anyLogged && first < lastSampleLogged) return false;
+        for (uint16_t k = 0; k < n; k++) {
+            uint32_t i = first + k;
+            if (timestamps[k] != i * FLASH_PERIOD_US) return false;
+            if ((int32_t)lroundf(values[k] * LOG_VALUE_SCALE) != quantize(sampleValue(i))) return false;
+        }
+        committed[seq] = {first, n};
+        lastSampleLogged = first + n;
+        anyLogged = true;
+        return true;
+    }
+
+    // Bloques terminados que siguen en la memoria: iguales a cuando se escribieron
+    void reread(FlashLog& log) {
+        if (log.empty()) return;
+        LogBlock block;
+        static uint32_t timestamps[LOG_PAYLOAD_SIZE + 1];
+        static float values[LOG_PAYLOAD_SIZE + 1];
+        for (auto& entry : committed) {
+            if (entry.first < log.oldestSeq() || entry.first > log.newestSeq()) continue;
+            if (!log.readBlock(entry.first, block) ||
+                logDecodeBlock(block, timestamps, values, LOG_PAYLOAD_SIZE + 1) != entry.second.count ||
+                timestamps[0] != entry.second.first * FLASH_PERIOD_US) {
+                rereadErrors++;
+            }
+        }
+    }
+
+    // Corre el "firmware" hasta 'samples' muestras o hasta el corte
+    void run(FlashLog& log, FileStorage& storage, uint32_t samples) {
+        uint32_t seen = log.empty() ? 0xFFFFFFFFu : log.newestSeq();
+        for (uint32_t s = 0; s < samples && !storage.powerLost; s++) {
+            uint32_t i = nextSample++;
+            log.append(i * FLASH_PERIOD_US, sampleValue(i));
+            if (s % FLASH_POLL_EVERY != 0) continue;
+            uint32_t before = storage.programs + storage.erases;
+            bool wasBusy = log.busy();
+            log.poll();
+            check(storage.programs + storage.erases - before <= 1, "más de una operación por poll()");
+            if (wasBusy && log.busy()) {
+                LogBlock block;
+                check(log.empty() || !log.readBlock(log.newestSeq(), block), "lectura con un borrado en curso");
+            }
+            if (!log.empty() && log.newestSeq() != seen && !storage.powerLost) {
+                seen = log.newestSeq();
+                if (!record(log, seen)) blockErrors++;
+            }
+        }
+    }
+};
+
+static FILE* blankFlash() {
+    FILE* file = tmpfile();
+    uint8_t erased[FLASH_SECTOR];
+    memset(erased, 0xFF, sizeof(erased));
+    for (int s = 0; s < FLASH_SECTORS; s++) fwrite(erased, 1, sizeof(erased), file);
+    return file;
+}
+
+static void wrapAround() {
+    printf("1) Vueltas completas y 2) borrado sin espera\n");
+    Harness h;
+    h.file = blankFlash();
+    FileStorage storage(h.file, -1);
+    std::unique_ptr<FlashLog> log(new FlashLog(storage));
+    check(log->mount() && log->empty(), "montaje en blanco");
+    h.run(*log, storage, FLASH_WRAP_SAMPLES);
+    h.reread(*log);
+
+    uint32_t laps = log->newestSeq() / log->capacityBlocks();
+    printf("   bloques %u (%u vueltas), borrados %u, consultas de busy %u, muestras perdidas %u\n",
+           log->newestSeq() + 1, laps, storage.erases, storage.busyPolls, log->droppedSamples);
+    check(laps >= 3, "menos de tres vueltas");
+    check(storage.busyPolls >= storage.erases * (FLASH_ERASE_POLLS - 1), "el borrado no se consultó con busy()");
+    check(h.blockErrors == 0, "bloque terminado distinto de lo escrito");
+    check(h.rereadErrors == 0, "bloque del rango que ya no se lee");
+    check(log->droppedSamples == 0 && log->writeErrors == 0, "muestras o escrituras perdidas sin cortes");
+    check(storage.programWhileErasing == 0 && storage.readWhileErasing == 0, "acceso con un borrado en curso");
+    check(storage.programNotErased == 0, "programación sobre flash sin borrar");
+    check(log->newestSeq() - log->oldestSeq() + 1 <= log->capacityBlocks(),
+          "rango oldestSeq()..newestSeq() más grande que la memoria");
+
+    // Remontar sin cortes: misma posición
+    uint32_t newest = log->newestSeq();
+    FileStorage again(h.file, -1);
+    std::unique_ptr<FlashLog> remounted(new FlashLog(again));
+    check(remounted->mount() && remounted->newestSeq() == newest, "remontar sin cortes");
+    h.reread(*remounted);
+    check(h.rereadErrors == 0, "bloques distintos después de remontar");
+    fclose(h.file);
+}
+
+static void powerCuts() {
+    printf("3) Cortes de energía\n");
+    srand(11);
+    Harness h;
+    h.file = blankFlash();
+    uint32_t cutPages = 0, cutErases = 0, lostBlocks = 0;
+    uint32_t previousNewest = 0;
+    uint32_t notErased = 0, accessWhileErasing = 0;
+
+    for (int cycle = 0; cycle <= FLASH_CUTS; cycle++) {
+        int64_t cutAfter = cycle < FLASH_CUTS ? 20 + rand() % 400 : -1;
+        FileStorage storage(h.file, cutAfter);
+        std::unique_ptr<FlashLog> log(new FlashLog(storage));
+        if (!log->mount()) {
+            check(false, "montaje después de un corte");
+            break;
+        }
+        // El último bloque terminado entero antes del corte es el más nuevo
+        // al remontar (el que se estaba programando no cuenta)
+        if (h.anyLogged) {
+            uint32_t expected = h.committed.rbegin()->first;
+            if (log->empty() || log->newestSeq() != expected) lostBlocks++;
+        }
+        h.reread(*log);
+
+        h.run(*log, storage, cycle < FLASH_CUTS ? 0xFFFFFFFFu : 20000);
+        if (h.anyLogged) {
+            check(h.committed.rbegin()->first >= previousNewest, "secuencia hacia atrás");
+            previousNewest = h.committed.rbegin()->first;
+        }
+        cutPages += storage.cutPages;
+        cutErases += storage.cutErases;
+        notErased += storage.programNotErased;
+        accessWhileErasing += storage.programWhileErasing + storage.readWhileErasing;
+    }
+
+    printf("   %d cortes: %u en una página, %u en un borrado; bloques terminados %zu, último %u\n", FLASH_CUTS,
+           cutPages, cutErases, h.committed.size(), previousNewest);
+    check(cutPages > 0 && cutErases > 0, "la prueba no cortó páginas y borrados");
+    check(h.blockErrors == 0, "bloque terminado distinto de lo escrito");
+    check(h.rereadErrors == 0, "bloque terminado que no sobrevivió a un corte");
+    check(lostBlocks == 0, "bloques terminados perdidos en un corte");
+    check(notErased == 0, "programación sobre flash sin borrar después de un corte");
+    check(accessWhileErasing == 0, "acceso con un borrado en curso");
+    fclose(h.file);
+}
+
+// Cambia un byte del payload del bloque seq directamente en el archivo
+static void corrupt(FILE* file, uint32_t slot) {
+    uint8_t b;
+    long at = (long)(slot * LOG_BLOCK_SIZE + sizeof(LogBlockHeader) + 1);
+    fseek(file, at, SEEK_SET);
+    if (fread(&b, 1, 1, file) != 1) return;
+    b ^= 0x10;
+    fseek(file, at, SEEK_SET);
+    fwrite(&b, 1, 1, file);
+}
+
+static void crcOnMount() {
+    printf("4) CRC al montar\n");
+    const uint32_t perSector = FLASH_SECTOR / LOG_BLOCK_SIZE;
+    Harness h;
+    h.file = blankFlash();
+    FileStorage storage(h.file, -1);
+    std::unique_ptr<FlashLog> log(new FlashLog(storage));
+    log->mount();
+    // Hasta el segundo bloque del cuarto sector
+    while (log->empty() || log->newestSeq() < 3 * perSector + 1) h.run(*log, storage, 64);
+    uint32_t newest = log->newestSeq();
+
+    // Payload cambiado en el más nuevo (en medio de un sector)
+    corrupt(h.file, newest);
+    FileStorage s1(h.file, -1);
+    std::unique_ptr<FlashLog> l1(new FlashLog(s1));
+    check(l1->mount() && l1->newestSeq() == newest - 1, "bloque con CRC malo en medio de un sector");
+    h.run(*l1, s1, 4000);
+    check(l1->newestSeq() >= 4 * perSector, "no saltó al sector siguiente después del bloque malo");
+    check(s1.programNotErased == 0, "programó sobre el bloque malo");
+
+    // Payload cambiado en el primer bloque de un sector: vale el sector anterior
+    uint32_t head = l1->newestSeq() - l1->newestSeq() % perSector;
+    corrupt(h.file, head % l1->capacityBlocks());
+    FileStorage s2(h.file, -1);
+    std::unique_ptr<FlashLog> l2(new FlashLog(s2));
+    check(l2->mount() && l2->newestSeq() == head - 1, "primer bloque del sector con CRC malo");
+    h.run(*l2, s2, 4000);
+    check(l2->newestSeq() > head && s2.programNotErased == 0, "no reescribió el sector después de borrarlo");
+    printf("   más nuevo %u -> %u, sector %u -> %u\n", newest, l1->newestSeq(), head, l2->newestSeq());
+    fclose(h.file);
+}
+
+int main() {
+    wrapAround();
+    powerCuts();
+    crcOnMount();
+    printf("%s\n", failures ? "FALLA" : "OK");
+    return failures ? 1 : 0;
+}
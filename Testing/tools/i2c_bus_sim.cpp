@@ -0,0 +1,457 @@
+/*
+  Simulación de los buses I2C del H7 y validación del modelo de tiempo (build nativo)
+
+  Compilar desde Testing/:
+    g++ -O2 -std=gnu++14 -Isrc tools/i2c_bus_sim.cpp -o i2c_bus_sim
+
+  Tres partes:
+  1. Transacciones: simula bit a bit las lecturas de los sensores I2C a
+     100 kHz, 400 kHz y 1 MHz como las genera el periférico del STM32H7
+     (SCLL/SCLH calculados para el reloj pedido, sincronización de SCL con el
+     tiempo de subida de la línea, START repetido, STOP y tBUF) más el driver
+     (armado de la transferencia, interrupción por byte con latencia variable
+     y estiramiento de SCL si el byte no llega a tiempo, interrupción de fin).
+     La capacidad del bus cambia en cada transacción. La estimación de
+     board_profile.h (i2cTransactionUs) tiene que cubrir el peor caso simulado
+     y no pasarse del promedio en más de I2C_SIM_MAX_SLACK_US. A 1 MHz los
+     sensores actuales no funcionan (admiten 400 kHz); la fila valida el
+     modelo para sensores Fast-mode Plus.
+  2. Perfiles: simula ticks de los perfiles multipunto, secuencial y
+     concurrente, con el tick (medio, p99 y máximo) contra la estimación del
+     perfil y la ocupación de cada bus y de cada sensor (lo mismo que el M4
+     mide con el DWT y el M7 reporta en "#BUS").
+  3. Ubicación: prueba todas las asignaciones de los sensores I2C de
+     ProfileMultiPoint a I2C1, I2C3 e I2C4 (sin direcciones repetidas ni
+     reservadas por la placa, con el reloj más alto que admiten los sensores
+     de cada bus) y sugiere la de menor tick concurrente; a igual tick, la
+     que deja más sensores en I2C3 (ya cableado en D11/D12) y evita I2C1,
+     compartido con el PMIC.
+
+  Termina con código 1 si el modelo no valida o un perfil se pasa de su
+  estimación.
+*/
+
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include "board_profiles.h"
+
+#define I2C_SIM_TRANSACTIONS   100000
+#define I2C_SIM_TICKS          50000
+#define I2C_SIM_MAX_SLACK_US   15.0f       // Exceso máximo de la estimación sobre el promedio
+#define I2C_SIM_BUSES          5           // Periféricos I2C1..I2C4 (índice 0 sin usar)
+
+// Periférico y líneas
+#define I2C_SIM_KERNEL_HZ      120000000   // Reloj del I2C (PCLK1 con la configuración de mbed)
+#define I2C_SIM_PULLUP_OHM     2200
+#define I2C_SIM_CAP_MIN_PF     20          // Capacidad del bus (pistas, cables, entradas)
+#define I2C_SIM_CAP_MAX_PF     100
+#define I2C_SIM_DESIGN_CAP_PF  50          // La que se supone al calcular SCLL/SCLH
+#define I2C_SIM_FALL_NS        10
+
+// Software del driver en el M4 (mbed I2C::transfer por interrupciones)
+#define I2C_SIM_ARM_MIN_US     2.0f        // Armado de la transferencia hasta el START
+#define I2C_SIM_ARM_MAX_US     6.0f
+#define I2C_SIM_ISR_MIN_US     0.5f        // Atención de TXIS/RXNE por byte de datos
+#define I2C_SIM_ISR_MAX_US     2.0f
+#define I2C_SIM_DONE_MIN_US    1.0f        // Interrupción de fin y callback
+#define I2C_SIM_DONE_MAX_US    4.0f
+#define I2C_SIM_SYSTICK_US     3.0f        // Una interrupción del SysTick (1 ms) que se cruza
+#define I2C_SIM_SYSTICK_PERIOD 1000.0f
+
+// Lecturas que no son I2C: entre el 70 y el 100 % de su estimación
+#define I2C_SIM_OTHER_MIN      0.7f
+
+static uint32_t lcgState = 12345;
+static float uniform() {
+    lcgState = lcgState * 1664525u + 1013904223u;
+    return (lcgState >> 8) * (1.0f / 16777216.0f);
+}
+static float uniform(float low, float high) { return low + (high - low) * uniform(); }
+
+// ---- Periférico ----
+
+// SCLL y SCLH como los calcula STM32CubeMX: el periodo contado más la
+// sincronización de SCL (subida, bajada y 2-3 ciclos del kernel en cada
+// flanco) da el periodo pedido, con tLOW y tHIGH mínimos del modo
+struct SclTiming {
+    double lowNs;
+    double highNs;
+};
+
+static double riseNs(double capPf) {
+    return 0.8473 * I2C_SIM_PULLUP_OHM * capPf * 1e-3;
+}
+
+static SclTiming designTiming(uint32_t clockHz) {
+    const double lowMin = clockHz <= 100000 ? 4700 : clockHz <= 400000 ? 1300 : 500;
+    const double highMin = clockHz <= 100000 ? 4000 : clockHz <= 400000 ? 600 : 260;
+    const double kernelNs = 1e9 / I2C_SIM_KERNEL_HZ;
+    const double syncNs = I2C_SIM_FALL_NS + riseNs(I2C_SIM_DESIGN_CAP_PF) + 2 * 2.5 * kernelNs;
+    const double counted = 1e9 / clockHz - syncNs;
+
+    SclTiming t = {0, 0};
+    for (int presc = 0; presc < 16; presc++) {
+        double step = (presc + 1) * kernelNs;
+        double scll = ceil(std::max(lowMin, counted * lowMin / (lowMin + highMin)) / step);
+        double sclh = std::max(ceil(highMin / step), floor((counted - scll * step) / step));
+        t.lowNs = scll * step;
+        t.highNs = sclh * step;
+        if (scll <= 256 && sclh <= 256) break;
+    }
+    return t;
+}
+
+struct SimTransaction {
+    float armUs;        // CPU: armado, antes del START
+    float busUs;        // START hasta el fin de tBUF
+    float doneUs;       // Interrupción de fin hasta que wait() vuelve
+    float totalUs() const { return armUs + busUs + doneUs; }
+};
+
+// Una transacción con la capacidad de bus capPf
+static SimTransaction simulateTransaction(uint32_t clockHz, uint8_t txBytes, uint8_t rxBytes, double capPf) {
+    const SclTiming scl = designTiming(clockHz);
+    const double kernelNs = 1e9 / I2C_SIM_KERNEL_HZ;
+    const double trNs = riseNs(capPf);
+    auto bitNs = [&]() {
+        double sync = (2 + (uniform() < 0.5f)) + (2 + (uniform() < 0.5f));
+        return scl.lowNs + scl.highNs + I2C_SIM_FALL_NS + trNs + sync * kernelNs;
+    };
+    auto byteNs = [&]() {
+        double ns = 0;
+        for (int b = 0; b < 9; b++) ns += bitNs();
+        return ns;
+    };
+
+    SimTransaction out;
+    out.armUs = uniform(I2C_SIM_ARM_MIN_US, I2C_SIM_ARM_MAX_US);
+
+    // Cada byte de datos lo atiende una interrupción disparada al empezar el
+    // byte anterior (TXDR/RXDR tienen un byte de buffer): si la atención
+    // tarda más que ese byte, el periférico estira SCL hasta que llega
+    double ns = scl.highNs;         // tHD;STA
+    double previousStart = 0;
+    auto dataByte = [&]() {
+        double isrNs = uniform(I2C_SIM_ISR_MIN_US, I2C_SIM_ISR_MAX_US) * 1000.0;
+        if (uniform() < ns / 1000.0 / I2C_SIM_SYSTICK_PERIOD) isrNs += I2C_SIM_SYSTICK_US * 1000.0;
+        double ready = previousStart + isrNs;
+        if (ready > ns) ns = ready;
+        previousStart = ns;
+        ns += byteNs();
+    };
+    auto addressByte = [&]() {
+        previousStart = ns;
+        ns += byteNs();
+    };
+
+    if (txBytes) {
+        addressByte();
+        for (int i = 0; i < txBytes; i++) dataByte();
+    }
+    if (rxBytes) {
+        if (txBytes) ns += scl.lowNs + trNs + scl.highNs + scl.highNs;    // SCL baja, tSU;STA, tHD;STA
+        addressByte();
+        for (int i = 0; i < rxBytes; i++) dataByte();
+    }
+    ns += scl.lowNs + trNs + scl.highNs;    // SCL baja, tSU;STO
+    ns += scl.lowNs;                        // tBUF (el periférico espera SCLL)
+    out.busUs = (float)(ns / 1000.0);
+
+    out.doneUs = uniform(I2C_SIM_DONE_MIN_US, I2C_SIM_DONE_MAX_US);
+    if (uniform() < out.busUs / I2C_SIM_SYSTICK_PERIOD) out.doneUs += I2C_SIM_SYSTICK_US;
+    return out;
+}
+
+static float capacity() {
+    return uniform(I2C_SIM_CAP_MIN_PF, I2C_SIM_CAP_MAX_PF);
+}
+
+// ---- Sensores de un perfil ----
+
+struct SimSensor {
+    const char* type;
+    SensorDesc desc;
+    uint8_t txLength;
+    uint8_t rxLength;
+};
+
+template <typename Sensor>
+SimSensor simSensor(const char* type, std::true_type) {
+    return SimSensor{type, Sensor::desc(), Sensor::txLength(), Sensor::rxLength()};
+}
+template <typename Sensor>
+SimSensor simSensor(const char* type, std::false_type) {
+    return SimSensor{type, Sensor::desc(), 0, 0};
+}
+
+template <typename Sensor>
+using IsI2c = std::integral_constant<bool, Sensor::desc().bus == BUS_I2C>;
+
+template <typename Profile>
+struct ProfileSensors;
+
+template <uint32_t PERIOD_US, typename... Sensors, typename... Stages, AcquireMode MODE>
+struct ProfileSensors<BoardProfile<PERIOD_US, SensorList<Sensors...>, StageList<Stages...>, MODE>> {
+    static std::vector<SimSensor> list() {
+        return {simSensor<Sensors>(sensorName(Sensors::id()), IsI2c<Sensors>())...};
+    }
+    static constexpr uint32_t perSampleUs() { return PROFILE_PUBLISH_US + stagesCostUs<Stages...>(); }
+};
+
+// ---- 1. Validación del modelo ----
+
+static bool validateModel() {
+    static const uint32_t clocks[] = {100000, 400000, 1000000};
+    const std::vector<SimSensor> sensors = ProfileSensors<ProfileMultiPoint>::list();
+
+    printf("Modelo de transacción (us): estimación contra %u transacciones simuladas\n", I2C_SIM_TRANSACTIONS);
+    printf("  %-8s %8s %4s %4s %7s %7s %7s %7s %7s  %s\n", "sensor", "reloj", "tx", "rx", "modelo", "media",
+           "p99", "máx", "exceso", "");
+    bool ok = true;
+    for (uint32_t clock : clocks) {
+        for (const SimSensor& s : sensors) {
+            if (s.desc.bus != BUS_I2C) continue;
+            std::vector<float> totals(I2C_SIM_TRANSACTIONS);
+            double sum = 0;
+            for (float& total : totals) {
+                total = simulateTransaction(clock, s.txLength, s.rxLength, capacity()).totalUs();
+                sum += total;
+            }
+            std::sort(totals.begin(), totals.end());
+            float mean = (float)(sum / totals.size());
+            float p99 = totals[totals.size() * 99 / 100];
+            float worst = totals.back();
+            float model = i2cTransactionUs(clock, s.txLength, s.rxLength);
+            float slack = model - mean;
+            bool pass = worst <= model && slack <= I2C_SIM_MAX_SLACK_US;
+            ok = ok && pass;
+            printf("  %-8s %6u k %4u %4u %7.1f %7.1f %7.1f %7.1f %7.1f  %s%s\n", s.type, clock / 1000,
+                   s.txLength, s.rxLength, model, mean, p99, worst, slack, pass ? "ok" : "FALLA",
+                   clock > s.desc.maxClockHz ? " (fuera de hoja de datos)" : "");
+        }
+    }
+    return ok;
+}
+
+// ---- 2. Ticks de un perfil ----
+
+template <typename Profile>
+static bool simulateProfile(const char* name) {
+    const std::vector<SimSensor> sensors = ProfileSensors<Profile>::list();
+    const size_t n = sensors.size();
+    const bool concurrent = Profile::mode() == ACQUIRE_CONCURRENT;
+    const uint32_t perSampleUs = ProfileSensors<Profile>::perSampleUs();
+
+    std::vector<float> ticks(I2C_SIM_TICKS);
+    std::vector<double> sensorBusyUs(n, 0.0);
+    double busBusyUs[I2C_SIM_BUSES] = {};
+    std::vector<uint8_t> rank(n);
+    std::vector<SensorDesc> descs(n);
+    for (size_t i = 0; i < n; i++) descs[i] = sensors[i].desc;
+    for (size_t i = 0; i < n; i++) rank[i] = descBusRank(descs.data(), i);
+    uint8_t rounds = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (descs[i].bus == BUS_I2C) rounds = std::max<uint8_t>(rounds, rank[i] + 1);
+    }
+
+    for (float& tick : ticks) {
+        float cpu = 0.0f;
+        auto other = [&](size_t i) {
+            cpu += uniform(I2C_SIM_OTHER_MIN, 1.0f) * sensors[i].desc.readUs;
+        };
+        if (!concurrent) {
+            // Lectura bloqueante tras otra, en el orden del perfil
+            for (size_t i = 0; i < n; i++) {
+                if (descs[i].bus == BUS_I2C) {
+                    SimTransaction t = simulateTransaction(descs[i].busClockHz, sensors[i].txLength,
+                                                           sensors[i].rxLength, capacity());
+                    cpu += t.totalUs();
+                    sensorBusyUs[i] += t.armUs + t.busUs;
+                    busBusyUs[descs[i].busIndex] += t.armUs + t.busUs;
+                } else {
+                    other(i);
+                }
+                cpu += perSampleUs;
+            }
+        } else {
+            // Por ronda: arrancar cada bus (el armado ocupa la CPU), leer SPI/ADC
+            // en la primera y esperar los fines en el orden del perfil
+            for (uint8_t round = 0; round < rounds; round++) {
+                std::vector<float> doneAt(n, 0.0f);
+                for (size_t i = 0; i < n; i++) {
+                    if (descs[i].bus != BUS_I2C || rank[i] != round) continue;
+                    SimTransaction t = simulateTransaction(descs[i].busClockHz, sensors[i].txLength,
+                                                           sensors[i].rxLength, capacity());
+                    cpu += t.armUs;
+                    doneAt[i] = cpu + t.busUs + t.doneUs;
+                    sensorBusyUs[i] += t.armUs + t.busUs;
+                    busBusyUs[descs[i].busIndex] += t.armUs + t.busUs;
+                }
+                if (round == 0) {
+                    for (size_t i = 0; i < n; i++) {
+                        if (descs[i].bus != BUS_I2C) {
+                            other(i);
+                            cpu += perSampleUs;
+                        }
+                    }
+                }
+                for (size_t i = 0; i < n; i++) {
+                    if (descs[i].bus != BUS_I2C || rank[i] != round) continue;
+                    cpu = std::max(cpu, doneAt[i]) + perSampleUs;
+                }
+            }
+        }
+        tick = cpu;
+    }
+
+    std::vector<float> sorted = ticks;
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0;
+    for (float t : ticks) sum += t;
+    float worst = sorted.back();
+    bool pass = worst <= Profile::tickUs();
+    double elapsedUs = (double)I2C_SIM_TICKS * Profile::periodUs();
+
+    printf("%-24s %s  tick medio %6.1f  p99 %6.1f  máx %6.1f  estimado %3u/%3u us  %s\n", name,
+           concurrent ? "concurrente" : "secuencial ", sum / I2C_SIM_TICKS, sorted[sorted.size() * 99 / 100],
+           worst, (unsigned)Profile::tickUs(), (unsigned)Profile::budgetUs(), pass ? "ok" : "FALLA");
+    for (size_t i = 0; i < n; i++) {
+        if (descs[i].bus != BUS_I2C) continue;
+        printf("  %-8s i2c%u  %5.1f %% del bus (estimado %5.1f %%)  %5.1f us por lectura\n", sensors[i].type,
+               descs[i].busIndex, 100.0 * sensorBusyUs[i] / elapsedUs, 100.0 * descs[i].readUs / Profile::periodUs(),
+               sensorBusyUs[i] / I2C_SIM_TICKS);
+    }
+    for (uint8_t bus = 1; bus < I2C_SIM_BUSES; bus++) {
+        if (busBusyUs[bus] == 0) continue;
+        printf("  bus i2c%u  ocupado %5.1f %% (estimado %5.1f %%)\n", bus, 100.0 * busBusyUs[bus] / elapsedUs,
+               100.0 * Profile::busLoadUs(bus) / Profile::periodUs());
+    }
+    return pass;
+}
+
+// ---- 3. Ubicación ----
+
+struct BusOption {
+    uint8_t index;
+    const char* alias;
+    uint8_t preference;                 // 0 = preferido
+    uint8_t reserved[2];
+};
+
+// Los pines y relojes de cada bus salen de board_profiles.h
+static const BusOption BUS_OPTIONS[] = {
+    {3, "BusI2c3", 0, {0, 0}},
+    {4, "BusI2c4", 1, {0, 0}},
+    {1, "BusI2c1", 2, {0x08, 0x60}},
+};
+#define BUS_OPTION_COUNT (sizeof(BUS_OPTIONS) / sizeof(BUS_OPTIONS[0]))
+
+static const char* sensorTypeName(uint8_t id) {
+    switch (id) {
+        case SENSOR_SM4291_I2C: return "Sm4291I2c";
+        case SENSOR_ELVH:       return "ElvhI2c";
+        case SENSOR_ABPLLN:     return "AbpllnI2c";
+        default:                return "?";
+    }
+}
+
+static void planPlacement() {
+    const std::vector<SimSensor> sensors = ProfileSensors<ProfileMultiPoint>::list();
+    std::vector<size_t> i2c;
+    for (size_t i = 0; i < sensors.size(); i++) {
+        if (sensors[i].desc.bus == BUS_I2C) i2c.push_back(i);
+    }
+
+    size_t combinations = 1;
+    for (size_t k = 0; k < i2c.size(); k++) combinations *= BUS_OPTION_COUNT;
+
+    bool found = false;
+    uint32_t bestUs = 0;
+    uint32_t bestPreference = 0;
+    uint32_t bestLoad = 0;
+    std::vector<uint8_t> best;
+    size_t valid = 0;
+
+    for (size_t c = 0; c < combinations; c++) {
+        std::vector<uint8_t> option(i2c.size());
+        size_t code = c;
+        for (size_t k = 0; k < i2c.size(); k++) {
+            option[k] = (uint8_t)(code % BUS_OPTION_COUNT);
+            code /= BUS_OPTION_COUNT;
+        }
+
+        // Reloj de cada bus: el más alto que admiten todos sus sensores
+        uint32_t clock[BUS_OPTION_COUNT];
+        for (size_t b = 0; b < BUS_OPTION_COUNT; b++) clock[b] = PROFILE_I2C_MAX_CLOCK_HZ;
+        for (size_t k = 0; k < i2c.size(); k++) {
+            clock[option[k]] = std::min(clock[option[k]], sensors[i2c[k]].desc.maxClockHz);
+        }
+
+        std::vector<SensorDesc> descs;
+        for (const SimSensor& s : sensors) descs.push_back(s.desc);
+        bool allowed = true;
+        uint32_t preference = 0;
+        for (size_t k = 0; k < i2c.size(); k++) {
+            const BusOption& bus = BUS_OPTIONS[option[k]];
+            const SimSensor& s = sensors[i2c[k]];
+            SensorDesc& d = descs[i2c[k]];
+            d.busIndex = bus.index;
+            d.busClockHz = clock[option[k]];
+            d.reservedAddress = d.address == bus.reserved[0] || d.address == bus.reserved[1];
+            d.readUs = i2cTransactionUs(d.busClockHz, s.txLength, s.rxLength);
+            allowed = allowed && !d.reservedAddress;
+            preference = preference * BUS_OPTION_COUNT + bus.preference;  // El primer sensor pesa más
+        }
+        if (!allowed || !descsNoAddressClash(descs.data(), descs.size())) continue;
+        valid++;
+
+        uint32_t us = descsConcurrentReadUs(descs.data(), descs.size());
+        uint32_t load = 0;
+        for (size_t b = 0; b < BUS_OPTION_COUNT; b++) {
+            uint32_t busLoad = 0;
+            for (size_t k = 0; k < i2c.size(); k++) {
+                if (option[k] == b) busLoad += descs[i2c[k]].readUs;
+            }
+            load = std::max(load, busLoad);
+        }
+        if (!found || us < bestUs || (us == bestUs && preference < bestPreference) ||
+            (us == bestUs && preference == bestPreference && load < bestLoad)) {
+            found = true;
+            bestUs = us;
+            bestPreference = preference;
+            bestLoad = load;
+            best = option;
+        }
+    }
+
+    printf("Ubicación: %u asignaciones, %u válidas\n", (unsigned)combinations, (unsigned)valid);
+    if (!found) {
+        printf("  ninguna asignación válida\n");
+        return;
+    }
+    printf("  lecturas concurrentes %u us (ProfileMultiPoint: %u us), bus más cargado %u us\n", bestUs,
+           (unsigned)ProfileMultiPoint::readUs(), bestLoad);
+    printf("  using ProfileSugerido = BoardProfile<500,\n      SensorList<");
+    size_t k = 0;
+    for (size_t i = 0; i < sensors.size(); i++) {
+        if (i) printf(", ");
+        if (sensors[i].desc.bus == BUS_I2C) {
+            printf("%s<%s>", sensorTypeName(sensors[i].desc.id), BUS_OPTIONS[best[k++]].alias);
+        } else {
+            printf("SscdannSpi<BusSpi1, PIN_D7>");
+        }
+    }
+    printf(">,\n      StageList<RangeCheckStage<>>, ACQUIRE_CONCURRENT>;\n");
+}
+
+int main() {
+    bool ok = validateModel();
+    printf("\n");
+    ok = simulateProfile<ProfileMultiPoint>("ProfileMultiPoint") && ok;
+    ok = simulateProfile<ProfileMultiPointSplit>("ProfileMultiPointSplit") && ok;
+    printf("\n");
+    planPlacement();
+    return ok ? 0 : 1;
+}
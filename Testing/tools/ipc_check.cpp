@@ -0,0 +1,309 @@
+/*
+  Prueba del canal M4 -> M7 de shared.h en el host (build nativo)
+
+  Compilar desde Testing/:
+    g++ -O2 -std=gnu++14 -pthread -Isrc tools/ipc_check.cpp -o ipc_check
+
+  1) Rango de caché: ipcCacheRange() cubre exactamente las líneas que toca
+     cada campo del bloque compartido (ni una de menos ni una de más) y los
+     campos que escribe cada núcleo no comparten línea.
+  2) Ring SPSC: un hilo productor (el M4) publica IPC_CHECK_SAMPLES muestras
+     y otro consumidor (el M7) las extrae a su ritmo, con pausas al azar para
+     que el ring se llene. Cada muestra recibida debe llegar en orden y sin
+     corromperse; las que faltan tienen que coincidir con ipc->dropped.
+  3) Buzón: el consumidor envía comandos mientras corre el ring y espera cada
+     ack; el productor los atiende entre muestras. Ningún comando se pierde,
+     se duplica o se confirma con el argumento equivocado.
+  4) Estado de lectura: una fuente de sensores que falla el ELVH cada tanto,
+     pasada por el ProfileRunner y el ring; las muestras fallidas llegan al
+     consumidor como SAMPLE_BUS_ERROR y las demás como SAMPLE_OK.
+  5) Saludo por arranque: con el bloque que dejó un arranque anterior (magic
+     válido, saludo ya respondido) o basura, un M4 que arranca de nuevo no
+     queda habilitado hasta que el M7 responde a su hello; un M7 sin
+     ACQ_ON_M4 (ipcRevoke()) deja el bloque inválido y no responde.
+
+  Devuelve 1 si falla alguna comprobación.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include "shared.h"
+#include "board_profiles.h"
+
+#define IPC_CHECK_SAMPLES    1000000u
+#define IPC_CHECK_COMMANDS   20000u
+#define IPC_CHECK_TICKS      10000u
+#define IPC_CHECK_ELVH_FAIL  7           // Cada cuántas lecturas falla el ELVH
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    if (!ok) {
+        if (failures < 10) printf("  FALLA: %s\n", what);
+        failures++;
+    }
+}
+
+static uint32_t pattern(uint32_t n) {
+    return n * 2654435761u ^ 0x5A5A5A5Au;
+}
+
+static void cacheRanges(IpcShared* ipc) {
+    printf("1) Rango de caché\n");
+    for (uintptr_t offset = 0; offset < 64; offset++) {
+        for (size_t size = 1; size <= 80; size++) {
+            IpcCacheRange r = ipcCacheRange((const void*)(0x38008000u + offset), size);
+            uintptr_t firstLine = (0x38008000u + offset) / IPC_CACHE_LINE;
+            uintptr_t lastLine = (0x38008000u + offset + size - 1) / IPC_CACHE_LINE;
+            bool ok = r.start == firstLine * IPC_CACHE_LINE &&
+                      r.size == (int32_t)((lastLine - firstLine + 1) * IPC_CACHE_LINE);
+            check(ok, "rango de líneas de caché");
+        }
+    }
+    size_t busBytes = sizeof(uint32_t) * (1 + 2 * SENSOR_COUNT);
+    IpcCacheRange r = ipcCacheRange(&ipc->busMap, busBytes);
+    check(r.start == (uintptr_t)&ipc->busMap && (size_t)r.size >= busBytes &&
+          (size_t)r.size < busBytes + IPC_CACHE_LINE, "líneas de las estadísticas de bus");
+    r = ipcCacheRange(&ipc->samples[3], sizeof(IpcSample));
+    check(r.size == IPC_CACHE_LINE, "una muestra no cruza líneas");
+
+    // Campos escritos por núcleos distintos en líneas distintas
+    uintptr_t line = IPC_CACHE_LINE;
+    check((uintptr_t)&ipc->head / line != (uintptr_t)&ipc->tail / line, "head y tail en la misma línea");
+    check((uintptr_t)&ipc->cmdSeq / line != (uintptr_t)&ipc->ackSeq / line, "cmdSeq y ackSeq en la misma línea");
+    check((uintptr_t)&ipc->welcome / line != (uintptr_t)&ipc->hello / line, "welcome y hello en la misma línea");
+    check((uintptr_t)&ipc->tail / line != (uintptr_t)&ipc->samples[0] / line, "tail junto a las muestras");
+    check((uintptr_t)&ipc->samples[IPC_RING_SIZE - 1] / line != (uintptr_t)&ipc->command / line,
+          "muestras junto al buzón");
+}
+
+static void ringAndMailbox(IpcShared* ipc) {
+    printf("2) Ring SPSC y 3) buzón\n");
+    ipcInit(ipc);
+    check(ipcReady(ipc), "bloque listo después de ipcInit()");
+
+    std::atomic<bool> producerDone(false);
+    uint32_t handled = 0;
+    uint32_t lastHandledSeq = 0;
+    uint32_t sumArgs = 0;
+    uint32_t badCommands = 0;
+
+    std::thread producer([&]() {
+        for (uint32_t n = 0; n < IPC_CHECK_SAMPLES; n++) {
+            IpcCommand cmd;
+            uint32_t arg;
+            if (ipcPollCommand(ipc, &cmd, &arg)) {
+                uint32_t seq = ipc->cmdSeq;
+                // Cada comando se atiende una sola vez y en orden
+                if (seq != lastHandledSeq + 1 || cmd != IPC_CMD_SET_PERIOD_US || arg != pattern(seq)) {
+                    badCommands++;
+                }
+                lastHandledSeq = seq;
+                sumArgs += arg;
+                handled++;
+                ipcAckCommand(ipc, 0);
+            }
+            IpcSample sample;
+            sample.timestampUs = n;
+            sample.sensorId = (uint8_t)(n % SENSOR_COUNT);
+            sample.status = SAMPLE_OK;
+            sample.sequence = (uint16_t)n;
+            sample.raw = (int32_t)pattern(n);
+            sample.value = (float)(n & 0xFFFF);
+            ipcPushSample(ipc, sample);
+            // Periodo de adquisición: cede el procesador para que el
+            // consumidor vaya al día aunque el host tenga un solo núcleo
+            if ((n & 31) == 31) std::this_thread::yield();
+        }
+        // Atender los comandos que queden
+        while (!producerDone.load()) {
+            IpcCommand cmd;
+            uint32_t arg;
+            if (ipcPollCommand(ipc, &cmd, &arg)) {
+                lastHandledSeq = ipc->cmdSeq;
+                sumArgs += arg;
+                handled++;
+                ipcAckCommand(ipc, 0);
+            }
+        }
+    });
+
+    uint32_t received = 0;
+    uint32_t expectNext = 0;
+    uint32_t skipped = 0;
+    uint32_t outOfOrder = 0;
+    uint32_t corrupted = 0;
+    uint32_t sentCommands = 0;
+    uint32_t pendingSeq = 0;
+    uint32_t sumSent = 0;
+    uint32_t maxFill = 0;
+    srand(3);
+
+    while (received + skipped < IPC_CHECK_SAMPLES) {
+        IpcSample sample;
+        if (ipcPopSample(ipc, &sample)) {
+            uint32_t n = sample.timestampUs;
+            if (n < expectNext) {
+                outOfOrder++;
+            } else {
+                skipped += n - expectNext;
+                expectNext = n + 1;
+            }
+            if (sample.raw != (int32_t)pattern(n) || sample.sequence != (uint16_t)n ||
+                sample.sensorId != n % SENSOR_COUNT || sample.value != (float)(n & 0xFFFF)) {
+                corrupted++;
+            }
+            received++;
+            uint32_t fill = ipc->head.value - ipc->tail.value;
+            if (fill > maxFill && fill <= IPC_RING_SIZE) maxFill = fill;
+        } else {
+            std::this_thread::yield();
+        }
+        // Pausas al azar: el ring se llena y el productor descarta
+        if ((rand() & 0xFFF) == 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        // Un comando a la vez, como el firmware: se espera el ack antes del siguiente
+        if (sentCommands < IPC_CHECK_COMMANDS) {
+            if (pendingSeq == 0 || ipcCommandAcked(ipc, pendingSeq)) {
+                uint32_t seq = ipc->cmdSeq + 1;
+                pendingSeq = ipcPostCommand(ipc, IPC_CMD_SET_PERIOD_US, pattern(seq));
+                check(pendingSeq == seq, "número de secuencia del comando");
+                sumSent += pattern(seq);
+                sentCommands++;
+            }
+        }
+        // Muestras que el productor descartó al final, después de la última recibida
+        if (expectNext + ipc->dropped >= IPC_CHECK_SAMPLES && ipc->head.value == ipc->tail.value &&
+            received + ipc->dropped >= IPC_CHECK_SAMPLES) {
+            skipped += IPC_CHECK_SAMPLES - expectNext;
+            break;
+        }
+    }
+    while (pendingSeq != 0 && !ipcCommandAcked(ipc, pendingSeq)) {
+    }
+    producerDone.store(true);
+    producer.join();
+
+    uint32_t dropped = ipc->dropped;
+    printf("   muestras %u: recibidas %u, descartadas %u (ring lleno), llenado máximo %u/%u\n",
+           IPC_CHECK_SAMPLES, received, dropped, maxFill, IPC_RING_SIZE);
+    printf("   comandos enviados %u, atendidos %u\n", sentCommands, handled);
+    check(outOfOrder == 0, "muestras fuera de orden");
+    check(corrupted == 0, "muestras corruptas");
+    check(skipped == dropped, "huecos distintos de los descartes contados");
+    check(received + dropped == IPC_CHECK_SAMPLES, "muestras perdidas sin contar");
+    check(dropped > 0, "el ring nunca se llenó (la prueba no ejercitó el descarte)");
+    check(badCommands == 0, "comando atendido fuera de orden o con otro argumento");
+    check(handled == sentCommands && sumArgs == sumSent, "comandos perdidos o duplicados");
+    check(lastHandledSeq == ipc->ackSeq && ipc->ackSeq == ipc->cmdSeq, "último ack");
+}
+
+// Fuente con un ELVH que falla cada IPC_CHECK_ELVH_FAIL lecturas
+struct FlakySource {
+    uint32_t elvhReads = 0;
+    uint32_t elvhFailed = 0;
+
+    template <typename Sensor>
+    bool read(Sensor, int32_t* raw) {
+        constexpr LinearCal cal = Sensor::cal();
+        float middle = 0.5f * (cal.outLow + cal.outHigh);
+        *raw = (int32_t)((middle - cal.offset) / cal.scale);
+        if (Sensor::id() != SENSOR_ELVH) return true;
+        elvhReads++;
+        if (elvhReads % IPC_CHECK_ELVH_FAIL == 0) {
+            elvhFailed++;
+            return false;
+        }
+        return true;
+    }
+
+    template <typename Sensor>
+    void start(Sensor) {}
+
+    template <typename Sensor>
+    bool finish(Sensor sensor, int32_t* raw) {
+        return read(sensor, raw);
+    }
+};
+
+struct RingSink {
+    IpcShared* ipc;
+    void publish(const IpcSample& sample) { ipcPushSample(ipc, sample); }
+};
+
+static void readStatus(IpcShared* ipc) {
+    printf("4) Estado de lectura del ELVH\n");
+    ipcInit(ipc);
+    FlakySource source;
+    RingSink sink = {ipc};
+    ProfileRunner<ProfileMultiPoint, FlakySource, RingSink> runner(source, sink);
+
+    uint32_t elvhOk = 0, elvhError = 0, othersError = 0;
+    for (uint32_t t = 0; t < IPC_CHECK_TICKS; t++) {
+        runner.tick(t * ProfileMultiPoint::periodUs(), (uint16_t)t, 1u << SENSOR_ELVH | 1u << SENSOR_SM4291_I2C);
+        IpcSample sample;
+        while (ipcPopSample(ipc, &sample)) {
+            if (sample.sensorId == SENSOR_ELVH) {
+                if (sample.status == SAMPLE_BUS_ERROR) elvhError++;
+                else if (sample.status == SAMPLE_OK) elvhOk++;
+            } else if (sample.status == SAMPLE_BUS_ERROR) {
+                othersError++;
+            }
+        }
+    }
+    printf("   ELVH: lecturas %u, fallidas %u; recibidas ok %u, error de bus %u\n", source.elvhReads,
+           source.elvhFailed, elvhOk, elvhError);
+    check(elvhError == source.elvhFailed, "lecturas fallidas del ELVH publicadas como OK");
+    check(elvhOk == source.elvhReads - source.elvhFailed, "lecturas buenas del ELVH");
+    check(othersError == 0, "error de bus en un sensor que no falló");
+    check(ipc->dropped == 0, "descartes con el consumidor al día");
+}
+
+static void handshake(IpcShared* ipc) {
+    printf("5) Saludo por arranque\n");
+    // Arranque con ACQ_ON_M4 completo
+    ipcInit(ipc);
+    check(!ipcAnswerHello(ipc), "el M7 respondió sin saludo del M4");
+    uint32_t hello = ipcHello(ipc);
+    check(ipcReady(ipc) && !ipcWelcomed(ipc, hello), "M4 habilitado antes de la respuesta del M7");
+    check(ipcAnswerHello(ipc) && ipcWelcomed(ipc, hello), "saludo respondido sin habilitar al M4");
+
+    // El M4 arranca de nuevo sobre el bloque que quedó (magic válido)
+    uint32_t again = ipcHello(ipc);
+    check(again != hello && ipcReady(ipc) && !ipcWelcomed(ipc, again),
+          "un bloque de un arranque anterior habilitó al M4");
+
+    // El M7 arranca con un firmware sin ACQ_ON_M4: no responde nunca
+    ipcRevoke(ipc);
+    again = ipcHello(ipc);
+    check(!ipcReady(ipc) && !ipcWelcomed(ipc, again), "bloque válido después de ipcRevoke()");
+
+    // Basura en SRAM4 (encendido): sin respuesta no se habilita nunca
+    for (uint32_t trial = 0; trial < 1000; trial++) {
+        ipc->magic = IPC_MAGIC;
+        ipc->version = IPC_VERSION;
+        ipc->welcome = pattern(trial);
+        ipc->hello.value = pattern(trial) - 1 + (trial & 1);
+        again = ipcHello(ipc);
+        check(again != 0 && !ipcWelcomed(ipc, again), "basura en SRAM4 habilitó al M4");
+    }
+
+    // Nuevo arranque completo: el mismo saludo vuelve a funcionar
+    ipcInit(ipc);
+    hello = ipcHello(ipc);
+    check(ipcAnswerHello(ipc) && ipcWelcomed(ipc, hello), "saludo después de ipcInit()");
+}
+
+int main() {
+    IpcShared* ipc = ipcShared();
+    cacheRanges(ipc);
+    ringAndMailbox(ipc);
+    readStatus(ipc);
+    handshake(ipc);
+    printf("%s\n", failures ? "FALLA" : "OK");
+    return failures ? 1 : 0;
+}
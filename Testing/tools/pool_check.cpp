@@ -0,0 +1,149 @@
+/*
+  Prueba del pool de bloques fijos de static_memory.h (build nativo)
+
+  Compilar desde Testing/:
+    g++ -O2 -std=gnu++14 -Isrc tools/pool_check.cpp -o pool_check
+
+  1) Agotamiento: se piden más bloques que la capacidad; los de sobra deben
+     devolver nullptr y contar como fallos sin tocar used.
+  2) Liberar y reutilizar: los bloques liberados vuelven a entregarse (LIFO),
+     con el constructor corrido otra vez y el destructor al liberar.
+  3) Estadísticas por pool: used, peak y failures de dos pools a la vez, que
+     aparezcan los dos en la lista del reporte y que reset() vuelva a dejar
+     todo libre sin borrar el pico.
+  4) Carga al azar: secuencia larga de alloc/free contra un modelo de
+     referencia; ningún bloque se entrega dos veces y owns() los reconoce.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "static_memory.h"
+
+#define POOL_A_BLOCKS 8
+#define POOL_B_BLOCKS 3
+
+static int failures = 0;
+static int liveObjects = 0;
+
+static void check(bool ok, const char* what) {
+    if (!ok) {
+        printf("  FALLA: %s\n", what);
+        failures++;
+    }
+}
+
+struct Block {
+    uint32_t tag;
+    uint8_t payload[20];
+    explicit Block(uint32_t t = 0) : tag(t) { liveObjects++; }
+    ~Block() { liveObjects--; }
+};
+
+StaticPool<Block, POOL_A_BLOCKS> poolA("bloques");
+StaticPool<uint64_t, POOL_B_BLOCKS> poolB("palabras");
+
+static void exhaustion() {
+    printf("1) Agotamiento\n");
+    Block* taken[POOL_A_BLOCKS];
+    for (int i = 0; i < POOL_A_BLOCKS; i++) {
+        taken[i] = poolA.create((uint32_t)i);
+        check(taken[i] != nullptr, "bloque dentro de la capacidad");
+    }
+    check(poolA.available() == 0, "available() en 0 con el pool lleno");
+    for (int i = 0; i < 3; i++) check(poolA.create(99u) == nullptr, "nullptr con el pool lleno");
+    check(poolA.used == POOL_A_BLOCKS, "used no pasa de la capacidad");
+    check(poolA.failures == 3, "tres fallos contados");
+    check(liveObjects == POOL_A_BLOCKS, "sin constructores en los pedidos rechazados");
+    for (int i = 0; i < POOL_A_BLOCKS; i++) check(taken[i]->tag == (uint32_t)i, "contenido intacto");
+    for (int i = 0; i < POOL_A_BLOCKS; i++) poolA.destroy(taken[i]);
+    check(poolA.used == 0 && liveObjects == 0, "todo liberado con destructores");
+    printf("   used %zu, pico %zu, fallos %zu\n", poolA.used, poolA.peak, poolA.failures);
+}
+
+static void reuse() {
+    printf("2) Liberar y reutilizar\n");
+    Block* a = poolA.create(1u);
+    Block* b = poolA.create(2u);
+    poolA.destroy(a);
+    Block* c = poolA.create(3u);
+    check(c == a, "el último liberado es el próximo entregado");
+    check(c->tag == 3, "constructor corrido al reutilizar");
+    check(b->tag == 2, "el otro bloque no se tocó");
+    poolA.destroy(nullptr);
+    check(poolA.used == 2, "destroy(nullptr) no cambia used");
+    poolA.destroy(b);
+    poolA.destroy(c);
+    check(poolA.used == 0 && liveObjects == 0, "todo liberado");
+}
+
+static void stats() {
+    printf("3) Estadísticas por pool\n");
+    uint64_t* words[POOL_B_BLOCKS + 1];
+    for (int i = 0; i <= POOL_B_BLOCKS; i++) words[i] = poolB.create((uint64_t)i);
+    check(words[POOL_B_BLOCKS] == nullptr, "pool chico agotado");
+    check(poolB.used == POOL_B_BLOCKS && poolB.peak == POOL_B_BLOCKS && poolB.failures == 1,
+          "used/pico/fallos del pool chico");
+    check(poolA.used == 0 && poolA.peak == POOL_A_BLOCKS && poolA.failures == 3,
+          "el otro pool no se mezcla");
+
+    bool seenA = false, seenB = false;
+    int listed = 0;
+    for (PoolBase* pool = PoolBase::first(); pool != nullptr; pool = pool->next) {
+        printf("   %-9s bloque %zu B x %zu, en uso %zu, pico %zu, fallos %zu\n", pool->name,
+               pool->blockSize, pool->capacity, pool->used, pool->peak, pool->failures);
+        seenA |= pool == &poolA;
+        seenB |= pool == &poolB;
+        listed++;
+    }
+    check(seenA && seenB && listed == 2, "los dos pools en la lista del reporte");
+    check(poolA.blockSize >= sizeof(Block) && poolB.blockSize >= sizeof(void*), "tamaño de bloque");
+
+    poolB.reset();
+    check(poolB.used == 0 && poolB.available() == POOL_B_BLOCKS, "reset() libera todo");
+    check(poolB.peak == POOL_B_BLOCKS, "reset() conserva el pico");
+}
+
+static void randomized() {
+    printf("4) Carga al azar\n");
+    srand(7);
+    Block* live[POOL_A_BLOCKS];
+    int count = 0;
+    size_t expectedFailures = poolA.failures;
+    for (int step = 0; step < 200000; step++) {
+        if (rand() % 2) {
+            Block* blk = poolA.create((uint32_t)step);
+            if (count == POOL_A_BLOCKS) {
+                expectedFailures++;
+                check(blk == nullptr, "nullptr con el pool lleno");
+                continue;
+            }
+            check(blk != nullptr && poolA.owns(blk), "bloque del pool");
+            for (int i = 0; i < count; i++) check(live[i] != blk, "bloque entregado dos veces");
+            live[count++] = blk;
+        } else if (count > 0) {
+            int k = rand() % count;
+            poolA.destroy(live[k]);
+            live[k] = live[--count];
+        }
+        if (poolA.used != (size_t)count) {
+            check(false, "used distinto del modelo");
+            break;
+        }
+        if (failures > 10) break;
+    }
+    check(poolA.failures == expectedFailures, "fallos contados como en el modelo");
+    check(liveObjects == count, "constructores y destructores balanceados");
+    Block outside(0);
+    check(!poolA.owns(&outside), "owns() rechaza un objeto de afuera");
+    while (count > 0) poolA.destroy(live[--count]);
+    printf("   used %zu, pico %zu, fallos %zu\n", poolA.used, poolA.peak, poolA.failures);
+}
+
+int main() {
+    exhaustion();
+    reuse();
+    stats();
+    randomized();
+    printf("%s\n", failures ? "FALLA" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,353 @@
+/*
+  Simulación del modo de bajo consumo de loop() (build nativo)
+
+  Compilar desde Testing/:
+    g++ -O2 -std=gnu++14 -Isrc tools/power_sim.cpp -o power_sim
+
+  El reloj cuenta ciclos de 480 MHz y el contador DWT es su parte baja de 32
+  bits (da varias vueltas en SIM_SECONDS). El timer interrumpe cada 500 us con
+  jitter, el SysTick cada 1 ms y el USB a intervalos al azar (tráfico del
+  host); cada ISR cuesta SIM_ISR_CYCLES. loop() es el
+  de main.cpp: ve la bandera del timer, libera la adquisición, corre una
+  porción con el planificador (task_scheduler.h) y, sin trabajo pendiente,
+  duerme como lowPowerIdle() con la misma contabilidad (EnergyAccount) y la
+  misma medición de latencia (WakeLatencyStats) de low_power.h.
+
+  1) Modelo: duty, corriente media, mAh y horas de batería de EnergyAccount
+     contra cuentas hechas a mano; mínimo/máximo/promedio de WakeLatencyStats.
+  2) Sin bajo consumo (loop girando) y con WFI, misma carga por SIM_SECONDS:
+     ningún tick perdido ni plazo de adquisición perdido; con WFI el tiempo
+     despierto y dormido de EnergyAccount suma el tiempo real (sin perder el
+     resto de cada conversión a us), el duty queda cerca de la utilización y
+     la batería dura más; latencia de despertar acotada.
+  3) La carrera entre la bandera y el WFI: con las interrupciones
+     deshabilitadas (como lowPowerIdle) un tick que llega en medio no se
+     pierde; sin deshabilitarlas el núcleo se duerme con la bandera puesta y
+     la simulación lo tiene que ver (ticks pisados o latencias de un periodo).
+
+  Devuelve 1 si falla alguna comprobación.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include "task_scheduler.h"
+#include "low_power.h"
+
+#define SIM_CPU_MHZ          480
+#define SIM_PERIOD_US        500
+#define SIM_JITTER_US        3
+#define SIM_SYSTICK_US       1000
+#define SIM_USB_MAX_US       4000      // Interrupciones del USB cada 0..4 ms
+#define SIM_SECONDS          60
+#define SIM_ISR_CYCLES       120       // Entrada, cuerpo y salida de una ISR
+#define SIM_LOOP_CYCLES      240       // Una vuelta de loop() sin trabajo
+#define SIM_WAKE_CYCLES      30        // Salida de WFI en modo sleep
+#define SIM_IDLE_WINDOW      480       // Entre la comprobación de la bandera y el WFI
+#define SIM_WAKE_BOUND_US    10        // Cota de la latencia de despertar
+
+enum IdleMode { IDLE_SPIN, IDLE_MASKED, IDLE_NAIVE };
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    if (!ok) {
+        printf("  FALLA: %s\n", what);
+        failures++;
+    }
+}
+
+static bool near(double a, double b, double tolerance) {
+    return fabs(a - b) <= tolerance;
+}
+
+// ---- Reloj, azar e interrupciones ----
+
+static uint64_t simCycles = 0;
+static uint32_t lcgState = 2024;
+
+static uint32_t lcg() {
+    lcgState = lcgState * 1664525u + 1013904223u;
+    return lcgState >> 8;
+}
+
+static uint32_t uniform(uint32_t low, uint32_t high) {
+    return low + lcg() % (high - low + 1);
+}
+
+static uint32_t dwtCycles() { return (uint32_t)simCycles; }
+static uint32_t simMicros() { return (uint32_t)(simCycles / SIM_CPU_MHZ); }
+
+struct SimIrq {
+    uint64_t nextTimer;
+    uint64_t nextSysTick;
+    uint64_t nextUsb;
+    bool flag;                  // readSensor
+    uint32_t stampUs;
+    uint32_t isrCycles;         // timerIsrCycles
+    uint32_t ticks;
+    uint32_t seen;
+    uint32_t lost;
+
+    void reset() {
+        nextTimer = (uint64_t)SIM_PERIOD_US * SIM_CPU_MHZ;
+        nextSysTick = (uint64_t)SIM_SYSTICK_US * SIM_CPU_MHZ;
+        nextUsb = (uint64_t)uniform(1, SIM_USB_MAX_US) * SIM_CPU_MHZ;
+        flag = false;
+        ticks = seen = lost = 0;
+    }
+
+    uint64_t nextEvent() const {
+        uint64_t next = nextTimer < nextSysTick ? nextTimer : nextSysTick;
+        return nextUsb < next ? nextUsb : next;
+    }
+
+    // Atiende las interrupciones vencidas; cada una corre en su instante (o
+    // apenas termina la anterior) y suma su costo
+    void deliver() {
+        while (nextEvent() <= simCycles) {
+            if (nextUsb <= nextTimer && nextUsb <= nextSysTick) {
+                nextUsb += (uint64_t)uniform(1, SIM_USB_MAX_US * SIM_CPU_MHZ);
+            } else if (nextTimer <= nextSysTick) {
+                if (flag) lost++;
+                flag = true;
+                isrCycles = (uint32_t)nextTimer;
+                stampUs = (uint32_t)(nextTimer / SIM_CPU_MHZ);
+                ticks++;
+                nextTimer += (uint64_t)(SIM_PERIOD_US - SIM_JITTER_US + uniform(0, 2 * SIM_JITTER_US)) * SIM_CPU_MHZ;
+            } else {
+                nextSysTick += (uint64_t)SIM_SYSTICK_US * SIM_CPU_MHZ;
+            }
+            simCycles += SIM_ISR_CYCLES;
+        }
+    }
+};
+
+static SimIrq irq;
+
+// Avanza el reloj ejecutando código (las interrupciones lo interrumpen)
+static void runFor(uint64_t cycles) {
+    simCycles += cycles;
+    irq.deliver();
+}
+
+// ---- Tareas ----
+
+static WakeLatencyStats wake;
+
+static TaskResult acquireTask(void*) {
+    wake.add(dwtCycles() - irq.isrCycles);   // lowPowerSampleWake()
+    runFor((uint64_t)uniform(60, 90) * SIM_CPU_MHZ);
+    return TASK_DONE;
+}
+
+static TaskResult ledTask(void*) {
+    runFor(5 * SIM_CPU_MHZ);
+    return TASK_DONE;
+}
+
+static TaskResult hostTask(void*) {
+    runFor(uniform(10, 40) * SIM_CPU_MHZ);
+    return TASK_DONE;
+}
+
+// Reporte en tres porciones de hasta 250 us
+static TaskResult reportTask(void* context) {
+    int& slice = *(int*)context;
+    runFor((uint64_t)uniform(150, 250) * SIM_CPU_MHZ);
+    if (++slice < 3) return TASK_MORE;
+    slice = 0;
+    return TASK_DONE;
+}
+
+// ---- loop() ----
+
+struct RunResult {
+    uint32_t ticks;
+    uint32_t lost;
+    uint32_t misses;
+    uint32_t maxWakeCycles;
+    uint32_t avgWakeCycles;
+    uint64_t exactRunCycles;    // Partición exacta del tiempo, para comparar
+    uint64_t exactSleepCycles;
+    uint64_t elapsedCycles;
+    EnergyAccount energy;
+    uint32_t idles;
+    uint32_t wakeups;
+    uint32_t immediate;         // WFI que volvió enseguida por una interrupción pendiente
+};
+
+static RunResult runLoop(IdleMode mode) {
+    simCycles = 0;
+    lcgState = 2024;
+    irq.reset();
+    wake.reset();
+    int reportSlice = 0;
+
+    TaskScheduler scheduler(simMicros);
+    int acq = scheduler.add({"acq", acquireTask, nullptr, SIM_PERIOD_US, 150, 0, true, 0});
+    scheduler.add({"host", hostTask, nullptr, 1000, 200, 0, false, 0});
+    scheduler.add({"led", ledTask, nullptr, 10000, 20, 0, false, 0});
+    scheduler.add({"report", reportTask, &reportSlice, 100000, 300, 900, false, 0});
+
+    RunResult r = RunResult();
+    r.energy.start(dwtCycles());
+    uint64_t mark = simCycles;
+    const uint64_t end = (uint64_t)SIM_SECONDS * 1000000u * SIM_CPU_MHZ;
+
+    while (simCycles < end) {
+        if (irq.flag) {
+            irq.flag = false;
+            scheduler.release(acq, irq.stampUs, irq.ticks - irq.seen - 1);
+            irq.seen = irq.ticks;
+        }
+        bool ran = scheduler.runOnce();
+        runFor(SIM_LOOP_CYCLES);
+        if (ran || mode == IDLE_SPIN || scheduler.pending()) continue;
+
+        // lowPowerIdle(readSensor)
+        r.idles++;
+        if (mode == IDLE_MASKED) {
+            // __disable_irq(): las interrupciones quedan pendientes
+            if (irq.flag) continue;
+            r.energy.runUntil(dwtCycles(), SIM_CPU_MHZ);
+            r.exactRunCycles += simCycles - mark;
+            mark = simCycles;
+            simCycles += SIM_IDLE_WINDOW;
+            // WFI despierta enseguida si ya hay una pendiente
+            if (irq.nextEvent() > simCycles) simCycles = irq.nextEvent();
+            else r.immediate++;
+            simCycles += SIM_WAKE_CYCLES;
+            irq.deliver();      // __enable_irq()
+        } else {
+            // Sin deshabilitar: una ISR entre la comprobación y el WFI pone la
+            // bandera y el núcleo se duerme igual hasta la interrupción siguiente
+            if (irq.flag) continue;
+            r.energy.runUntil(dwtCycles(), SIM_CPU_MHZ);
+            r.exactRunCycles += simCycles - mark;
+            mark = simCycles;
+            runFor(SIM_IDLE_WINDOW);
+            simCycles = irq.nextEvent() + SIM_WAKE_CYCLES;
+            irq.deliver();
+        }
+        r.wakeups++;
+        r.energy.sleepUntil(dwtCycles(), SIM_CPU_MHZ);
+        r.exactSleepCycles += simCycles - mark;
+        mark = simCycles;
+    }
+    if (mode != IDLE_SPIN) {
+        r.energy.runUntil(dwtCycles(), SIM_CPU_MHZ);
+        r.exactRunCycles += simCycles - mark;
+    }
+
+    r.elapsedCycles = simCycles;
+    r.ticks = irq.ticks;
+    r.lost = irq.lost;
+    r.misses = scheduler.stats(acq).misses;
+    r.maxWakeCycles = wake.maxCycles;
+    r.avgWakeCycles = wake.averageCycles();
+    return r;
+}
+
+static void model() {
+    printf("1) Modelo de energía y latencia\n");
+    EnergyAccount e;
+    e.reset();
+    check(e.dutyCycle() == 1.0f, "sin tiempo contado el duty es 1 (peor caso)");
+    e.addRun(1000000);
+    e.addSleep(3000000);
+    check(near(e.dutyCycle(), 0.25, 1e-6), "duty 1 s despierto / 3 s dormido");
+    check(near(e.averageMa(), 0.25 * POWER_RUN_MA + 0.75 * POWER_SLEEP_MA, 1e-3), "corriente media");
+    check(near(e.consumedMah(), (1.0 * POWER_RUN_MA + 3.0 * POWER_SLEEP_MA) / 3600.0, 1e-6), "mAh consumidos");
+    check(near(e.batteryHours(), POWER_BATTERY_MAH / (0.25 * POWER_RUN_MA + 0.75 * POWER_SLEEP_MA), 1e-3),
+          "horas de batería");
+    check(near(e.averageMa(100.0f, 10.0f), 32.5, 1e-4), "corrientes de otra placa");
+
+    // Marca de ciclos: los restos de la división no se pierden, ni al dar
+    // la vuelta el contador de 32 bits
+    e.start(0xFFFFFF00u);
+    uint32_t cycles = 0xFFFFFF00u;
+    uint64_t total = 0;
+    for (int i = 0; i < 100000; i++) {
+        uint32_t step = 100 + (uint32_t)i % 700;
+        cycles += step;
+        total += step;
+        if (i % 2) e.sleepUntil(cycles, SIM_CPU_MHZ);
+        else e.runUntil(cycles, SIM_CPU_MHZ);
+    }
+    check(e.runUs + e.sleepUs == total / SIM_CPU_MHZ, "restos de la conversión a us perdidos");
+
+    WakeLatencyStats w;
+    w.reset();
+    check(w.averageCycles() == 0 && w.maxCycles == 0 && w.minCycles == UINT32_MAX, "latencias vacías");
+    w.add(300);
+    w.add(100);
+    w.add(500);
+    check(w.count == 3 && w.minCycles == 100 && w.maxCycles == 500 && w.averageCycles() == 300,
+          "mínimo/máximo/promedio de la latencia");
+    printf("   duty %.2f, %.2f mA, %.4f mAh, %.1f h de batería\n", 0.25, 0.25 * POWER_RUN_MA + 0.75 * POWER_SLEEP_MA,
+           (1.0 * POWER_RUN_MA + 3.0 * POWER_SLEEP_MA) / 3600.0,
+           POWER_BATTERY_MAH / (0.25 * POWER_RUN_MA + 0.75 * POWER_SLEEP_MA));
+}
+
+static void compare() {
+    printf("2) Loop girando contra WFI (%d s)\n", SIM_SECONDS);
+    RunResult spin = runLoop(IDLE_SPIN);
+    RunResult sleep = runLoop(IDLE_MASKED);
+
+    // Girando, el núcleo nunca duerme: todo el tiempo cuenta como despierto
+    EnergyAccount spinEnergy;
+    spinEnergy.reset();
+    spinEnergy.addRun((uint32_t)(spin.elapsedCycles / SIM_CPU_MHZ));
+
+    double exactDuty = (double)sleep.exactRunCycles / (double)(sleep.exactRunCycles + sleep.exactSleepCycles);
+    uint64_t accountedUs = sleep.energy.runUs + sleep.energy.sleepUs;
+    printf("   girando: ticks %u, perdidos %u, plazos perdidos %u, latencia %u/%u ciclos, %.1f mA, %.1f h\n",
+           spin.ticks, spin.lost, spin.misses, spin.avgWakeCycles, spin.maxWakeCycles, spinEnergy.averageMa(),
+           spinEnergy.batteryHours());
+    printf("   WFI:     ticks %u, perdidos %u, plazos perdidos %u, latencia %u/%u ciclos, duty %.1f %% (exacto %.1f %%), "
+           "%.1f mA, %.1f h\n",
+           sleep.ticks, sleep.lost, sleep.misses, sleep.avgWakeCycles, sleep.maxWakeCycles,
+           sleep.energy.dutyCycle() * 100.0f, exactDuty * 100.0, sleep.energy.averageMa(),
+           sleep.energy.batteryHours());
+    printf("            %u entradas a WFI, contado %llu us de %llu us, despierto %llu us (exacto %.0f us)\n",
+           sleep.wakeups, (unsigned long long)accountedUs, (unsigned long long)(sleep.elapsedCycles / SIM_CPU_MHZ),
+           (unsigned long long)sleep.energy.runUs, (double)sleep.exactRunCycles / SIM_CPU_MHZ);
+
+    check(spin.lost == 0 && spin.misses == 0, "ticks o plazos perdidos con el loop girando");
+    check(sleep.lost == 0 && sleep.misses == 0, "ticks o plazos perdidos con WFI");
+    check(sleep.ticks >= spin.ticks - 1, "menos ticks atendidos con WFI");
+    check(accountedUs + 1 >= sleep.elapsedCycles / SIM_CPU_MHZ && accountedUs <= sleep.elapsedCycles / SIM_CPU_MHZ,
+          "despierto + dormido distinto del tiempo transcurrido");
+    // Cada cambio de estado puede correr menos de 1 us de un lado al otro,
+    // pero sin acumular un sesgo
+    double exactRunUs = (double)sleep.exactRunCycles / SIM_CPU_MHZ;
+    check(near(sleep.energy.runUs, exactRunUs, 1e-3 * exactRunUs), "tiempo despierto mal contado");
+    check(near(sleep.energy.dutyCycle(), exactDuty, 1e-4), "duty distinto del simulado");
+    check(sleep.energy.dutyCycle() < 0.30f, "duty demasiado alto para la carga");
+    check(sleep.energy.batteryHours() > 1.3f * spinEnergy.batteryHours(), "la batería no dura más con WFI");
+    check(sleep.maxWakeCycles <= SIM_WAKE_BOUND_US * SIM_CPU_MHZ, "latencia de despertar fuera de la cota");
+}
+
+static void race() {
+    printf("3) Carrera entre la bandera y el WFI\n");
+    RunResult masked = runLoop(IDLE_MASKED);
+    RunResult naive = runLoop(IDLE_NAIVE);
+    printf("   con interrupciones deshabilitadas: %u WFI con una pendiente, perdidos %u, latencia máxima %u us\n",
+           masked.immediate, masked.lost, masked.maxWakeCycles / SIM_CPU_MHZ);
+    printf("   sin deshabilitar: perdidos %u, plazos perdidos %u, latencia máxima %u us\n", naive.lost, naive.misses,
+           naive.maxWakeCycles / SIM_CPU_MHZ);
+    check(masked.immediate > 0, "ningún tick cayó entre la comprobación y el WFI (la prueba no ejercitó la carrera)");
+    check(masked.lost == 0 && masked.misses == 0 && masked.maxWakeCycles <= SIM_WAKE_BOUND_US * SIM_CPU_MHZ,
+          "tick perdido o demorado con lowPowerIdle()");
+    check(naive.lost > 0 || naive.maxWakeCycles > SIM_PERIOD_US / 2 * SIM_CPU_MHZ,
+          "la simulación no ve la carrera sin deshabilitar");
+}
+
+int main() {
+    model();
+    compare();
+    race();
+    printf("%s\n", failures ? "FALLA" : "OK");
+    return failures ? 1 : 0;
+}
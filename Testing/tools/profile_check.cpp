@@ -0,0 +1,226 @@
+/*
+  Verificación de los perfiles de placa en el host (build nativo)
+
+  Compilar desde Testing/:
+    g++ -O2 -std=gnu++14 -Isrc tools/profile_check.cpp -o profile_check
+
+  1) Instanciar cada perfil de board_profiles.h ya corre sus static_assert
+     (SensorId repetidos, direcciones I2C, pines, buses, relojes y
+     presupuesto del tick), así que si compila, los perfiles son válidos.
+     Después cada perfil corre PROFILE_CHECK_TICKS ticks con una fuente
+     simulada y se reporta el tick estimado contra el presupuesto, el periodo
+     mínimo, las muestras publicadas por estado y el tiempo por tick en el
+     host. Cada sensor del perfil tiene que publicar PROFILE_CHECK_TICKS /
+     decimación muestras (y los demás ninguna), con la decimación y las
+     cuentas por estado de la tabla expected.
+  2) Perfiles con conflictos: vuelve a compilar este archivo (con $CXX o g++,
+     solo la sintaxis) con cada -DPROFILE_CHECK_CONFLICTS=N; cada uno tiene
+     que fallar con el mensaje de su static_assert:
+    1  dos sensores en la misma dirección I2C
+    2  un bus declarado con dos relojes distintos
+    3  CS del SPI sobre un pin del I2C
+    4  lectura que no entra en el periodo (SM4291 a 100 kHz y 2 kHz)
+    5  SM4291 en un bus a 1 MHz (admite hasta 400 kHz)
+    6  ABPLLN en I2C1, en la dirección del PMIC
+     Compilar a mano con uno de esos -D muestra el mensaje completo.
+
+  Devuelve 1 si falla alguna comprobación.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "board_profiles.h"
+
+#define PROFILE_CHECK_TICKS  200000
+#define PROFILE_CHECK_FAIL   997     // Cada cuántas lecturas falla el bus simulado
+#define PROFILE_CHECK_CONFLICT_COUNT 6
+
+#if PROFILE_CHECK_CONFLICTS == 1
+using ProfileConflict = BoardProfile<500,
+    SensorList<Sm4291I2c<BusI2c3>, ElvhI2c<BusI2c3, 0x6C>>, StageList<>>;
+#elif PROFILE_CHECK_CONFLICTS == 2
+using ProfileConflict = BoardProfile<500,
+    SensorList<Sm4291I2c<BusI2c3>, ElvhI2c<I2cBus<3, PIN_D11, PIN_D12, 100000>>>, StageList<>>;
+#elif PROFILE_CHECK_CONFLICTS == 3
+using ProfileConflict = BoardProfile<500,
+    SensorList<Sm4291I2c<BusI2c3>, SscdannSpi<BusSpi1, PIN_D12>>, StageList<>>;
+#elif PROFILE_CHECK_CONFLICTS == 4
+using ProfileConflict = BoardProfile<500,
+    SensorList<Sm4291I2c<I2cBus<3, PIN_D11, PIN_D12, 100000>>>, StageList<>>;
+#elif PROFILE_CHECK_CONFLICTS == 5
+using ProfileConflict = BoardProfile<500,
+    SensorList<Sm4291I2c<I2cBus<3, PIN_D11, PIN_D12, 1000000>>>, StageList<>>;
+#elif PROFILE_CHECK_CONFLICTS == 6
+using ProfileConflict = BoardProfile<500,
+    SensorList<Sm4291I2c<BusI2c3>, AbpllnI2c<BusI2c1>>, StageList<>, ACQUIRE_CONCURRENT>;
+#endif
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    if (!ok) {
+        printf("  FALLA: %s\n", what);
+        failures++;
+    }
+}
+
+// Cuentas simuladas: una rampa que recorre la banda de calibración (y se
+// pasa un poco de los extremos) y un error de bus cada tanto
+struct SimSource {
+    uint32_t reads = 0;
+
+    template <typename Sensor>
+    bool read(Sensor, int32_t* raw) {
+        reads++;
+        if (reads % PROFILE_CHECK_FAIL == 0) return false;
+        constexpr LinearCal cal = Sensor::cal();
+        float span = cal.outHigh - cal.outLow;
+        float value = cal.outLow - 0.3f * span + 1.6f * span * (float)(reads % 1000) / 1000.0f;
+        *raw = (int32_t)((value - cal.offset) / cal.scale);
+        return true;
+    }
+
+    // Modo concurrente: la transacción "termina" al pedir el resultado
+    template <typename Sensor>
+    void start(Sensor) {}
+
+    template <typename Sensor>
+    bool finish(Sensor sensor, int32_t* raw) {
+        return read(sensor, raw);
+    }
+};
+
+struct CountingSink {
+    uint32_t published = 0;
+    uint32_t byStatus[3] = {0, 0, 0};
+    uint32_t bySensor[SENSOR_COUNT] = {};
+    double checksum = 0.0;
+
+    void publish(const IpcSample& sample) {
+        published++;
+        if (sample.status < 3) byStatus[sample.status]++;
+        bySensor[sample.sensorId]++;
+        checksum += sample.value;
+    }
+};
+
+// Lo que tiene que publicar cada perfil en PROFILE_CHECK_TICKS ticks
+struct ProfileExpect {
+    uint32_t channels;      // Sensores publicados
+    uint32_t decimation;    // Una muestra publicada cada tantos ticks por sensor
+    uint32_t ok;
+    uint32_t busErrors;
+    uint32_t outOfRange;
+};
+
+template <typename Profile>
+static void checkProfile(const char* name, const ProfileExpect& expected) {
+    SimSource source;
+    CountingSink sink;
+    ProfileRunner<Profile, SimSource, CountingSink> runner(source, sink);
+
+    uint32_t errorTicks = 0;
+    clock_t start = clock();
+    for (uint32_t t = 0; t < PROFILE_CHECK_TICKS; t++) {
+        if (runner.tick(t * Profile::periodUs(), (uint16_t)t, Profile::sensorMask())) errorTicks++;
+    }
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    printf("%-24s sensores %u  tick %3u/%3u us %s (periodo %4u, mínimo %4u)  host %.1f ns/tick\n", name,
+           (unsigned)Profile::sensorCount(), (unsigned)Profile::tickUs(), (unsigned)Profile::budgetUs(),
+           Profile::mode() == ACQUIRE_CONCURRENT ? "concurrente" : "secuencial ",
+           (unsigned)Profile::periodUs(), (unsigned)Profile::minPeriodUs(), seconds * 1e9 / PROFILE_CHECK_TICKS);
+    printf("%-24s lecturas %u  publicadas %u (ok %u, bus %u, rango %u)  ticks con error %u  suma %.3g\n", "",
+           source.reads, sink.published, sink.byStatus[SAMPLE_OK], sink.byStatus[SAMPLE_BUS_ERROR],
+           sink.byStatus[SAMPLE_OUT_OF_RANGE], errorTicks, sink.checksum);
+
+    uint32_t channels = 0;
+    bool perSensor = true;
+    for (uint8_t id = 0; id < SENSOR_COUNT; id++) {
+        bool inProfile = Profile::sensorMask() & (1u << id);
+        if (inProfile) channels++;
+        if (sink.bySensor[id] != (inProfile ? PROFILE_CHECK_TICKS / expected.decimation : 0)) perSensor = false;
+    }
+    check(channels == expected.channels && Profile::sensorCount() == expected.channels, "canales publicados");
+    check(source.reads == PROFILE_CHECK_TICKS * expected.channels, "lecturas por tick");
+    check(perSensor, "muestras por sensor (decimación)");
+    check(sink.published * expected.decimation == source.reads, "decimación");
+    check(sink.byStatus[SAMPLE_OK] == expected.ok, "muestras ok");
+    check(sink.byStatus[SAMPLE_BUS_ERROR] == expected.busErrors, "errores de bus");
+    check(sink.byStatus[SAMPLE_OUT_OF_RANGE] == expected.outOfRange, "fuera de rango");
+    check(Profile::tickUs() <= Profile::budgetUs() && Profile::minPeriodUs() <= Profile::periodUs(),
+          "tick fuera del presupuesto");
+}
+
+// Mensaje del static_assert que tiene que cortar cada conflicto
+static const char* const conflictMessages[PROFILE_CHECK_CONFLICT_COUNT + 1] = {
+    NULL,
+    "dos sensores con la misma dirección en un bus I2C",
+    "un bus declarado con pines o reloj distintos",
+    "un pin asignado a dos recursos distintos",
+    "la adquisición estimada no entra en el periodo del tick",
+    "un bus I2C más rápido que el máximo de uno de sus sensores",
+    "un sensor en una dirección I2C reservada por la placa",
+};
+
+// Compila este archivo con -DPROFILE_CHECK_CONFLICTS=conflict (0 = sin el
+// define) y devuelve si compiló; el mensaje del compilador queda en output
+static bool compileSelf(int conflict, char* output, size_t outputSize) {
+    char dir[256];
+    const char* slash = strrchr(__FILE__, '/');
+    snprintf(dir, sizeof(dir), "%.*s", slash ? (int)(slash - __FILE__) : 1, slash ? __FILE__ : ".");
+    const char* cxx = getenv("CXX") ? getenv("CXX") : "g++";
+    char define[48] = "";
+    if (conflict > 0) snprintf(define, sizeof(define), "-DPROFILE_CHECK_CONFLICTS=%d", conflict);
+    char command[768];
+    snprintf(command, sizeof(command), "%s -std=gnu++14 -fsyntax-only -I%s/../src %s %s 2>&1", cxx, dir, define,
+             __FILE__);
+
+    FILE* pipe = popen(command, "r");
+    if (!pipe) return false;
+    size_t used = 0;
+    size_t n;
+    while (used + 1 < outputSize && (n = fread(output + used, 1, outputSize - 1 - used, pipe)) > 0) used += n;
+    output[used] = '\0';
+    char rest[256];
+    while (fread(rest, 1, sizeof(rest), pipe) > 0) {}
+    return pclose(pipe) == 0;
+}
+
+static void checkConflicts() {
+    printf("2) Perfiles con conflictos\n");
+    static char output[65536];
+    // Sin conflicto tiene que compilar: si no, las fallas de abajo no dicen nada
+    bool baseline = compileSelf(0, output, sizeof(output));
+    check(baseline, "profile_check.cpp no compila sin conflictos");
+    if (!baseline) {
+        printf("%s", output);
+        return;
+    }
+    for (int conflict = 1; conflict <= PROFILE_CHECK_CONFLICT_COUNT; conflict++) {
+        bool compiled = compileSelf(conflict, output, sizeof(output));
+        bool message = strstr(output, conflictMessages[conflict]) != NULL;
+        printf("  %d  %-58s %s\n", conflict, conflictMessages[conflict],
+               compiled ? "compiló" : message ? "rechazado" : "rechazado por otro motivo");
+        check(!compiled && message, conflictMessages[conflict]);
+    }
+}
+
+int main() {
+    printf("1) Perfiles de board_profiles.h\n");
+    checkProfile<ProfileSuction>("ProfileSuction", {1, 1, 187210, 200, 12590});
+    checkProfile<ProfileSuctionRedundant>("ProfileSuctionRedundant", {2, 1, 386815, 401, 12784});
+    checkProfile<ProfileMultiPoint>("ProfileMultiPoint", {4, 1, 761637, 802, 37561});
+    checkProfile<ProfileSlowMonitor>("ProfileSlowMonitor", {1, 10, 18581, 20, 1399});
+    checkProfile<ProfileMultiPointSplit>("ProfileMultiPointSplit", {4, 1, 760838, 802, 38360});
+#ifdef PROFILE_CHECK_CONFLICTS
+    checkProfile<ProfileConflict>("ProfileConflict", {0, 1, 0, 0, 0});
+#else
+    checkConflicts();
+#endif
+
+    printf("%s\n", failures ? "FALLA" : "OK");
+    return failures ? 1 : 0;
+}
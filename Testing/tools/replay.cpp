@@ -0,0 +1,426 @@
+/*
+  Replay determinístico del procesamiento del firmware (build nativo)
+
+  Compilar desde Testing/:
+    g++ -O2 -std=gnu++14 -Isrc tools/replay.cpp -o replay
+
+  Pasa una traza de cuentas crudas por las mismas etapas que el firmware, con
+  el tiempo de la traza como reloj simulado:
+  - driver:   cuentas -> mbar con la calibración del sensor, por bloques con
+              pressureConvertBatch (pressure_convert.h; da lo mismo que la
+              conversión de los drivers después de leer el bus)
+  - pipeline: filtro, contadores y estado del LED RGB (sample_pipeline.h)
+  - ventana:  curtosis y estado del LED de la ventana (window_core.h)
+  - formato:  renglones de salida idénticos a los del puerto serie
+
+  La salida son los renglones del firmware más eventos "#LED <us> <estado>"
+  (cambio de color del LED RGB) y "#W <us> <estado> <curtosis>" (cambio del
+  LED de la ventana). Con --golden se compara byte a byte contra una salida
+  de referencia y se termina con código 1 si difiere; con --record se guarda
+  la salida actual como referencia. El throughput de cada etapa se informa
+  por stderr, así no ensucia la comparación.
+
+  Traza (texto, una muestra por renglón; '#' empieza un comentario):
+    <micros> <cuentas>     cuentas ya extraídas de la palabra del sensor
+    <micros> ERR           lectura fallida en el bus
+
+  Sin argumentos corre los casos guardados en tools/golden (tabla
+  goldenCases: traza, sensor, configuración y salida esperada) y devuelve 1
+  si alguno difiere. Las referencias son del build de la línea de arriba:
+  con -march=native (FMA) cambia el último decimal de algunos renglones.
+  Si un cambio altera la salida a propósito, regenerar la referencia con
+  --record y revisar el diff antes de commitearla, por ejemplo:
+    replay --alpha 0.25 --window 20 --record tools/golden/sm4291_filtered.expected
+           tools/golden/sm4291_synthetic.trace
+
+  Uso:
+    replay                                  casos de tools/golden
+    replay [opciones] [traza]
+      --sensor S        sm4291 (por defecto), sm4291-analog, abplln, elvh, sscdann
+      --synthetic SEG   genera SEG segundos de traza de SM4291 en lugar de leerla
+      --write-trace F   guarda la traza usada (para conservarla junto a la referencia)
+      --golden F        compara la salida con F
+      --record F        guarda la salida en F
+      --alpha A         alfa del filtro IIR (por defecto 1 = sin filtrado)
+      --window N        muestras de la ventana de curtosis
+      --repeat N        repeticiones para medir el throughput
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include "pressure_convert.h"
+#include "sample_pipeline.h"
+#include "window_core.h"
+
+// runtime_config.h declara la configuración global del firmware
+RuntimeConfig activeConfig = defaultRuntimeConfig();
+RuntimeConfig pendingConfig = defaultRuntimeConfig();
+bool configPending = false;
+
+#define REPLAY_WINDOW_MAX  50      // WINDOW_SIZE de window_analysis.h
+#define SYNTH_PERIOD_US    500
+
+struct SensorModel {
+    const char* name;
+    const LinearCal* cal;
+    bool clamped;
+    float unitScale;       // Unidades de la calibración -> mbar
+};
+
+static const SensorModel sensors[] = {
+    {"sm4291",        &CAL_SM4291_I2C,    false, 1.0f},
+    {"sm4291-analog", &CAL_SM4291_ANALOG, true,  1.0f},
+    {"abplln",        &CAL_ABPLLN,        true,  1.0f},
+    {"elvh",          &CAL_ELVH_BAR,      false, 1000.0f},
+    {"sscdann",       &CAL_SSCDANN,       false, 1.0f},
+};
+
+struct TraceSample {
+    uint32_t us;
+    int32_t counts;
+    bool ok;
+};
+
+static bool loadTrace(const char* path, std::vector<TraceSample>& trace) {
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+    char line[128];
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') continue;
+        unsigned long us;
+        char value[32];
+        if (sscanf(line, "%lu %31s", &us, value) != 2) continue;
+        TraceSample s;
+        s.us = (uint32_t)us;
+        s.ok = strcmp(value, "ERR") != 0;
+        s.counts = s.ok ? (int32_t)strtol(value, nullptr, 10) : 0;
+        trace.push_back(s);
+    }
+    fclose(f);
+    return true;
+}
+
+// Generador congruencial propio: la traza no depende de rand() de la plataforma
+static uint32_t lcgState = 12345;
+static float lcgUniform() {
+    lcgState = lcgState * 1664525u + 1013904223u;
+    return (lcgState >> 8) * (1.0f / 16777216.0f);
+}
+
+// SM4291 por I2C: reposo, rampa, meseta con pulsación, ráfagas de errores
+// (3 y 10 seguidos: naranja y luego rojo), un pico fuera de rango y succión alta
+static void synthesizeTrace(double seconds, std::vector<TraceSample>& trace) {
+    const LinearCal& cal = CAL_SM4291_I2C;
+    long total = (long)(seconds * 1e6 / SYNTH_PERIOD_US);
+    for (long n = 0; n < total; n++) {
+        double t = n * SYNTH_PERIOD_US * 1e-6;
+        double phase = t / seconds;
+        double mbar;
+        if (phase < 0.1) mbar = -5.0;
+        else if (phase < 0.3) mbar = -5.0 - 145.0 * (phase - 0.1) / 0.2;
+        else if (phase < 0.6) mbar = -150.0 + 20.0 * sin(2.0 * M_PI * 8.0 * t);
+        else mbar = -350.0 + 5.0 * sin(2.0 * M_PI * 25.0 * t);
+        mbar += 0.8 * (lcgUniform() - 0.5);
+
+        TraceSample s;
+        s.us = (uint32_t)(n * SYNTH_PERIOD_US);
+        s.ok = true;
+        long errorAt = (long)(0.45 * total);
+        long burstAt = (long)(0.5 * total);
+        if ((n >= errorAt && n < errorAt + 3) || (n >= burstAt && n < burstAt + 10)) s.ok = false;
+        if (n >= (long)(0.7 * total) && n < (long)(0.7 * total) + 4) mbar = 40.0;   // Fuera de rango
+        s.counts = s.ok ? (int32_t)lround((mbar - cal.offset) / cal.scale) : 0;
+        trace.push_back(s);
+    }
+}
+
+static double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Compara dos salidas renglón a renglón; devuelve la cantidad de renglones distintos
+static size_t diffOutputs(const std::string& expected, const std::string& actual) {
+    size_t differing = 0, line = 1, e = 0, a = 0;
+    while (e < expected.size() || a < actual.size()) {
+        size_t eEnd = expected.find('\n', e), aEnd = actual.find('\n', a);
+        if (eEnd == std::string::npos) eEnd = expected.size();
+        if (aEnd == std::string::npos) aEnd = actual.size();
+        std::string el = e < expected.size() ? expected.substr(e, eEnd - e) : "<fin>";
+        std::string al = a < actual.size() ? actual.substr(a, aEnd - a) : "<fin>";
+        if (el != al) {
+            if (differing < 5) {
+                fprintf(stderr, "renglón %zu:\n  esperado: %s\n  obtenido: %s\n", line, el.c_str(), al.c_str());
+            }
+            differing++;
+        }
+        e = eEnd + 1;
+        a = aEnd + 1;
+        line++;
+    }
+    return differing;
+}
+
+static bool readFile(const char* path, std::string& contents) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    char buffer[4096];
+    size_t got;
+    while ((got = fread(buffer, 1, sizeof(buffer), f)) > 0) contents.append(buffer, got);
+    fclose(f);
+    return true;
+}
+
+static const SensorModel* findSensor(const char* name) {
+    for (const SensorModel& s : sensors) {
+        if (!strcmp(s.name, name)) return &s;
+    }
+    return nullptr;
+}
+
+// Pasa la traza por las cuatro etapas 'repeat' veces; devuelve la salida y
+// acumula el tiempo de cada etapa en stageSeconds
+static std::string replayTrace(const std::vector<TraceSample>& trace, const SensorModel* sensor,
+                               const RuntimeConfig& config, int repeat, double stageSeconds[4]) {
+    const size_t n = trace.size();
+    const LinearCal cal = sensor->clamped ? *sensor->cal : unclampedCal(*sensor->cal);
+    std::vector<int32_t> counts(n);
+    for (size_t i = 0; i < n; i++) counts[i] = trace[i].counts;
+    std::vector<float> mbar(n);
+    std::vector<SampleResult> results(n);
+    std::vector<uint8_t> windowStates(n);
+    std::vector<float> windowKurt(n);
+    std::string output;
+    output.reserve(n * 32);
+
+    for (int rep = 0; rep < repeat; rep++) {
+        // Etapa driver: la traza entera por el kernel por bloques (mismo
+        // resultado que la conversión del driver tras leer las cuentas)
+        double start = nowSeconds();
+        pressureConvertBatch(counts.data(), mbar.data(), n, cal);
+        for (size_t i = 0; i < n; i++) {
+            mbar[i] = trace[i].ok ? mbar[i] * sensor->unitScale : SUCTION_ERROR_VALUE;
+        }
+        stageSeconds[0] += nowSeconds() - start;
+
+        // Etapa pipeline
+        SamplePipeline pipeline;
+        start = nowSeconds();
+        for (size_t i = 0; i < n; i++) {
+            results[i] = pipeline.process(mbar[i], config);
+        }
+        stageSeconds[1] += nowSeconds() - start;
+
+        // Etapa ventana (como addSampleToWindow + processWindowAnalysis por muestra)
+        int window[REPLAY_WINDOW_MAX];
+        size_t windowIndex = 0;
+        bool windowFilled = false;
+        LedState ledState = LED_OFF;
+        uint32_t greenStart = 0;
+        start = nowSeconds();
+        for (size_t i = 0; i < n; i++) {
+            if (trace[i].ok) {
+                window[windowIndex++] = trace[i].counts;
+                if (windowIndex >= config.windowLength) {
+                    windowIndex = 0;
+                    windowFilled = true;
+                }
+            }
+            LedState next = windowLedStep(ledState, windowFilled, window, config.windowLength,
+                                          trace[i].us / 1000, &greenStart,
+                                          config.kurtosisLow, config.kurtosisHigh);
+            windowKurt[i] = next != ledState ? windowKurtosis(window, config.windowLength) : 0.0f;
+            windowStates[i] = (uint8_t)next;
+            ledState = next;
+        }
+        stageSeconds[2] += nowSeconds() - start;
+
+        // Etapa formato: renglones del firmware y eventos de los LEDs
+        output.clear();
+        uint8_t lastStatus = 0xFF;
+        uint8_t lastWindow = LED_OFF;
+        char line[PIPELINE_LINE_SIZE];
+        start = nowSeconds();
+        for (size_t i = 0; i < n; i++) {
+            size_t length = formatSampleLine(trace[i].us, results[i], config, line);
+            output.append(line, length);
+            if (results[i].status != lastStatus) {
+                lastStatus = results[i].status;
+                output += "#LED ";
+                output += std::to_string(trace[i].us);
+                output += " ";
+                output += suctionStatusName(lastStatus);
+                output += "\r\n";
+            }
+            if (windowStates[i] != lastWindow) {
+                lastWindow = windowStates[i];
+                output += "#W ";
+                output += std::to_string(trace[i].us);
+                output += " ";
+                output += ledStateName((LedState)lastWindow);
+                output += " ";
+                output.append(line, formatFloat(line, windowKurt[i], 6));
+                output += "\r\n";
+            }
+        }
+        stageSeconds[3] += nowSeconds() - start;
+    }
+    return output;
+}
+
+// Trazas guardadas con su salida de referencia (rutas desde Testing/)
+struct GoldenCase {
+    const char* trace;
+    const char* sensor;
+    const char* expected;
+    float alpha;
+    uint16_t windowLength;
+};
+
+static const GoldenCase goldenCases[] = {
+    {"tools/golden/sm4291_synthetic.trace", "sm4291", "tools/golden/sm4291_synthetic.expected", 1.0f, 50},
+    {"tools/golden/sm4291_synthetic.trace", "sm4291", "tools/golden/sm4291_filtered.expected", 0.25f, 20},
+    {"tools/golden/abplln_band.trace",      "abplln", "tools/golden/abplln_band.expected",     1.0f, 50},
+};
+
+// Sin argumentos: corre todos los casos guardados
+static int runGoldenCases() {
+    int failed = 0;
+    for (const GoldenCase& c : goldenCases) {
+        std::vector<TraceSample> trace;
+        std::string expected;
+        if (!loadTrace(c.trace, trace) || trace.empty() || !readFile(c.expected, expected)) {
+            printf("  FALLA: no se pudo leer %s o %s (correr desde Testing/)\n", c.trace, c.expected);
+            failed++;
+            continue;
+        }
+        RuntimeConfig config = defaultRuntimeConfig();
+        config.filterAlpha = c.alpha;
+        config.windowLength = c.windowLength;
+        double stageSeconds[4] = {0, 0, 0, 0};
+        std::string output = replayTrace(trace, findSensor(c.sensor), config, 1, stageSeconds);
+        size_t differing = diffOutputs(expected, output);
+        printf("%-40s %6zu muestras  %s\n", c.expected, trace.size(), differing ? "DISTINTA" : "igual");
+        if (differing) {
+            printf("  FALLA: %zu renglones distintos de %s\n", differing, c.expected);
+            failed++;
+        }
+    }
+    printf("%s\n", failed ? "FALLA" : "OK");
+    return failed ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) return runGoldenCases();
+
+    const char* tracePath = nullptr;
+    const char* goldenPath = nullptr;
+    const char* recordPath = nullptr;
+    const char* writeTracePath = nullptr;
+    const SensorModel* sensor = &sensors[0];
+    double synthSeconds = 0.0;
+    int repeat = 1;
+    RuntimeConfig config = defaultRuntimeConfig();
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(arg, "--sensor") && hasValue) {
+            const char* name = argv[++i];
+            sensor = findSensor(name);
+            if (!sensor) {
+                fprintf(stderr, "sensor desconocido: %s\n", name);
+                return 2;
+            }
+        } else if (!strcmp(arg, "--synthetic") && hasValue) {
+            synthSeconds = atof(argv[++i]);
+        } else if (!strcmp(arg, "--write-trace") && hasValue) {
+            writeTracePath = argv[++i];
+        } else if (!strcmp(arg, "--golden") && hasValue) {
+            goldenPath = argv[++i];
+        } else if (!strcmp(arg, "--record") && hasValue) {
+            recordPath = argv[++i];
+        } else if (!strcmp(arg, "--alpha") && hasValue) {
+            config.filterAlpha = (float)atof(argv[++i]);
+        } else if (!strcmp(arg, "--window") && hasValue) {
+            int length = atoi(argv[++i]);
+            config.windowLength = (uint16_t)(length < 4 ? 4 : length > REPLAY_WINDOW_MAX ? REPLAY_WINDOW_MAX : length);
+        } else if (!strcmp(arg, "--repeat") && hasValue) {
+            repeat = atoi(argv[++i]);
+            if (repeat < 1) repeat = 1;
+        } else if (arg[0] != '-') {
+            tracePath = arg;
+        } else {
+            fprintf(stderr, "opción desconocida: %s\n", arg);
+            return 2;
+        }
+    }
+
+    std::vector<TraceSample> trace;
+    if (synthSeconds > 0.0) {
+        synthesizeTrace(synthSeconds, trace);
+        sensor = &sensors[0];
+    } else if (!tracePath || !loadTrace(tracePath, trace)) {
+        fprintf(stderr, "no se pudo leer la traza (usar un archivo o --synthetic SEG)\n");
+        return 2;
+    }
+    if (trace.empty()) {
+        fprintf(stderr, "traza vacía\n");
+        return 2;
+    }
+    if (writeTracePath) {
+        FILE* f = fopen(writeTracePath, "w");
+        if (!f) return 2;
+        fprintf(f, "# sensor %s\n", sensor->name);
+        for (const TraceSample& s : trace) {
+            if (s.ok) fprintf(f, "%u %d\n", (unsigned)s.us, (int)s.counts);
+            else fprintf(f, "%u ERR\n", (unsigned)s.us);
+        }
+        fclose(f);
+    }
+
+    const size_t n = trace.size();
+    double stageSeconds[4] = {0, 0, 0, 0};
+    std::string output = replayTrace(trace, sensor, config, repeat, stageSeconds);
+
+    const char* stageNames[4] = {"driver", "pipeline", "ventana", "formato"};
+    double totalSeconds = 0.0;
+    fprintf(stderr, "%zu muestras x %d repeticiones (%s)\n", n, repeat, sensor->name);
+    fprintf(stderr, "etapa       ns/muestra   Mmuestras/s\n");
+    for (int s = 0; s < 4; s++) {
+        double perSample = stageSeconds[s] * 1e9 / ((double)n * repeat);
+        fprintf(stderr, "%-10s  %10.1f  %12.2f\n", stageNames[s], perSample, 1e3 / perSample);
+        totalSeconds += stageSeconds[s];
+    }
+    fprintf(stderr, "total       %10.1f  %12.2f\n", totalSeconds * 1e9 / ((double)n * repeat),
+            (double)n * repeat / totalSeconds / 1e6);
+
+    if (recordPath) {
+        FILE* f = fopen(recordPath, "wb");
+        if (!f) return 2;
+        fwrite(output.data(), 1, output.size(), f);
+        fclose(f);
+    }
+    if (goldenPath) {
+        std::string expected;
+        if (!readFile(goldenPath, expected)) {
+            fprintf(stderr, "no se pudo leer la referencia %s\n", goldenPath);
+            return 2;
+        }
+        size_t differing = diffOutputs(expected, output);
+        if (differing) {
+            fprintf(stderr, "DIFERENCIAS: %zu renglones\n", differing);
+            return 1;
+        }
+        fprintf(stderr, "OK: salida idéntica a %s (%zu bytes)\n", goldenPath, output.size());
+    } else if (!recordPath) {
+        fwrite(output.data(), 1, output.size(), stdout);
+    }
+    return 0;
+}
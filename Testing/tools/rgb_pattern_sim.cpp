@@ -0,0 +1,121 @@
+/*
+  Línea de tiempo del motor de patrones del LED (build nativo)
+
+  Compilar desde Testing/:
+    g++ -O2 -std=gnu++14 -Isrc tools/rgb_pattern_sim.cpp -o rgb_pattern_sim
+
+  Encola la secuencia de inicio de main.cpp y un código de error, avanza un
+  reloj simulado con pasos irregulares de 1 a SIM_MAX_STEP_MS (como un loop()
+  con carga variable) e imprime cada cambio de color. Comprueba, con
+  SIM_SEEDS semillas distintas:
+  - cada cambio cae en el primer paso en o después de su múltiplo esperado
+    de la duración de cada patrón (tabla expected), sin acumular el jitter
+  - RgbOutputState (el que usa PortentaRGB) pide escribir solo los canales
+    que cambiaron, y nada mientras el color se mantiene
+
+  Devuelve 1 si falla alguna comprobación.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "rgb_pattern.h"
+
+#define SIM_END_MS       10000
+#define SIM_MAX_STEP_MS  7
+#define SIM_SEEDS        20
+
+struct Transition {
+    uint32_t atMs;
+    RGBColor color;
+    bool fromPattern;
+};
+
+static const RGBColor blue = {0, 0, 255}, magenta = {255, 0, 255}, green = {0, 255, 0};
+static const RGBColor white = {255, 255, 255}, red = {255, 0, 0}, black = {0, 0, 0};
+static const RGBColor status = {0, 255, 0};   // Color de estado cuando no hay patrón
+
+// Inicio (3 x 500 ms), parpadeo 3 x (200 + 200) desde 1500 y código de 3
+// pulsos (200 + 300 cada uno, 1500 de pausa: ciclo de 3000) dos veces desde 2700
+static const Transition expected[] = {
+    {0, blue, true},     {500, magenta, true}, {1000, green, true},
+    {1500, white, true}, {1700, black, true},  {1900, white, true}, {2100, black, true},
+    {2300, white, true}, {2500, black, true},
+    {2700, red, true},   {2900, black, true},  {3200, red, true},   {3400, black, true},
+    {3700, red, true},   {3900, black, true},
+    {5700, red, true},   {5900, black, true},  {6200, red, true},   {6400, black, true},
+    {6700, red, true},   {6900, black, true},
+    {8700, status, false},
+};
+#define EXPECTED_CHANGES (sizeof(expected) / sizeof(expected[0]))
+
+static int failures = 0;
+
+static void check(bool ok, unsigned seed, const char* what) {
+    if (!ok) {
+        if (failures < 10) printf("  FALLA (semilla %u): %s\n", seed, what);
+        failures++;
+    }
+}
+
+static void runSeed(unsigned seed, bool print) {
+    srand(seed);
+    RgbPatternQueue queue;
+    queue.push(RgbPattern::solid(blue, 500));
+    queue.push(RgbPattern::solid(magenta, 500));
+    queue.push(RgbPattern::solid(green, 500));
+    queue.push(RgbPattern::blink(white, 200, 200, 3));
+    queue.push(RgbPattern::errorCode(red, 3, 2));
+
+    RgbOutputState output;
+    RGBColor shown = {1, 2, 3};
+    bool first = true;
+    uint32_t changes = 0, writes = 0, channelWrites = 0;
+    char what[96];
+    for (uint32_t now = 0; now < SIM_END_MS; now += 1 + rand() % SIM_MAX_STEP_MS) {
+        RGBColor color;
+        bool fromPattern = queue.render(now, &color);
+        if (!fromPattern) color = status;
+
+        // Lo que escribiría PortentaRGB::write() en este paso
+        uint8_t mask = output.update(color);
+        uint8_t differing = first ? RGB_CHANNEL_ALL
+                                  : (color.red != shown.red ? RGB_CHANNEL_RED : 0) |
+                                        (color.green != shown.green ? RGB_CHANNEL_GREEN : 0) |
+                                        (color.blue != shown.blue ? RGB_CHANNEL_BLUE : 0);
+        snprintf(what, sizeof(what), "canales escritos %#x en %u ms, cambiaron %#x", mask, (unsigned)now,
+                 differing);
+        check(mask == differing, seed, what);
+        if (mask) writes++;
+        channelWrites += ((mask >> 0) & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1);
+
+        if (first || !sameColor(color, shown)) {
+            if (print) {
+                printf("%6u ms  %3u %3u %3u  %s\n", (unsigned)now, color.red, color.green, color.blue,
+                       fromPattern ? "patron" : "estado");
+            }
+            if (changes < EXPECTED_CHANGES) {
+                const Transition& e = expected[changes];
+                snprintf(what, sizeof(what), "cambio %u en %u ms, esperado en %u ms", (unsigned)changes,
+                         (unsigned)now, (unsigned)e.atMs);
+                check(now >= e.atMs && now < e.atMs + SIM_MAX_STEP_MS, seed, what);
+                snprintf(what, sizeof(what), "cambio %u con otro color", (unsigned)changes);
+                check(sameColor(color, e.color) && fromPattern == e.fromPattern, seed, what);
+            }
+            shown = color;
+            first = false;
+            changes++;
+        }
+    }
+    snprintf(what, sizeof(what), "%u cambios, esperados %u", (unsigned)changes, (unsigned)EXPECTED_CHANGES);
+    check(changes == EXPECTED_CHANGES, seed, what);
+    check(writes == changes, seed, "escrituras sin cambio de color");
+    if (print) printf("cambios: %u, escrituras de canal: %u\n", (unsigned)changes, (unsigned)channelWrites);
+}
+
+int main(int argc, char** argv) {
+    unsigned seed = argc > 1 ? (unsigned)atoi(argv[1]) : 1;
+    runSeed(seed, true);
+    for (unsigned s = seed + 1; s < seed + SIM_SEEDS; s++) runSeed(s, false);
+    printf("%s\n", failures ? "FALLA" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,179 @@
+/*
+  Prueba de los agregados de rollup.h contra una referencia exacta (build nativo)
+
+  Compilar desde Testing/:
+    g++ -O2 -std=gnu++14 -Isrc tools/rollup_check.cpp -o rollup_check
+
+  Una hora y un poco más de señal sintética a 2 kHz (con jitter en los
+  timestamps, el desborde de micros() a mitad de la hora y picos fuera del
+  rango del histograma) pasa por RollupCascade. En paralelo se guardan todas
+  las muestras de cada ventana de 1 s, 1 min y 1 h y, al emitirse cada nivel,
+  se compara con lo exacto:
+  - count, min y max iguales
+  - media y varianza (Welford en el nivel 0, fusión de Chan en 1 min y 1 h)
+    contra el cálculo en dos pasadas en double
+  - p50/p95/p99 contra la muestra de ese rango en la ventana ordenada, con
+    error de a lo sumo un bin (3 mbar) dentro del rango
+    y el min/max exacto en las colas de afuera
+  - el histograma fusionado de cada nivel es el mismo que cargar todas sus
+    muestras en uno solo
+
+  Devuelve 1 si falla alguna comprobación.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include "rollup.h"
+
+#define CHECK_RATE_US       500
+#define CHECK_JITTER_US     40
+#define CHECK_SECONDS       (3600 + 30)
+#define CHECK_START_US      (0xFFFFFFFFu - 1800u * 1000000u)   // micros() desborda a la media hora
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    if (!ok) {
+        if (failures < 10) printf("  FALLA: %s\n", what);
+        failures++;
+    }
+}
+
+static uint32_t lcgState = 99;
+
+static uint32_t lcg() {
+    lcgState = lcgState * 1664525u + 1013904223u;
+    return lcgState >> 8;
+}
+
+static float noise() {
+    return ((float)(lcg() & 0xFFFF) / 65536.0f - 0.5f) * 6.0f;
+}
+
+// Succión que recorre casi todo el rango, con picos fuera de él
+static float signal(uint64_t n) {
+    float t = (float)n * CHECK_RATE_US * 1e-6f;
+    float value = -220.0f + 150.0f * sinf(t * 0.05f) + 40.0f * sinf(t * 7.0f) + noise();
+    uint32_t r = lcg() % 20000;
+    if (r == 0) value = -580.0f - (float)(lcg() % 50);   // Por debajo de ROLLUP_MIN_MBAR
+    if (r == 1) value = 55.0f + (float)(lcg() % 20);      // Por encima de ROLLUP_MAX_MBAR
+    return value;
+}
+
+// Muestras exactas de la ventana abierta de cada nivel
+static std::vector<float> windows[ROLLUP_LEVELS];
+static uint32_t emitted[ROLLUP_LEVELS];
+static double maxQuantileError = 0.0;
+static double maxMeanError = 0.0;
+static double maxVarianceError = 0.0;
+
+static float exactQuantile(std::vector<float>& sorted, float q) {
+    size_t rank = (size_t)ceil(q * sorted.size());
+    if (rank < 1) rank = 1;
+    return sorted[rank - 1];
+}
+
+static void compare(uint8_t level, const Rollup& r) {
+    std::vector<float>& samples = windows[level];
+    emitted[level]++;
+    check(r.count == samples.size(), "count distinto");
+    if (r.count != samples.size() || samples.empty()) return;
+
+    double sum = 0.0;
+    for (float v : samples) sum += v;
+    double mean = sum / samples.size();
+    double m2 = 0.0;
+    for (float v : samples) m2 += ((double)v - mean) * ((double)v - mean);
+    double variance = samples.size() > 1 ? m2 / (samples.size() - 1) : 0.0;
+
+    std::vector<float> sorted(samples);
+    std::sort(sorted.begin(), sorted.end());
+    check(r.minValue == sorted.front() && r.maxValue == sorted.back(), "min/max distintos");
+
+    double meanError = fabs(r.mean - mean);
+    double varianceError = fabs(r.variance() - variance) / variance;
+    if (meanError > maxMeanError) maxMeanError = meanError;
+    if (varianceError > maxVarianceError) maxVarianceError = varianceError;
+    check(meanError < 1e-9 * fabs(mean) + 1e-9, "media distinta de la exacta");
+    check(varianceError < 1e-5, "varianza distinta de la exacta");
+
+    const float width = (ROLLUP_MAX_MBAR - ROLLUP_MIN_MBAR) / ROLLUP_BINS;
+    const float qs[] = {0.0f, 0.001f, 0.5f, 0.95f, 0.99f, 0.9999f, 1.0f};
+    for (float q : qs) {
+        float exact = exactQuantile(sorted, q);
+        float estimate = r.quantile(q);
+        double error = fabs((double)estimate - exact);
+        if (exact < ROLLUP_MIN_MBAR || exact >= ROLLUP_MAX_MBAR) {
+            // Cola fuera del rango: el valor observado del extremo
+            check(estimate == (exact < ROLLUP_MIN_MBAR ? r.minValue : r.maxValue), "cola fuera del rango");
+            continue;
+        }
+        if (error > maxQuantileError) maxQuantileError = error;
+        check(error <= width * 1.0001f, "percentil a más de un bin del exacto");
+    }
+
+    // Histograma fusionado == histograma de todas las muestras
+    QuantileSketch direct;
+    direct.reset();
+    for (float v : samples) direct.add(v);
+    bool same = direct.below == r.sketch.below && direct.above == r.sketch.above;
+    for (int i = 0; i < ROLLUP_BINS; i++) same = same && direct.bins[i] == r.sketch.bins[i];
+    check(same, "histograma fusionado distinto del directo");
+
+    samples.clear();
+}
+
+int main() {
+    printf("Cascada 1 s / 1 min / 1 h, %d s a 2 kHz\n", CHECK_SECONDS);
+    RollupCascade cascade(compare);
+
+    // Réplica de la regla de cierre del nivel 0 en tiempo sin desborde
+    uint64_t windowStart = 0;
+    bool open = false;
+    uint32_t closes[ROLLUP_LEVELS] = {0};
+    uint32_t secondsClosed = 0;
+    const uint64_t samples = (uint64_t)CHECK_SECONDS * 1000000u / CHECK_RATE_US;
+
+    for (uint64_t n = 0; n < samples; n++) {
+        uint64_t t = n * CHECK_RATE_US + lcg() % CHECK_JITTER_US;
+        float value = signal(n);
+        uint32_t timestampUs = (uint32_t)(CHECK_START_US + t);
+
+        if (open && t - windowStart >= ROLLUP_BASE_US) {
+            // Lo que cierra la cascada en este add(): las muestras de la
+            // ventana de cada nivel que se cierra pasan al siguiente
+            for (uint8_t level = 0; level < ROLLUP_LEVELS; level++) {
+                bool closing = level == 0 || closes[level] + 1 >= ROLLUP_FANOUT;
+                if (!closing) {
+                    closes[level]++;
+                    break;
+                }
+                if (level + 1 < ROLLUP_LEVELS) {
+                    windows[level + 1].insert(windows[level + 1].end(), windows[level].begin(), windows[level].end());
+                }
+                if (level > 0) closes[level] = 0;
+            }
+            secondsClosed++;
+            open = false;
+        }
+        if (!open) {
+            windowStart = t;
+            open = true;
+        }
+        cascade.add(timestampUs, value);
+        windows[0].push_back(value);
+    }
+
+    printf("   emitidos: %u de 1 s, %u de 1 min, %u de 1 h\n", emitted[0], emitted[1], emitted[2]);
+    printf("   error máximo: percentil %.3f mbar (bin %.1f mbar), media %.2e mbar, varianza %.2e relativa\n",
+           maxQuantileError, (ROLLUP_MAX_MBAR - ROLLUP_MIN_MBAR) / ROLLUP_BINS, maxMeanError, maxVarianceError);
+    // Cada ventana de 1 s empieza en su primera muestra: con el jitter dura
+    // algo más de 1 s y en la hora entran un poco menos de 3600
+    check(secondsClosed >= 3600 && emitted[0] == secondsClosed && emitted[1] == secondsClosed / ROLLUP_FANOUT &&
+          emitted[2] == 1, "ventanas emitidas");
+    printf("%s\n", failures ? "FALLA" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,423 @@
+/*
+  Simulación en tiempo simulado del planificador de loop() (build nativo)
+
+  Compilar desde Testing/:
+    g++ -O2 -std=gnu++14 -Isrc tools/sched_sim.cpp -o sched_sim
+
+  El reloj es un contador de microsegundos que solo avanzan las tareas (con su
+  costo sorteado) y el propio loop. El timer dispara cada 500 us con jitter y,
+  como en el equipo, solo levanta una bandera: si llega otro tick antes de que
+  el loop la vea, la muestra se pierde. Carga sintética sobre la adquisición:
+  - host: comandos del host con llegadas al azar
+  - led, i2c (escaneo del bus) y report (renglones "#..."), periódicas
+  - xcorr: un bloque cada 256 ticks, 5 FFT
+  - flash: bloques del log cada ~60 ms, 2 páginas por bloque
+  - http: un cliente cada ~2 s, pedido y respuesta en ~12 pasos
+
+  1) Con el planificador (task_scheduler.h) y todas las porciones dentro del
+     presupuesto: la adquisición no puede perder plazos ni ticks, y su peor
+     respuesta tiene que quedar bajo la cota de responseBoundUs().
+  2) El loop anterior con la misma carga, todo en secuencia y cada trabajo
+     largo de una vez (sin los delay() del servidor HTTP, que lo harían peor).
+  3) Borrados de sector de SIM_ERASE_US como los hace FlashLog::poll(): una
+     porción solo inicia el borrado y las siguientes consultan busy() sin
+     esperar (la tarea vuelve al próximo periodo). La adquisición no puede
+     perder ticks ni plazos, ninguna porción se pasa y el log no se atrasa.
+  4) Referencia: el mismo borrado hecho de una vez dentro de la porción. El
+     planificador no puede desalojarlo, pero lo cuenta como exceso y los
+     plazos que hace perder quedan contados.
+
+  Devuelve 1 si falla alguna comprobación.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include "task_scheduler.h"
+
+#define SIM_PERIOD_US        500
+#define SIM_SECONDS          60
+#define SIM_END_US           ((uint32_t)SIM_SECONDS * 1000000u)
+#define SIM_JITTER_US        3
+#define SIM_LOOP_US          1         // Costo de una vuelta de loop() sin trabajo
+#define SIM_ERASE_US         30000     // Borrado de un sector de la QSPI (decenas de ms)
+#define SIM_ERASE_EVERY      8         // Páginas por sector: un borrado cada tantas páginas
+#define SIM_FLASH_BACKLOG    8         // Páginas pendientes que entran en los LOG_BUFFERS
+
+// ---- Reloj y azar ----
+
+static uint32_t simNow = 0;
+static uint32_t lcgState = 12345;
+
+static uint32_t simClock() { return simNow; }
+
+static uint32_t lcg() {
+    lcgState = lcgState * 1664525u + 1013904223u;
+    return lcgState >> 8;
+}
+
+// Entero uniforme en [low, high]
+static uint32_t uniform(uint32_t low, uint32_t high) {
+    return low + lcg() % (high - low + 1);
+}
+
+// ---- Timer ----
+
+struct SimTimer {
+    uint32_t nextTickUs;
+    bool flag;
+    uint32_t stampUs;
+    uint32_t ticks;
+    uint32_t lost;
+    uint32_t seen;              // Ticks que el loop ya vio (para contar los pisados)
+
+    void reset() {
+        nextTickUs = SIM_PERIOD_US;
+        flag = false;
+        ticks = lost = seen = 0;
+    }
+
+    // Interrupciones hasta simNow
+    void deliver() {
+        while ((int32_t)(simNow - nextTickUs) >= 0) {
+            if (flag) lost++;
+            flag = true;
+            stampUs = nextTickUs;
+            ticks++;
+            nextTickUs += SIM_PERIOD_US + uniform(0, 2 * SIM_JITTER_US) - SIM_JITTER_US;
+        }
+    }
+};
+
+static SimTimer timer;
+
+// ---- Carga sintética ----
+
+enum EraseMode {
+    ERASE_NONE,
+    ERASE_RESUMABLE,        // eraseStart() y luego busy() en cada porción
+    ERASE_BLOCKING          // Todo el borrado dentro de una porción
+};
+
+struct Load {
+    uint32_t hostNextUs;
+    uint32_t flashNextBlockUs;
+    uint32_t flashOps;          // Operaciones de flash pendientes
+    uint32_t flashDone;
+    uint32_t flashMaxPending;
+    uint32_t eraseEndUs;
+    bool erasing;
+    bool sectorErased;
+    uint32_t httpNextUs;
+    uint32_t httpSteps;         // Pasos que le quedan al cliente en curso
+    uint32_t xcorrTicks;
+    uint32_t xcorrStages;       // Etapas del bloque en curso
+    uint32_t xcorrDue;          // Bloques listos sin procesar (solo en el loop anterior)
+    uint32_t erasesInjected;
+    EraseMode erases;
+
+    void reset(EraseMode eraseMode) {
+        hostNextUs = uniform(0, 20000);
+        flashNextBlockUs = 60000;
+        flashOps = flashDone = flashMaxPending = 0;
+        erasing = sectorErased = false;
+        httpNextUs = 2000000;
+        httpSteps = 0;
+        xcorrTicks = 0;
+        xcorrStages = 0;
+        xcorrDue = 0;
+        erasesInjected = 0;
+        erases = eraseMode;
+    }
+
+    // Llegadas que no dependen del loop (bloques del log, clientes HTTP)
+    void arrivals() {
+        if ((int32_t)(simNow - flashNextBlockUs) >= 0) {
+            flashOps += 2;
+            if (flashOps > flashMaxPending) flashMaxPending = flashOps;
+            flashNextBlockUs += uniform(50000, 70000);
+        }
+        if (httpSteps == 0 && (int32_t)(simNow - httpNextUs) >= 0) {
+            httpSteps = 12;
+            httpNextUs += uniform(1500000, 2500000);
+        }
+    }
+
+    bool hostArrived() {
+        if ((int32_t)(simNow - hostNextUs) < 0) return false;
+        hostNextUs += uniform(2000, 40000);
+        return true;
+    }
+
+    // Una muestra: lectura I2C, filtro, renglón de salida. Devuelve true si
+    // completó un bloque de la correlación.
+    bool acquire() {
+        simNow += uniform(60, 120);
+        if (++xcorrTicks >= 256) {
+            xcorrTicks = 0;
+            return true;
+        }
+        return false;
+    }
+
+    void host() { simNow += uniform(20, 150); }
+    void led() { simNow += uniform(5, 15); }
+    void discovery() { simNow += uniform(25, 35); }
+    void report() { simNow += uniform(50, 280); }
+    void xcorrStage() { simNow += uniform(60, 140); }
+
+    // Una operación de flash como FlashLog::poll(): una página o, al entrar
+    // en un sector, su borrado. Devuelve false si el borrado sigue en curso.
+    bool flashOp() {
+        if (erasing) {
+            simNow += uniform(2, 5);                    // Leer el registro de estado
+            if ((int32_t)(simNow - eraseEndUs) < 0) return false;
+            erasing = false;
+            sectorErased = true;
+        }
+        if (erases != ERASE_NONE && !sectorErased) {
+            erasesInjected++;
+            if (erases == ERASE_RESUMABLE) {
+                simNow += uniform(20, 40);              // Write enable + sector erase
+                eraseEndUs = simNow + SIM_ERASE_US;
+                erasing = true;
+                return true;
+            }
+            simNow += SIM_ERASE_US;
+        }
+        simNow += uniform(150, 280);
+        flashOps--;
+        sectorErased = ++flashDone % SIM_ERASE_EVERY != 0;
+        return true;
+    }
+
+    void httpStep() {
+        simNow += uniform(60, 180);
+        httpSteps--;
+    }
+};
+
+static Load load;
+
+// ---- Tareas para el planificador ----
+
+static TaskScheduler* sched;
+static int taskAcq, taskHost, taskXcorr;
+
+static TaskResult acqTask(void*) {
+    if (load.acquire()) {
+        load.xcorrStages = 5;
+        sched->release(taskXcorr, simNow);
+    }
+    return TASK_DONE;
+}
+
+static TaskResult hostTask(void*) { load.host(); return TASK_DONE; }
+static TaskResult ledTask(void*) { load.led(); return TASK_DONE; }
+static TaskResult discoveryTask(void*) { load.discovery(); return TASK_DONE; }
+static TaskResult reportTask(void*) { load.report(); return TASK_DONE; }
+
+static TaskResult xcorrTask(void*) {
+    if (load.xcorrStages == 0) return TASK_DONE;
+    load.xcorrStage();
+    return --load.xcorrStages > 0 ? TASK_MORE : TASK_DONE;
+}
+
+static TaskResult flashTask(void*) {
+    if (load.flashOps == 0 || !load.flashOp()) return TASK_DONE;
+    return load.flashOps > 0 ? TASK_MORE : TASK_DONE;
+}
+
+static TaskResult httpTask(void*) {
+    if (load.httpSteps == 0) return TASK_DONE;
+    load.httpStep();
+    return load.httpSteps > 0 ? TASK_MORE : TASK_DONE;
+}
+
+// ---- Escenarios ----
+
+struct Result {
+    uint32_t ticks;
+    uint32_t lost;
+    uint32_t misses;
+    uint32_t worstUs;
+    uint32_t boundUs;
+    uint32_t overruns;      // De todas las tareas
+    uint32_t erases;
+    uint32_t flashPages;
+    uint32_t flashMaxPending;
+};
+
+static Result runScheduler(EraseMode erases, bool print) {
+    simNow = 0;
+    timer.reset();
+    load.reset(erases);
+
+    TaskScheduler scheduler(simClock);
+    sched = &scheduler;
+    // Mismos periodos y presupuestos que main.cpp (más http)
+    taskAcq = scheduler.add({"acq", acqTask, nullptr, SIM_PERIOD_US, 150, 0, true, 0});
+    scheduler.add({"i2c", discoveryTask, nullptr, 1000, 40, 0, false, 0});
+    taskHost = scheduler.add({"host", hostTask, nullptr, 1000, 200, 0, true, 0});
+    scheduler.add({"flash", flashTask, nullptr, 10000, 300, 2 * 300, false, 0});
+    scheduler.add({"led", ledTask, nullptr, 10000, 20, 0, false, 0});
+    scheduler.add({"http", httpTask, nullptr, 20000, 200, 12 * 200, false, 0});
+    scheduler.add({"report", reportTask, nullptr, 100000, 300, 0, false, 0});
+    taskXcorr = scheduler.add({"xcorr", xcorrTask, nullptr, 256 * SIM_PERIOD_US, 150, 5 * 150, true, 0});
+
+    while (simNow < SIM_END_US) {
+        timer.deliver();
+        load.arrivals();
+        if (timer.flag) {
+            timer.flag = false;
+            scheduler.release(taskAcq, timer.stampUs, timer.ticks - timer.seen - 1);
+            timer.seen = timer.ticks;
+        }
+        if (load.hostArrived() && !scheduler.active(taskHost)) {
+            scheduler.release(taskHost, simNow);
+        }
+        scheduler.runOnce();
+        simNow += SIM_LOOP_US;
+    }
+
+    Result result = {};
+    result.ticks = timer.ticks;
+    result.lost = timer.lost;
+    result.misses = scheduler.stats(taskAcq).misses;
+    result.worstUs = scheduler.stats(taskAcq).maxResponseUs;
+    result.boundUs = scheduler.responseBoundUs(taskAcq);
+    result.erases = load.erasesInjected;
+    result.flashPages = load.flashDone;
+    result.flashMaxPending = load.flashMaxPending;
+    for (uint8_t id = 0; id < scheduler.taskCount(); id++) result.overruns += scheduler.stats(id).overruns;
+
+    if (print) {
+        printf("  %-7s %4s %8s %7s %6s %6s %10s %11s %9s\n", "tarea", "prio", "trabajos", "porc.",
+               "perd.", "exc.", "postergada", "peor porc.", "peor resp");
+        for (uint8_t id = 0; id < scheduler.taskCount(); id++) {
+            const TaskStats& s = scheduler.stats(id);
+            printf("  %-7s %4u %8u %7u %6u %6u %10u %8u us %6u us\n", scheduler.name(id), scheduler.rank(id),
+                   s.jobs, s.slices, s.misses, s.overruns, s.deferred, s.maxSliceUs, s.maxResponseUs);
+        }
+        printf("  utilización declarada %.1f %%\n", 100.0f * scheduler.utilization());
+    }
+    return result;
+}
+
+// El loop anterior: cada vuelta hace todo lo que haya, en orden fijo
+static Result runSequential() {
+    simNow = 0;
+    timer.reset();
+    load.reset(ERASE_NONE);
+    uint32_t nextLed = 0, nextReport = 0, nextDiscovery = 0;
+
+    Result result = {};
+    while (simNow < SIM_END_US) {
+        timer.deliver();
+        load.arrivals();
+        if (load.hostArrived()) load.host();
+        if ((int32_t)(simNow - nextLed) >= 0) {
+            load.led();
+            nextLed += 10000;
+        }
+        if (timer.flag) {
+            timer.flag = false;
+            uint32_t stamp = timer.stampUs;
+            if (load.acquire()) load.xcorrDue++;
+            uint32_t response = simNow - stamp;
+            if (response > result.worstUs) result.worstUs = response;
+            if (response > SIM_PERIOD_US) result.misses++;
+            if ((int32_t)(simNow - nextDiscovery) >= 0) {
+                load.discovery();
+                nextDiscovery += 1000;
+            }
+        }
+        // Bloque de correlación completo dentro de push()
+        while (load.xcorrDue > 0) {
+            for (int stage = 0; stage < 5; stage++) load.xcorrStage();
+            load.xcorrDue--;
+        }
+        if (load.flashOps > 0 && !timer.flag) load.flashOp();
+        while (load.httpSteps > 0) load.httpStep();     // wifiLedServerLoop() bloqueante
+        if ((int32_t)(simNow - nextReport) >= 0) {
+            load.report();
+            nextReport += 100000;
+        }
+        simNow += SIM_LOOP_US;
+    }
+    result.ticks = timer.ticks;
+    result.lost = timer.lost;
+    return result;
+}
+
+static void printResult(const char* name, const Result& r) {
+    printf("  %-34s ticks %7u  perdidos %5u  plazos %5u  peor %5u us", name, r.ticks, r.lost, r.misses,
+           r.worstUs);
+    if (r.boundUs) printf("  (cota %u us)", r.boundUs);
+    printf("\n");
+}
+
+int main() {
+    int failures = 0;
+
+    printf("1) Planificador, %d s a %d Hz con carga sintética\n", SIM_SECONDS, 1000000 / SIM_PERIOD_US);
+    Result nominal = runScheduler(ERASE_NONE, true);
+    printResult("planificador", nominal);
+    if (nominal.lost != 0 || nominal.misses != 0) {
+        printf("  FALLA: la adquisición perdió ticks o plazos\n");
+        failures++;
+    }
+    if (nominal.boundUs == 0 || nominal.worstUs > nominal.boundUs || nominal.boundUs > SIM_PERIOD_US) {
+        printf("  FALLA: peor respuesta fuera de la cota o cota mayor que el periodo\n");
+        failures++;
+    }
+    if (nominal.overruns != 0) {
+        printf("  FALLA: %u porciones excedieron su presupuesto\n", nominal.overruns);
+        failures++;
+    }
+
+    printf("\n2) Loop anterior con la misma carga\n");
+    Result sequential = runSequential();
+    printResult("secuencial", sequential);
+    if (sequential.lost + sequential.misses == 0) {
+        printf("  (la carga no alcanza para mostrar la diferencia)\n");
+    }
+
+    printf("\n3) Planificador con borrados de %d us reanudables en la flash\n", SIM_ERASE_US);
+    Result resumable = runScheduler(ERASE_RESUMABLE, false);
+    printResult("planificador + borrados", resumable);
+    printf("  borrados %u, páginas %u, máximo pendiente %u páginas\n", resumable.erases, resumable.flashPages,
+           resumable.flashMaxPending);
+    if (resumable.erases == 0 || resumable.flashPages <= (resumable.erases - 1) * SIM_ERASE_EVERY) {
+        printf("  FALLA: no hubo borrados o el log no avanzó\n");
+        failures++;
+    }
+    if (resumable.lost != 0 || resumable.misses != 0) {
+        printf("  FALLA: la adquisición perdió %u ticks y %u plazos durante los borrados\n", resumable.lost,
+               resumable.misses);
+        failures++;
+    }
+    if (resumable.overruns != 0) {
+        printf("  FALLA: %u porciones excedieron su presupuesto\n", resumable.overruns);
+        failures++;
+    }
+    if (resumable.flashMaxPending > SIM_FLASH_BACKLOG) {
+        printf("  FALLA: el log se atrasó más de lo que entra en RAM\n");
+        failures++;
+    }
+
+    printf("\n4) Referencia: el mismo borrado de una vez dentro de la porción\n");
+    Result erase = runScheduler(ERASE_BLOCKING, false);
+    printResult("planificador + borrado bloqueante", erase);
+    printf("  borrados %u, excesos contados %u\n", erase.erases, erase.overruns);
+    if (erase.overruns != erase.erases) {
+        printf("  FALLA: cada borrado tiene que contar como un exceso\n");
+        failures++;
+    }
+    if (erase.erases > 0 && erase.misses < erase.lost) {
+        printf("  FALLA: los ticks perdidos tienen que contar como plazos perdidos\n");
+        failures++;
+    }
+
+    printf("\n%s\n", failures ? "FALLA" : "OK");
+    return failures ? 1 : 0;
+}
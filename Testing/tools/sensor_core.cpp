@@ -0,0 +1,282 @@
+/*
+  Biblioteca compartida con los kernels del firmware para Python (build nativo)
+
+  Compilar desde Testing/:
+    g++ -O2 -std=gnu++14 -shared -fPIC -Isrc tools/sensor_core.cpp -o libsensorcore.so
+  (en Windows con MinGW: -o sensorcore.dll; en macOS: -o libsensorcore.dylib)
+
+  Expone con una ABI de C (para ctypes, sin dependencias de compilación en
+  Python) el mismo código que corre en el dispositivo:
+  - StreamDecoder (stream_decoder.h): renglones de la salida serie a arreglos
+  - SamplePipeline (sample_pipeline.h): filtro IIR y estado de succión
+  - Rollup (rollup.h) y windowKurtosis (window_core.h): momentos y percentiles
+  - FftRadix2 (fft_core.h): tamaños potencia de 2 entre 64 y 8192
+  - un ring de historial con escritura espejada, así las últimas N muestras
+    quedan siempre contiguas y Python las ve como arreglos numpy sin copiar
+
+  Todas las funciones trabajan sobre bloques: una llamada por lectura del
+  puerto o por cuadro de la GUI, no por muestra. El wrapper es sensor_core.py.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <new>
+#include "stream_decoder.h"
+#include "sample_pipeline.h"
+#include "rollup.h"
+#include "window_core.h"
+#include "fft_core.h"
+
+#ifdef _WIN32
+#define SC_API extern "C" __declspec(dllexport)
+#else
+#define SC_API extern "C" __attribute__((visibility("default")))
+#endif
+
+#define SC_ABI_VERSION 2
+
+// Tipos de renglón en los flags del decodificador
+#define SC_FLAG_TIMED  0x01
+
+SC_API int sc_abi_version() {
+    return SC_ABI_VERSION;
+}
+
+// ---- Decodificador ----
+
+SC_API StreamDecoder* sc_decoder_new() {
+    return new (std::nothrow) StreamDecoder();
+}
+
+SC_API void sc_decoder_free(StreamDecoder* decoder) {
+    delete decoder;
+}
+
+// Muestras que puede dar un bloque de 'n' bytes: el renglón de muestra más
+// corto es "1\n" (2 bytes) y el primero puede terminar con un solo '\n' un
+// renglón que empezó en el bloque anterior
+#define SC_DECODER_CAPACITY(n) ((n) / 2 + 1)
+
+// Decodifica 'n' bytes. Las muestras van a us/value/flags, que deben tener
+// lugar para SC_DECODER_CAPACITY(n) ('capacity'; con menos no se consume nada
+// y se devuelve SIZE_MAX) y los renglones de metadatos a 'meta', separados
+// por '\n' (hasta metaCapacity; los que no entran se descartan). Devuelve la
+// cantidad de muestras.
+SC_API size_t sc_decoder_feed(StreamDecoder* decoder, const char* data, size_t n,
+                              uint32_t* us, float* value, uint8_t* flags, size_t capacity,
+                              char* meta, size_t metaCapacity, size_t* metaLength) {
+    if (metaLength) *metaLength = 0;
+    if (capacity < SC_DECODER_CAPACITY(n)) return SIZE_MAX;
+    size_t count = 0;
+    size_t metaUsed = 0;
+    decoder->feed(data, n, [&](DecodedKind kind, const DecodedSample& sample) {
+        if (kind == DECODED_SAMPLE) {
+            us[count] = sample.us;
+            value[count] = sample.value;
+            flags[count] = sample.timed ? SC_FLAG_TIMED : 0;
+            count++;
+        } else if (kind == DECODED_META && meta) {
+            size_t length = strlen(decoder->line);
+            if (metaUsed + length + 1 <= metaCapacity) {
+                memcpy(&meta[metaUsed], decoder->line, length);
+                metaUsed += length;
+                meta[metaUsed++] = '\n';
+            }
+        }
+    });
+    if (metaLength) *metaLength = metaUsed;
+    return count;
+}
+
+// lines, samples, errors, metadata, other
+SC_API void sc_decoder_counters(const StreamDecoder* decoder, uint32_t* out) {
+    out[0] = decoder->lines;
+    out[1] = decoder->samples;
+    out[2] = decoder->errors;
+    out[3] = decoder->metadata;
+    out[4] = decoder->other;
+}
+
+SC_API float sc_decoder_rate_hz(const StreamDecoder* decoder) {
+    return decoder->rateHz();
+}
+
+// ---- Ring de historial ----
+
+// Cada muestra se escribe en i y en i + capacity: la ventana de las últimas
+// 'size' muestras siempre está contigua a partir de 'start'
+struct HistoryRing {
+    size_t capacity;
+    size_t write;
+    size_t size;
+    double* times;
+    float* values;
+};
+
+SC_API HistoryRing* sc_ring_new(size_t capacity) {
+    if (capacity == 0) return nullptr;
+    HistoryRing* ring = new (std::nothrow) HistoryRing();
+    if (!ring) return nullptr;
+    ring->capacity = capacity;
+    ring->write = 0;
+    ring->size = 0;
+    ring->times = new (std::nothrow) double[2 * capacity];
+    ring->values = new (std::nothrow) float[2 * capacity];
+    if (!ring->times || !ring->values) {
+        delete[] ring->times;
+        delete[] ring->values;
+        delete ring;
+        return nullptr;
+    }
+    return ring;
+}
+
+SC_API void sc_ring_free(HistoryRing* ring) {
+    if (!ring) return;
+    delete[] ring->times;
+    delete[] ring->values;
+    delete ring;
+}
+
+SC_API void sc_ring_push(HistoryRing* ring, const double* times, const float* values, size_t n) {
+    // De un bloque más largo que el ring solo quedan las últimas muestras
+    if (n > ring->capacity) {
+        times += n - ring->capacity;
+        values += n - ring->capacity;
+        n = ring->capacity;
+    }
+    for (size_t i = 0; i < n; i++) {
+        size_t w = ring->write;
+        ring->times[w] = ring->times[w + ring->capacity] = times[i];
+        ring->values[w] = ring->values[w + ring->capacity] = values[i];
+        ring->write = w + 1 == ring->capacity ? 0 : w + 1;
+    }
+    ring->size = ring->size + n > ring->capacity ? ring->capacity : ring->size + n;
+}
+
+SC_API void sc_ring_clear(HistoryRing* ring) {
+    ring->write = 0;
+    ring->size = 0;
+}
+
+SC_API size_t sc_ring_size(const HistoryRing* ring) {
+    return ring->size;
+}
+
+// Índice de la muestra más antigua de la ventana en los arreglos espejados
+static size_t ringStart(const HistoryRing* ring) {
+    return ring->size < ring->capacity ? 0 : ring->write;
+}
+
+// Punteros a la ventana (válidos hasta el próximo push)
+SC_API const double* sc_ring_times(const HistoryRing* ring) {
+    return &ring->times[ringStart(ring)];
+}
+
+SC_API const float* sc_ring_values(const HistoryRing* ring) {
+    return &ring->values[ringStart(ring)];
+}
+
+// Primer índice de la ventana con tiempo >= since (búsqueda binaria; los
+// tiempos se agregan en orden)
+SC_API size_t sc_ring_lower_bound(const HistoryRing* ring, double since) {
+    const double* t = sc_ring_times(ring);
+    size_t low = 0;
+    size_t high = ring->size;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (t[mid] < since) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+// ---- Pipeline de muestra ----
+
+struct PipelineHandle {
+    SamplePipeline pipeline;
+    RuntimeConfig config;
+};
+
+SC_API PipelineHandle* sc_pipeline_new() {
+    PipelineHandle* handle = new (std::nothrow) PipelineHandle();
+    if (handle) handle->config = defaultRuntimeConfig();
+    return handle;
+}
+
+SC_API void sc_pipeline_free(PipelineHandle* handle) {
+    delete handle;
+}
+
+SC_API void sc_pipeline_configure(PipelineHandle* handle, float filterAlpha, float suctionLowMax,
+                                  float suctionMediumMax) {
+    handle->config.filterAlpha = filterAlpha;
+    handle->config.suctionLowMax = suctionLowMax;
+    handle->config.suctionMediumMax = suctionMediumMax;
+}
+
+SC_API void sc_pipeline_reset(PipelineHandle* handle) {
+    handle->pipeline.reset();
+}
+
+// Procesa 'n' valores en mbar (SUCTION_ERROR_VALUE = lectura fallida): valor
+// filtrado y SuctionStatus por muestra
+SC_API void sc_pipeline_process(PipelineHandle* handle, const float* mbar, size_t n, float* out,
+                                uint8_t* status) {
+    for (size_t i = 0; i < n; i++) {
+        SampleResult result = handle->pipeline.process(mbar[i], handle->config);
+        out[i] = result.value;
+        status[i] = result.status;
+    }
+}
+
+// ---- Momentos ----
+
+// count, min, max, media, varianza, p50, p95, p99 con el agregado del firmware
+SC_API void sc_rollup(const float* values, size_t n, double* out) {
+    Rollup rollup;
+    rollup.reset();
+    for (size_t i = 0; i < n; i++) rollup.add(0, values[i]);
+    out[0] = rollup.count;
+    out[1] = rollup.minValue;
+    out[2] = rollup.maxValue;
+    out[3] = rollup.mean;
+    out[4] = rollup.variance();
+    out[5] = rollup.quantile(0.50f);
+    out[6] = rollup.quantile(0.95f);
+    out[7] = rollup.quantile(0.99f);
+}
+
+// Curtosis de la ventana como la calcula window_analysis (datos enteros)
+SC_API float sc_window_kurtosis(const int32_t* data, size_t n) {
+    static_assert(sizeof(int) == sizeof(int32_t), "windowKurtosis trabaja con int");
+    return windowKurtosis(reinterpret_cast<const int*>(data), n);
+}
+
+// ---- FFT ----
+
+template <size_t N>
+static void fftFixed(float* re, float* im, bool inverse) {
+    static const FftRadix2<N> fft;
+    fft.transform(re, im, inverse);
+}
+
+// FFT compleja en el lugar (la inversa sin escalar, como FftRadix2).
+// -1 si n no es una potencia de 2 entre 64 y 8192.
+SC_API int sc_fft(float* re, float* im, size_t n, int inverse) {
+    switch (n) {
+        case 64:   fftFixed<64>(re, im, inverse != 0); return 0;
+        case 128:  fftFixed<128>(re, im, inverse != 0); return 0;
+        case 256:  fftFixed<256>(re, im, inverse != 0); return 0;
+        case 512:  fftFixed<512>(re, im, inverse != 0); return 0;
+        case 1024: fftFixed<1024>(re, im, inverse != 0); return 0;
+        case 2048: fftFixed<2048>(re, im, inverse != 0); return 0;
+        case 4096: fftFixed<4096>(re, im, inverse != 0); return 0;
+        case 8192: fftFixed<8192>(re, im, inverse != 0); return 0;
+        default:   return -1;
+    }
+}
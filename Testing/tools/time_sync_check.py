@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""
+Prueba de ClockSync con un reloj de dispositivo que deriva y cruza el desborde
+de micros() (2^32 us)
+
+Ejecutar desde Testing/:
+    python3 tools/time_sync_check.py
+
+El reloj del dispositivo arranca 20 s antes del desborde y corre 80 ppm más
+rápido que el del host. Cada 0.5 s se hace un ping con RTT al azar (a veces
+con buffering de varios ms) y las muestras (2 kHz) llegan en lotes de 100 con
+la demora del USB, de modo que hay lotes que llegan después de un ping que ya
+cruzó el desborde con muestras de antes, y lotes que lo cruzan por dentro.
+También se convierten muestras antes del primer ping (deben dar None sin
+alterar nada).
+
+Se verifica que ninguna muestra quede desplazada una vuelta (71.6 min), el
+error máximo contra el tiempo real de cada muestra y la deriva estimada.
+"""
+
+import os
+import random
+import sys
+
+import numpy as np
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
+from time_sync import MICROS_WRAP, ClockSync  # noqa: E402
+
+DRIFT_PPM = 80.0
+START_BEFORE_WRAP_S = 20.0
+DURATION_S = 60.0
+RATE_HZ = 2000
+BATCH = 100
+PING_PERIOD_S = 0.5
+SETTLE_S = 3.0          # Primeros pings: la recta todavía no converge
+MAX_ERROR_S = 0.5e-3
+
+
+def device_us(host_s):
+    """Contador micros() de 32 bits para un instante del host"""
+    start = MICROS_WRAP - int(START_BEFORE_WRAP_S * 1e6)
+    return (start + int(round(host_s * (1.0 + DRIFT_PPM * 1e-6) * 1e6))) % MICROS_WRAP
+
+
+def main():
+    random.seed(1)
+    sync = ClockSync()
+    failures = []
+
+    # Muestras antes del primer ping
+    early = [device_us(0.001 * k) for k in range(10)]
+    if sync.to_host(early[0]) is not None or sync.to_host_array(early) is not None:
+        failures.append("conversión antes del primer SYNC no devolvió None")
+
+    # Eventos en orden de llegada al host: pings y lotes de muestras
+    events = []
+    t = 0.0
+    while t < DURATION_S:
+        rtt = random.uniform(0.2e-3, 1.0e-3)
+        if random.random() < 0.2:
+            rtt += random.uniform(2e-3, 20e-3)
+        events.append((t + rtt, "ping", t, rtt))
+        t += PING_PERIOD_S
+    n_batches = int(DURATION_S * RATE_HZ) // BATCH
+    for b in range(n_batches):
+        times = (b * BATCH + np.arange(BATCH)) / RATE_HZ
+        arrival = times[-1] + random.uniform(1e-3, 60e-3)
+        events.append((arrival, "batch", times, None))
+    events.sort(key=lambda e: e[0])
+
+    max_error = 0.0
+    wrapped = 0
+    straddled = 0
+    for arrival, kind, payload, rtt in events:
+        if kind == "ping":
+            send = payload
+            # El dispositivo responde a mitad del viaje (con asimetría al azar)
+            reply = send + rtt * random.uniform(0.4, 0.6)
+            sync.add_exchange(send, device_us(reply), send + rtt)
+            continue
+        true_s = payload
+        us = np.array([device_us(x) for x in true_s], dtype=np.int64)
+        host = sync.to_host_array(us)
+        if host is None:
+            continue
+        if us[0] > us[-1]:
+            straddled += 1
+        if us[-1] < MICROS_WRAP // 2:
+            wrapped += 1
+        single = sync.to_host(int(us[0]))
+        if abs(single - host[0]) > 1e-9:
+            failures.append(f"to_host y to_host_array difieren en t={true_s[0]:.3f} s")
+        if true_s[0] < SETTLE_S:
+            continue
+        error = float(np.max(np.abs(host - true_s)))
+        if error > 1000.0:
+            failures.append(f"lote en t={true_s[0]:.3f} s corrido una vuelta ({error:.0f} s)")
+        max_error = max(max_error, error)
+
+    # ClockSync da segundos de host por segundo de dispositivo
+    expected_ppm = (1.0 / (1.0 + DRIFT_PPM * 1e-6) - 1.0) * 1e6
+    drift_error = abs(sync.drift_ppm - expected_ppm)
+    print(f"Deriva: {expected_ppm:.2f} ppm real, {sync.drift_ppm:.2f} ppm estimada")
+    print(f"Lotes después del desborde: {wrapped}, lotes que lo cruzan: {straddled}")
+    print(f"Error máximo después de {SETTLE_S:.0f} s: {max_error * 1e6:.1f} us (límite {MAX_ERROR_S * 1e6:.0f} us)")
+
+    if wrapped == 0 or straddled == 0:
+        failures.append("la simulación no cruzó el desborde")
+    if max_error > MAX_ERROR_S:
+        failures.append(f"error máximo {max_error * 1e6:.1f} us")
+    if drift_error > 5.0:
+        failures.append(f"deriva con error de {drift_error:.2f} ppm")
+
+    for failure in failures[:10]:
+        print("  " + failure)
+    print("FALLA" if failures else "OK")
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
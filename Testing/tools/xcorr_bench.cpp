@@ -0,0 +1,153 @@
+/*
+  Prueba sintética y medición de throughput de la correlación cruzada (build nativo)
+
+  Compilar desde Testing/:
+    g++ -O2 -std=gnu++14 -Isrc tools/xcorr_bench.cpp -o xcorr_bench
+
+  1) Retardos conocidos: el canal 0 es una suma de senoidales entre 1 y 200 Hz
+     con fases al azar (se puede retrasar una fracción de muestra exacta) y
+     los canales 1..3 son la misma señal retrasada 3.3, 12.75 y 40.4 muestras,
+     con ruido propio. Se reporta el retardo estimado por cada motor y el
+     error; el directo solo cubre hasta XCORR_BENCH_SHORT_LAG muestras.
+     Cada estimación dentro del rango de su motor tiene que ser válida, con
+     error de a lo sumo XCORR_BENCH_MAX_ERROR muestras, y la de la FFT con
+     coherencia de al menos XCORR_BENCH_MIN_COHERENCE.
+  2) Throughput: tiempo de procesar 60 s de 4 canales a 2 kHz con cada motor,
+     en muestras por segundo y como múltiplo del tiempo real (ninguno puede
+     ir más lento que el tiempo real).
+
+  Devuelve 1 si falla alguna comprobación.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "cross_correlation.h"
+
+#define SIM_RATE_HZ           2000.0
+#define SIM_TONES             64
+#define SIM_NOISE             0.2      // Desvío del ruido propio de cada canal (señal ~1)
+#define XCORR_BENCH_WINDOW    512
+#define XCORR_BENCH_SHORT_LAG 16
+#define BENCH_SECONDS         60
+#define XCORR_BENCH_MAX_ERROR 1.0      // Muestras
+#define XCORR_BENCH_MIN_COHERENCE 0.8f
+
+static const double trueDelays[XCORR_MAX_CHANNELS] = {0.0, 3.3, 12.75, 40.4};
+
+static double toneFreq[SIM_TONES], tonePhase[SIM_TONES], toneAmp[SIM_TONES];
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    if (!ok) {
+        printf("  FALLA: %s\n", what);
+        failures++;
+    }
+}
+
+static double uniform() { return rand() / (RAND_MAX + 1.0); }
+
+static double gaussian() {
+    double u1 = uniform() + 1e-12, u2 = uniform();
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+// Señal en el instante t (en muestras, admite fracciones)
+static double signalAt(double t) {
+    double sum = 0.0;
+    for (int i = 0; i < SIM_TONES; i++) {
+        sum += toneAmp[i] * sin(2.0 * M_PI * toneFreq[i] * t / SIM_RATE_HZ + tonePhase[i]);
+    }
+    return sum;
+}
+
+static void makeFrame(long n, float* frame) {
+    for (int c = 0; c < XCORR_MAX_CHANNELS; c++) {
+        frame[c] = (float)(-200.0 + 10.0 * signalAt(n - trueDelays[c]) + 10.0 * SIM_NOISE * gaussian());
+    }
+}
+
+static double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static FftCrossCorrelator<XCORR_BENCH_WINDOW> fftEngine;
+static DirectCorrelator<XCORR_BENCH_SHORT_LAG> directEngine;
+
+int main(int argc, char** argv) {
+    srand(argc > 1 ? (unsigned)atoi(argv[1]) : 1);
+    double norm = 0.0;
+    for (int i = 0; i < SIM_TONES; i++) {
+        toneFreq[i] = 1.0 + 199.0 * uniform();
+        tonePhase[i] = 2.0 * M_PI * uniform();
+        toneAmp[i] = 1.0;
+        norm += 0.5;
+    }
+    for (int i = 0; i < SIM_TONES; i++) toneAmp[i] /= sqrt(norm);
+
+    fftEngine.setChannels(XCORR_MAX_CHANNELS);
+    directEngine.setChannels(XCORR_MAX_CHANNELS);
+
+    // 1) Retardos conocidos (10 s)
+    float frame[XCORR_MAX_CHANNELS];
+    for (long n = 0; n < (long)(10 * SIM_RATE_HZ); n++) {
+        makeFrame(n, frame);
+        fftEngine.push(frame);
+        directEngine.push(frame);
+    }
+    printf("canal  real     fft      err     pico  coher  | directo  err\n");
+    double worstFft = 0.0, worstDirect = 0.0;
+    for (int c = 1; c < XCORR_MAX_CHANNELS; c++) {
+        const DelayEstimate& f = fftEngine.estimate(c);
+        const DelayEstimate& d = directEngine.estimate(c);
+        double errFft = f.delaySamples - trueDelays[c];
+        printf("%d    %6.2f  %7.3f  %+6.3f  %5.3f  %5.3f  |", c, trueDelays[c], f.delaySamples, errFft,
+               f.peak, f.coherence);
+        if (!f.valid) printf(" (fft no válido)");
+        if (fabs(errFft) > worstFft) worstFft = fabs(errFft);
+        if (trueDelays[c] < XCORR_BENCH_SHORT_LAG) {
+            double errDirect = d.delaySamples - trueDelays[c];
+            printf(" %7.3f  %+6.3f%s\n", d.delaySamples, errDirect, d.valid ? "" : " (no válido)");
+            if (fabs(errDirect) > worstDirect) worstDirect = fabs(errDirect);
+            check(d.valid && fabs(errDirect) <= XCORR_BENCH_MAX_ERROR, "retardo del motor directo");
+        } else {
+            printf("   fuera de rango (%s)\n", d.valid ? "válido?" : "no válido");
+        }
+        check(f.valid && fabs(errFft) <= XCORR_BENCH_MAX_ERROR, "retardo de la FFT");
+        check(f.coherence >= XCORR_BENCH_MIN_COHERENCE, "coherencia de la FFT");
+    }
+    printf("peor error: fft %.3f muestras, directo %.3f muestras\n\n", worstFft, worstDirect);
+
+    // 2) Throughput con datos pregenerados (no se mide la síntesis)
+    const long total = (long)(BENCH_SECONDS * SIM_RATE_HZ);
+    float* data = (float*)malloc(sizeof(float) * XCORR_MAX_CHANNELS * total);
+    for (long n = 0; n < total; n++) {
+        for (int c = 0; c < XCORR_MAX_CHANNELS; c++) {
+            data[n * XCORR_MAX_CHANNELS + c] = (float)(10.0 * gaussian());
+        }
+    }
+
+    double start = nowSeconds();
+    for (long n = 0; n < total; n++) fftEngine.push(&data[n * XCORR_MAX_CHANNELS]);
+    double fftSeconds = nowSeconds() - start;
+
+    start = nowSeconds();
+    for (long n = 0; n < total; n++) directEngine.push(&data[n * XCORR_MAX_CHANNELS]);
+    double directSeconds = nowSeconds() - start;
+
+    printf("throughput (%d canales, %d s a %.0f Hz):\n", XCORR_MAX_CHANNELS, BENCH_SECONDS, SIM_RATE_HZ);
+    printf("  fft N=%d:     %.0f ticks/s  (%.0fx tiempo real, %.1f us por bloque)\n", XCORR_BENCH_WINDOW,
+           total / fftSeconds, BENCH_SECONDS / fftSeconds,
+           fftSeconds * 1e6 / (double)(total / FftCrossCorrelator<XCORR_BENCH_WINDOW>::hopSize()));
+    printf("  directo L=%d: %.0f ticks/s  (%.0fx tiempo real)\n", XCORR_BENCH_SHORT_LAG,
+           total / directSeconds, BENCH_SECONDS / directSeconds);
+    check(fftSeconds < BENCH_SECONDS && directSeconds < BENCH_SECONDS, "más lento que el tiempo real");
+    free(data);
+
+    printf("%s\n", failures ? "FALLA" : "OK");
+    return failures ? 1 : 0;
+}